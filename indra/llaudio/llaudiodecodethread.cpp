@@ -0,0 +1,650 @@
+/**
+ * @file llaudiodecodethread.cpp
+ * @brief Vorbis decoding of sound assets on worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llaudiodecodethread.h"
+
+#include "llapr.h"
+#include "llendianswizzle.h"
+#include "llmath.h"
+#include "lltimer.h"
+#include "llvfile.h"
+#include "llvfs.h"
+#include "llvorbisencode.h"
+
+#include "vorbis/codec.h"
+#include "vorbis/vorbisfile.h"
+#include <iterator> //VS2010
+
+static const S32 WAV_HEADER_SIZE = 44;
+
+// This magic value is equivilent to 150MiB of data.
+// Prevents griffers from utilizin a huge xbox sound the size of god to instafry the viewer
+static const size_t MAX_WAV_SIZE = 157286400;
+
+//-----------------------------------------------------------------------------
+// ov_callbacks reading from an LLVorbisDecodeState::Source
+//-----------------------------------------------------------------------------
+
+static size_t source_read(void *ptr, size_t size, size_t nmemb, void *datasource)
+{
+	LLVorbisDecodeState::Source* source = (LLVorbisDecodeState::Source*)datasource;
+	if (!size)
+	{
+		return 0;
+	}
+	size_t bytes = llmin(size * nmemb, source->mData.size() - source->mPos);
+	nmemb = bytes / size;
+	if (nmemb)
+	{
+		memcpy(ptr, &source->mData[source->mPos], nmemb * size);	/*Flawfinder: ignore*/
+		source->mPos += nmemb * size;
+	}
+	return nmemb;
+}
+
+static int source_seek(void *datasource, ogg_int64_t offset, int whence)
+{
+	LLVorbisDecodeState::Source* source = (LLVorbisDecodeState::Source*)datasource;
+
+	S64 origin;
+	switch (whence) {
+	case SEEK_SET:
+		origin = 0;
+		break;
+	case SEEK_END:
+		origin = (S64)source->mData.size();
+		break;
+	case SEEK_CUR:
+		origin = (S64)source->mPos;
+		break;
+	default:
+		llerrs << "Invalid whence argument to source_seek" << llendl;
+		return -1;
+	}
+
+	S64 pos = origin + (S64)offset;
+	if (pos < 0 || pos > (S64)source->mData.size())
+	{
+		return -1;
+	}
+	source->mPos = (size_t)pos;
+	return 0;
+}
+
+static int source_close(void *datasource)
+{
+	// The data belongs to the decode state
+	return 0;
+}
+
+static long source_tell(void *datasource)
+{
+	LLVorbisDecodeState::Source* source = (LLVorbisDecodeState::Source*)datasource;
+	return (long)source->mPos;
+}
+
+//-----------------------------------------------------------------------------
+// LLVorbisDecodeState
+//-----------------------------------------------------------------------------
+
+LLVorbisDecodeState::LLVorbisDecodeState(const LLUUID& uuid, const std::string& out_filename)
+	: mUUID(uuid),
+	  mOutFilename(out_filename),
+	  mVF(NULL),
+	  mCurrentSection(0),
+	  mValid(FALSE),
+	  mDone(FALSE),
+	  mBadData(FALSE),
+	  mStarted(FALSE),
+	  mDecoding(FALSE),
+	  mDecodeTime(0.f),
+	  mAborted(FALSE),
+	  mFinished(FALSE)
+{
+}
+
+LLVorbisDecodeState::LLVorbisDecodeState(const std::string& in_filename, const std::string& out_filename)
+	: mInFilename(in_filename),
+	  mOutFilename(out_filename),
+	  mVF(NULL),
+	  mCurrentSection(0),
+	  mValid(FALSE),
+	  mDone(FALSE),
+	  mBadData(FALSE),
+	  mStarted(FALSE),
+	  mDecoding(FALSE),
+	  mDecodeTime(0.f),
+	  mAborted(FALSE),
+	  mFinished(FALSE)
+{
+}
+
+LLVorbisDecodeState::~LLVorbisDecodeState()
+{
+	if (mVF)
+	{
+		ov_clear(mVF);
+		delete mVF;
+	}
+}
+
+void LLVorbisDecodeState::decode()
+{
+	decodeSome(LLTimer(), F32_MAX);
+}
+
+BOOL LLVorbisDecodeState::decodeSome(const LLTimer& slice_timer, F32 num_secs)
+{
+	LLTimer timer;
+
+	if (!mStarted)
+	{
+		mStarted = TRUE;
+		mDecoding = !mAborted && readSource() && initDecode();
+	}
+
+	if (mDecoding)
+	{
+		try
+		{
+			while (!mAborted && !decodeSection())
+			{
+				// decodeSection does all of the work
+				if (slice_timer.getElapsedTimeF32() >= num_secs)
+				{
+					// Out of time, carry on from here next call
+					mDecodeTime += timer.getElapsedTimeF32();
+					return FALSE;
+				}
+			}
+		}
+		catch (std::bad_alloc)
+		{
+			llwarns << "bad_alloc whilst decoding " << mUUID << llendl;
+			mValid = FALSE;
+			mDone = TRUE;
+		}
+		mDecoding = FALSE;
+
+		if (mAborted)
+		{
+			mValid = FALSE;
+		}
+		else if (!mValid)
+		{
+			// We had an error when decoding, the source is no good.
+			llwarns << mUUID << " has invalid vorbis data, aborting decode" << llendl;
+			mBadData = TRUE;
+		}
+		else
+		{
+			finishDecode();
+		}
+	}
+
+	// Nothing is needed from here on but the flags, free the buffers now
+	// rather than whenever the main thread lets go.
+	if (mVF)
+	{
+		ov_clear(mVF);
+		delete mVF;
+		mVF = NULL;
+	}
+	std::vector<U8>().swap(mSource.mData);
+	std::vector<U8>().swap(mWAVBuffer);
+
+	mDecodeTime += timer.getElapsedTimeF32();
+	return TRUE;
+}
+
+BOOL LLVorbisDecodeState::readSource()
+{
+	S32 size = 0;
+	if (mInFilename.empty())
+	{
+		if (gVFS)
+		{
+			size = gVFS->getSize(mUUID, LLAssetType::AT_SOUND);
+		}
+		if (size > 0)
+		{
+			mSource.mData.resize(size);
+			size = gVFS->getData(mUUID, LLAssetType::AT_SOUND, &mSource.mData[0], 0, size);
+		}
+	}
+	else
+	{
+		size = LLAPRFile::size(mInFilename);
+		if (size > 0)
+		{
+			mSource.mData.resize(size);
+			size = LLAPRFile::readEx(mInFilename, &mSource.mData[0], 0, size);
+		}
+	}
+
+	if (size <= 0)
+	{
+		llwarns << "unable to read vorbis source for " << (mInFilename.empty() ? mUUID.asString() : mInFilename) << llendl;
+		return FALSE;
+	}
+	mSource.mData.resize(size);
+	mSource.mPos = 0;
+	return TRUE;
+}
+
+BOOL LLVorbisDecodeState::initDecode()
+{
+	ov_callbacks source_callbacks;
+	source_callbacks.read_func = source_read;
+	source_callbacks.seek_func = source_seek;
+	source_callbacks.close_func = source_close;
+	source_callbacks.tell_func = source_tell;
+
+	mVF = new OggVorbis_File;
+	int r = ov_open_callbacks(&mSource, mVF, NULL, 0, source_callbacks);
+	if(r < 0) 
+	{
+		llwarns << r << " Input to vorbis decode does not appear to be an Ogg bitstream: " << mUUID << llendl;
+		delete mVF;
+		mVF = NULL;
+		return(FALSE);
+	}
+	
+	S32 sample_count = ov_pcm_total(mVF, -1);
+	size_t size_guess = (size_t)sample_count;
+	vorbis_info* vi = ov_info(mVF, -1);
+	size_guess *= vi->channels;
+	size_guess *= 2;
+	size_guess += 2048;
+	
+	bool abort_decode = false;
+	if (size_guess >= MAX_WAV_SIZE)
+	{
+		llwarns << "Bad sound caught by zmagic" << llendl;
+		abort_decode = true;
+	}
+	else if( vi->channels < 1 || vi->channels > LLVORBIS_CLIP_MAX_CHANNELS )
+	{
+		abort_decode = true;
+		llwarns << "Bad channel count: " << vi->channels << llendl;
+	}
+
+	if( abort_decode )
+	{
+		llwarns << "Canceling initDecode. Bad asset: " << mUUID << llendl;
+		llwarns << "Bad asset encoded by: " << ov_comment(mVF,-1)->vendor << llendl;
+		return FALSE;
+	}
+	
+	try
+	{
+		mWAVBuffer.reserve(size_guess);
+		mWAVBuffer.resize(WAV_HEADER_SIZE);
+	}
+	catch(std::bad_alloc)
+	{
+		llwarns << "bad_alloc" << llendl;
+		return FALSE;
+	}
+
+	{
+		// write the .wav format header
+		//"RIFF"
+		mWAVBuffer[0] = 0x52;
+		mWAVBuffer[1] = 0x49;
+		mWAVBuffer[2] = 0x46;
+		mWAVBuffer[3] = 0x46;
+
+		// length = datalen + 36 (to be filled in later)
+		mWAVBuffer[4] = 0x00;
+		mWAVBuffer[5] = 0x00;
+		mWAVBuffer[6] = 0x00;
+		mWAVBuffer[7] = 0x00;
+
+		//"WAVE"
+		mWAVBuffer[8] = 0x57;
+		mWAVBuffer[9] = 0x41;
+		mWAVBuffer[10] = 0x56;
+		mWAVBuffer[11] = 0x45;
+
+		// "fmt "
+		mWAVBuffer[12] = 0x66;
+		mWAVBuffer[13] = 0x6D;
+		mWAVBuffer[14] = 0x74;
+		mWAVBuffer[15] = 0x20;
+
+		// chunk size = 16
+		mWAVBuffer[16] = 0x10;
+		mWAVBuffer[17] = 0x00;
+		mWAVBuffer[18] = 0x00;
+		mWAVBuffer[19] = 0x00;
+
+		// format (1 = PCM)
+		mWAVBuffer[20] = 0x01;
+		mWAVBuffer[21] = 0x00;
+
+		// number of channels
+		mWAVBuffer[22] = 0x01;
+		mWAVBuffer[23] = 0x00;
+
+		// samples per second
+		mWAVBuffer[24] = 0x44;
+		mWAVBuffer[25] = 0xAC;
+		mWAVBuffer[26] = 0x00;
+		mWAVBuffer[27] = 0x00;
+
+		// average bytes per second
+		mWAVBuffer[28] = 0x88;
+		mWAVBuffer[29] = 0x58;
+		mWAVBuffer[30] = 0x01;
+		mWAVBuffer[31] = 0x00;
+
+		// bytes to output at a single time
+		mWAVBuffer[32] = 0x02;
+		mWAVBuffer[33] = 0x00;
+		 
+		// 16 bits per sample
+		mWAVBuffer[34] = 0x10;
+		mWAVBuffer[35] = 0x00;
+
+		// "data"
+		mWAVBuffer[36] = 0x64;
+		mWAVBuffer[37] = 0x61;
+		mWAVBuffer[38] = 0x74;
+		mWAVBuffer[39] = 0x61;
+
+		// these are the length of the data chunk, to be filled in later
+		mWAVBuffer[40] = 0x00;
+		mWAVBuffer[41] = 0x00;
+		mWAVBuffer[42] = 0x00;
+		mWAVBuffer[43] = 0x00;
+	}
+
+	return TRUE;
+}
+
+BOOL LLVorbisDecodeState::decodeSection()
+{
+	if (mDone)
+	{
+		return TRUE;
+	}
+	char pcmout[4096];	/*Flawfinder: ignore*/
+
+	BOOL eof = FALSE;
+	long ret=ov_read(mVF, pcmout, sizeof(pcmout), 0, 2, 1, &mCurrentSection);
+	if (ret == 0)
+	{
+		/* EOF */
+		eof = TRUE;
+		mDone = TRUE;
+		mValid = TRUE;
+	}
+	else if (ret < 0)
+	{
+		/* error in the stream.  Not a problem, just reporting it in
+		   case we (the app) cares.  In this case, we don't. */
+
+		llwarns << "BAD vorbis decode in decodeSection." << llendl;
+
+		mValid = FALSE;
+		mDone = TRUE;
+		// We're done, return TRUE.
+		return TRUE;
+	}
+	else
+	{
+		/* we don't bother dealing with sample rate changes, etc, but.
+		   you'll have to*/
+		std::copy(pcmout, pcmout+ret, std::back_inserter(mWAVBuffer));
+	}
+	return eof;
+}
+
+BOOL LLVorbisDecodeState::finishDecode()
+{
+	// write "data" chunk length, in little-endian format
+	S32 data_length = mWAVBuffer.size() - WAV_HEADER_SIZE;
+	mWAVBuffer[40] = (data_length) & 0x000000FF;
+	mWAVBuffer[41] = (data_length >> 8) & 0x000000FF;
+	mWAVBuffer[42] = (data_length >> 16) & 0x000000FF;
+	mWAVBuffer[43] = (data_length >> 24) & 0x000000FF;
+	// write overall "RIFF" length, in little-endian format
+	data_length += 36;
+	mWAVBuffer[4] = (data_length) & 0x000000FF;
+	mWAVBuffer[5] = (data_length >> 8) & 0x000000FF;
+	mWAVBuffer[6] = (data_length >> 16) & 0x000000FF;
+	mWAVBuffer[7] = (data_length >> 24) & 0x000000FF;
+
+	//
+	// FUDGECAKES!!! Vorbis encode/decode messes up loop point transitions (pop)
+	// do a cheap-and-cheesy crossfade 
+	//
+	{
+		S16 *samplep;
+		S32 i;
+		S32 fade_length;
+		char pcmout[4096];		/*Flawfinder: ignore*/ 	
+
+		fade_length = llmin((S32)128,(S32)(data_length-36)/8);			
+		if((S32)mWAVBuffer.size() > (WAV_HEADER_SIZE + 2* fade_length))
+		{
+			memcpy(pcmout, &mWAVBuffer[WAV_HEADER_SIZE], (2 * fade_length));	/*Flawfinder: ignore*/
+		}
+		llendianswizzle(&pcmout, 2, fade_length);
+	
+		samplep = (S16 *)pcmout;
+		for (i = 0 ;i < fade_length; i++)
+		{
+			*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
+			samplep++;
+		}
+
+		llendianswizzle(&pcmout, 2, fade_length);			
+		if((WAV_HEADER_SIZE+(2 * fade_length)) < (S32)mWAVBuffer.size())
+		{
+			memcpy(&mWAVBuffer[WAV_HEADER_SIZE], pcmout, (2 * fade_length));	/*Flawfinder: ignore*/
+		}
+		S32 near_end = mWAVBuffer.size() - (2 * fade_length);
+		if ((S32)mWAVBuffer.size() > ( near_end + 2* fade_length))
+		{
+			memcpy(pcmout, &mWAVBuffer[near_end], (2 * fade_length));	/*Flawfinder: ignore*/
+		}
+		llendianswizzle(&pcmout, 2, fade_length);
+
+		samplep = (S16 *)pcmout;
+		for (i = fade_length-1 ; i >=  0; i--)
+		{
+			*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
+			samplep++;
+		}
+	
+		llendianswizzle(&pcmout, 2, fade_length);			
+		if (near_end + (2 * fade_length) < (S32)mWAVBuffer.size())
+		{
+			memcpy(&mWAVBuffer[near_end], pcmout, (2 * fade_length));/*Flawfinder: ignore*/
+		}
+	}
+
+	if (36 == data_length)
+	{
+		llwarns << "BAD Vorbis decode in finishDecode!" << llendl;
+		mValid = FALSE;
+		return TRUE; // we've finished
+	}
+
+	// Write to a temporary name and rename it into place, so nobody looking
+	// for the decoded file (LLAudioEngine::hasDecodedFile()) finds half of it.
+	std::string tmp_filename = mOutFilename + ".tmp";
+	S32 size = (S32)mWAVBuffer.size();
+	if (LLAPRFile::isExist(tmp_filename))
+	{
+		// left over from a crash, writeEx() doesn't truncate
+		LLAPRFile::remove(tmp_filename);
+	}
+	if (LLAPRFile::writeEx(tmp_filename, &mWAVBuffer[0], 0, size) != size ||
+		!LLAPRFile::rename(tmp_filename, mOutFilename))
+	{
+		llwarns << "Unable to write file in LLVorbisDecodeState::finishDecode" << llendl;
+		LLAPRFile::remove(tmp_filename);
+		mValid = FALSE;
+		return TRUE; // we've finished
+	}
+
+	return TRUE;
+}
+
+void LLVorbisDecodeState::flushBadFile()
+{
+	if (mInFilename.empty() && gVFS)
+	{
+		llwarns << "Flushing bad vorbis file from VFS for " << mUUID << llendl;
+		LLVFile file(gVFS, mUUID, LLAssetType::AT_SOUND, LLVFile::WRITE);
+		file.remove();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLAudioDecodeThread
+//-----------------------------------------------------------------------------
+
+// static
+LLAudioDecodeThread::thread_list_t LLAudioDecodeThread::sThreads;
+
+LLAudioDecodeThread::LLAudioDecodeThread(bool threaded)
+	: LLQueuedThread("audiodecode", threaded)
+{
+}
+
+LLAudioDecodeThread::handle_t LLAudioDecodeThread::addDecode(LLVorbisDecodeState* decode, U32 priority)
+{
+	handle_t handle = generateHandle();
+	DecodeRequest* req = new DecodeRequest(handle, priority, decode);
+	if (!addRequest(req))
+	{
+		req->deleteRequest();
+		handle = nullHandle();
+	}
+	return handle;
+}
+
+//static
+void LLAudioDecodeThread::initClass(S32 num_threads, bool threaded)
+{
+	llassert(sThreads.empty());
+	if (!threaded)
+	{
+		// LLAudioDecodeMgr decodes on the main thread a slice at a time
+		// when there are no threads, rather than whole files in update().
+		return;
+	}
+	num_threads = llmax(num_threads, 0);
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		sThreads.push_back(new LLAudioDecodeThread(threaded));
+	}
+}
+
+//static
+S32 LLAudioDecodeThread::updateClass(U32 max_time_ms)
+{
+	S32 pending = 0;
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		pending += (*iter)->update(max_time_ms);
+	}
+	return pending;
+}
+
+//static
+void LLAudioDecodeThread::cleanupClass()
+{
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		LLAudioDecodeThread* thread = *iter;
+		thread->setQuitting();
+		while (thread->getPending())
+		{
+			thread->update(0);
+		}
+		delete thread;
+	}
+	sThreads.clear();
+}
+
+//static
+void LLAudioDecodeThread::queueDecode(LLVorbisDecodeState* decode, U32 priority)
+{
+	LLAudioDecodeThread* best = NULL;
+	S32 best_pending = 0;
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		S32 pending = (*iter)->getPending();
+		if (!best || pending < best_pending)
+		{
+			best = *iter;
+			best_pending = pending;
+		}
+	}
+
+	if (!best || best->addDecode(decode, priority) == nullHandle())
+	{
+		// No threads (or shutting down): decode in place so the caller still gets a result
+		decode->decode();
+		decode->setFinished();
+	}
+}
+
+LLAudioDecodeThread::DecodeRequest::DecodeRequest(handle_t handle, U32 priority, LLVorbisDecodeState* decode)
+	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	  mDecode(decode)
+{
+}
+
+LLAudioDecodeThread::DecodeRequest::~DecodeRequest()
+{
+}
+
+void LLAudioDecodeThread::DecodeRequest::deleteRequest()
+{
+	LLQueuedThread::QueuedRequest::deleteRequest();
+}
+
+// Called from the decode thread (or the main thread when not threaded)
+bool LLAudioDecodeThread::DecodeRequest::processRequest()
+{
+	mDecode->decode();
+	mDecode->setFinished();
+	return true;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file llaudiodecodethread.h
+ * @brief Vorbis decoding of sound assets on worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAUDIODECODETHREAD_H
+#define LL_LLAUDIODECODETHREAD_H
+
+#include <string>
+#include <vector>
+#include "llqueuedthread.h"
+#include "lluuid.h"
+
+struct OggVorbis_File;
+class LLTimer;
+
+//-----------------------------------------------------------------------------
+// LLVorbisDecodeState
+// Decodes one Ogg Vorbis sound to a .wav file. The source is read into
+// memory in one go and the whole decode happens in decode(), which runs on
+// an LLAudioDecodeThread; the main thread only looks at the result once
+// isFinished() is set. Without decode threads the main thread calls
+// decodeSome() instead, a time slice at a time. Sources in the VFS are read with LLVFS::getData(),
+// which is what LLVFSThread uses too: LLVFile isn't safe off the main thread.
+//-----------------------------------------------------------------------------
+class LLVorbisDecodeState : public LLThreadSafeRefCount
+{
+public:
+	// The encoded source, handed to vorbisfile through ov_callbacks.
+	struct Source
+	{
+		Source() : mPos(0) {}
+
+		std::vector<U8>	mData;
+		size_t			mPos;
+	};
+
+	// Decodes the AT_SOUND asset uuid from gVFS.
+	LLVorbisDecodeState(const LLUUID& uuid, const std::string& out_filename);
+	// Decodes an .ogg file on disk. Used by tests and benchmarks.
+	LLVorbisDecodeState(const std::string& in_filename, const std::string& out_filename);
+
+	// Runs on the decode thread.
+	void					decode();
+	// Decodes until done or until slice_timer reaches num_secs. Returns
+	// TRUE once done; call again to carry on otherwise.
+	BOOL					decodeSome(const LLTimer& slice_timer, F32 num_secs);
+	// Makes decode() give up at the next section if it hasn't finished yet.
+	void					abort()					{ mAborted = TRUE; }
+
+	// Set once decode() has returned.
+	BOOL					isFinished()			{ return mFinished ? TRUE : FALSE; }
+	void					setFinished()			{ mFinished = TRUE; }
+
+	BOOL					isValid() const			{ return mValid; }
+	// The source wasn't usable Vorbis data; the main thread should
+	// flushBadFile() it.
+	BOOL					isBadData() const		{ return mBadData; }
+	// Removes the source asset from the VFS. Main thread only.
+	void					flushBadFile();
+	const LLUUID&			getUUID() const			{ return mUUID; }
+	const std::string&		getOutFilename() const	{ return mOutFilename; }
+	F32						getDecodeTime() const	{ return mDecodeTime; }
+
+protected:
+	virtual ~LLVorbisDecodeState();
+
+private:
+	BOOL					readSource();
+	BOOL					initDecode();
+	BOOL					decodeSection(); // Returns TRUE if done.
+	BOOL					finishDecode();
+
+private:
+	LLUUID					mUUID;
+	std::string				mInFilename;		// empty when decoding from the VFS
+	std::string				mOutFilename;
+	Source					mSource;
+	OggVorbis_File*			mVF;
+	S32						mCurrentSection;
+	std::vector<U8>			mWAVBuffer;
+	BOOL					mValid;
+	BOOL					mDone;
+	BOOL					mBadData;
+	BOOL					mStarted;
+	BOOL					mDecoding;			// source read and vorbisfile open
+	F32						mDecodeTime;
+	LLAtomic32<BOOL>		mAborted;
+	LLAtomic32<BOOL>		mFinished;
+};
+
+//-----------------------------------------------------------------------------
+// LLAudioDecodeThread
+// The threads sounds are decoded on. Like LLVFSThread this is a static pool,
+// set up by initClass(); a decode goes to whichever thread has the fewest
+// requests pending, so several sounds decode side by side. With no threads
+// (AudioDecodeThreads 0, or threading off) there is no pool and
+// LLAudioDecodeMgr decodes on the main thread as it always did.
+//-----------------------------------------------------------------------------
+class LLAudioDecodeThread : public LLQueuedThread
+{
+	class DecodeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~DecodeRequest(); // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, U32 priority, LLVorbisDecodeState* decode);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void deleteRequest();
+
+	private:
+		LLPointer<LLVorbisDecodeState> mDecode;
+	};
+
+public:
+	LLAudioDecodeThread(bool threaded = true);
+
+	handle_t				addDecode(LLVorbisDecodeState* decode, U32 priority);
+
+	static void				initClass(S32 num_threads, bool threaded = true);
+	static S32				updateClass(U32 max_time_ms);
+	static void				cleanupClass();
+	static BOOL				isInitialized()			{ return !sThreads.empty(); }
+	// Poll decode->isFinished() from the main thread for the result.
+	static void				queueDecode(LLVorbisDecodeState* decode, U32 priority = PRIORITY_NORMAL);
+
+private:
+	typedef std::vector<LLAudioDecodeThread*> thread_list_t;
+	static thread_list_t	sThreads;
+};
+
+#endif // LL_LLAUDIODECODETHREAD_H
@@ -0,0 +1,368 @@
+/**
+ * @file llaudiodecodethread_test.cpp
+ * @brief LLAudioDecodeThread test cases and decode benchmark.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+// Class to test
+#include "../llaudiodecodethread.h"
+#include "../llvorbisencode.h"
+#include "llapr.h"
+#include "llformat.h"
+#include "llmath.h"
+#include "llvfile.h"
+#include "llvfs.h"
+#include "apr_file_info.h"
+#include "apr_file_io.h"
+// For timer class
+#include "../llcommon/lltimer.h"
+// Tut header
+#include "../test/lltut.h"
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes: 
+// * Add here stubbed implementation of the few classes and methods used in the class to be tested
+// * Add as little as possible (let the link errors guide you)
+// * Do not make any assumption as to how those classes or methods work (i.e. don't copy/paste code)
+// * A simulator for a class can be implemented here. Please comment and document thoroughly.
+
+LLVFS* gVFS = NULL;
+S32 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type) { return 0; }
+S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length) { return 0; }
+
+const S32 LLVFile::READ = 0x00000001;
+const S32 LLVFile::WRITE = 0x00000002;
+LLVFile::LLVFile(LLVFS *vfs, const LLUUID &file_id, const LLAssetType::EType file_type, S32 mode) { }
+LLVFile::~LLVFile() { }
+BOOL LLVFile::remove() { return FALSE; }
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	// Sounds are made by encoding a generated tone with encode_vorbis_file(),
+	// so the tests don't need any assets. The benchmark decodes the .ogg files
+	// in LL_AUDIO_DECODE_BENCH_DIR instead, if it is set.
+	struct audiodecodethread_data
+	{
+		typedef std::vector<LLPointer<LLVorbisDecodeState> > decode_list_t;
+
+		audiodecodethread_data()
+		{
+			const char* tmp_dir = NULL;
+			apr_temp_dir_get(&tmp_dir, gAPRPoolp);
+			mTempDir = tmp_dir ? tmp_dir : ".";
+			mTempDir += "/llaudiodecodethread_test_";
+		}
+
+		~audiodecodethread_data()
+		{
+			LLAudioDecodeThread::cleanupClass();
+			for (std::vector<std::string>::iterator iter = mTempFiles.begin(); iter != mTempFiles.end(); ++iter)
+			{
+				if (LLAPRFile::isExist(*iter))
+				{
+					LLAPRFile::remove(*iter);
+				}
+			}
+		}
+
+		std::string tempFile(const std::string& name)
+		{
+			mTempFiles.push_back(mTempDir + name);
+			return mTempFiles.back();
+		}
+
+		static void putU16(std::vector<U8>& data, U16 value)
+		{
+			data.push_back(value & 0xFF);
+			data.push_back((value >> 8) & 0xFF);
+		}
+
+		static void putU32(std::vector<U8>& data, U32 value)
+		{
+			putU16(data, value & 0xFFFF);
+			putU16(data, (value >> 16) & 0xFFFF);
+		}
+
+		// Writes seconds of a mono 44.1kHz 16 bit tone and encodes it.
+		std::string makeOgg(const std::string& name, F32 seconds, F32 frequency)
+		{
+			const U32 num_samples = (U32)(seconds * LLVORBIS_CLIP_SAMPLE_RATE);
+			std::vector<U8> wav;
+			wav.insert(wav.end(), "RIFF", "RIFF" + 4);
+			putU32(wav, 36 + num_samples * 2);
+			wav.insert(wav.end(), "WAVE", "WAVE" + 4);
+			wav.insert(wav.end(), "fmt ", "fmt " + 4);
+			putU32(wav, 16);
+			putU16(wav, 1);			// PCM
+			putU16(wav, 1);			// mono
+			putU32(wav, LLVORBIS_CLIP_SAMPLE_RATE);
+			putU32(wav, LLVORBIS_CLIP_SAMPLE_RATE * 2);
+			putU16(wav, 2);
+			putU16(wav, 16);
+			wav.insert(wav.end(), "data", "data" + 4);
+			putU32(wav, num_samples * 2);
+			for (U32 i = 0; i < num_samples; i++)
+			{
+				F32 t = (F32)i / LLVORBIS_CLIP_SAMPLE_RATE;
+				putU16(wav, (U16)(S16)(10000.f * sinf(F_TWO_PI * frequency * t)));
+			}
+
+			std::string wav_name = tempFile(name + ".wav");
+			std::string ogg_name = tempFile(name + ".ogg");
+			ensure_equals("write wav", LLAPRFile::writeEx(wav_name, &wav[0], 0, (S32)wav.size()), (S32)wav.size());
+			ensure_equals("encode " + name, encode_vorbis_file(wav_name, ogg_name), LLVORBISENC_NOERR);
+			return ogg_name;
+		}
+
+		static void waitFor(decode_list_t& decodes)
+		{
+			for (decode_list_t::iterator iter = decodes.begin(); iter != decodes.end(); ++iter)
+			{
+				while (!(*iter)->isFinished())
+				{
+					LLAudioDecodeThread::updateClass(1);
+					ms_sleep(1);
+				}
+			}
+		}
+
+		static std::vector<U8> readFile(const std::string& filename)
+		{
+			std::vector<U8> data;
+			S32 size = LLAPRFile::size(filename);
+			if (size > 0)
+			{
+				data.resize(size);
+				data.resize(llmax(LLAPRFile::readEx(filename, &data[0], 0, size), 0));
+			}
+			return data;
+		}
+
+		std::string mTempDir;
+		std::vector<std::string> mTempFiles;
+	};
+	typedef test_group<audiodecodethread_data> audiodecodethread_test;
+	typedef audiodecodethread_test::object audiodecodethread_object;
+	tut::audiodecodethread_test audiodecodethread_testcase("llaudiodecodethread");
+
+	template<> template<>
+	void audiodecodethread_object::test<1>()
+	{
+		// no threads: queueDecode() decodes in place
+		std::string ogg_name = makeOgg("tone", 1.f, 440.f);
+		std::string wav_name = tempFile("tone.dsf");
+		LLPointer<LLVorbisDecodeState> decode = new LLVorbisDecodeState(ogg_name, wav_name);
+		LLAudioDecodeThread::queueDecode(decode);
+
+		ensure("finished", decode->isFinished());
+		ensure("valid", decode->isValid());
+		ensure("not bad", !decode->isBadData());
+		std::vector<U8> wav = readFile(wav_name);
+		ensure("has header", wav.size() > 44 && !strncmp((char*)&wav[0], "RIFF", 4) && !strncmp((char*)&wav[36], "data", 4));
+		U32 data_length = wav[40] | (wav[41] << 8) | (wav[42] << 16) | (wav[43] << 24);
+		ensure_equals("data length", data_length, (U32)wav.size() - 44);
+		ensure("about a second of samples", llabs((S32)(data_length / 2) - (S32)LLVORBIS_CLIP_SAMPLE_RATE) < 2048);
+		ensure("no temporary file left", !LLAPRFile::isExist(wav_name + ".tmp"));
+	}
+
+	template<> template<>
+	void audiodecodethread_object::test<2>()
+	{
+		// not Vorbis, and missing altogether
+		std::string junk_name = tempFile("junk.ogg");
+		std::vector<U8> junk(4096, 0x5A);
+		LLAPRFile::writeEx(junk_name, &junk[0], 0, (S32)junk.size());
+
+		LLPointer<LLVorbisDecodeState> junk_decode = new LLVorbisDecodeState(junk_name, tempFile("junk.dsf"));
+		LLAudioDecodeThread::queueDecode(junk_decode);
+		ensure("junk finished", junk_decode->isFinished());
+		ensure("junk invalid", !junk_decode->isValid());
+		ensure("junk no output", !LLAPRFile::isExist(mTempDir + "junk.dsf"));
+
+		LLPointer<LLVorbisDecodeState> missing_decode = new LLVorbisDecodeState(mTempDir + "missing.ogg", tempFile("missing.dsf"));
+		LLAudioDecodeThread::queueDecode(missing_decode);
+		ensure("missing finished", missing_decode->isFinished());
+		ensure("missing invalid", !missing_decode->isValid());
+	}
+
+	template<> template<>
+	void audiodecodethread_object::test<3>()
+	{
+		// aborted before it ran
+		std::string ogg_name = makeOgg("abort", 1.f, 440.f);
+		LLPointer<LLVorbisDecodeState> decode = new LLVorbisDecodeState(ogg_name, tempFile("abort.dsf"));
+		decode->abort();
+		LLAudioDecodeThread::queueDecode(decode);
+		ensure("finished", decode->isFinished());
+		ensure("invalid", !decode->isValid());
+		ensure("not bad", !decode->isBadData());
+		ensure("no output", !LLAPRFile::isExist(mTempDir + "abort.dsf"));
+	}
+
+	template<> template<>
+	void audiodecodethread_object::test<4>()
+	{
+		// a batch decoded in place and on a pool of threads comes out the same
+		std::vector<std::string> sources;
+		for (S32 i = 0; i < 16; i++)
+		{
+			sources.push_back(makeOgg(llformat("batch%d", i), 2.f, 220.f + 20.f * i));
+		}
+
+		decode_list_t serial;
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			serial.push_back(new LLVorbisDecodeState(sources[i], tempFile(llformat("serial%d.dsf", i))));
+			LLAudioDecodeThread::queueDecode(serial.back());
+		}
+
+		LLAudioDecodeThread::initClass(4, true);
+		decode_list_t pooled;
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			pooled.push_back(new LLVorbisDecodeState(sources[i], tempFile(llformat("pooled%d.dsf", i))));
+			LLAudioDecodeThread::queueDecode(pooled.back());
+		}
+		waitFor(pooled);
+		LLAudioDecodeThread::cleanupClass();
+
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			ensure("valid " + sources[i], serial[i]->isValid());
+			ensure_equals("valid " + sources[i], pooled[i]->isValid(), serial[i]->isValid());
+			ensure("same output " + sources[i], readFile(serial[i]->getOutFilename()) == readFile(pooled[i]->getOutFilename()));
+		}
+	}
+
+	template<> template<>
+	void audiodecodethread_object::test<5>()
+	{
+		// no pool for 0 threads; decodeSome() a slice at a time gives the
+		// same output as a whole decode()
+		LLAudioDecodeThread::initClass(0, true);
+		ensure("no pool", !LLAudioDecodeThread::isInitialized());
+		LLAudioDecodeThread::cleanupClass();
+
+		std::string ogg_name = makeOgg("slice", 2.f, 330.f);
+		LLPointer<LLVorbisDecodeState> whole = new LLVorbisDecodeState(ogg_name, tempFile("whole.dsf"));
+		whole->decode();
+
+		LLPointer<LLVorbisDecodeState> sliced = new LLVorbisDecodeState(ogg_name, tempFile("sliced.dsf"));
+		S32 calls = 1;
+		while (!sliced->decodeSome(LLTimer(), 0.f))
+		{
+			calls++;
+		}
+		ensure("took several slices", calls > 1);
+		ensure("valid", sliced->isValid());
+		ensure("same output", readFile(whole->getOutFilename()) == readFile(sliced->getOutFilename()));
+	}
+
+	template<> template<>
+	void audiodecodethread_object::test<6>()
+	{
+		// Benchmark, run only when LL_RUN_BENCHMARKS is set: decodes a batch
+		// in place and then on a pool of threads, checks both come out the
+		// same, and reports how long each took.
+		if (!getenv("LL_RUN_BENCHMARKS"))
+		{
+			skip("benchmark; set LL_RUN_BENCHMARKS to run it");
+		}
+
+		std::vector<std::string> sources;
+		const char* bench_dir = getenv("LL_AUDIO_DECODE_BENCH_DIR");
+		if (bench_dir)
+		{
+			apr_dir_t* dir = NULL;
+			if (apr_dir_open(&dir, bench_dir, gAPRPoolp) == APR_SUCCESS)
+			{
+				apr_finfo_t info;
+				while (apr_dir_read(&info, APR_FINFO_NAME | APR_FINFO_TYPE, dir) == APR_SUCCESS)
+				{
+					std::string name = info.name;
+					if (info.filetype == APR_REG && name.size() > 4 && name.substr(name.size() - 4) == ".ogg")
+					{
+						sources.push_back(std::string(bench_dir) + "/" + name);
+					}
+				}
+				apr_dir_close(dir);
+			}
+		}
+		if (sources.empty())
+		{
+			for (S32 i = 0; i < 16; i++)
+			{
+				sources.push_back(makeOgg(llformat("bench%d", i), 2.f, 220.f + 20.f * i));
+			}
+		}
+
+		decode_list_t serial;
+		LLTimer timer;
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			serial.push_back(new LLVorbisDecodeState(sources[i], tempFile(llformat("serial%d.dsf", i))));
+			LLAudioDecodeThread::queueDecode(serial.back());
+		}
+		F32 serial_time = timer.getElapsedTimeF32();
+
+		const S32 NUM_THREADS = 4;
+		LLAudioDecodeThread::initClass(NUM_THREADS, true);
+		decode_list_t pooled;
+		timer.reset();
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			pooled.push_back(new LLVorbisDecodeState(sources[i], tempFile(llformat("pooled%d.dsf", i))));
+			LLAudioDecodeThread::queueDecode(pooled.back());
+		}
+		waitFor(pooled);
+		F32 pooled_time = timer.getElapsedTimeF32();
+		LLAudioDecodeThread::cleanupClass();
+
+		for (U32 i = 0; i < sources.size(); i++)
+		{
+			ensure_equals("valid " + sources[i], pooled[i]->isValid(), serial[i]->isValid());
+			ensure("same output " + sources[i], readFile(serial[i]->getOutFilename()) == readFile(pooled[i]->getOutFilename()));
+		}
+
+		llinfos << "Decoded " << sources.size() << " sounds: in place " << serial_time
+				<< "s, " << NUM_THREADS << " threads " << pooled_time << "s" << llendl;
+	}
+}
@@ -70,6 +70,7 @@ LLJoint::LLJoint(const std::string &name, LLJoint *parent)
 	mXform.setScaleChildOffset(TRUE);
 	mXform.setScale(LLVector3(1.0f, 1.0f, 1.0f));
 	mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
+	mUpdateXform = TRUE;
 	mJointNum = 0;
 
 	setName(name);
@@ -121,6 +122,10 @@ void LLJoint::touch(U32 flags)
 		{
 			child_flags |= POSITION_DIRTY;
 		}
+		if ((flags & MATRIX_DIRTY) && !mChildren.empty())
+		{
+			mDirtyFlags |= CHILDREN_DIRTY;
+		}
 
 		for (child_list_t::iterator iter = mChildren.begin();
 			 iter != mChildren.end(); ++iter)
@@ -129,6 +134,25 @@ void LLJoint::touch(U32 flags)
 			joint->touch(child_flags);
 		}
 	}
+
+	if (flags & MATRIX_DIRTY)
+	{
+		setParentsChildrenDirty();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// setParentsChildrenDirty()
+// Marks the way down to this joint for updateWorldMatrixChildren().
+//-----------------------------------------------------------------------------
+void LLJoint::setParentsChildrenDirty()
+{
+	for (LLJoint* parent = mParent;
+		 parent && !(parent->mDirtyFlags & CHILDREN_DIRTY);
+		 parent = parent->mParent)
+	{
+		parent->mDirtyFlags |= CHILDREN_DIRTY;
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -179,6 +203,9 @@ void LLJoint::addChild(LLJoint* joint)
 	joint->mXform.setParent(&mXform);
 	joint->mParent = this;	
 	joint->touch();
+	// a new joint is dirty already, so touch() may not have done this
+	joint->setParentsChildrenDirty();
+	clearSortedJoints();
 }
 
 
@@ -195,6 +222,7 @@ void LLJoint::removeChild(LLJoint* joint)
 		joint->mXform.setParent(NULL);
 		joint->mParent = NULL;
 		joint->touch();
+		clearSortedJoints();
 	}
 }
 
@@ -214,6 +242,7 @@ void LLJoint::removeAllChildren()
 		joint->mParent = NULL;
 		joint->touch();
 	}
+	clearSortedJoints();
 }
 
 
@@ -443,20 +472,70 @@ void LLJoint::updateWorldPRSParent()
 
 //-----------------------------------------------------------------------------
 // updateWorldMatrixChildren()
+// Walks the joints below this one in a flat array, parents first, skipping
+// any subtree that has nothing dirty in it.
 //-----------------------------------------------------------------------------
 void LLJoint::updateWorldMatrixChildren()
 {	
-	if (!this->mUpdateXform) return;
+	if (mSortedJoints.empty())
+	{
+		addSortedJoints(mSortedJoints);
+	}
 
-	if (mDirtyFlags & MATRIX_DIRTY)
+	S32 count = (S32)mSortedJoints.size();
+	for (S32 i = 0; i < count; )
 	{
-		updateWorldMatrix();
+		const SortedJoint& sorted = mSortedJoints[i];
+		LLJoint* joint = sorted.mJoint;
+		if (!joint->mUpdateXform)
+		{
+			// Not ours to update, but if anything down there is still dirty
+			// the joints above have to keep saying so for the next time.
+			if (joint->mDirtyFlags & (MATRIX_DIRTY | CHILDREN_DIRTY))
+			{
+				joint->setParentsChildrenDirty();
+			}
+			i = sorted.mSubtreeEnd;
+		}
+		else if (!(joint->mDirtyFlags & (MATRIX_DIRTY | CHILDREN_DIRTY)))
+		{
+			i = sorted.mSubtreeEnd;
+		}
+		else
+		{
+			joint->updateWorldMatrix();
+			joint->mDirtyFlags &= ~CHILDREN_DIRTY;
+			i++;
+		}
 	}
+}
+
+//-----------------------------------------------------------------------------
+// addSortedJoints()
+//-----------------------------------------------------------------------------
+void LLJoint::addSortedJoints(std::vector<SortedJoint>& joints)
+{
+	S32 index = (S32)joints.size();
+	SortedJoint sorted = { this, 0 };
+	joints.push_back(sorted);
 	for (child_list_t::iterator iter = mChildren.begin();
 		 iter != mChildren.end(); ++iter)
 	{
 		LLJoint* joint = *iter;
-		joint->updateWorldMatrixChildren();
+		joint->addSortedJoints(joints);
+	}
+	joints[index].mSubtreeEnd = (S32)joints.size();
+}
+
+//-----------------------------------------------------------------------------
+// clearSortedJoints()
+// Called when the joints below this one change.
+//-----------------------------------------------------------------------------
+void LLJoint::clearSortedJoints()
+{
+	for (LLJoint* joint = this; joint; joint = joint->mParent)
+	{
+		joint->mSortedJoints.clear();
 	}
 }
 
@@ -469,7 +548,7 @@ void LLJoint::updateWorldMatrix()
 	{
 		sNumUpdates++;
 		mXform.updateMatrix(FALSE);
-		mDirtyFlags = 0x0;
+		mDirtyFlags &= CHILDREN_DIRTY;
 	}
 }
 
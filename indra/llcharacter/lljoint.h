@@ -37,6 +37,7 @@
 // Header Files
 //-----------------------------------------------------------------------------
 #include <string>
+#include <vector>
 
 #include "linked_lists.h"
 #include "v3math.h"
@@ -76,7 +77,9 @@ public:
 		MATRIX_DIRTY = 0x1 << 0,
 		ROTATION_DIRTY = 0x1 << 1,
 		POSITION_DIRTY = 0x1 << 2,
-		ALL_DIRTY = 0x7
+		ALL_DIRTY = 0x7,
+		// set on every joint above one with MATRIX_DIRTY set
+		CHILDREN_DIRTY = 0x1 << 3
 	};
 protected:
 	std::string	mName;
@@ -87,6 +90,20 @@ protected:
 	// explicit transformation members
 	LLXformMatrix		mXform;
 
+	// this joint and all the ones below it, parents before children, as
+	// walked by updateWorldMatrixChildren(). Rebuilt when joints are added
+	// or removed anywhere below.
+	struct SortedJoint
+	{
+		LLJoint*	mJoint;
+		S32			mSubtreeEnd;	// index just past this joint's descendants
+	};
+	std::vector<SortedJoint> mSortedJoints;
+
+	void addSortedJoints(std::vector<SortedJoint>& joints);
+	void clearSortedJoints();
+	void setParentsChildrenDirty();
+
 public:
 	U32				mDirtyFlags;
 	BOOL			mUpdateXform;
@@ -49,6 +49,7 @@
 #include "v3math.h"
 #include "llapr.h"
 #include "llbvhconsts.h"
+#include "lluuidmap.h"
 
 class LLKeyframeDataCache;
 class LLVFS;
@@ -448,7 +449,7 @@ public:
 	LLKeyframeDataCache(){};
 	~LLKeyframeDataCache();
 
-	typedef std::map<LLUUID, class LLKeyframeMotion::JointMotionList*> keyframe_data_map_t; 
+	typedef LLUUIDMap<class LLKeyframeMotion::JointMotionList*> keyframe_data_map_t;
 	static keyframe_data_map_t sKeyframeDataMap;
 
 	static void addKeyframeData(const LLUUID& id, LLKeyframeMotion::JointMotionList*);
@@ -34,6 +34,8 @@
 
 #include "linden_common.h"
 #include "llapr.h"
+#include "llstringtable.h"
+#include "llthread.h"
 
 apr_pool_t *gAPRPoolp = NULL; // Global APR memory pool
 apr_thread_mutex_t *gLogMutexp = NULL;
@@ -55,6 +57,14 @@ void ll_init_apr()
 
 		// Initialize thread-local APR pool support.
 		LLVolatileAPRPool::initLocalAPRFilePool();
+
+		// Per thread fast timer counters and event traces.
+		LLThreadRecord::initClass();
+		LLFastTimer::initClass();
+		LLEventTrace::initClass();
+
+		// Lets worker threads add to the string tables.
+		LLStringTable::initClass();
 	}
 }
 
@@ -79,6 +89,10 @@ void ll_cleanup_apr()
 		apr_thread_mutex_destroy(gCallStacksLogMutexp);
 		gCallStacksLogMutexp = NULL;
 	}
+	LLStringTable::cleanupClass();
+	LLEventTrace::cleanupClass();
+	LLFastTimer::cleanupClass();
+	LLThreadRecord::cleanupClass();
 	if (gAPRPoolp)
 	{
 		apr_pool_destroy(gAPRPoolp);
@@ -0,0 +1,347 @@
+/**
+ * @file lleventtrace.cpp
+ * @brief Timeline of what each thread was doing, for chrome://tracing
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lleventtrace.h"
+
+#include "llapr.h"
+#include "llfasttimer.h"
+#include "llstl.h"
+#include "llthread.h"
+
+#include <set>
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Each thread writes its own ring buffer and nothing else, so recording
+// takes no locks. The writer fills a slot before it moves mHead past it;
+// writeChromeTrace() copies the buffer out, then checks how far mHead has
+// moved on since and throws away whatever was overwritten meanwhile.
+//
+
+namespace
+{
+	struct Event
+	{
+		U64 mTime;
+		const char* mName;
+		S32 mTimer;
+		U8 mCategory;
+		U8 mPhase;
+	};
+
+	const U32 BUFFER_MASK = LLEventTrace::BUFFER_EVENTS - 1;
+
+	const char* CATEGORY_NAMES[LLEventTrace::CAT_COUNT] =
+	{
+		"timer",
+		"request",
+		"message"
+	};
+}
+
+struct LLEventTrace::ThreadTrace
+{
+	ThreadTrace(LLThreadRecord* recordp)
+	:	mEvents(NULL),
+		mHead(0),
+		mWrapped(FALSE),
+		mRecord(recordp)
+	{
+	}
+
+	~ThreadTrace()
+	{
+		delete[] mEvents;
+	}
+
+	void record(ECategory category, const char* name, S32 timer, U8 phase)
+	{
+		U32 head = mHead;
+		Event& event = mEvents[head & BUFFER_MASK];
+		event.mTime = get_cpu_clock_count();
+		event.mName = name;
+		event.mTimer = timer;
+		event.mCategory = (U8)category;
+		event.mPhase = phase;
+		if ((head & BUFFER_MASK) == BUFFER_MASK)
+		{
+			mWrapped = TRUE;
+		}
+		mHead = head + 1;
+	}
+
+	Event* mEvents;				// allocated on first use
+	LLAtomicU32 mHead;			// events ever recorded
+	BOOL mWrapped;
+	LLThreadRecord* mRecord;	// name and exit, under its mutex
+};
+
+typedef std::vector<LLEventTrace::ThreadTrace*> thread_trace_list_t;
+
+BOOL LLEventTrace::sEnabled = FALSE;
+
+static BOOL sTraceInitialized = FALSE;
+static thread_trace_list_t sThreadTraces;		// LLThreadRecord::getMutex()
+
+static std::set<std::string>& get_interned_names()
+{
+	static std::set<std::string> names;
+	return names;
+}
+
+// Quotes str for JSON.
+static std::string json_string(const std::string& str)
+{
+	std::string quoted = "\"";
+	for (std::string::const_iterator iter = str.begin(); iter != str.end(); ++iter)
+	{
+		unsigned char c = *iter;
+		if (c == '"' || c == '\\')
+		{
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (c < 0x20)
+		{
+			quoted += llformat("\\u%04x", c);
+		}
+		else
+		{
+			quoted += c;
+		}
+	}
+	quoted += '"';
+	return quoted;
+}
+
+//static
+void LLEventTrace::initClass()
+{
+	// after LLThreadRecord::initClass()
+	sTraceInitialized = LLThreadRecord::getMutex() != NULL;
+}
+
+//static
+void LLEventTrace::cleanupClass()
+{
+	// before LLThreadRecord::cleanupClass(), once every other thread has
+	// stopped
+	sEnabled = FALSE;
+	sTraceInitialized = FALSE;
+	for (thread_trace_list_t::iterator iter = sThreadTraces.begin();
+		 iter != sThreadTraces.end(); ++iter)
+	{
+		(*iter)->mRecord->mTrace = NULL;
+		delete *iter;
+	}
+	sThreadTraces.clear();
+}
+
+//static
+void LLEventTrace::setEnabled(BOOL enabled)
+{
+	sEnabled = enabled && sTraceInitialized;
+}
+
+//static
+const char* LLEventTrace::internName(const std::string& name)
+{
+	if (!sTraceInitialized)
+	{
+		return get_interned_names().insert(name).first->c_str();
+	}
+	LLMutexLock lock(LLThreadRecord::getMutex());
+	return get_interned_names().insert(name).first->c_str();
+}
+
+//static
+LLEventTrace::ThreadTrace* LLEventTrace::getThreadTrace()
+{
+	LLThreadRecord* recordp = sTraceInitialized ? LLThreadRecord::getCurrent() : NULL;
+	if (!recordp)
+	{
+		return NULL;
+	}
+
+	ThreadTrace* tracep = recordp->mTrace;
+	if (!tracep)
+	{
+		tracep = new ThreadTrace(recordp);
+		recordp->mTrace = tracep;
+		LLMutexLock lock(LLThreadRecord::getMutex());
+		sThreadTraces.push_back(tracep);
+	}
+	return tracep;
+}
+
+//static
+void LLEventTrace::begin(ECategory category, const char* name, S32 timer)
+{
+	ThreadTrace* tracep = getThreadTrace();
+	if (!tracep)
+	{
+		return;
+	}
+	if (!tracep->mEvents)
+	{
+		// threads that are never traced don't pay for a buffer
+		LLMutexLock lock(LLThreadRecord::getMutex());
+		tracep->mEvents = new Event[BUFFER_EVENTS];
+	}
+	tracep->record(category, name, timer, 'B');
+}
+
+//static
+void LLEventTrace::end()
+{
+	ThreadTrace* tracep = getThreadTrace();
+	if (tracep && tracep->mEvents)
+	{
+		tracep->record(CAT_TIMER, NULL, -1, 'E');
+	}
+}
+
+//static
+BOOL LLEventTrace::writeChromeTrace(const std::string& filename)
+{
+	if (!sTraceInitialized)
+	{
+		return FALSE;
+	}
+
+	llofstream file(filename);
+	if (!file.is_open())
+	{
+		llwarns << "Unable to write event trace to " << filename << llendl;
+		return FALSE;
+	}
+
+	F64 usec_per_count = 1000000.0 / (F64)LLFastTimer::countsPerSecond();
+	std::vector<Event> events;
+	S32 num_events = 0;
+
+	file << "{\"traceEvents\":[" << std::endl;
+	BOOL first = TRUE;
+
+	LLMutexLock lock(LLThreadRecord::getMutex());
+	thread_trace_list_t::iterator iter = sThreadTraces.begin();
+	while (iter != sThreadTraces.end())
+	{
+		ThreadTrace* tracep = *iter;
+		const LLThreadRecord* recordp = tracep->mRecord;
+		std::string thread_name = recordp->mName.empty() ? llformat("Thread %d", recordp->mID) : recordp->mName;
+		file << (first ? "" : ",\n")
+			 << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << recordp->mID
+			 << ",\"args\":{\"name\":" << json_string(thread_name) << "}}";
+		first = FALSE;
+
+		events.clear();
+		if (tracep->mEvents)
+		{
+			U32 head = tracep->mHead;
+			U32 count = tracep->mWrapped ? (U32)BUFFER_EVENTS : head;
+			U32 start = head - count;
+			events.resize(count);
+			for (U32 i = 0; i < count; i++)
+			{
+				events[i] = tracep->mEvents[(start + i) & BUFFER_MASK];
+			}
+
+			// The slots written since, and the one being written now,
+			// held the oldest of the events copied.
+			U32 written = (U32)tracep->mHead - head + 1;
+			U32 free_slots = (U32)BUFFER_EVENTS - count;
+			if (written > free_slots)
+			{
+				events.erase(events.begin(), events.begin() + llmin(written - free_slots, count));
+			}
+		}
+
+		// Ends of events that began before the buffer did have nothing
+		// to end.
+		S32 depth = 0;
+		for (std::vector<Event>::iterator event = events.begin(); event != events.end(); ++event)
+		{
+			if (event->mPhase == 'E')
+			{
+				if (!depth)
+				{
+					continue;
+				}
+				depth--;
+			}
+			else
+			{
+				depth++;
+			}
+
+			file << ",\n{\"ph\":\"" << (char)event->mPhase << "\",\"pid\":1,\"tid\":" << recordp->mID
+				 << ",\"ts\":" << llformat("%.3f", (F64)event->mTime * usec_per_count);
+			if (event->mPhase == 'B')
+			{
+				std::string name;
+				if (event->mName)
+				{
+					name = event->mName;
+				}
+				else if (event->mTimer >= 0)
+				{
+					name = LLFastTimer::getTimerName(event->mTimer);
+				}
+				file << ",\"cat\":\"" << CATEGORY_NAMES[llclamp((S32)event->mCategory, 0, CAT_COUNT - 1)]
+					 << "\",\"name\":" << json_string(name);
+			}
+			file << "}";
+			num_events++;
+		}
+
+		if (recordp->mExited)
+		{
+			// its events are written, and nothing else will be
+			tracep->mRecord->mTrace = NULL;
+			delete tracep;
+			iter = sThreadTraces.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	file << "\n]}" << std::endl;
+	file.close();
+
+	llinfos << "Wrote " << num_events << " trace events to " << filename << llendl;
+	return TRUE;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file lleventtrace.h
+ * @brief Timeline of what each thread was doing, for chrome://tracing
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLEVENTTRACE_H
+#define LL_LLEVENTTRACE_H
+
+#include <string>
+
+// Records when fast timers, queued thread requests and message handlers
+// start and stop, into a ring buffer per thread, and writes the last few
+// seconds of it out in the Chrome trace event format. Open the file in
+// chrome://tracing to see where a hitch went.
+//
+// Recording is off until setEnabled(TRUE), and costs one test of sEnabled
+// per event while it is.
+class LLEventTrace
+{
+public:
+	enum ECategory
+	{
+		CAT_TIMER,
+		CAT_REQUEST,
+		CAT_MESSAGE,
+		CAT_COUNT
+	};
+
+	// Events kept per thread; the oldest are overwritten.
+	enum { BUFFER_EVENTS = 1 << 16 };
+
+	// Called by ll_init_apr() on the main thread. Threads are named in the
+	// trace by LLThreadRecord.
+	static void initClass();
+	static void cleanupClass();
+
+	static void setEnabled(BOOL enabled);
+	static BOOL isEnabled()					{ return sEnabled; }
+
+	// Returns a copy of name that lives as long as the process, for event
+	// names that don't.
+	static const char* internName(const std::string& name);
+
+	// name must outlive the trace; timer is the LLFastTimer index of a
+	// CAT_TIMER event, which is named when the trace is written.
+	static void begin(ECategory category, const char* name, S32 timer = -1);
+	static void end();
+
+	// MAIN thread. Writes every thread's buffered events to filename as a
+	// Chrome trace. Returns FALSE if the file couldn't be written.
+	static BOOL writeChromeTrace(const std::string& filename);
+
+	static BOOL sEnabled;
+
+	struct ThreadTrace;
+
+private:
+	static ThreadTrace* getThreadTrace();
+};
+
+// Traces the enclosing scope, if tracing was on when it started.
+class LLEventTraceScope
+{
+public:
+	LLEventTraceScope(LLEventTrace::ECategory category, const char* name)
+	:	mTraced(LLEventTrace::sEnabled)
+	{
+		if (mTraced)
+		{
+			LLEventTrace::begin(category, name);
+		}
+	}
+	~LLEventTraceScope()
+	{
+		if (mTraced)
+		{
+			LLEventTrace::end();
+		}
+	}
+
+private:
+	BOOL mTraced;
+};
+
+#endif // LL_LLEVENTTRACE_H
@@ -33,7 +33,10 @@
 
 #include "llfasttimer.h"
 
+#include "llapr.h"
 #include "llprocessor.h"
+#include "llstl.h"
+#include "llthread.h"
 
 
 #if LL_WINDOWS
@@ -72,6 +75,113 @@ U64 LLFastTimer::sClockResolution = 1000000000; // 1e9, Nanosecond resolution
 U64 LLFastTimer::sClockResolution = 1000000; // 1e6, Microsecond resolution
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// Per thread counters
+//
+// A thread only ever writes its own ThreadTimers, so timing takes no locks.
+// Counts go into one of three banks: reset() moves each thread on to the
+// next bank every frame, and empties the bank it moved the thread off the
+// frame before, which nothing can still be adding to by then.
+//
+
+struct LLFastTimer::ThreadTimers
+{
+	enum
+	{
+		NUM_TIMERS = FTM_NUM_TYPES + FTM_MAX_NAMED_TIMERS,
+		NUM_BANKS = 3
+	};
+
+	struct Frame
+	{
+		U64 mStart;
+		U64 mChildCounts;
+		S32 mTimer;
+	};
+
+	struct Bank
+	{
+		U64 mCounts[NUM_TIMERS];
+		U32 mCalls[NUM_TIMERS];
+	};
+
+	ThreadTimers(LLThreadRecord* recordp)
+	:	mRecord(recordp),
+		mDepth(0),
+		mBank(0),
+		mFrames(0),
+		mCollectedExit(FALSE)
+	{
+		for (S32 i = 0; i < NUM_TIMERS; i++)
+		{
+			mParent[i] = -1;
+			mCountAverage[i] = 0.0;
+			mCallAverage[i] = 0.0;
+		}
+		memset(mBanks, 0, sizeof(mBanks));
+	}
+
+	LLThreadRecord* mRecord;	// name and exit, under its mutex
+
+	// the owning thread only
+	Frame mStack[FTM_MAX_DEPTH];
+	S32 mDepth;
+
+	// written by the owning thread, read by reset()
+	S32 mParent[NUM_TIMERS];	// the timer that was running when it last started
+	Bank mBanks[NUM_BANKS];
+	LLAtomicU32 mBank;
+
+	// the main thread only
+	F64 mCountAverage[NUM_TIMERS];
+	F64 mCallAverage[NUM_TIMERS];
+	S32 mFrames;
+	BOOL mCollectedExit;		// shown for one frame after the thread exited
+};
+
+typedef std::vector<LLFastTimer::ThreadTimers*> thread_timers_list_t;
+
+static U32 sMainThreadID = 0;
+static BOOL sThreadTimersInitialized = FALSE;
+static thread_timers_list_t sThreadTimers;		// LLThreadRecord::getMutex()
+
+// Named timers are registered while statics are constructed, so the list
+// has to be constructed on first use.
+static std::vector<std::string>& get_named_timers()
+{
+	static std::vector<std::string> named_timers;
+	return named_timers;
+}
+
+// Names given to EFastTimerTypes by setTimerName().
+static std::vector<std::string>& get_type_names()
+{
+	static std::vector<std::string> type_names;
+	return type_names;
+}
+
+LLFastTimer::DeclareTimer::DeclareTimer(const std::string& name)
+:	mName(name),
+	mIndex(-1)
+{
+	// timers with the same name share their counters
+	std::vector<std::string>& named_timers = get_named_timers();
+	for (S32 i = 0; i < (S32)named_timers.size(); i++)
+	{
+		if (named_timers[i] == name)
+		{
+			mIndex = i;
+			return;
+		}
+	}
+	if (named_timers.size() < FTM_MAX_NAMED_TIMERS)
+	{
+		mIndex = (S32)named_timers.size();
+		named_timers.push_back(name);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 //
@@ -196,6 +306,293 @@ void LLFastTimer::reset()
 		sCalls[i] = 0;
 	}
 	sCurDepth = 0;
+
+	collectThreadTimers();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//static
+void LLFastTimer::initClass()
+{
+	// after LLThreadRecord::initClass()
+	if (sThreadTimersInitialized || !LLThreadRecord::getMutex())
+	{
+		return;
+	}
+	sThreadTimersInitialized = TRUE;
+	sMainThreadID = LLThread::currentID();
+}
+
+//static
+void LLFastTimer::cleanupClass()
+{
+	// before LLThreadRecord::cleanupClass(), once every other thread has
+	// stopped
+	sThreadTimersInitialized = FALSE;
+	for (thread_timers_list_t::iterator iter = sThreadTimers.begin();
+		 iter != sThreadTimers.end(); ++iter)
+	{
+		(*iter)->mRecord->mTimers = NULL;
+		delete *iter;
+	}
+	sThreadTimers.clear();
+}
+
+//static
+BOOL LLFastTimer::isMainThread()
+{
+	return !sMainThreadID || LLThread::currentID() == sMainThreadID;
+}
+
+//static
+LLFastTimer::ThreadTimers* LLFastTimer::getThreadTimers()
+{
+	LLThreadRecord* recordp = sThreadTimersInitialized ? LLThreadRecord::getCurrent() : NULL;
+	if (!recordp)
+	{
+		return NULL;
+	}
+
+	ThreadTimers* threadp = recordp->mTimers;
+	if (!threadp)
+	{
+		threadp = new ThreadTimers(recordp);
+		recordp->mTimers = threadp;
+		LLMutexLock lock(LLThreadRecord::getMutex());
+		sThreadTimers.push_back(threadp);
+	}
+	return threadp;
+}
+
+void LLFastTimer::startThreadTimer(S32 timer)
+{
+	ThreadTimers* threadp = timer < 0 ? NULL : getThreadTimers();
+	if (!threadp || threadp->mDepth >= FTM_MAX_DEPTH)
+	{
+		// nothing to stop
+		mType = FTM_NUM_TYPES;
+		mThreadTimers = NULL;
+		mTraced = FALSE;
+		return;
+	}
+	mThreadTimers = threadp;
+
+	S32 depth = threadp->mDepth++;
+	if (!depth)
+	{
+		threadp->mParent[timer] = -1;
+	}
+	else if (threadp->mStack[depth - 1].mTimer != timer)
+	{
+		// recursion keeps the outermost caller
+		threadp->mParent[timer] = threadp->mStack[depth - 1].mTimer;
+	}
+
+	ThreadTimers::Frame& frame = threadp->mStack[depth];
+	frame.mTimer = timer;
+	frame.mChildCounts = 0;
+	frame.mStart = get_cpu_clock_count();
+
+	mTraced = LLEventTrace::sEnabled;
+	if (mTraced)
+	{
+		LLEventTrace::begin(LLEventTrace::CAT_TIMER, NULL, timer);
+	}
+}
+
+void LLFastTimer::stopThreadTimer()
+{
+	U64 end = get_cpu_clock_count();
+	ThreadTimers* threadp = mThreadTimers;
+
+	ThreadTimers::Frame& frame = threadp->mStack[--threadp->mDepth];
+	U64 delta = end - frame.mStart;
+	ThreadTimers::Bank& bank = threadp->mBanks[(U32)threadp->mBank];
+	bank.mCounts[frame.mTimer] += delta - llmin(frame.mChildCounts, delta);
+	bank.mCalls[frame.mTimer]++;
+
+	if (threadp->mDepth > 0)
+	{
+		threadp->mStack[threadp->mDepth - 1].mChildCounts += delta;
+	}
+
+	if (mTraced)
+	{
+		LLEventTrace::end();
+	}
+}
+
+//static
+void LLFastTimer::collectThreadTimers()
+{
+	if (!sThreadTimersInitialized)
+	{
+		return;
+	}
+
+	LLMutexLock lock(LLThreadRecord::getMutex());
+	thread_timers_list_t::iterator iter = sThreadTimers.begin();
+	while (iter != sThreadTimers.end())
+	{
+		ThreadTimers* threadp = *iter;
+		if (threadp->mCollectedExit)
+		{
+			threadp->mRecord->mTimers = NULL;
+			delete threadp;
+			iter = sThreadTimers.erase(iter);
+			continue;
+		}
+
+		U32 bank_idx = threadp->mBank;
+		threadp->mBank = (bank_idx + 1) % ThreadTimers::NUM_BANKS;
+		ThreadTimers::Bank& bank = threadp->mBanks[(bank_idx + ThreadTimers::NUM_BANKS - 1) % ThreadTimers::NUM_BANKS];
+		if (threadp->mRecord->mExited)
+		{
+			// nothing is adding to the other banks any more
+			for (S32 i = 0; i < ThreadTimers::NUM_BANKS; i++)
+			{
+				ThreadTimers::Bank& other = threadp->mBanks[i];
+				if (&other != &bank)
+				{
+					for (S32 j = 0; j < ThreadTimers::NUM_TIMERS; j++)
+					{
+						bank.mCounts[j] += other.mCounts[j];
+						bank.mCalls[j] += other.mCalls[j];
+					}
+				}
+			}
+			threadp->mCollectedExit = TRUE;
+		}
+
+		if (!sPauseHistory)
+		{
+			F64 frames = (F64)llmin(threadp->mFrames, (S32)FTM_HISTORY_NUM);
+			for (S32 i = 0; i < ThreadTimers::NUM_TIMERS; i++)
+			{
+				threadp->mCountAverage[i] = (threadp->mCountAverage[i] * frames + (F64)bank.mCounts[i]) / (frames + 1.0);
+				threadp->mCallAverage[i] = (threadp->mCallAverage[i] * frames + (F64)bank.mCalls[i]) / (frames + 1.0);
+			}
+			threadp->mFrames++;
+		}
+		memset(&bank, 0, sizeof(bank));
+		++iter;
+	}
+}
+
+// Adds timer and everything last started under it to stats, depth first.
+static void add_thread_timer(const LLFastTimer::ThreadTimers* threadp, S32 timer, S32 parent, S32 depth,
+							 const std::vector<S32>& first_child, const std::vector<S32>& next_sibling,
+							 std::vector<BOOL>& added, LLFastTimer::ThreadStats& stats)
+{
+	added[timer] = TRUE;
+	LLFastTimer::ThreadTimerStats timer_stats;
+	timer_stats.mTimer = timer;
+	timer_stats.mParent = parent;
+	timer_stats.mDepth = depth;
+	timer_stats.mCountAverage = threadp->mCountAverage[timer];
+	timer_stats.mCallAverage = threadp->mCallAverage[timer];
+	stats.mTimers.push_back(timer_stats);
+
+	S32 pos = (S32)stats.mTimers.size() - 1;
+	for (S32 child = first_child[timer]; child >= 0; child = next_sibling[child])
+	{
+		// a timer that has been started under each of its callers can
+		// make a loop
+		if (!added[child])
+		{
+			add_thread_timer(threadp, child, pos, depth + 1, first_child, next_sibling, added, stats);
+		}
+	}
+}
+
+//static
+void LLFastTimer::getThreadStats(std::vector<ThreadStats>& stats)
+{
+	stats.clear();
+	if (!sThreadTimersInitialized)
+	{
+		return;
+	}
+
+	const S32 NUM_TIMERS = ThreadTimers::NUM_TIMERS;
+	std::vector<S32> first_child(NUM_TIMERS);
+	std::vector<S32> next_sibling(NUM_TIMERS);
+	std::vector<BOOL> added(NUM_TIMERS);
+
+	LLMutexLock lock(LLThreadRecord::getMutex());
+	for (thread_timers_list_t::iterator iter = sThreadTimers.begin();
+		 iter != sThreadTimers.end(); ++iter)
+	{
+		ThreadTimers* threadp = *iter;
+		stats.push_back(ThreadStats());
+		ThreadStats& thread_stats = stats.back();
+		const LLThreadRecord* recordp = threadp->mRecord;
+		thread_stats.mName = recordp->mName.empty() ? llformat("Thread %d", recordp->mID) : recordp->mName;
+
+		// link each timer that ran lately to the one it last started under,
+		// backwards so the children end up in order
+		std::fill(first_child.begin(), first_child.end(), -1);
+		std::fill(next_sibling.begin(), next_sibling.end(), -1);
+		std::fill(added.begin(), added.end(), FALSE);
+		for (S32 timer = NUM_TIMERS - 1; timer >= 0; timer--)
+		{
+			S32 parent = threadp->mParent[timer];
+			if (threadp->mCallAverage[timer] > 0.0
+				&& parent >= 0 && parent < NUM_TIMERS
+				&& threadp->mCallAverage[parent] > 0.0)
+			{
+				next_sibling[timer] = first_child[parent];
+				first_child[parent] = timer;
+			}
+		}
+
+		for (S32 timer = 0; timer < NUM_TIMERS; timer++)
+		{
+			S32 parent = threadp->mParent[timer];
+			if (threadp->mCallAverage[timer] > 0.0
+				&& (parent < 0 || parent >= NUM_TIMERS || threadp->mCallAverage[parent] <= 0.0))
+			{
+				add_thread_timer(threadp, timer, -1, 0, first_child, next_sibling, added, thread_stats);
+			}
+		}
+		// whatever is left is in a loop with no way to the top
+		for (S32 timer = 0; timer < NUM_TIMERS; timer++)
+		{
+			if (threadp->mCallAverage[timer] > 0.0 && !added[timer])
+			{
+				add_thread_timer(threadp, timer, -1, 0, first_child, next_sibling, added, thread_stats);
+			}
+		}
+	}
+}
+
+//static
+std::string LLFastTimer::getTimerName(S32 timer)
+{
+	std::vector<std::string>& named_timers = get_named_timers();
+	S32 named = timer - FTM_NUM_TYPES;
+	if (named >= 0 && named < (S32)named_timers.size())
+	{
+		return named_timers[named];
+	}
+	std::vector<std::string>& type_names = get_type_names();
+	if (timer >= 0 && timer < (S32)type_names.size() && !type_names[timer].empty())
+	{
+		return type_names[timer];
+	}
+	return llformat("Timer %d", timer);
+}
+
+//static
+void LLFastTimer::setTimerName(S32 timer, const std::string& name)
+{
+	if (timer >= 0 && timer < FTM_NUM_TYPES)
+	{
+		std::vector<std::string>& type_names = get_type_names();
+		type_names.resize(FTM_NUM_TYPES);
+		type_names[timer] = name;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,11 @@
 
 #define FAST_TIMER_ON 1
 
+#include <string>
+#include <vector>
+
+#include "lleventtrace.h"
+
 U64 get_cpu_clock_count();
 
 class LLFastTimer
@@ -114,6 +119,8 @@ public:
 		FTM_STATESORT_POSTSORT,
 		FTM_REBUILD_VBO,
 		FTM_REBUILD_VOLUME_VB,
+		FTM_REBUILD_VOLUME_GEN,
+		FTM_REBUILD_VOLUME_COMMIT,
 		FTM_REBUILD_BRIDGE_VB,
 		FTM_REBUILD_HUD_VB,
 		FTM_REBUILD_TERRAIN_VB,
@@ -173,6 +180,7 @@ public:
 		FTM_AUTO_SELECT,
 		FTM_ARRANGE,
 		FTM_FILTER,
+		FTM_FILTER_INDEX,
 		FTM_REFRESH,
 		FTM_SORT,
 		FTM_PICK,
@@ -193,7 +201,45 @@ public:
 	};
 	enum { FTM_HISTORY_NUM = 60 };
 	enum { FTM_MAX_DEPTH = 64 };
-	
+	enum { FTM_MAX_NAMED_TIMERS = 256 };
+
+	// A timer that isn't in EFastTimerType. Declare one at file scope,
+	//   static LLFastTimer::DeclareTimer FTM_CACHE_READ("Cache Read");
+	// and time a scope with LLFastTimer t(FTM_CACHE_READ). Named timers may
+	// be used on any thread.
+	class DeclareTimer
+	{
+	public:
+		DeclareTimer(const std::string& name);
+
+		const std::string& getName() const	{ return mName; }
+		// Position of the timer in the per thread counters, after all the
+		// EFastTimerTypes; -1 if there were too many to register it.
+		S32 getIndex() const				{ return mIndex; }
+
+	private:
+		std::string mName;
+		S32 mIndex;
+	};
+
+	// Counters of one thread, see llfasttimer.cpp.
+	struct ThreadTimers;
+
+	// What a thread timed, averaged over the last few frames.
+	struct ThreadTimerStats
+	{
+		S32 mTimer;			// EFastTimerType, or FTM_NUM_TYPES + DeclareTimer::getIndex()
+		S32 mParent;		// position in the same list, -1 at the top of the tree
+		S32 mDepth;
+		F64 mCountAverage;	// counts in the timer itself, not its children, per frame
+		F64 mCallAverage;
+	};
+	struct ThreadStats
+	{
+		std::string mName;
+		std::vector<ThreadTimerStats> mTimers;	// depth first
+	};
+
 public:
 	static EFastTimerType sCurType;
 
@@ -201,6 +247,13 @@ public:
 	{
 #if FAST_TIMER_ON
 		mType = type;
+		if (!isMainThread())
+		{
+			// the static counters below belong to the main thread
+			startThreadTimer(type);
+			return;
+		}
+		mThreadTimers = NULL;
 		sCurType = type;
 		// These don't get counted, because they use CPU clockticks
 		//gTimerBins[gCurTimerBin]++;
@@ -210,11 +263,36 @@ public:
 
 		sStart[sCurDepth] = cpu_clocks;
 		sCurDepth++;
+		// read once, so that turning tracing on or off while this is
+		// running doesn't leave a begin without an end or the other way
+		mTraced = LLEventTrace::sEnabled;
+		if (mTraced)
+		{
+			LLEventTrace::begin(LLEventTrace::CAT_TIMER, NULL, type);
+		}
 #endif
 	};
+	LLFastTimer(DeclareTimer& timer)
+	{
+#if FAST_TIMER_ON
+		mType = FTM_NUM_TYPES;
+		startThreadTimer(timer.getIndex() < 0 ? -1 : FTM_NUM_TYPES + timer.getIndex());
+#endif
+	}
+
 	~LLFastTimer()
 	{
 #if FAST_TIMER_ON
+		if (mThreadTimers)
+		{
+			stopThreadTimer();
+			return;
+		}
+		if (mType == FTM_NUM_TYPES)
+		{
+			return;
+		}
+
 		U64 end,delta;
 		int i;
 
@@ -230,12 +308,29 @@ public:
 		// Subtract delta from parents
 		for (i=0; i<sCurDepth; i++)
 			sStart[i] += delta;
+		if (mTraced)
+		{
+			LLEventTrace::end();
+		}
 #endif
 	}
 
 	static void reset();
 	static U64 countsPerSecond();
 
+	// Sets up the per thread counters; called by ll_init_apr() on the main
+	// thread. Until then every timer counts as being on the main thread.
+	// Threads are named in getThreadStats() by LLThreadRecord.
+	static void initClass();
+	static void cleanupClass();
+	static BOOL isMainThread();
+	// MAIN thread. Builds the call trees of all threads from what reset()
+	// last collected.
+	static void getThreadStats(std::vector<ThreadStats>& stats);
+	static std::string getTimerName(S32 timer);
+	// Names an EFastTimerType for getTimerName().
+	static void setTimerName(S32 timer, const std::string& name);
+
 public:
 	static int sCurDepth;
 	static U64 sStart[FTM_MAX_DEPTH];
@@ -252,8 +347,18 @@ public:
 	static F64 sCPUClockFrequency;
     static U64 sClockResolution;
 	
+private:
+	// Named timers, and all timers off the main thread, go to the calling
+	// thread's own counters without locking anything. reset() collects them.
+	void startThreadTimer(S32 timer);
+	void stopThreadTimer();
+	static ThreadTimers* getThreadTimers();
+	static void collectThreadTimers();
+
 private:
 	EFastTimerType mType;
+	ThreadTimers* mThreadTimers;
+	BOOL mTraced;
 };
 
 
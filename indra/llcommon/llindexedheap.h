@@ -0,0 +1,231 @@
+/** 
+ * @file llindexedheap.h
+ * @brief Binary max-heap that can reprioritize its elements in place
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLINDEXEDHEAP_H
+#define LL_LLINDEXEDHEAP_H
+
+#include <vector>
+
+//
+// Priority queue kept as a binary max-heap in a vector. Every element
+// remembers its own position in the heap (through the set/get index
+// functions), so changing an element's priority or removing it is
+// O(log n) without searching for it, unlike LLPriQueueMap.
+//
+// Elements not in the heap must report an index < 0. An element can
+// only be in one LLIndexedHeap at a time.
+//
+
+template <class DATA_TYPE>
+class LLIndexedHeap
+{
+public:
+	typedef void (*set_index_fn)(DATA_TYPE &data, const S32 index);
+	typedef S32 (*get_index_fn)(const DATA_TYPE &data);
+
+	LLIndexedHeap(set_index_fn set_index, get_index_fn get_index) : mSetIndex(set_index), mGetIndex(get_index)
+	{
+	}
+
+	~LLIndexedHeap()
+	{
+		clear();
+	}
+
+	// Adds data to the heap, or moves it to the new priority if it is
+	// already there.
+	void push(const F32 priority, DATA_TYPE data)
+	{
+		S32 index = mGetIndex(data);
+		if (index < 0)
+		{
+			mHeap.push_back(node_t(priority, data));
+			siftUp((S32)mHeap.size() - 1);
+		}
+		else if (priority > mHeap[index].first)
+		{
+			mHeap[index].first = priority;
+			siftUp(index);
+		}
+		else if (priority < mHeap[index].first)
+		{
+			mHeap[index].first = priority;
+			siftDown(index);
+		}
+	}
+
+	// Like push(), but never lowers the priority of data already in the heap.
+	void raise(const F32 priority, DATA_TYPE data)
+	{
+		S32 index = mGetIndex(data);
+		if (index < 0 || priority > mHeap[index].first)
+		{
+			push(priority, data);
+		}
+	}
+
+	// Removes the element with the highest priority.
+	BOOL pop(DATA_TYPE *datap, F32 *priorityp = NULL)
+	{
+		if (mHeap.empty())
+		{
+			return FALSE;
+		}
+		*datap = mHeap[0].second;
+		if (priorityp)
+		{
+			*priorityp = mHeap[0].first;
+		}
+		erase(0);
+		return TRUE;
+	}
+
+	BOOL remove(DATA_TYPE data)
+	{
+		S32 index = mGetIndex(data);
+		if (index < 0)
+		{
+			return FALSE;
+		}
+		erase(index);
+		return TRUE;
+	}
+
+	BOOL contains(const DATA_TYPE &data) const
+	{
+		return mGetIndex(data) >= 0;
+	}
+
+	F32 getTopPriority() const
+	{
+		return mHeap.empty() ? 0.f : mHeap[0].first;
+	}
+
+	S32 getLength() const
+	{
+		return (S32)mHeap.size();
+	}
+
+	BOOL isEmpty() const
+	{
+		return mHeap.empty();
+	}
+
+	void clear()
+	{
+		for (typename node_list_t::iterator iter = mHeap.begin(); iter != mHeap.end(); ++iter)
+		{
+			mSetIndex(iter->second, -1);
+		}
+		mHeap.clear();
+	}
+
+protected:
+	typedef std::pair<F32, DATA_TYPE> node_t;
+	typedef std::vector<node_t> node_list_t;
+
+	void erase(S32 index)
+	{
+		mSetIndex(mHeap[index].second, -1);
+		S32 last = (S32)mHeap.size() - 1;
+		if (index != last)
+		{
+			F32 old_priority = mHeap[index].first;
+			place(index, mHeap[last]);
+			mHeap.pop_back();
+			if (mHeap[index].first > old_priority)
+			{
+				siftUp(index);
+			}
+			else
+			{
+				siftDown(index);
+			}
+		}
+		else
+		{
+			mHeap.pop_back();
+		}
+	}
+
+	void place(S32 index, const node_t &node)
+	{
+		mHeap[index] = node;
+		mSetIndex(mHeap[index].second, index);
+	}
+
+	void siftUp(S32 index)
+	{
+		node_t node = mHeap[index];
+		while (index > 0)
+		{
+			S32 parent = (index - 1) / 2;
+			if (!(node.first > mHeap[parent].first))
+			{
+				break;
+			}
+			place(index, mHeap[parent]);
+			index = parent;
+		}
+		place(index, node);
+	}
+
+	void siftDown(S32 index)
+	{
+		node_t node = mHeap[index];
+		S32 count = (S32)mHeap.size();
+		while (TRUE)
+		{
+			S32 child = index * 2 + 1;
+			if (child >= count)
+			{
+				break;
+			}
+			if (child + 1 < count && mHeap[child + 1].first > mHeap[child].first)
+			{
+				child++;
+			}
+			if (!(mHeap[child].first > node.first))
+			{
+				break;
+			}
+			place(index, mHeap[child]);
+			index = child;
+		}
+		place(index, node);
+	}
+
+	node_list_t mHeap;
+	set_index_fn mSetIndex;
+	get_index_fn mGetIndex;
+};
+
+#endif // LL_LLINDEXEDHEAP_H
@@ -35,12 +35,15 @@
 
 //============================================================================
 
+static LLFastTimer::DeclareTimer FTM_PROCESS_QUEUED_REQUEST("Queued Request");
+
 // MAIN THREAD
 LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(TRUE),
-	mNextHandle(0)
+	mNextHandle(0),
+	mTraceName(LLEventTrace::internName(name))
 {
 	if (mThreaded)
 	{
@@ -429,7 +432,12 @@ S32 LLQueuedThread::processNextRequest()
 	if (req)
 	{
 		// process request
-		bool complete = req->processRequest();
+		bool complete;
+		{
+			LLFastTimer t(FTM_PROCESS_QUEUED_REQUEST);
+			LLEventTraceScope trace(LLEventTrace::CAT_REQUEST, mTraceName);
+			complete = req->processRequest();
+		}
 
 		if (complete)
 		{
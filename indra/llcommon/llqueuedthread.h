@@ -212,6 +212,8 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	const char* mTraceName; // requests in the event trace
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
@@ -35,11 +35,81 @@
 
 #include "llstringtable.h"
 #include "llstl.h"
+#include "llthread.h"
 
 LLStringTable gStringTable(32768);
 
+LLMutex *LLStringTable::sMutex = NULL;
+
+// Takes the writers' lock, if there is one yet.
+class LLStringTableLock
+{
+public:
+	LLStringTableLock(LLMutex *mutex) : mMutex(mutex)
+	{
+		if (mMutex)
+		{
+			mMutex->lock();
+		}
+	}
+	~LLStringTableLock()
+	{
+		if (mMutex)
+		{
+			mMutex->unlock();
+		}
+	}
+private:
+	LLMutex *mMutex;
+};
+
+LLStringTable::Buckets::Buckets(U32 size, Buckets *replaced)
+:	mSize(size),
+	mReplaced(replaced)
+{
+	mHeads = new Node*[mSize];
+	for (U32 i = 0; i < mSize; i++)
+	{
+		mHeads[i] = NULL;
+	}
+}
+
+LLStringTable::Buckets::~Buckets()
+{
+	for (U32 i = 0; i < mSize; i++)
+	{
+		Node *node = mHeads[i];
+		while (node)
+		{
+			Node *next = node->mNext;
+			delete node;
+			node = next;
+		}
+	}
+	delete [] mHeads;
+	delete mReplaced;
+}
+
+//static
+void LLStringTable::initClass()
+{
+	if (!sMutex)
+	{
+		sMutex = new LLMutex(gAPRPoolp);
+	}
+}
+
+//static
+void LLStringTable::cleanupClass()
+{
+	// Every other thread has stopped by now.
+	delete sMutex;
+	sMutex = NULL;
+}
+
 LLStringTable::LLStringTable(int tablesize)
-: mUniqueEntries(0)
+:	mUniqueEntries(0),
+	mNumNodes(0)
 {
 	S32 i;
 	if (!tablesize)
@@ -57,54 +127,27 @@ LLStringTable::LLStringTable(int tablesize)
 		}
 	}
 	mMaxEntries = tablesize;
-
-#if !STRING_TABLE_HASH_MAP
-	// ALlocate strings
-	mStringList = new string_list_ptr_t[mMaxEntries];
-	// Clear strings
-	for (i = 0; i < mMaxEntries; i++)
-	{
-		mStringList[i] = NULL;
-	}
-#endif
+	mBuckets = new Buckets(mMaxEntries, NULL);
 }
 
 LLStringTable::~LLStringTable()
 {
-#if !STRING_TABLE_HASH_MAP
-	if (mStringList)
+	// Every entry is in the newest bucket array exactly once.
+	for (U32 i = 0; i < mBuckets->mSize; i++)
 	{
-		for (S32 i = 0; i < mMaxEntries; i++)
+		for (Node *node = mBuckets->mHeads[i]; node; node = node->mNext)
 		{
-			if (mStringList[i])
-			{
-				string_list_t::iterator iter;
-				for (iter = mStringList[i]->begin(); iter != mStringList[i]->end(); iter++)
-					delete *iter; // *iter = (LLStringTableEntry*)
-			}
-			delete mStringList[i];
+			delete node->mEntry;
 		}
-		delete [] mStringList;
-		mStringList = NULL;
 	}
-#else
-	// Need to clean up the string hash
-	for_each(mStringHash.begin(), mStringHash.end(), DeletePairedPointer());
-	mStringHash.clear();
-#endif
+	delete mBuckets;
+	mBuckets = NULL;
 }
 
 
-static U32 hash_my_string(const char *str, int max_entries)
+static U32 hash_my_string(const char *str)
 {
 	U32 retval = 0;
-#if 0
-	while (*str)
-	{
-		retval <<= 1;
-		retval += *str++;
-	}
-#else
 	while (*str)
 	{
 		retval = (retval<<4) + *str;
@@ -113,8 +156,50 @@ static U32 hash_my_string(const char *str, int max_entries)
 		retval = retval & (~x);
 		str++;
 	}
-#endif
-	return (retval & (max_entries-1)); // max_entries is gauranteed to be power of 2
+	return retval;
+}
+
+// Finds live or dead entries, without locking.
+LLStringTableEntry* LLStringTable::findEntry(const char *str, U32 hash_value)
+{
+	const Buckets *buckets = mBuckets;
+	for (const Node *node = buckets->mHeads[hash_value & (buckets->mSize - 1)]; node; node = node->mNext)
+	{
+		if (node->mHash == hash_value
+			&& !strncmp(node->mEntry->mString, str, MAX_STRINGS_LENGTH))
+		{
+			return node->mEntry;
+		}
+	}
+	return NULL;
+}
+
+// Called with the lock held. The node is complete before it's published.
+void LLStringTable::link(Buckets *buckets, LLStringTableEntry *entry, U32 hash_value)
+{
+	Node *node = new Node;
+	node->mEntry = entry;
+	node->mHash = hash_value;
+	U32 index = hash_value & (buckets->mSize - 1);
+	node->mNext = buckets->mHeads[index];
+	apr_atomic_xchgptr((volatile void **)&buckets->mHeads[index], node);
+}
+
+// Called with the lock held. Copies the chains into an array twice the
+// size, then swaps it in; readers on the old one carry on undisturbed.
+void LLStringTable::grow()
+{
+	Buckets *old_buckets = mBuckets;
+	Buckets *new_buckets = new Buckets(old_buckets->mSize * 2, old_buckets);
+	for (U32 i = 0; i < old_buckets->mSize; i++)
+	{
+		for (const Node *node = old_buckets->mHeads[i]; node; node = node->mNext)
+		{
+			link(new_buckets, node->mEntry, node->mHash);
+		}
+	}
+	apr_atomic_xchgptr((volatile void **)&mBuckets, new_buckets);
+	mMaxEntries = new_buckets->mSize;
 }
 
 char* LLStringTable::checkString(const std::string& str)
@@ -144,43 +229,11 @@ LLStringTableEntry* LLStringTable::checkStringEntry(const char *str)
 {
 	if (str)
 	{
-		char *ret_val;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-		string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-		string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-		std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-		string_hash_t::iterator lower = P.first;
-		string_hash_t::iterator upper = P.second;
-#endif
-		for (string_hash_t::iterator iter = lower; iter != upper; iter++)
-		{
-			entry = iter->second;
-			ret_val = entry->mString;
-			if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-			{
-				return entry;
-			}
-		}
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-		if (strlist)
+		LLStringTableEntry *entry = findEntry(str, hash_my_string(str));
+		if (entry && entry->isLive())
 		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
-			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					return entry;
-				}
-			}
+			return entry;
 		}
-#endif
 	}
 	return NULL;
 }
@@ -214,63 +267,33 @@ LLStringTableEntry* LLStringTable::addStringEntry(const char *str)
 {
 	if (str)
 	{
-		char *ret_val = NULL;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-		string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-		string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-		std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-		string_hash_t::iterator lower = P.first;
-		string_hash_t::iterator upper = P.second;
-#endif
-		for (string_hash_t::iterator iter = lower; iter != upper; iter++)
+		U32 hash_value = hash_my_string(str);
+		LLStringTableEntry *entry = findEntry(str, hash_value);
+		if (!entry)
 		{
-			entry = iter->second;
-			ret_val = entry->mString;
-			if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
+			LLStringTableLock lock(sMutex);
+			// someone may have added it since we looked
+			entry = findEntry(str, hash_value);
+			if (!entry)
 			{
-				entry->incCount();
-				return entry;
-			}
-		}
-
-		// not found, so add!
-		LLStringTableEntry* newentry = new LLStringTableEntry(str);
-		ret_val = newentry->mString;
-		mStringHash.insert(string_hash_t::value_type(hash_value, newentry));
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-
-		if (strlist)
-		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
-			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
+				// not found, so add!
+				entry = new LLStringTableEntry(str);
+				link(mBuckets, entry, hash_value);
+				mUniqueEntries++;
+				if (++mNumNodes > 2 * mMaxEntries)
 				{
-					entry->incCount();
-					return entry;
+					grow();
 				}
+				return entry;
 			}
 		}
-		else
+
+		if (!entry->incCount())
 		{
-			mStringList[hash_value] = new string_list_t;
-			strlist = mStringList[hash_value];
+			// brought back from the dead
+			mUniqueEntries++;
 		}
-
-		// not found, so add!
-		LLStringTableEntry *newentry = new LLStringTableEntry(str);
-		//ret_val = newentry->mString;
-		strlist->push_front(newentry);
-#endif
-		mUniqueEntries++;
-		return newentry;
+		return entry;
 	}
 	else
 	{
@@ -282,66 +305,19 @@ void LLStringTable::removeString(const char *str)
 {
 	if (str)
 	{
-		char *ret_val;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
+		LLStringTableEntry *entry = findEntry(str, hash_my_string(str));
+		if (entry)
 		{
-#if 1 // Microsoft
-			string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-			string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-			std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-			string_hash_t::iterator lower = P.first;
-			string_hash_t::iterator upper = P.second;
-#endif
-			for (string_hash_t::iterator iter = lower; iter != upper; iter++)
+			if (!entry->isLive())
 			{
-				entry = iter->second;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					if (!entry->decCount())
-					{
-						mUniqueEntries--;
-						if (mUniqueEntries < 0)
-						{
-							llerror("LLStringTable:removeString trying to remove too many strings!", 0);
-						}
-						delete iter->second;
-						mStringHash.erase(iter);
-					}
-					return;
-				}
+				llerror("LLStringTable:removeString trying to remove too many strings!", 0);
+				return;
 			}
-		}
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-
-		if (strlist)
-		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
+			if (!entry->decCount())
 			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					if (!entry->decCount())
-					{
-						mUniqueEntries--;
-						if (mUniqueEntries < 0)
-						{
-							llerror("LLStringTable:removeString trying to remove too many strings!", 0);
-						}
-						strlist->remove(entry);
-						delete entry;
-					}
-					return;
-				}
+				// stays in the table, in case another thread is looking at it
+				mUniqueEntries--;
 			}
 		}
-#endif
 	}
 }
-
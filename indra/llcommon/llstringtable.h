@@ -35,26 +35,13 @@
 #define LL_STRING_TABLE_H
 
 #include "lldefs.h"
+#include "llapr.h"
 #include "llformat.h"
 #include "llstl.h"
 #include <list>
 #include <set>
 
-#if LL_WINDOWS
-# if (_MSC_VER >= 1300 && _MSC_VER < 1400)
-#  define STRING_TABLE_HASH_MAP 1
-# endif
-#else
-//# define STRING_TABLE_HASH_MAP 1
-#endif
-
-#if STRING_TABLE_HASH_MAP
-#if LL_WINDOWS
-#include <hash_map>
-#else
-#include <ext/hash_map>
-#endif
-#endif
+class LLMutex;
 
 const U32 MAX_STRINGS_LENGTH = 256;
 
@@ -74,21 +61,34 @@ public:
 	~LLStringTableEntry()
 	{
 		delete [] mString;
-		mCount = 0;
 	}
-	void incCount()		{ mCount++; }
-	BOOL decCount()		{ return --mCount; }
+	// Returns the count from before the increment.
+	S32 incCount()		{ return mCount++; }
+	// Returns FALSE once the count reaches zero.
+	BOOL decCount()		{ return mCount-- != 0; }
+	BOOL isLive()		{ return (S32)mCount > 0; }
 
 	char *mString;
-	S32  mCount;
+	LLAtomicS32 mCount;
 };
 
+// Interned strings that any thread can look up or add. Lookups, and adds of
+// strings that are already there, don't lock; only a new string takes the
+// lock (one for all tables) while it's linked in. The buckets double as the
+// table fills, and entries are never moved or freed until the table goes,
+// so the pointers handed out stay good. A string whose count drops to zero
+// is just marked dead, and adding it again brings the same entry back.
 class LLStringTable
 {
 public:
 	LLStringTable(int tablesize);
 	~LLStringTable();
 
+	// The lock is created with the global APR pool. Tables used before
+	// then, during static initialization, are only used by one thread.
+	static void initClass();
+	static void cleanupClass();
+
 	char *checkString(const char *str);
 	char *checkString(const std::string& str);
 	LLStringTableEntry *checkStringEntry(const char *str);
@@ -100,21 +100,38 @@ public:
 	LLStringTableEntry *addStringEntry(const std::string& str);
 	void  removeString(const char *str);
 
-	S32 mMaxEntries;
-	S32 mUniqueEntries;
-	
-#if STRING_TABLE_HASH_MAP
-#if LL_WINDOWS
-	typedef std::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#else
-	typedef __gnu_cxx::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#endif
-	string_hash_t mStringHash;
-#else
-	typedef std::list<LLStringTableEntry *> string_list_t;
-	typedef string_list_t * string_list_ptr_t;
-	string_list_ptr_t	*mStringList;
-#endif	
+	S32 mMaxEntries;				// buckets in use, grows with the table
+	LLAtomicS32 mUniqueEntries;		// live strings
+
+private:
+	struct Node
+	{
+		LLStringTableEntry *mEntry;
+		U32 mHash;
+		Node *mNext;
+	};
+
+	// A bucket array is never changed once it's replaced, so a reader still
+	// walking it sees everything that was in it. Old arrays are kept until
+	// the table is destroyed.
+	struct Buckets
+	{
+		Buckets(U32 size, Buckets *replaced);
+		~Buckets();
+
+		U32 mSize;
+		Node * volatile *mHeads;
+		Buckets *mReplaced;
+	};
+
+	LLStringTableEntry *findEntry(const char *str, U32 hash_value);
+	void link(Buckets *buckets, LLStringTableEntry *entry, U32 hash_value);
+	void grow();
+
+	Buckets * volatile mBuckets;
+	S32 mNumNodes;
+
+	static LLMutex *sMutex;
 };
 
 extern LLStringTable gStringTable;
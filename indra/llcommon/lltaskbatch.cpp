@@ -0,0 +1,152 @@
+/**
+ * @file lltaskbatch.cpp
+ * @brief Batches of independent tasks shared out to a pool of helper threads
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltaskbatch.h"
+
+//============================================================================
+// LLTaskBatch
+
+LLTaskBatch::LLTaskBatch()
+	: mTaskCount(0), mNextTask(0), mTasksDone(0)
+{
+}
+
+LLTaskBatch::~LLTaskBatch()
+{
+}
+
+// MAIN THREAD
+void LLTaskBatch::run(S32 count, S32 max_helpers)
+{
+	// set before any helper can see the batch, adding the requests locks
+	mTaskCount = count;
+
+	// this thread takes a share too
+	if (count > 1)
+	{
+		LLTaskBatchThread::startBatch(this, llmin(count - 1, max_helpers));
+	}
+	runTasks();
+	while (mTasksDone < count)
+	{
+		LLThread::yield();
+	}
+}
+
+void LLTaskBatch::runTasks()
+{
+	S32 index;
+	while ((index = mNextTask++) < mTaskCount)
+	{
+		runTask(index);
+		mTasksDone++;
+	}
+}
+
+//============================================================================
+// LLTaskBatchThread
+
+//static
+LLTaskBatchThread::thread_list_t LLTaskBatchThread::sThreads;
+
+LLTaskBatchThread::LLTaskBatchThread()
+	: LLQueuedThread("taskbatch", true)
+{
+}
+
+void LLTaskBatchThread::addBatch(LLTaskBatch* batch)
+{
+	BatchRequest* req = new BatchRequest(generateHandle(), batch);
+	if (!addRequest(req))
+	{
+		req->deleteRequest();
+	}
+}
+
+//static
+void LLTaskBatchThread::initClass(S32 num_threads, bool threaded)
+{
+	llassert(sThreads.empty());
+	if (!threaded)
+	{ // a helper that only runs when polled would just be slower
+		return;
+	}
+
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		sThreads.push_back(new LLTaskBatchThread());
+	}
+}
+
+//static
+void LLTaskBatchThread::cleanupClass()
+{
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		delete *iter;
+	}
+	sThreads.clear();
+}
+
+//static
+void LLTaskBatchThread::startBatch(LLTaskBatch* batch, S32 max_helpers)
+{
+	S32 helpers = llmin(max_helpers, (S32) sThreads.size());
+	for (S32 i = 0; i < helpers; i++)
+	{
+		sThreads[i]->addBatch(batch);
+		sThreads[i]->update(0); // unpauses the thread
+	}
+}
+
+LLTaskBatchThread::BatchRequest::BatchRequest(handle_t handle, LLTaskBatch* batch)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+	  mBatch(batch)
+{
+}
+
+LLTaskBatchThread::BatchRequest::~BatchRequest()
+{
+}
+
+void LLTaskBatchThread::BatchRequest::deleteRequest()
+{
+	LLQueuedThread::QueuedRequest::deleteRequest();
+}
+
+bool LLTaskBatchThread::BatchRequest::processRequest()
+{
+	// finds nothing to do if the main thread already drained the batch
+	mBatch->runTasks();
+	return true;
+}
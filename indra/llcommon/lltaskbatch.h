@@ -0,0 +1,108 @@
+/**
+ * @file lltaskbatch.h
+ * @brief Batches of independent tasks shared out to a pool of helper threads
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTASKBATCH_H
+#define LL_LLTASKBATCH_H
+
+#include <vector>
+#include "llqueuedthread.h"
+
+//============================================================================
+// LLTaskBatch
+// A set of independent tasks that the main thread works through together with
+// the LLTaskBatchThread helpers. Tasks are claimed one at a time by whichever
+// thread asks next, so a helper that wakes up late just finds nothing left.
+
+class LLTaskBatch : public LLThreadSafeRefCount
+{
+public:
+	LLTaskBatch();
+
+	// MAIN THREAD, runs tasks 0 to count - 1 with up to max_helpers helpers
+	// and returns once they are all done. Only call this once per batch.
+	void run(S32 count, S32 max_helpers);
+
+	// any thread, claims and runs tasks until there are none left
+	void runTasks();
+
+protected:
+	virtual ~LLTaskBatch();
+
+	// any thread, must not touch anything another task of the batch does
+	virtual void runTask(S32 index) = 0;
+
+private:
+	S32 mTaskCount;
+	LLAtomicS32 mNextTask;
+	LLAtomicS32 mTasksDone;
+};
+
+//============================================================================
+// LLTaskBatchThread
+// The pool of helpers LLTaskBatch::run() wakes up. Like LLVFSThread this is
+// a static pool set up by initClass(); with no threads every batch simply
+// runs on the main thread.
+
+class LLTaskBatchThread : public LLQueuedThread
+{
+	class BatchRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~BatchRequest(); // use deleteRequest()
+
+	public:
+		BatchRequest(handle_t handle, LLTaskBatch* batch);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void deleteRequest();
+
+	private:
+		LLPointer<LLTaskBatch> mBatch;
+	};
+
+public:
+	LLTaskBatchThread();
+
+	void addBatch(LLTaskBatch* batch);
+
+	static void initClass(S32 num_threads, bool threaded = true);
+	static void cleanupClass();
+	static BOOL isInitialized() { return !sThreads.empty(); }
+	// wakes up to max_helpers threads to work on batch
+	static void startBatch(LLTaskBatch* batch, S32 max_helpers);
+
+private:
+	typedef std::vector<LLTaskBatchThread*> thread_list_t;
+	static thread_list_t sThreads;
+};
+
+#endif // LL_LLTASKBATCH_H
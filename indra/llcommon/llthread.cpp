@@ -36,6 +36,7 @@
 
 #include "llthread.h"
 
+#include "llstl.h"
 #include "lltimer.h"
 
 #if LL_LINUX || LL_SOLARIS
@@ -75,6 +76,9 @@ void *APR_THREAD_FUNC LLThread::staticRun(apr_thread_t *apr_threadp, void *datap
 	// Create a thread local APRFile pool.
 	LLVolatileAPRPool::createLocalAPRFilePool();
 
+	// Name this thread's fast timers and event trace.
+	LLThreadRecord::registerThread(threadp->mName);
+
 	// Run the user supplied function
 	threadp->run();
 
@@ -339,6 +343,93 @@ void LLCondition::broadcast()
 
 //============================================================================
 
+apr_threadkey_t* LLThreadRecord::sKey = NULL;
+LLMutex* LLThreadRecord::sMutex = NULL;
+std::vector<LLThreadRecord*> LLThreadRecord::sRecords;
+
+// Called by APR on the way out of every thread that has a record.
+static void thread_record_exited(void* data)
+{
+	LLThreadRecord* recordp = (LLThreadRecord*)data;
+	LLMutex* mutexp = LLThreadRecord::getMutex();
+	if (mutexp)
+	{
+		LLMutexLock lock(mutexp);
+		recordp->mExited = TRUE;
+	}
+}
+
+LLThreadRecord::LLThreadRecord(S32 id)
+:	mID(id),
+	mExited(FALSE),
+	mTimers(NULL),
+	mTrace(NULL)
+{
+}
+
+//static
+void LLThreadRecord::initClass()
+{
+	if (sKey)
+	{
+		return;
+	}
+	apr_status_t status = apr_threadkey_private_create(&sKey, &thread_record_exited, gAPRPoolp);
+	if (status != APR_SUCCESS)
+	{
+		sKey = NULL;
+		return;
+	}
+	sMutex = new LLMutex(gAPRPoolp);
+	registerThread("Main");
+}
+
+//static
+void LLThreadRecord::cleanupClass()
+{
+	// Every other thread has stopped by now, and LLFastTimer and
+	// LLEventTrace have let go of their parts.
+	sKey = NULL;
+	for_each(sRecords.begin(), sRecords.end(), DeletePointer());
+	sRecords.clear();
+	delete sMutex;
+	sMutex = NULL;
+}
+
+//static
+LLThreadRecord* LLThreadRecord::getCurrent()
+{
+	if (!sKey)
+	{
+		return NULL;
+	}
+
+	void* data = NULL;
+	apr_threadkey_private_get(&data, sKey);
+	LLThreadRecord* recordp = (LLThreadRecord*)data;
+	if (!recordp)
+	{
+		LLMutexLock lock(sMutex);
+		recordp = new LLThreadRecord((S32)sRecords.size() + 1);
+		sRecords.push_back(recordp);
+		apr_threadkey_private_set(recordp, sKey);
+	}
+	return recordp;
+}
+
+//static
+void LLThreadRecord::registerThread(const std::string& name)
+{
+	LLThreadRecord* recordp = getCurrent();
+	if (recordp)
+	{
+		LLMutexLock lock(sMutex);
+		recordp->mName = name;
+	}
+}
+
+//============================================================================
+
 //----------------------------------------------------------------------------
 
 //static
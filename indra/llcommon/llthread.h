@@ -35,6 +35,8 @@
 
 #include "llapr.h"
 #include "llapp.h"
+#include "lleventtrace.h"
+#include "llfasttimer.h"
 #include "llmemory.h"
 
 #include "apr_thread_cond.h"
@@ -177,6 +179,43 @@ private:
 
 //============================================================================
 
+// One per thread that has timed or traced anything, made on its first use
+// and found again without locking. LLFastTimer and LLEventTrace hang their
+// per thread data off it, and get the thread's name and whether it has
+// exited from it. Records are kept until cleanupClass(), since what was
+// timed or traced on a thread is still shown after it exits.
+class LLThreadRecord
+{
+public:
+	// Called by ll_init_apr() and ll_cleanup_apr() on the main thread.
+	static void initClass();
+	static void cleanupClass();
+
+	// The calling thread's record; NULL before initClass().
+	static LLThreadRecord* getCurrent();
+	// Names the calling thread. LLThread names its threads when they start.
+	static void registerThread(const std::string& name);
+	// Held to read the mName and mExited of another thread's record.
+	static LLMutex* getMutex()				{ return sMutex; }
+
+	S32 mID;					// in the order the threads were first seen
+	std::string mName;			// empty if the thread was never named
+	BOOL mExited;
+
+	// owned by LLFastTimer and LLEventTrace
+	LLFastTimer::ThreadTimers* mTimers;
+	LLEventTrace::ThreadTrace* mTrace;
+
+private:
+	LLThreadRecord(S32 id);
+
+	static apr_threadkey_t* sKey;
+	static LLMutex* sMutex;
+	static std::vector<LLThreadRecord*> sRecords;
+};
+
+//============================================================================
+
 void LLThread::lockData()
 {
 	mRunCondition->lock();
@@ -0,0 +1,417 @@
+/**
+ * @file lluuidmap.h
+ * @brief Open addressing hash containers keyed on LLUUID
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLUUIDMAP_H
+#define LL_LLUUIDMAP_H
+
+#include "stdtypes.h"
+#include "lldefs.h"
+#include "lluuid.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Drop-in replacements for std::map<LLUUID, T> and std::set<LLUUID> where
+// the order of the keys doesn't matter. Values live in one flat array,
+// found by linear probing from a slot picked by the key, so a lookup is
+// usually a single cache miss instead of one per level of a tree.
+//
+// Most ids are MD5 digests already, so the slot comes from the sum of the
+// key's words (getCRC32()) times a large odd constant, keeping the top
+// bits. That's one multiply, and still spreads out hand-made ids that only
+// differ in a byte or two.
+//
+// Iterators work like std::map's except that iteration order is arbitrary
+// and an insert can invalidate all of them, as with a hash_map. Erasing
+// only invalidates the erased element, so the usual
+//	map.erase(iter++);
+// still works: erased slots are marked and reused rather than shifted.
+
+template <class VALUE, class KEY_OF>
+class LLUUIDHashTable
+{
+public:
+	typedef LLUUID key_type;
+	typedef VALUE value_type;
+	typedef size_t size_type;
+
+	template <class REF, class PTR>
+	class iterator_base
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef VALUE value_type;
+		typedef ptrdiff_t difference_type;
+		typedef PTR pointer;
+		typedef REF reference;
+
+		iterator_base() : mTable(NULL), mSlot(0) {}
+		// lets an iterator convert to a const_iterator
+		template <class R, class P>
+		iterator_base(const iterator_base<R, P>& rhs) : mTable(rhs.mTable), mSlot(rhs.mSlot) {}
+
+		REF operator*() const			{ return mTable->mValues[mSlot]; }
+		PTR operator->() const			{ return &mTable->mValues[mSlot]; }
+
+		iterator_base& operator++()
+		{
+			mSlot = mTable->nextFull(mSlot + 1);
+			return *this;
+		}
+		iterator_base operator++(int)
+		{
+			iterator_base old = *this;
+			++*this;
+			return old;
+		}
+
+		template <class R, class P>
+		bool operator==(const iterator_base<R, P>& rhs) const	{ return mSlot == rhs.mSlot; }
+		template <class R, class P>
+		bool operator!=(const iterator_base<R, P>& rhs) const	{ return mSlot != rhs.mSlot; }
+
+	private:
+		friend class LLUUIDHashTable;
+		template <class R, class P> friend class iterator_base;
+
+		iterator_base(const LLUUIDHashTable* table, size_type slot) : mTable(table), mSlot(slot) {}
+
+		const LLUUIDHashTable* mTable;
+		size_type mSlot;
+	};
+	typedef iterator_base<VALUE&, VALUE*> iterator;
+	typedef iterator_base<const VALUE&, const VALUE*> const_iterator;
+
+	LLUUIDHashTable()
+	:	mValues(NULL),
+		mStates(NULL),
+		mCapacity(0),
+		mShift(32),
+		mSize(0),
+		mErased(0)
+	{
+	}
+
+	LLUUIDHashTable(const LLUUIDHashTable& rhs)
+	:	mValues(NULL),
+		mStates(NULL),
+		mCapacity(0),
+		mShift(32),
+		mSize(0),
+		mErased(0)
+	{
+		copy(rhs);
+	}
+
+	~LLUUIDHashTable()
+	{
+		clear();
+		deallocate();
+	}
+
+	LLUUIDHashTable& operator=(const LLUUIDHashTable& rhs)
+	{
+		if (this != &rhs)
+		{
+			clear();
+			copy(rhs);
+		}
+		return *this;
+	}
+
+	iterator begin()				{ return iterator(this, nextFull(0)); }
+	iterator end()					{ return iterator(this, mCapacity); }
+	const_iterator begin() const	{ return const_iterator(this, nextFull(0)); }
+	const_iterator end() const		{ return const_iterator(this, mCapacity); }
+
+	bool empty() const				{ return mSize == 0; }
+	size_type size() const			{ return mSize; }
+	// slots allocated, for diagnostics
+	size_type capacity() const		{ return mCapacity; }
+
+	iterator find(const LLUUID& key)
+	{
+		return iterator(this, findSlot(key));
+	}
+	const_iterator find(const LLUUID& key) const
+	{
+		return const_iterator(this, findSlot(key));
+	}
+	size_type count(const LLUUID& key) const
+	{
+		return findSlot(key) != mCapacity ? 1 : 0;
+	}
+
+	std::pair<iterator, bool> insert(const VALUE& value)
+	{
+		const LLUUID& key = KEY_OF()(value);
+		size_type slot = findSlot(key);
+		if (slot != mCapacity)
+		{
+			return std::make_pair(iterator(this, slot), false);
+		}
+		slot = insertSlot(key);
+		new (&mValues[slot]) VALUE(value);
+		mStates[slot] = FULL;
+		mSize++;
+		return std::make_pair(iterator(this, slot), true);
+	}
+
+	void erase(iterator iter)
+	{
+		mValues[iter.mSlot].~VALUE();
+		mStates[iter.mSlot] = ERASED;
+		mSize--;
+		mErased++;
+	}
+	size_type erase(const LLUUID& key)
+	{
+		size_type slot = findSlot(key);
+		if (slot == mCapacity)
+		{
+			return 0;
+		}
+		erase(iterator(this, slot));
+		return 1;
+	}
+
+	void clear()
+	{
+		for (size_type i = 0; i < mCapacity; i++)
+		{
+			if (mStates[i] == FULL)
+			{
+				mValues[i].~VALUE();
+			}
+			mStates[i] = EMPTY;
+		}
+		mSize = 0;
+		mErased = 0;
+	}
+
+	// Makes room for count values without growing again.
+	void reserve(size_type count)
+	{
+		size_type capacity = MIN_CAPACITY;
+		while (tooFull(count, capacity))
+		{
+			capacity *= 2;
+		}
+		if (capacity > mCapacity)
+		{
+			rehash(capacity);
+		}
+	}
+
+	void swap(LLUUIDHashTable& rhs)
+	{
+		std::swap(mValues, rhs.mValues);
+		std::swap(mStates, rhs.mStates);
+		std::swap(mCapacity, rhs.mCapacity);
+		std::swap(mShift, rhs.mShift);
+		std::swap(mSize, rhs.mSize);
+		std::swap(mErased, rhs.mErased);
+	}
+
+protected:
+	enum { EMPTY = 0, FULL, ERASED };
+	enum { MIN_CAPACITY = 16 };
+
+	// Three quarters full, counting erased slots, since probes have to
+	// step over them too.
+	static bool tooFull(size_type used, size_type capacity)
+	{
+		return used * 4 > capacity * 3;
+	}
+
+	size_type hashSlot(const LLUUID& key) const
+	{
+		return (size_type)((key.getCRC32() * 2654435769U) >> mShift);
+	}
+
+	// The slot holding key, or mCapacity if there isn't one.
+	size_type findSlot(const LLUUID& key) const
+	{
+		if (!mSize)
+		{
+			return mCapacity;
+		}
+		size_type mask = mCapacity - 1;
+		for (size_type slot = hashSlot(key); ; slot = (slot + 1) & mask)
+		{
+			if (mStates[slot] == EMPTY)
+			{
+				return mCapacity;
+			}
+			if (mStates[slot] == FULL && KEY_OF()(mValues[slot]) == key)
+			{
+				return slot;
+			}
+		}
+	}
+
+	// A free slot for key, which isn't in the table yet, growing the table
+	// or clearing out erased slots first if needs be.
+	size_type insertSlot(const LLUUID& key)
+	{
+		if (tooFull(mSize + mErased + 1, mCapacity))
+		{
+			size_type capacity = llmax((size_type)MIN_CAPACITY, mCapacity);
+			while (tooFull(mSize + 1, capacity))
+			{
+				capacity *= 2;
+			}
+			rehash(capacity);
+		}
+		size_type mask = mCapacity - 1;
+		size_type slot = hashSlot(key);
+		while (mStates[slot] == FULL)
+		{
+			slot = (slot + 1) & mask;
+		}
+		if (mStates[slot] == ERASED)
+		{
+			mErased--;
+		}
+		return slot;
+	}
+
+	size_type nextFull(size_type slot) const
+	{
+		while (slot < mCapacity && mStates[slot] != FULL)
+		{
+			slot++;
+		}
+		return slot;
+	}
+
+	void rehash(size_type capacity)
+	{
+		VALUE* old_values = mValues;
+		U8* old_states = mStates;
+		size_type old_capacity = mCapacity;
+
+		mValues = std::allocator<VALUE>().allocate(capacity);
+		mStates = new U8[capacity];
+		memset(mStates, EMPTY, capacity);
+		mCapacity = capacity;
+		mShift = 32;
+		while (capacity > 1)
+		{
+			capacity >>= 1;
+			mShift--;
+		}
+		mErased = 0;
+
+		for (size_type i = 0; i < old_capacity; i++)
+		{
+			if (old_states[i] == FULL)
+			{
+				size_type slot = insertSlot(KEY_OF()(old_values[i]));
+				new (&mValues[slot]) VALUE(old_values[i]);
+				mStates[slot] = FULL;
+				old_values[i].~VALUE();
+			}
+		}
+		if (old_values)
+		{
+			std::allocator<VALUE>().deallocate(old_values, old_capacity);
+		}
+		delete [] old_states;
+	}
+
+	void copy(const LLUUIDHashTable& rhs)
+	{
+		reserve(rhs.mSize);
+		for (const_iterator iter = rhs.begin(); iter != rhs.end(); ++iter)
+		{
+			insert(*iter);
+		}
+	}
+
+	void deallocate()
+	{
+		if (mValues)
+		{
+			std::allocator<VALUE>().deallocate(mValues, mCapacity);
+		}
+		delete [] mStates;
+		mValues = NULL;
+		mStates = NULL;
+		mCapacity = 0;
+	}
+
+	VALUE* mValues;
+	U8* mStates;
+	size_type mCapacity;	// always a power of 2
+	S32 mShift;				// 32 - log2(mCapacity)
+	size_type mSize;
+	size_type mErased;
+};
+
+template <class DATA>
+struct LLUUIDMapKey
+{
+	const LLUUID& operator()(const std::pair<const LLUUID, DATA>& value) const	{ return value.first; }
+};
+
+struct LLUUIDSetKey
+{
+	const LLUUID& operator()(const LLUUID& value) const	{ return value; }
+};
+
+template <class DATA>
+class LLUUIDMap : public LLUUIDHashTable<std::pair<const LLUUID, DATA>, LLUUIDMapKey<DATA> >
+{
+public:
+	typedef DATA mapped_type;
+
+	DATA& operator[](const LLUUID& key)
+	{
+		typename LLUUIDMap::iterator iter = this->find(key);
+		if (iter != this->end())
+		{
+			return iter->second;
+		}
+		return this->insert(std::make_pair(key, DATA())).first->second;
+	}
+};
+
+class LLUUIDSet : public LLUUIDHashTable<LLUUID, LLUUIDSetKey>
+{
+};
+
+#endif
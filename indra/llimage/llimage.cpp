@@ -37,6 +37,7 @@
 #include "llmath.h"
 #include "v4coloru.h"
 #include "llmemtype.h"
+#include "llsys.h"
 
 #include "llimagebmp.h"
 #include "llimagetga.h"
@@ -59,6 +60,7 @@ void LLImage::initClass()
 {
 	sMutex = new LLMutex(NULL);
 	LLImageJ2C::openDSO();
+	LLImageRaw::setUseSSE2(gSysCPU.hasSSE2());
 }
 
 //static
@@ -244,6 +246,7 @@ U8* LLImageBase::allocateDataSize(S32 width, S32 height, S32 ncomponents, S32 si
 
 S32 LLImageRaw::sGlobalRawMemory = 0;
 S32 LLImageRaw::sRawImageCount = 0;
+bool LLImageRaw::sUseSSE2 = false;
 
 LLImageRaw::LLImageRaw()
 	: LLImageBase()
@@ -411,6 +414,15 @@ void LLImageRaw::verticalFlip()
 {
 	LLMemType mt1((LLMemType::EMemType)mMemType);
 	S32 row_bytes = getWidth() * getComponents();
+	if (sUseSSE2)
+	{
+		// swap in place, no line buffer needed
+		for (S32 row = 0; row < getHeight() / 2; row++)
+		{
+			swapRowsSSE2(getData() + row * row_bytes, getData() + (getHeight() - 1 - row) * row_bytes, row_bytes);
+		}
+		return;
+	}
 	U8* line_buffer = new U8[row_bytes];
 	if (!line_buffer )
 	{
@@ -501,6 +513,12 @@ void LLImageRaw::biasedScaleToPowerOfTwo(S32 max_dim)
 
 
 
+//static
+void LLImageRaw::setUseSSE2(bool use_sse2)
+{
+	sUseSSE2 = use_sse2 && supportsSSE2();
+}
+
 // Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f).  Thanks, Jim Blinn!
 inline U8 LLImageRaw::fastFractionalMult( U8 a, U8 b )
 {
@@ -557,6 +575,22 @@ void LLImageRaw::compositeScaled4onto3(LLImageRaw* src)
 	// Vertical: scale but no composite
 	S32 temp_data_size = src->getWidth() * dst->getHeight() * src->getComponents();
 	U8* temp_buffer = new U8[ temp_data_size ];
+	if (sUseSSE2)
+	{
+		scaleRowsSSE2( src->getData(), temp_buffer, src->getComponents() * src->getWidth(), src->getHeight(), dst->getHeight() );
+
+		// Horizontal: scale a row, then composite it
+		U8* row_buffer = new U8[ src->getComponents() * dst->getWidth() ];
+		for( S32 row = 0; row < dst->getHeight(); row++ )
+		{
+			copyLineScaledSSE2( temp_buffer + (src->getComponents() * src->getWidth() * row), row_buffer, src->getComponents(), src->getWidth(), dst->getWidth() );
+			compositeRow4onto3SSE2( row_buffer, dst->getData() + (dst->getComponents() * dst->getWidth() * row), dst->getWidth() );
+		}
+		delete[] row_buffer;
+		delete[] temp_buffer;
+		return;
+	}
+
 	for( S32 col = 0; col < src->getWidth(); col++ )
 	{
 		copyLineScaled( src->getData() + (src->getComponents() * col), temp_buffer + (src->getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
@@ -600,6 +634,11 @@ void LLImageRaw::compositeUnscaled4onto3( LLImageRaw* src )
 	U8* src_data = src->getData();
 	U8* dst_data = dst->getData();
 	S32 pixels = getWidth() * getHeight();
+	if (sUseSSE2)
+	{
+		compositeRow4onto3SSE2( src_data, dst_data, pixels );
+		return;
+	}
 	while( pixels-- )
 	{
 		U8 alpha = src_data[3];
@@ -756,6 +795,11 @@ void LLImageRaw::copyUnscaled4onto3( LLImageRaw* src )
 	S32 pixels = getWidth() * getHeight();
 	U8* src_data = src->getData();
 	U8* dst_data = dst->getData();
+	if (sUseSSE2)
+	{
+		copyRow4onto3SSE2( src_data, dst_data, pixels );
+		return;
+	}
 	for( S32 i=0; i<pixels; i++ )
 	{
 		dst_data[0] = src_data[0];
@@ -778,6 +822,11 @@ void LLImageRaw::copyUnscaled3onto4( LLImageRaw* src )
 	S32 pixels = getWidth() * getHeight();
 	U8* src_data = src->getData();
 	U8* dst_data = dst->getData();
+	if (sUseSSE2)
+	{
+		copyRow3onto4SSE2( src_data, dst_data, pixels );
+		return;
+	}
 	for( S32 i=0; i<pixels; i++ )
 	{
 		dst_data[0] = src_data[0];
@@ -809,15 +858,22 @@ void LLImageRaw::copyScaled( LLImageRaw* src )
 	S32 temp_data_size = src->getWidth() * dst->getHeight() * getComponents();
 	llassert_always(temp_data_size > 0);
 	U8* temp_buffer = new U8[ temp_data_size ];
-	for( S32 col = 0; col < src->getWidth(); col++ )
+	if (sUseSSE2)
 	{
-		copyLineScaled( src->getData() + (getComponents() * col), temp_buffer + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
+		scaleRowsSSE2( src->getData(), temp_buffer, getComponents() * src->getWidth(), src->getHeight(), dst->getHeight() );
+	}
+	else
+	{
+		for( S32 col = 0; col < src->getWidth(); col++ )
+		{
+			copyLineScaled( src->getData() + (getComponents() * col), temp_buffer + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
+		}
 	}
 
 	// Horizontal
 	for( S32 row = 0; row < dst->getHeight(); row++ )
 	{
-		copyLineScaled( temp_buffer + (getComponents() * src->getWidth() * row), dst->getData() + (getComponents() * dst->getWidth() * row), src->getWidth(), dst->getWidth(), 1, 1 );
+		scaleRow( temp_buffer + (getComponents() * src->getWidth() * row), dst->getData() + (getComponents() * dst->getWidth() * row), src->getWidth(), dst->getWidth() );
 	}
 
 	// Clean up
@@ -846,9 +902,16 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 		S32 temp_data_size = old_width * new_height * getComponents();
 		llassert_always(temp_data_size > 0);
 		U8* temp_buffer = new U8[ temp_data_size ];
-		for( S32 col = 0; col < old_width; col++ )
+		if (sUseSSE2)
+		{
+			scaleRowsSSE2( getData(), temp_buffer, getComponents() * old_width, old_height, new_height );
+		}
+		else
 		{
-			copyLineScaled( getData() + (getComponents() * col), temp_buffer + (getComponents() * col), old_height, new_height, old_width, old_width );
+			for( S32 col = 0; col < old_width; col++ )
+			{
+				copyLineScaled( getData() + (getComponents() * col), temp_buffer + (getComponents() * col), old_height, new_height, old_width, old_width );
+			}
 		}
 
 		deleteData();
@@ -858,7 +921,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 		// Horizontal
 		for( S32 row = 0; row < new_height; row++ )
 		{
-			copyLineScaled( temp_buffer + (getComponents() * old_width * row), new_buffer + (getComponents() * new_width * row), old_width, new_width, 1, 1 );
+			scaleRow( temp_buffer + (getComponents() * old_width * row), new_buffer + (getComponents() * new_width * row), old_width, new_width );
 		}
 
 		// Clean up
@@ -1021,6 +1084,18 @@ void LLImageRaw::copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixe
 	}
 }
 
+void LLImageRaw::scaleRow( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
+{
+	if (sUseSSE2 && getComponents() >= 3)
+	{
+		copyLineScaledSSE2( in, out, getComponents(), in_pixel_len, out_pixel_len );
+	}
+	else
+	{
+		copyLineScaled( in, out, in_pixel_len, out_pixel_len, 1, 1 );
+	}
+}
+
 void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
 {
 	llassert( getComponents() == 3 );
@@ -1052,9 +1127,9 @@ void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S3
 			// Interval is embedded in one input pixel
 			S32 t1 = index0 * IN_COMPONENTS;
 			in_scaled_r = in[t1 + 0];
-			in_scaled_g = in[t1 + 0];
-			in_scaled_b = in[t1 + 0];
-			in_scaled_a = in[t1 + 0];
+			in_scaled_g = in[t1 + 1];
+			in_scaled_b = in[t1 + 2];
+			in_scaled_a = in[t1 + 3];
 		}
 		else
 		{
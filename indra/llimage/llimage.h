@@ -229,6 +229,24 @@ public:
 	// Src and dst are same size.  Src has 4 components.  Dst has 3 components.
 	void compositeUnscaled4onto3( LLImageRaw* src );
 
+	// SSE2 versions of the copy, scale and composite loops live in
+	// llimage_sse2.cpp. supportsSSE2() is false when that file was not
+	// built with SSE2 enabled; setUseSSE2() picks the kernels at runtime.
+	static bool supportsSSE2();
+	static void setUseSSE2(bool use_sse2);
+	static bool getUseSSE2() { return sUseSSE2; }
+
+	// SSE2 kernels, only valid when supportsSSE2() is true.
+	// Box filters row_bytes wide rows from in_rows down or up to out_rows.
+	static void scaleRowsSSE2(const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows);
+	// Box filters a 3 or 4 component row from in_pixel_len to out_pixel_len pixels.
+	static void copyLineScaledSSE2(const U8* in, U8* out, S32 components, S32 in_pixel_len, S32 out_pixel_len);
+	// Blends a row of 4 component pixels over a row of 3 component pixels.
+	static void compositeRow4onto3SSE2(const U8* in, U8* out, S32 pixels);
+	static void copyRow3onto4SSE2(const U8* in, U8* out, S32 pixels);
+	static void copyRow4onto3SSE2(const U8* in, U8* out, S32 pixels);
+	static void swapRowsSSE2(U8* row_a, U8* row_b, S32 row_bytes);
+
 protected:
 	// Create an image from a local file (generally used in tools)
 	bool createFromFile(const std::string& filename, bool j2c_lowest_mip_only = false);
@@ -236,11 +254,17 @@ protected:
 	void copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step );
 	void compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
 
+	// Horizontal pass of a scale into out, using the SSE2 kernel when enabled
+	void scaleRow( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
+
 	U8	fastFractionalMult(U8 a,U8 b);
 
 public:
 	static S32 sGlobalRawMemory;
 	static S32 sRawImageCount;
+
+private:
+	static bool sUseSSE2;
 };
 
 // Compressed representation of image.
@@ -0,0 +1,412 @@
+/** 
+ * @file llimage_sse2.cpp
+ * @brief SSE2 kernels for scaling, compositing and converting LLImageRaw
+ * pixel data.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Visual Studio required settings for this file:
+// Code Generation: SSE2
+
+#include "linden_common.h"
+
+#include "llimage.h"
+
+#include "llmath.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+
+#if LL_VECTORIZE && (_M_IX86_FP > 1 || defined(__SSE2__) ) //These intrinsics are only valid with sse2 or higher.
+
+#include <emmintrin.h>
+
+// The kernels reproduce the arithmetic of the scalar loops in
+// llimage.cpp lane for lane: box filter sums are accumulated in the
+// same order in single precision and rounded with floor(x + 0.5),
+// and alpha blending uses the same integer approximation of x*y/255.
+
+// Zero extends the 16 bytes at p to four vectors of four floats
+inline void load_bytes_ps(const U8* p, __m128& f0, __m128& f1, __m128& f2, __m128& f3)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v = _mm_loadu_si128((const __m128i*)p);
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+	f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+	f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+	f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+	f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+// Rounds non-negative floats like llround() and saturates them to bytes
+inline __m128i round_ps_epu8(__m128 f0, __m128 f1, __m128 f2, __m128 f3)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128i i0 = _mm_cvttps_epi32(_mm_add_ps(f0, half));
+	__m128i i1 = _mm_cvttps_epi32(_mm_add_ps(f1, half));
+	__m128i i2 = _mm_cvttps_epi32(_mm_add_ps(f2, half));
+	__m128i i3 = _mm_cvttps_epi32(_mm_add_ps(f3, half));
+	return _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+}
+
+template <S32 COMPONENTS>
+inline __m128 load_pixel_ps(const U8* p)
+{
+	S32 bits;
+	if (COMPONENTS == 4)
+	{
+		memcpy(&bits, p, sizeof(bits));		/* Flawfinder: ignore */
+	}
+	else
+	{
+		bits = p[0] | (p[1] << 8) | (p[2] << 16);
+	}
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero);
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+}
+
+template <S32 COMPONENTS>
+inline void store_pixel_ps(U8* p, __m128 f)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128i i = _mm_cvttps_epi32(_mm_add_ps(f, half));
+	i = _mm_packus_epi16(_mm_packs_epi32(i, i), i);
+	S32 bits = _mm_cvtsi128_si32(i);
+	p[0] = (U8)bits;
+	p[1] = (U8)(bits >> 8);
+	p[2] = (U8)(bits >> 16);
+	if (COMPONENTS == 4)
+	{
+		p[3] = (U8)(bits >> 24);
+	}
+}
+
+// (U8)(255*(a/255.f)*(b/255.f) + 0.5f) on 16 bit lanes, see
+// LLImageRaw::fastFractionalMult()
+inline __m128i fast_fractional_mult_epi16(__m128i a, __m128i b)
+{
+	__m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+}
+
+inline U8 fast_fractional_mult(U8 a, U8 b)
+{
+	U32 i = a * b + 128;
+	return U8((i + (i>>8)) >> 8);
+}
+
+// static
+void LLImageRaw::scaleRowsSSE2(const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows)
+{
+	const F32 ratio = F32(in_rows) / out_rows; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const __m128 norm = _mm_set1_ps(norm_factor);
+
+	for (S32 y = 0; y < out_rows; y++)
+	{
+		// Same sampling as LLImageRaw::copyLineScaled(), applied to
+		// whole rows so that every load is contiguous.
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8* outp = out + y * row_bytes;
+		const U8* in0 = in + index0 * row_bytes;
+		if (index0 == index1)
+		{
+			memcpy(outp, in0, row_bytes);		/* Flawfinder: ignore */
+			continue;
+		}
+		const U8* in1 = (fract1 && index1 < in_rows) ? in + index1 * row_bytes : NULL;
+
+		const __m128 f0 = _mm_set1_ps(fract0);
+		const __m128 f1 = _mm_set1_ps(fract1);
+		S32 x = 0;
+		for (; x + 16 <= row_bytes; x += 16)
+		{
+			__m128 a0, a1, a2, a3;
+			__m128 b0, b1, b2, b3;
+			load_bytes_ps(in0 + x, a0, a1, a2, a3);
+			a0 = _mm_mul_ps(a0, f0);
+			a1 = _mm_mul_ps(a1, f0);
+			a2 = _mm_mul_ps(a2, f0);
+			a3 = _mm_mul_ps(a3, f0);
+			for (S32 u = index0 + 1; u < index1; u++)
+			{
+				load_bytes_ps(in + u * row_bytes + x, b0, b1, b2, b3);
+				a0 = _mm_add_ps(a0, b0);
+				a1 = _mm_add_ps(a1, b1);
+				a2 = _mm_add_ps(a2, b2);
+				a3 = _mm_add_ps(a3, b3);
+			}
+			if (in1)
+			{
+				load_bytes_ps(in1 + x, b0, b1, b2, b3);
+				a0 = _mm_add_ps(a0, _mm_mul_ps(b0, f1));
+				a1 = _mm_add_ps(a1, _mm_mul_ps(b1, f1));
+				a2 = _mm_add_ps(a2, _mm_mul_ps(b2, f1));
+				a3 = _mm_add_ps(a3, _mm_mul_ps(b3, f1));
+			}
+			_mm_storeu_si128((__m128i*)(outp + x),
+							 round_ps_epu8(_mm_mul_ps(a0, norm), _mm_mul_ps(a1, norm),
+										   _mm_mul_ps(a2, norm), _mm_mul_ps(a3, norm)));
+		}
+
+		// Leftover bytes at the end of the row
+		for (; x < row_bytes; x++)
+		{
+			F32 v = in0[x] * fract0;
+			for (S32 u = index0 + 1; u < index1; u++)
+			{
+				v += in[u * row_bytes + x];
+			}
+			if (in1)
+			{
+				v += in1[x] * fract1;
+			}
+			v *= norm_factor;
+			outp[x] = U8(llround(v));
+		}
+	}
+}
+
+template <S32 COMPONENTS>
+static void copy_line_scaled_sse2(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len)
+{
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const __m128 norm = _mm_set1_ps(norm_factor);
+
+	for (S32 x = 0; x < out_pixel_len; x++)
+	{
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8* outp = out + x * COMPONENTS;
+		if (index0 == index1)
+		{
+			// Interval is embedded in one input pixel
+			const U8* inp = in + index0 * COMPONENTS;
+			for (S32 i = 0; i < COMPONENTS; ++i)
+			{
+				outp[i] = inp[i];
+			}
+			continue;
+		}
+
+		__m128 acc = _mm_mul_ps(load_pixel_ps<COMPONENTS>(in + index0 * COMPONENTS), _mm_set1_ps(fract0));
+		for (S32 u = index0 + 1; u < index1; u++)
+		{
+			acc = _mm_add_ps(acc, load_pixel_ps<COMPONENTS>(in + u * COMPONENTS));
+		}
+		if (fract1 && index1 < in_pixel_len)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(load_pixel_ps<COMPONENTS>(in + index1 * COMPONENTS), _mm_set1_ps(fract1)));
+		}
+		store_pixel_ps<COMPONENTS>(outp, _mm_mul_ps(acc, norm));
+	}
+}
+
+// static
+void LLImageRaw::copyLineScaledSSE2(const U8* in, U8* out, S32 components, S32 in_pixel_len, S32 out_pixel_len)
+{
+	llassert(components == 3 || components == 4);
+	if (components == 4)
+	{
+		copy_line_scaled_sse2<4>(in, out, in_pixel_len, out_pixel_len);
+	}
+	else
+	{
+		copy_line_scaled_sse2<3>(in, out, in_pixel_len, out_pixel_len);
+	}
+}
+
+// static
+void LLImageRaw::compositeRow4onto3SSE2(const U8* in, U8* out, S32 pixels)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(255);
+
+	// Two pixels per pass. Alpha of 0 and 255 need no special casing,
+	// fastFractionalMult(x, 255) == x and fastFractionalMult(x, 0) == 0.
+	S32 i = 0;
+	for (; i + 2 <= pixels; i += 2)
+	{
+		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)in), zero);
+		__m128i alpha = _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+		alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+		S32 d0 = out[0] | (out[1] << 8) | (out[2] << 16);
+		S32 d1 = out[3] | (out[4] << 8) | (out[5] << 16);
+		__m128i dst = _mm_unpacklo_epi32(_mm_cvtsi32_si128(d0), _mm_cvtsi32_si128(d1));
+		dst = _mm_unpacklo_epi8(dst, zero);
+
+		__m128i res = _mm_add_epi16(fast_fractional_mult_epi16(dst, _mm_sub_epi16(full, alpha)),
+									fast_fractional_mult_epi16(src, alpha));
+		res = _mm_packus_epi16(res, res);
+		S32 p0 = _mm_cvtsi128_si32(res);
+		S32 p1 = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+		out[0] = (U8)p0;
+		out[1] = (U8)(p0 >> 8);
+		out[2] = (U8)(p0 >> 16);
+		out[3] = (U8)p1;
+		out[4] = (U8)(p1 >> 8);
+		out[5] = (U8)(p1 >> 16);
+
+		in += 8;
+		out += 6;
+	}
+
+	for (; i < pixels; i++)
+	{
+		U8 alpha = in[3];
+		U8 transparency = 255 - alpha;
+		out[0] = fast_fractional_mult(out[0], transparency) + fast_fractional_mult(in[0], alpha);
+		out[1] = fast_fractional_mult(out[1], transparency) + fast_fractional_mult(in[1], alpha);
+		out[2] = fast_fractional_mult(out[2], transparency) + fast_fractional_mult(in[2], alpha);
+		in += 4;
+		out += 3;
+	}
+}
+
+// static
+void LLImageRaw::copyRow3onto4SSE2(const U8* in, U8* out, S32 pixels)
+{
+	const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+	const __m128i alpha = _mm_set1_epi32((S32)0xff000000);
+
+	// Four pixels per pass, the 16 byte load reads a pixel and a bit
+	// ahead so stop early enough to stay inside the row.
+	S32 i = 0;
+	for (; i + 6 <= pixels; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)in);
+		__m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+		__m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+		__m128i p = _mm_unpacklo_epi64(p01, p23);
+		_mm_storeu_si128((__m128i*)out, _mm_or_si128(_mm_and_si128(p, rgb_mask), alpha));
+		in += 12;
+		out += 16;
+	}
+
+	for (; i < pixels; i++)
+	{
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+		out[3] = 255;
+		in += 3;
+		out += 4;
+	}
+}
+
+// static
+void LLImageRaw::copyRow4onto3SSE2(const U8* in, U8* out, S32 pixels)
+{
+	const __m128i mask0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+	const __m128i mask1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+	const __m128i mask2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
+	const __m128i mask3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
+
+	S32 i = 0;
+	for (; i + 4 <= pixels; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)in);
+		__m128i p = _mm_and_si128(v, mask0);
+		p = _mm_or_si128(p, _mm_srli_si128(_mm_and_si128(v, mask1), 1));
+		p = _mm_or_si128(p, _mm_srli_si128(_mm_and_si128(v, mask2), 2));
+		p = _mm_or_si128(p, _mm_srli_si128(_mm_and_si128(v, mask3), 3));
+
+		// 12 bytes out
+		_mm_storel_epi64((__m128i*)out, p);
+		S32 tail = _mm_cvtsi128_si32(_mm_srli_si128(p, 8));
+		memcpy(out + 8, &tail, sizeof(tail));		/* Flawfinder: ignore */
+		in += 16;
+		out += 12;
+	}
+
+	for (; i < pixels; i++)
+	{
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+		in += 4;
+		out += 3;
+	}
+}
+
+// static
+void LLImageRaw::swapRowsSSE2(U8* row_a, U8* row_b, S32 row_bytes)
+{
+	S32 x = 0;
+	for (; x + 16 <= row_bytes; x += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(row_a + x));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row_b + x));
+		_mm_storeu_si128((__m128i*)(row_a + x), b);
+		_mm_storeu_si128((__m128i*)(row_b + x), a);
+	}
+	for (; x < row_bytes; x++)
+	{
+		U8 t = row_a[x];
+		row_a[x] = row_b[x];
+		row_b[x] = t;
+	}
+}
+
+// static
+bool LLImageRaw::supportsSSE2()
+{
+	return true;
+}
+
+#else
+
+// Never called, LLImageRaw::setUseSSE2() refuses to enable them.
+void LLImageRaw::scaleRowsSSE2(const U8*, U8*, S32, S32, S32) { llassert(false); }
+void LLImageRaw::copyLineScaledSSE2(const U8*, U8*, S32, S32, S32) { llassert(false); }
+void LLImageRaw::compositeRow4onto3SSE2(const U8*, U8*, S32) { llassert(false); }
+void LLImageRaw::copyRow3onto4SSE2(const U8*, U8*, S32) { llassert(false); }
+void LLImageRaw::copyRow4onto3SSE2(const U8*, U8*, S32) { llassert(false); }
+void LLImageRaw::swapRowsSSE2(U8*, U8*, S32) { llassert(false); }
+
+// static
+bool LLImageRaw::supportsSSE2()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,358 @@
+/** 
+ * @file llimage_sse2_test.cpp
+ * @brief Checks the SSE2 LLImageRaw kernels against the scalar
+ * arithmetic and measures their pixel throughput.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include <cstdlib>
+#include <vector>
+// Class to test
+#include "../llimage.h"
+#include "llformat.h"
+#include "llmath.h"
+// For timer class
+#include "../llcommon/lltimer.h"
+// Tut header
+#include "../test/lltut.h"
+
+// -------------------------------------------------------------------------------------------
+// Reference implementations: the per pixel arithmetic of the scalar
+// LLImageRaw loops, written out plainly to compare the kernels against.
+// -------------------------------------------------------------------------------------------
+
+namespace
+{
+	U8 ref_fractional_mult(U8 a, U8 b)
+	{
+		U32 i = a * b + 128;
+		return U8((i + (i>>8)) >> 8);
+	}
+
+	// Box filters one channel of a line of pixels, step is in pixels
+	void ref_scale_line(const U8* in, U8* out, S32 components, S32 in_len, S32 out_len, S32 in_step, S32 out_step)
+	{
+		const F32 ratio = F32(in_len) / out_len;
+		const F32 norm_factor = 1.f / ratio;
+		for (S32 x = 0; x < out_len; x++)
+		{
+			const F32 sample0 = x * ratio;
+			const F32 sample1 = (x+1) * ratio;
+			const S32 index0 = llfloor(sample0);
+			const S32 index1 = llfloor(sample1);
+			const F32 fract0 = 1.f - (sample0 - F32(index0));
+			const F32 fract1 = sample1 - F32(index1);
+			for (S32 c = 0; c < components; c++)
+			{
+				U8& dst = out[x * out_step * components + c];
+				if (index0 == index1)
+				{
+					dst = in[index0 * in_step * components + c];
+					continue;
+				}
+				F32 v = in[index0 * in_step * components + c] * fract0;
+				for (S32 u = index0 + 1; u < index1; u++)
+				{
+					v += in[u * in_step * components + c];
+				}
+				if (fract1 && index1 < in_len)
+				{
+					v += in[index1 * in_step * components + c] * fract1;
+				}
+				dst = U8(llround(v * norm_factor));
+			}
+		}
+	}
+
+	void fill_random(std::vector<U8>& data)
+	{
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			data[i] = (U8)(rand() & 0xff);
+		}
+	}
+
+	// x87 builds may round the box filter sums differently by one
+	S32 count_mismatches(const std::vector<U8>& a, const std::vector<U8>& b)
+	{
+		S32 count = 0;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (abs((S32)a[i] - (S32)b[i]) > 1)
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+}
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	struct imagesse2_test
+	{
+		imagesse2_test()
+		{
+			srand(1234);
+		}
+
+		void skipUnsupported()
+		{
+			if (!LLImageRaw::supportsSSE2())
+			{
+				skip("llimage_sse2.cpp was built without SSE2");
+			}
+		}
+
+		void checkScale(S32 components, S32 in_w, S32 in_h, S32 out_w, S32 out_h)
+		{
+			std::vector<U8> src(in_w * in_h * components);
+			fill_random(src);
+
+			// vertical pass, column by column versus row by row
+			std::vector<U8> ref_temp(in_w * out_h * components);
+			std::vector<U8> sse_temp(ref_temp.size());
+			for (S32 col = 0; col < in_w; col++)
+			{
+				ref_scale_line(&src[components * col], &ref_temp[components * col], components, in_h, out_h, in_w, in_w);
+			}
+			LLImageRaw::scaleRowsSSE2(&src[0], &sse_temp[0], in_w * components, in_h, out_h);
+			ensure_equals(llformat("vertical %dx%dx%d to %d rows", in_w, in_h, components, out_h).c_str(),
+						  count_mismatches(ref_temp, sse_temp), 0);
+
+			// horizontal pass
+			std::vector<U8> ref_out(out_w * out_h * components);
+			std::vector<U8> sse_out(ref_out.size());
+			for (S32 row = 0; row < out_h; row++)
+			{
+				ref_scale_line(&ref_temp[components * in_w * row], &ref_out[components * out_w * row], components, in_w, out_w, 1, 1);
+				LLImageRaw::copyLineScaledSSE2(&ref_temp[components * in_w * row], &sse_out[components * out_w * row], components, in_w, out_w);
+			}
+			ensure_equals(llformat("horizontal %dx%d to %d columns", in_w, components, out_w).c_str(),
+						  count_mismatches(ref_out, sse_out), 0);
+		}
+	};
+
+	typedef test_group<imagesse2_test> imagesse2_t;
+	typedef imagesse2_t::object imagesse2_object_t;
+	tut::imagesse2_t tut_imagesse2("imagesse2");
+
+	template<> template<>
+	void imagesse2_object_t::test<1>()
+	{
+		skipUnsupported();
+		// power of two reductions, odd ratios and enlargement
+		for (S32 components = 3; components <= 4; components++)
+		{
+			checkScale(components, 512, 512, 256, 256);
+			checkScale(components, 1024, 1024, 128, 128);
+			checkScale(components, 300, 200, 128, 64);
+			checkScale(components, 77, 33, 31, 55);
+			checkScale(components, 64, 64, 256, 256);
+		}
+		// the vertical kernel doesn't care about the pixel layout
+		std::vector<U8> src(129 * 65);
+		fill_random(src);
+		std::vector<U8> ref_out(129 * 32);
+		std::vector<U8> sse_out(ref_out.size());
+		ref_scale_line(&src[0], &ref_out[0], 129, 65, 32, 1, 1);
+		LLImageRaw::scaleRowsSSE2(&src[0], &sse_out[0], 129, 65, 32);
+		ensure_equals("single channel", count_mismatches(ref_out, sse_out), 0);
+	}
+
+	template<> template<>
+	void imagesse2_object_t::test<2>()
+	{
+		skipUnsupported();
+		// composite must match exactly, including the fully opaque and
+		// fully transparent shortcuts of the scalar loop, odd lengths
+		// exercise the leftover pixel
+		for (S32 pixels = 1; pixels < 40; pixels++)
+		{
+			std::vector<U8> src(pixels * 4);
+			std::vector<U8> ref_dst(pixels * 3);
+			fill_random(src);
+			fill_random(ref_dst);
+			for (S32 i = 0; i < pixels; i++)
+			{
+				S32 kind = rand() % 3;
+				if (kind == 0) src[i * 4 + 3] = 0;
+				if (kind == 1) src[i * 4 + 3] = 255;
+			}
+			std::vector<U8> sse_dst(ref_dst);
+
+			for (S32 i = 0; i < pixels; i++)
+			{
+				U8 alpha = src[i * 4 + 3];
+				if (!alpha)
+				{
+					continue;
+				}
+				for (S32 c = 0; c < 3; c++)
+				{
+					U8& dst = ref_dst[i * 3 + c];
+					dst = (255 == alpha) ? src[i * 4 + c]
+						: ref_fractional_mult(dst, 255 - alpha) + ref_fractional_mult(src[i * 4 + c], alpha);
+				}
+			}
+			LLImageRaw::compositeRow4onto3SSE2(&src[0], &sse_dst[0], pixels);
+			ensure(llformat("composite of %d pixels", pixels).c_str(), ref_dst == sse_dst);
+		}
+	}
+
+	template<> template<>
+	void imagesse2_object_t::test<3>()
+	{
+		skipUnsupported();
+		// channel conversions and row swaps, with guard bytes to catch
+		// writes past the end of the row
+		const U8 GUARD = 0xa5;
+		for (S32 pixels = 1; pixels < 40; pixels++)
+		{
+			std::vector<U8> rgb(pixels * 3);
+			std::vector<U8> rgba(pixels * 4);
+			fill_random(rgb);
+			fill_random(rgba);
+
+			std::vector<U8> out4(pixels * 4 + 16, GUARD);
+			LLImageRaw::copyRow3onto4SSE2(&rgb[0], &out4[0], pixels);
+			for (S32 i = 0; i < pixels; i++)
+			{
+				ensure_equals("3onto4 r", out4[i * 4 + 0], rgb[i * 3 + 0]);
+				ensure_equals("3onto4 g", out4[i * 4 + 1], rgb[i * 3 + 1]);
+				ensure_equals("3onto4 b", out4[i * 4 + 2], rgb[i * 3 + 2]);
+				ensure_equals("3onto4 a", out4[i * 4 + 3], (U8)255);
+			}
+			ensure_equals("3onto4 guard", out4[pixels * 4], GUARD);
+
+			std::vector<U8> out3(pixels * 3 + 16, GUARD);
+			LLImageRaw::copyRow4onto3SSE2(&rgba[0], &out3[0], pixels);
+			for (S32 i = 0; i < pixels; i++)
+			{
+				ensure_equals("4onto3 r", out3[i * 3 + 0], rgba[i * 4 + 0]);
+				ensure_equals("4onto3 g", out3[i * 3 + 1], rgba[i * 4 + 1]);
+				ensure_equals("4onto3 b", out3[i * 3 + 2], rgba[i * 4 + 2]);
+			}
+			ensure_equals("4onto3 guard", out3[pixels * 3], GUARD);
+
+			std::vector<U8> row_a(rgba);
+			std::vector<U8> row_b(rgb.begin(), rgb.end());
+			row_b.resize(row_a.size());
+			std::vector<U8> orig_a(row_a);
+			std::vector<U8> orig_b(row_b);
+			LLImageRaw::swapRowsSSE2(&row_a[0], &row_b[0], (S32)row_a.size());
+			ensure("swapped a", row_a == orig_b);
+			ensure("swapped b", row_b == orig_a);
+		}
+	}
+
+	template<> template<>
+	void imagesse2_object_t::test<4>()
+	{
+		skipUnsupported();
+		// Throughput of a 2:1 reduction and a composite at common
+		// texture sizes, scalar reference versus SSE2. Reported only.
+		const S32 sizes[] = { 256, 512, 1024 };
+		for (S32 s = 0; s < 3; s++)
+		{
+			const S32 size = sizes[s];
+			const S32 half = size / 2;
+			const S32 iterations = (1024 * 1024 * 4) / (size * size);
+			std::vector<U8> src(size * size * 4);
+			std::vector<U8> temp(size * half * 4);
+			std::vector<U8> out(half * half * 4);
+			std::vector<U8> dst(size * size * 3);
+			fill_random(src);
+			fill_random(dst);
+
+			LLTimer timer;
+			for (S32 i = 0; i < iterations; i++)
+			{
+				for (S32 col = 0; col < size; col++)
+				{
+					ref_scale_line(&src[4 * col], &temp[4 * col], 4, size, half, size, size);
+				}
+				for (S32 row = 0; row < half; row++)
+				{
+					ref_scale_line(&temp[4 * size * row], &out[4 * half * row], 4, size, half, 1, 1);
+				}
+			}
+			F64 scalar_scale = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < iterations; i++)
+			{
+				LLImageRaw::scaleRowsSSE2(&src[0], &temp[0], size * 4, size, half);
+				for (S32 row = 0; row < half; row++)
+				{
+					LLImageRaw::copyLineScaledSSE2(&temp[4 * size * row], &out[4 * half * row], 4, size, half);
+				}
+			}
+			F64 sse2_scale = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < iterations; i++)
+			{
+				U8* dst_data = &dst[0];
+				const U8* src_data = &src[0];
+				for (S32 p = 0; p < size * size; p++)
+				{
+					U8 alpha = src_data[3];
+					U8 transparency = 255 - alpha;
+					dst_data[0] = ref_fractional_mult(dst_data[0], transparency) + ref_fractional_mult(src_data[0], alpha);
+					dst_data[1] = ref_fractional_mult(dst_data[1], transparency) + ref_fractional_mult(src_data[1], alpha);
+					dst_data[2] = ref_fractional_mult(dst_data[2], transparency) + ref_fractional_mult(src_data[2], alpha);
+					src_data += 4;
+					dst_data += 3;
+				}
+			}
+			F64 scalar_composite = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < iterations; i++)
+			{
+				LLImageRaw::compositeRow4onto3SSE2(&src[0], &dst[0], size * size);
+			}
+			F64 sse2_composite = timer.getElapsedTimeF64();
+
+			const F64 mpixels = (F64)size * size * iterations / 1000000.0;
+			llinfos << size << "x" << size << " RGBA"
+					<< " scale 2:1 Mpix/s scalar " << mpixels / llmax(scalar_scale, 0.000001)
+					<< " sse2 " << mpixels / llmax(sse2_scale, 0.000001)
+					<< " composite Mpix/s scalar " << mpixels / llmax(scalar_composite, 0.000001)
+					<< " sse2 " << mpixels / llmax(sse2_composite, 0.000001)
+					<< llendl;
+		}
+	}
+}
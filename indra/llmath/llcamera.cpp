@@ -35,6 +35,9 @@
 #include "llmath.h"
 #include "llcamera.h"
 
+// static
+bool LLCamera::sUseSSE = false;
+
 // ---------------- Constructors and destructors ----------------
 
 LLCamera::LLCamera() :
@@ -316,6 +319,28 @@ S32 LLCamera::AABBInFrustumNoFarClip(const LLVector3 &center, const LLVector3& r
 	return result;
 }
 
+void LLCamera::AABBInFrustumBatch(const F32* const center[3], const F32* const radius[3], S32 count, S32* results, BOOL no_far_clip)
+{
+	if (sUseSSE)
+	{
+		AABBInFrustumBatchSSE(center, radius, count, results, no_far_clip);
+		return;
+	}
+
+	for (S32 i = 0; i < count; i++)
+	{
+		LLVector3 c(center[0][i], center[1][i], center[2][i]);
+		LLVector3 r(radius[0][i], radius[1][i], radius[2][i]);
+		results[i] = no_far_clip ? AABBInFrustumNoFarClip(c, r) : AABBInFrustum(c, r);
+	}
+}
+
+// static
+void LLCamera::setUseSSE(bool use_sse)
+{
+	sUseSSE = use_sse && supportsSSE();
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
@@ -188,6 +188,18 @@ public:
 	S32 AABBInFrustum(const LLVector3 &center, const LLVector3& radius);
 	S32 AABBInFrustumNoFarClip(const LLVector3 &center, const LLVector3& radius);
 
+	// Tests count boxes at once. center and radius each point to three arrays
+	// (x, y and z components) of count floats. Writes what AABBInFrustum(), or
+	// AABBInFrustumNoFarClip() if no_far_clip is set, returns for each box to
+	// results. Four boxes at a time with SSE when enabled, see setUseSSE().
+	void AABBInFrustumBatch(const F32* const center[3], const F32* const radius[3], S32 count, S32* results, BOOL no_far_clip = FALSE);
+
+	// Whether llcamera_sse.cpp was built with SSE.
+	static bool supportsSSE();
+	// Enables the SSE batch tests, if supported. Off by default.
+	static void setUseSSE(bool use_sse);
+	static bool getUseSSE() { return sUseSSE; }
+
 	//does a quick 'n dirty sphere-sphere check
 	S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -207,6 +219,12 @@ protected:
 	void calculateFrustumPlanes(F32 left, F32 right, F32 top, F32 bottom);
 	void calculateFrustumPlanesFromWindow(F32 x1, F32 y1, F32 x2, F32 y2);
 	void calculateWorldFrustumPlanes();
+
+private:
+	// In llcamera_sse.cpp
+	void AABBInFrustumBatchSSE(const F32* const center[3], const F32* const radius[3], S32 count, S32* results, BOOL no_far_clip);
+
+	static bool sUseSSE;
 };
 
 
@@ -0,0 +1,159 @@
+/** 
+ * @file llcamera_sse.cpp
+ * @brief SSE versions of the LLCamera frustum tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+// Visual Studio required settings for this file:
+// Code Generation: SSE
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "llcamera.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+
+#if LL_VECTORIZE
+
+#include <xmmintrin.h>
+
+// Four boxes per vector. Each lane does the arithmetic of the scalar
+// AABBInFrustum() in the same order, so the results are identical.
+void LLCamera::AABBInFrustumBatchSSE(const F32* const center[3], const F32* const radius[3], S32 count, S32* results, BOOL no_far_clip)
+{
+	// Plane normals, -d and the octant signs that AABBInFrustum() gets
+	// from its scaler table, broadcast once for the whole batch
+	__m128 nx[7], ny[7], nz[7], neg_d[7], sx[7], sy[7], sz[7];
+	U32 planes = 0;
+	for (U32 i = 0; i < mPlaneCount; i++)
+	{
+		if (no_far_clip && i == 5)
+		{
+			continue;
+		}
+
+		const LLPlane& p = mAgentPlanes[i].p;
+		const U8 mask = mAgentPlanes[i].mask;
+		nx[planes] = _mm_set1_ps(p.mV[0]);
+		ny[planes] = _mm_set1_ps(p.mV[1]);
+		nz[planes] = _mm_set1_ps(p.mV[2]);
+		neg_d[planes] = _mm_set1_ps(-p.mV[3]);
+		sx[planes] = _mm_set1_ps(mask & 1 ? 1.f : -1.f);
+		sy[planes] = _mm_set1_ps(mask & 2 ? 1.f : -1.f);
+		sz[planes] = _mm_set1_ps(mask & 4 ? 1.f : -1.f);
+		planes++;
+	}
+	const __m128 corner_dist_sq = _mm_set1_ps(mFrustumCornerDist * mFrustumCornerDist);
+
+	S32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(center[0] + i);
+		const __m128 cy = _mm_loadu_ps(center[1] + i);
+		const __m128 cz = _mm_loadu_ps(center[2] + i);
+		const __m128 rx = _mm_loadu_ps(radius[0] + i);
+		const __m128 ry = _mm_loadu_ps(radius[1] + i);
+		const __m128 rz = _mm_loadu_ps(radius[2] + i);
+
+		__m128 outside = _mm_setzero_ps();
+		__m128 partial = _mm_setzero_ps();
+		for (U32 j = 0; j < planes; j++)
+		{
+			const __m128 rsx = _mm_mul_ps(rx, sx[j]);
+			const __m128 rsy = _mm_mul_ps(ry, sy[j]);
+			const __m128 rsz = _mm_mul_ps(rz, sz[j]);
+
+			// n * minp and n * maxp
+			const __m128 dist_min = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(nx[j], _mm_sub_ps(cx, rsx)),
+				_mm_mul_ps(ny[j], _mm_sub_ps(cy, rsy))),
+				_mm_mul_ps(nz[j], _mm_sub_ps(cz, rsz)));
+			const __m128 dist_max = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(nx[j], _mm_add_ps(cx, rsx)),
+				_mm_mul_ps(ny[j], _mm_add_ps(cy, rsy))),
+				_mm_mul_ps(nz[j], _mm_add_ps(cz, rsz)));
+
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist_min, neg_d[j]));
+			partial = _mm_or_ps(partial, _mm_cmpgt_ps(dist_max, neg_d[j]));
+		}
+
+		const S32 outside_mask = _mm_movemask_ps(outside);
+		const S32 partial_mask = _mm_movemask_ps(partial);
+
+		// AABBInFrustum() tests boxes bigger than the frustum the other way
+		// around, those few go through it one at a time
+		S32 large_mask = 0;
+		if (!no_far_clip)
+		{
+			const __m128 radius_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz));
+			large_mask = _mm_movemask_ps(_mm_cmpgt_ps(radius_sq, corner_dist_sq));
+		}
+
+		for (S32 k = 0; k < 4; k++)
+		{
+			const S32 bit = 1 << k;
+			if (large_mask & bit)
+			{
+				results[i + k] = AABBInFrustum(LLVector3(center[0][i + k], center[1][i + k], center[2][i + k]),
+											   LLVector3(radius[0][i + k], radius[1][i + k], radius[2][i + k]));
+			}
+			else
+			{
+				results[i + k] = (outside_mask & bit) ? 0 : ((partial_mask & bit) ? 1 : 2);
+			}
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		LLVector3 c(center[0][i], center[1][i], center[2][i]);
+		LLVector3 r(radius[0][i], radius[1][i], radius[2][i]);
+		results[i] = no_far_clip ? AABBInFrustumNoFarClip(c, r) : AABBInFrustum(c, r);
+	}
+}
+
+// static
+bool LLCamera::supportsSSE()
+{
+	return true;
+}
+
+#else
+
+// Never called, LLCamera::setUseSSE() refuses to enable it.
+void LLCamera::AABBInFrustumBatchSSE(const F32* const[3], const F32* const[3], S32, S32*, BOOL) { llassert(false); }
+
+// static
+bool LLCamera::supportsSSE()
+{
+	return false;
+}
+
+#endif
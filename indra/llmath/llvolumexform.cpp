@@ -0,0 +1,80 @@
+/** 
+ * @file llvolumexform.cpp
+ * @brief Batched transforms of LLVolumeFace vertices into vertex buffers
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumexform.h"
+
+// static
+LLVolumeXform::transform_func_t LLVolumeXform::sTransformFunc = &LLVolumeXform::transformOriginal;
+
+// static
+void LLVolumeXform::transformOriginal(const vertex_t* verts, S32 count,
+									  const LLMatrix4& mat, const LLMatrix3& norm_mat,
+									  LLStrider<LLVector3> positions,
+									  LLStrider<LLVector3> normals,
+									  LLStrider<LLVector3> binormals)
+{
+	if (positions.get())
+	{
+		for (S32 i = 0; i < count; i++)
+		{
+			*positions++ = verts[i].mPosition * mat;
+		}
+	}
+
+	if (normals.get())
+	{
+		for (S32 i = 0; i < count; i++)
+		{
+			LLVector3 normal = verts[i].mNormal * norm_mat;
+			normal.normVec();
+			*normals++ = normal;
+		}
+	}
+
+	if (binormals.get())
+	{
+		for (S32 i = 0; i < count; i++)
+		{
+			LLVector3 binormal = verts[i].mBinormal * norm_mat;
+			binormal.normVec();
+			*binormals++ = binormal;
+		}
+	}
+}
+
+// static
+void LLVolumeXform::setUseSSE(bool use_sse)
+{
+	sTransformFunc = (use_sse && supportsSSE()) ? &transformSSE : &transformOriginal;
+}
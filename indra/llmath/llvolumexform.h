@@ -0,0 +1,87 @@
+/** 
+ * @file llvolumexform.h
+ * @brief Batched transforms of LLVolumeFace vertices into vertex buffers
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEXFORM_H
+#define LL_LLVOLUMEXFORM_H
+
+#include "llstrider.h"
+#include "llvolume.h"
+#include "m3math.h"
+#include "m4math.h"
+
+// Transforms whole faces worth of volume vertices at once, as
+// LLFace::getGeometryVolume() needs them for its vertex buffers. The SSE
+// kernel works on four vertices at a time; setUseSSE() picks it at runtime
+// the same way LLViewerJointMesh picks its skinning functions.
+class LLVolumeXform
+{
+public:
+	typedef LLVolumeFace::VertexData vertex_t;
+
+	// Writes verts[i].mPosition * mat to positions[i], and verts[i].mNormal
+	// and verts[i].mBinormal times norm_mat, normalized, to normals[i] and
+	// binormals[i], for count vertices. Outputs whose strider is NULL are
+	// skipped.
+	static void transform(const vertex_t* verts, S32 count,
+						  const LLMatrix4& mat, const LLMatrix3& norm_mat,
+						  LLStrider<LLVector3> positions,
+						  LLStrider<LLVector3> normals,
+						  LLStrider<LLVector3> binormals)
+	{
+		(*sTransformFunc)(verts, count, mat, norm_mat, positions, normals, binormals);
+	}
+
+	static void transformOriginal(const vertex_t* verts, S32 count,
+								  const LLMatrix4& mat, const LLMatrix3& norm_mat,
+								  LLStrider<LLVector3> positions,
+								  LLStrider<LLVector3> normals,
+								  LLStrider<LLVector3> binormals);
+	// In llvolumexform_sse.cpp
+	static void transformSSE(const vertex_t* verts, S32 count,
+							 const LLMatrix4& mat, const LLMatrix3& norm_mat,
+							 LLStrider<LLVector3> positions,
+							 LLStrider<LLVector3> normals,
+							 LLStrider<LLVector3> binormals);
+
+	// Whether llvolumexform_sse.cpp was built with SSE.
+	static bool supportsSSE();
+	// Selects transformSSE() for transform(), if supported. Off by default.
+	static void setUseSSE(bool use_sse);
+	static bool getUseSSE() { return sTransformFunc != &transformOriginal; }
+
+private:
+	typedef void (*transform_func_t)(const vertex_t*, S32, const LLMatrix4&, const LLMatrix3&,
+									 LLStrider<LLVector3>, LLStrider<LLVector3>, LLStrider<LLVector3>);
+	static transform_func_t sTransformFunc;
+};
+
+#endif // LL_LLVOLUMEXFORM_H
@@ -0,0 +1,180 @@
+/** 
+ * @file llvolumexform_sse.cpp
+ * @brief SSE version of the LLVolumeFace vertex transforms
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+// Visual Studio required settings for this file:
+// Code Generation: SSE
+
+#include "linden_common.h"
+
+#include "llvolumexform.h"
+#include "v4math.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
+#include "llv4vector3.h"
+
+#if LL_VECTORIZE
+
+// Writes the x, y and z of v without touching whatever follows them in
+// an interleaved vertex buffer.
+inline void store_vec3(LLVector3& o, const V4F32& v)
+{
+	_mm_storel_pi((__m64*) o.mV, v);
+	_mm_store_ss(o.mV + VZ, _mm_movehl_ps(v, v));
+}
+
+// LLVector3::normVec() on four vectors at once.
+inline void normalize_vec4(LLV4Vector3* v)
+{
+	__m128 x = v[0].v;
+	__m128 y = v[1].v;
+	__m128 z = v[2].v;
+	__m128 w = v[3].v;
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+
+	__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	// zero vectors too short to normalize
+	__m128 valid = _mm_cmpgt_ps(mag, _mm_set1_ps(FP_MAG_THRESHOLD));
+	__m128 oomag = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.f), mag), valid);
+	x = _mm_mul_ps(x, oomag);
+	y = _mm_mul_ps(y, oomag);
+	z = _mm_mul_ps(z, oomag);
+
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	v[0].v = x;
+	v[1].v = y;
+	v[2].v = z;
+	v[3].v = w;
+}
+
+// static
+void LLVolumeXform::transformSSE(const vertex_t* verts, S32 count,
+								 const LLMatrix4& mat, const LLMatrix3& norm_mat,
+								 LLStrider<LLVector3> positions,
+								 LLStrider<LLVector3> normals,
+								 LLStrider<LLVector3> binormals)
+{
+	LLV4Matrix4 v4mat;
+	v4mat = mat;
+
+	// the fourth column of each row is never set by operator=
+	LLV4Matrix3 v4norm_mat;
+	v4norm_mat.mV[VX] = v4norm_mat.mV[VY] = v4norm_mat.mV[VZ] = v4norm_mat.mV[VW] = _mm_setzero_ps();
+	v4norm_mat = norm_mat;
+
+	LLV4Vector3 out[4];
+
+	S32 i = 0;
+	for ( ; i + 4 <= count; i += 4)
+	{
+		const vertex_t* v = verts + i;
+
+		if (positions.get())
+		{
+			for (S32 k = 0; k < 4; k++)
+			{
+				v4mat.multiply(v[k].mPosition, out[k]);
+				store_vec3(positions[i + k], out[k].v);
+			}
+		}
+
+		if (normals.get())
+		{
+			for (S32 k = 0; k < 4; k++)
+			{
+				v4norm_mat.multiply(v[k].mNormal, out[k]);
+			}
+			normalize_vec4(out);
+			for (S32 k = 0; k < 4; k++)
+			{
+				store_vec3(normals[i + k], out[k].v);
+			}
+		}
+
+		if (binormals.get())
+		{
+			for (S32 k = 0; k < 4; k++)
+			{
+				v4norm_mat.multiply(v[k].mBinormal, out[k]);
+			}
+			normalize_vec4(out);
+			for (S32 k = 0; k < 4; k++)
+			{
+				store_vec3(binormals[i + k], out[k].v);
+			}
+		}
+	}
+
+	if (i < count)
+	{ //leftovers that don't fill a vector
+		if (positions.get())
+		{
+			positions += i;
+		}
+		if (normals.get())
+		{
+			normals += i;
+		}
+		if (binormals.get())
+		{
+			binormals += i;
+		}
+		transformOriginal(verts + i, count - i, mat, norm_mat, positions, normals, binormals);
+	}
+}
+
+// static
+bool LLVolumeXform::supportsSSE()
+{
+	return true;
+}
+
+#else
+
+// Never called, LLVolumeXform::setUseSSE() refuses to enable it.
+void LLVolumeXform::transformSSE(const vertex_t* verts, S32 count,
+								 const LLMatrix4& mat, const LLMatrix3& norm_mat,
+								 LLStrider<LLVector3> positions,
+								 LLStrider<LLVector3> normals,
+								 LLStrider<LLVector3> binormals)
+{
+	transformOriginal(verts, count, mat, norm_mat, positions, normals, binormals);
+}
+
+// static
+bool LLVolumeXform::supportsSSE()
+{
+	return false;
+}
+
+#endif
@@ -270,6 +270,59 @@ LLEstateAssetRequest::~LLEstateAssetRequest()
 }
 
 
+///----------------------------------------------------------------------------
+/// LLAssetDownloadQueue
+///----------------------------------------------------------------------------
+
+BOOL LLAssetDownloadQueue::add(LLAssetRequest* req, BOOL at_front)
+{
+	mNumRequests++;
+	std::pair<index_t::iterator, bool> result = mIndex.insert(
+		index_t::value_type(asset_key_t(req->getUUID(), req->getType()), Entry()));
+	Entry& entry = result.first->second;
+	entry.mRequests.push_back(req);
+	if (!result.second)
+	{
+		// Already on its way, ride along
+		return FALSE;
+	}
+
+	if (at_front)
+	{
+		mQueue.push_front(req);
+		entry.mQueueIter = mQueue.begin();
+	}
+	else
+	{
+		entry.mQueueIter = mQueue.insert(mQueue.end(), req);
+	}
+	return TRUE;
+}
+
+const LLAssetDownloadQueue::request_list_t* LLAssetDownloadQueue::find(const LLUUID& uuid, LLAssetType::EType type) const
+{
+	index_t::const_iterator iter = mIndex.find(asset_key_t(uuid, type));
+	return iter != mIndex.end() ? &iter->second.mRequests : NULL;
+}
+
+S32 LLAssetDownloadQueue::take(const LLUUID& uuid, LLAssetType::EType type, request_list_t& requests)
+{
+	index_t::iterator iter = mIndex.find(asset_key_t(uuid, type));
+	if (iter == mIndex.end())
+	{
+		return 0;
+	}
+
+	Entry& entry = iter->second;
+	S32 count = (S32)entry.mRequests.size();
+	mQueue.erase(entry.mQueueIter);
+	requests.splice(requests.end(), entry.mRequests);
+	mIndex.erase(iter);
+	mNumRequests -= count;
+	return count;
+}
+
+
 ///----------------------------------------------------------------------------
 /// LLAssetStorage
 ///----------------------------------------------------------------------------
@@ -344,8 +397,27 @@ void LLAssetStorage::_cleanupRequests(BOOL all, S32 error)
 	F64 mt_secs = LLMessageSystem::getMessageTimeSeconds();
 
 	request_list_t timed_out;
+
+	// Downloads time out together with the request that started the transfer
+	for (request_list_t::iterator iter = mPendingDownloads.getQueue().begin();
+		 iter != mPendingDownloads.getQueue().end(); )
+	{
+		request_list_t::iterator curiter = iter++;
+		LLAssetRequest* tmp = *curiter;
+		if (all || LL_ASSET_STORAGE_TIMEOUT < (mt_secs - tmp->mTime))
+		{
+			LLUUID uuid = tmp->getUUID();
+			LLAssetType::EType type = tmp->getType();
+			S32 count = mPendingDownloads.take(uuid, type, timed_out);
+			llwarns << "Asset " << getRequestName(RT_DOWNLOAD) << " request "
+					<< (all ? "aborted" : "timed out") << " for "
+					<< uuid << "." << LLAssetType::lookup(type)
+					<< " (" << count << " requests)" << llendl;
+		}
+	}
+
 	S32 rt;
-	for (rt = 0; rt < RT_COUNT; rt++)
+	for (rt = RT_DOWNLOAD + 1; rt < RT_COUNT; rt++)
 	{
 		request_list_t* requests = getRequestList((ERequestType)rt);
 		for (request_list_t::iterator iter = requests->begin();
@@ -354,11 +426,8 @@ void LLAssetStorage::_cleanupRequests(BOOL all, S32 error)
 			request_list_t::iterator curiter = iter++;
 			LLAssetRequest* tmp = *curiter;
 			// if all is true, we want to clean up everything
-			// otherwise just check for timed out requests
-			// EXCEPT for upload timeouts
-			if (all 
-				|| ((RT_DOWNLOAD == rt)
-					&& LL_ASSET_STORAGE_TIMEOUT < (mt_secs - tmp->mTime)))
+			// uploads don't time out
+			if (all)
 			{
 				llwarns << "Asset " << getRequestName((ERequestType)rt) << " request "
 						<< (all ? "aborted" : "timed out") << " for "
@@ -449,12 +518,13 @@ void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, vo
 		BOOL duplicate = FALSE;
 		
 		// check to see if there's a pending download of this uuid already
-		for (request_list_t::iterator iter = mPendingDownloads.begin();
-			 iter != mPendingDownloads.end(); ++iter )
+		const request_list_t* pending = mPendingDownloads.find(uuid, type);
+		if (pending)
 		{
-			LLAssetRequest  *tmp = *iter;
-			if ((type == tmp->getType()) && (uuid == tmp->getUUID()))
+			for (request_list_t::const_iterator iter = pending->begin();
+				 iter != pending->end(); ++iter)
 			{
+				LLAssetRequest* tmp = *iter;
 				if (callback == tmp->mDownCallback && user_data == tmp->mUserData)
 				{
 					// this is a duplicate from the same subsystem - throw it away
@@ -462,11 +532,11 @@ void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, vo
 							<< "." << LLAssetType::lookup(type) << llendl;
 					return;
 				}
-				
-				// this is a duplicate request
-				// queue the request, but don't actually ask for it again
-				duplicate = TRUE;
 			}
+
+			// this is a duplicate request
+			// queue the request, but don't actually ask for it again
+			duplicate = TRUE;
 		}
 		if (duplicate)
 		{
@@ -502,9 +572,7 @@ void LLAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::EType at
 		req->mUserData = user_data;
 		req->mIsPriority = is_priority;
 	
-		mPendingDownloads.push_back(req);
-	
-		if (!duplicate)
+		if (mPendingDownloads.add(req))
 		{
 			// send request message to our upstream data provider
 			// Create a new asset transfer.
@@ -554,26 +622,16 @@ void LLAssetStorage::downloadCompleteCallback(
 		return;
 	}
 
-	// Inefficient since we're doing a find through a list that may have thousands of elements.
-	// This is due for refactoring; we will probably change mPendingDownloads into a set.
-	request_list_t::iterator download_iter = std::find(gAssetStorage->mPendingDownloads.begin(), 
-													   gAssetStorage->mPendingDownloads.end(),
-													   req);
-	// If the LLAssetRequest doesn't exist in the downloads queue, then it either has already been deleted
-	// by _cleanupRequests, or it's a transfer.
-	if (download_iter != gAssetStorage->mPendingDownloads.end())
-	{
-		req->setUUID(file_id);
-		req->setType(file_type);
-	}
+	// req may already have been deleted by _cleanupRequests, or be a transfer's
+	// own request, so don't touch it from here on: the asset id is all we need.
 
 	if (LL_ERR_NOERR == result)
 	{
 		// we might have gotten a zero-size file
-		LLVFile vfile(gAssetStorage->mVFS, req->getUUID(), req->getType());
+		LLVFile vfile(gAssetStorage->mVFS, file_id, file_type);
 		if (vfile.getSize() <= 0)
 		{
-			llwarns << "downloadCompleteCallback has non-existent or zero-size asset " << req->getUUID() << llendl;
+			llwarns << "downloadCompleteCallback has non-existent or zero-size asset " << file_id << llendl;
 			
 			result = LL_ERR_ASSET_REQUEST_NOT_IN_DATABASE;
 			vfile.remove();
@@ -584,25 +642,14 @@ void LLAssetStorage::downloadCompleteCallback(
 	// SJB: We process the callbacks in reverse order, I do not know if this is important,
 	//      but I didn't want to mess with it.
 	request_list_t requests;
-	for (request_list_t::iterator iter = gAssetStorage->mPendingDownloads.begin();
-		 iter != gAssetStorage->mPendingDownloads.end();  )
+	gAssetStorage->mPendingDownloads.take(file_id, file_type, requests);
+	for (request_list_t::reverse_iterator iter = requests.rbegin();
+		 iter != requests.rend(); ++iter)
 	{
-		request_list_t::iterator curiter = iter++;
-		LLAssetRequest* tmp = *curiter;
-		if ((tmp->getUUID() == file_id) && (tmp->getType()== file_type))
-		{
-			requests.push_front(tmp);
-			iter = gAssetStorage->mPendingDownloads.erase(curiter);
-		}
-	}
-	for (request_list_t::iterator iter = requests.begin();
-		 iter != requests.end();  )
-	{
-		request_list_t::iterator curiter = iter++;
-		LLAssetRequest* tmp = *curiter;
+		LLAssetRequest* tmp = *iter;
 		if (tmp->mDownCallback)
 		{
-			tmp->mDownCallback(gAssetStorage->mVFS, req->getUUID(), req->getType(), tmp->mUserData, result, ext_status);
+			tmp->mDownCallback(gAssetStorage->mVFS, file_id, file_type, tmp->mUserData, result, ext_status);
 		}
 		delete tmp;
 	}
@@ -962,7 +1009,7 @@ LLAssetStorage::request_list_t* LLAssetStorage::getRequestList(LLAssetStorage::E
 	switch (rt)
 	{
 	case RT_DOWNLOAD:
-		return &mPendingDownloads;
+		return &mPendingDownloads.getQueue();
 	case RT_UPLOAD:
 		return &mPendingUploads;
 	case RT_LOCALUPLOAD:
@@ -978,7 +1025,7 @@ const LLAssetStorage::request_list_t* LLAssetStorage::getRequestList(LLAssetStor
 	switch (rt)
 	{
 	case RT_DOWNLOAD:
-		return &mPendingDownloads;
+		return &mPendingDownloads.getQueue();
 	case RT_UPLOAD:
 		return &mPendingUploads;
 	case RT_LOCALUPLOAD:
@@ -1008,6 +1055,12 @@ std::string LLAssetStorage::getRequestName(LLAssetStorage::ERequestType rt)
 
 S32 LLAssetStorage::getNumPending(LLAssetStorage::ERequestType rt) const
 {
+	if (RT_DOWNLOAD == rt)
+	{
+		// coalesced requests count too
+		return mPendingDownloads.getNumRequests();
+	}
+
 	const request_list_t* requests = getRequestList(rt);
 	S32 num_pending = -1;
 	if (requests)
@@ -1149,6 +1202,29 @@ bool LLAssetStorage::deletePendingRequest(LLAssetStorage::ERequestType rt,
 											LLAssetType::EType asset_type,
 											const LLUUID& asset_id)
 {
+	if (RT_DOWNLOAD == rt)
+	{
+		// Everyone waiting on the transfer goes with it
+		request_list_t requests;
+		if (!mPendingDownloads.take(asset_id, asset_type, requests))
+		{
+			return false;
+		}
+		for (request_list_t::iterator iter = requests.begin(); iter != requests.end(); ++iter)
+		{
+			LLAssetRequest* req = *iter;
+			if (req->mDownCallback)
+			{
+				req->mDownCallback(mVFS, asset_id, asset_type, req->mUserData, LL_ERR_TCP_TIMEOUT, LL_EXSTAT_REQUEST_DROPPED);
+			}
+			delete req;
+		}
+		llinfos << "Asset " << getRequestName(rt) << " request for "
+				<< asset_id << "." << LLAssetType::lookup(asset_type)
+				<< " removed from pending queue." << llendl;
+		return true;
+	}
+
 	request_list_t* requests = getRequestList(rt);
 	if (deletePendingRequest(requests, asset_type, asset_id))
 	{
@@ -1237,19 +1313,21 @@ const char* LLAssetStorage::getErrorString(S32 status)
 void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, void (*callback)(const char*, const LLUUID&, void *, S32, LLExtStat), void *user_data, BOOL is_priority)
 {
 	// check for duplicates here, since we're about to fool the normal duplicate checker
-	for (request_list_t::iterator iter = mPendingDownloads.begin();
-		 iter != mPendingDownloads.end();  )
+	const request_list_t* pending = mPendingDownloads.find(uuid, type);
+	if (pending)
 	{
-		LLAssetRequest* tmp = *iter++;
-		if (type == tmp->getType() && 
-			uuid == tmp->getUUID() &&
-			legacyGetDataCallback == tmp->mDownCallback &&
-			callback == ((LLLegacyAssetRequest *)tmp->mUserData)->mDownCallback &&
-			user_data == ((LLLegacyAssetRequest *)tmp->mUserData)->mUserData)
+		for (request_list_t::const_iterator iter = pending->begin();
+			 iter != pending->end(); ++iter)
 		{
-			// this is a duplicate from the same subsystem - throw it away
-			llinfos << "Discarding duplicate request for UUID " << uuid << llendl;
-			return;
+			LLAssetRequest* tmp = *iter;
+			if (legacyGetDataCallback == tmp->mDownCallback &&
+				callback == ((LLLegacyAssetRequest *)tmp->mUserData)->mDownCallback &&
+				user_data == ((LLLegacyAssetRequest *)tmp->mUserData)->mUserData)
+			{
+				// this is a duplicate from the same subsystem - throw it away
+				llinfos << "Discarding duplicate request for UUID " << uuid << llendl;
+				return;
+			}
 		}
 	}
 	
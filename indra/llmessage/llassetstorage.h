@@ -34,7 +34,9 @@
 #ifndef LL_LLASSETSTORAGE_H
 #define LL_LLASSETSTORAGE_H
 
+#include <list>
 #include <string>
+#include <boost/unordered_map.hpp>
 
 #include "lluuid.h"
 #include "lltimer.h"
@@ -198,6 +200,54 @@ public:
 };
 
 
+// The pending downloads of an LLAssetStorage. Requests for an asset that is
+// already on its way are coalesced: only the first one goes in the queue
+// and gets a transfer, later ones wait behind it, and take() hands all of
+// them back when the transfer completes. Lookups by asset are hashed.
+class LLAssetDownloadQueue
+{
+public:
+	typedef std::list<LLAssetRequest*> request_list_t;
+
+	LLAssetDownloadQueue() : mNumRequests(0) {}
+
+	// Returns TRUE if req is the first request for its asset, which means
+	// the caller has to start the transfer.
+	BOOL add(LLAssetRequest* req, BOOL at_front = FALSE);
+	// Everything waiting on the asset, first request first. NULL if nothing is.
+	const request_list_t* find(const LLUUID& uuid, LLAssetType::EType type) const;
+	// Removes every request for the asset and appends them to requests, first
+	// request first. Returns how many there were.
+	S32 take(const LLUUID& uuid, LLAssetType::EType type, request_list_t& requests);
+
+	// The first request for each asset, in the order they get transfers.
+	// Only ever reorder it with splice(), the index keeps iterators into it.
+	request_list_t& getQueue()							{ return mQueue; }
+	const request_list_t& getQueue() const				{ return mQueue; }
+	// Number of requests, coalesced ones included.
+	S32 getNumRequests() const							{ return mNumRequests; }
+
+private:
+	typedef std::pair<LLUUID, LLAssetType::EType> asset_key_t;
+	struct asset_key_hash
+	{
+		size_t operator()(const asset_key_t& key) const
+		{
+			return (size_t)key.first.getCRC32() ^ ((size_t)key.second * 0x9E3779B1);
+		}
+	};
+	struct Entry
+	{
+		request_list_t::iterator	mQueueIter;		// the first request, in mQueue
+		request_list_t				mRequests;		// all of them
+	};
+	typedef boost::unordered_map<asset_key_t, Entry, asset_key_hash> index_t;
+
+	request_list_t	mQueue;
+	index_t			mIndex;
+	S32				mNumRequests;
+};
+
 // Map of known bad assets
 typedef std::map<LLUUID,U64,lluuid_less> toxic_asset_map_t;
 
@@ -237,8 +287,8 @@ protected:
 	LLXferManager	*mXferManager;
 
 
-	typedef std::list<LLAssetRequest*> request_list_t;
-	request_list_t mPendingDownloads;
+	typedef LLAssetDownloadQueue::request_list_t request_list_t;
+	LLAssetDownloadQueue mPendingDownloads;
 	request_list_t mPendingUploads;
 	request_list_t mPendingLocalUploads;
 	
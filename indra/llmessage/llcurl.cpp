@@ -55,6 +55,7 @@
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llthread.h"
+#include "lltimer.h"
 
 #include "llsocks5.h"
 
@@ -70,16 +71,24 @@
 
 	Furthermore, it would behoove us to keep track of which
 	hosts an easy handle was used for and pick an easy handle
-	that matches the next request.  This code does not current
-	do this.
+	that matches the next request.  Free handles are filed by
+	the host they last talked to for this reason, and
+	LLCurlRequest limits the connections it opens per host so
+	that a burst of requests queues for a warm connection
+	instead of opening a new one each.
  */
 
 //////////////////////////////////////////////////////////////////////////////
 
-static const S32 EASY_HANDLE_POOL_SIZE		= 5;
+static const S32 EASY_HANDLE_POOL_SIZE		= 16;
 static const S32 MULTI_PERFORM_CALL_REPEAT	= 5;
 static const S32 CURL_REQUEST_TIMEOUT = 30; // seconds
-static const S32 MAX_ACTIVE_REQUEST_COUNT = 100;
+
+// Default LLCurlRequest concurrency limits
+static const S32 DEFAULT_TEXTURE_REQUEST_LIMIT	= 16;
+static const S32 DEFAULT_CAPS_REQUEST_LIMIT		= 8;
+static const S32 DEFAULT_LONG_POLL_REQUEST_LIMIT	= 4;
+static const S32 DEFAULT_HOST_REQUEST_LIMIT		= 8;
 
 // DEBUG //
 S32 gCurlEasyCount = 0;
@@ -233,6 +242,15 @@ public:
 	
 	void resetState();
 
+	// Scheduling state for LLCurlRequest. Unlike the request state it
+	// survives resetState(), so a free handle remembers its host.
+	void setHost(const std::string& host) { mHost = host; }
+	const std::string& getHost() const { return mHost; }
+	void setSchedule(S32 request_class, U64 queued_time, U64 start_time);
+	S32 getRequestClass() const { return mRequestClass; }
+	U64 getQueuedTime() const { return mQueuedTime; }
+	U64 getStartTime() const { return mStartTime; }
+
 private:	
 	CURL*				mCurlEasyHandle;
 	struct curl_slist*	mHeaders;
@@ -248,11 +266,19 @@ private:
 	std::vector<char*>	mStrings;
 	
 	ResponderPtr		mResponder;
+
+	std::string			mHost;
+	S32					mRequestClass;
+	U64					mQueuedTime;
+	U64					mStartTime;
 };
 
 LLCurl::Easy::Easy()
 	: mHeaders(NULL),
-	  mCurlEasyHandle(NULL)
+	  mCurlEasyHandle(NULL),
+	  mRequestClass(-1),
+	  mQueuedTime(0),
+	  mStartTime(0)
 {
 	mErrorBuffer[0] = 0;
 }
@@ -325,6 +351,13 @@ void LLCurl::Easy::resetState()
 	mHeaderOutput.clear();
 }
 
+void LLCurl::Easy::setSchedule(S32 request_class, U64 queued_time, U64 start_time)
+{
+	mRequestClass = request_class;
+	mQueuedTime = queued_time;
+	mStartTime = start_time;
+}
+
 void LLCurl::Easy::setErrorBuffer()
 {
 	setopt(CURLOPT_ERRORBUFFER, &mErrorBuffer);
@@ -521,7 +554,8 @@ public:
 	Multi();
 	~Multi();
 
-	Easy* allocEasy();
+	// Prefers a free handle which last talked to host
+	Easy* allocEasy(const std::string& host = std::string());
 	bool addEasy(Easy* easy);
 	
 	void removeEasy(Easy* easy);
@@ -531,8 +565,11 @@ public:
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	void setPipelining(bool pipelining);
+
 	S32 mQueued;
 	S32 mErrorCount;
+	LLCurlRequest* mOwner; // notified of completed requests, may be NULL
 	
 private:
 	void easyFree(Easy*);
@@ -543,13 +580,14 @@ private:
 	easy_active_list_t mEasyActiveList;
 	typedef std::map<CURL*, Easy*> easy_active_map_t;
 	easy_active_map_t mEasyActiveMap;
-	typedef std::set<Easy*> easy_free_list_t;
+	typedef std::multimap<std::string, Easy*> easy_free_list_t;
 	easy_free_list_t mEasyFreeList;
 };
 
 LLCurl::Multi::Multi()
 	: mQueued(0),
-	  mErrorCount(0)
+	  mErrorCount(0),
+	  mOwner(NULL)
 {
 	mCurlMultiHandle = curl_multi_init();
 	if (!mCurlMultiHandle)
@@ -575,7 +613,7 @@ LLCurl::Multi::~Multi()
 	mEasyActiveMap.clear();
 	
 	// Clean up freed
-	for_each(mEasyFreeList.begin(), mEasyFreeList.end(), DeletePointer());	
+	for_each(mEasyFreeList.begin(), mEasyFreeList.end(), DeletePairedPointer());	
 	mEasyFreeList.clear();
 
 	curl_multi_cleanup(mCurlMultiHandle);
@@ -588,6 +626,13 @@ CURLMsg* LLCurl::Multi::info_read(S32* msgs_in_queue)
 	return curlmsg;
 }
 
+void LLCurl::Multi::setPipelining(bool pipelining)
+{
+#if LIBCURL_VERSION_NUM >= 0x071000
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_PIPELINING, pipelining ? 1L : 0L);
+#endif
+}
+
 
 S32 LLCurl::Multi::perform()
 {
@@ -619,12 +664,18 @@ S32 LLCurl::Multi::process()
 		++processed;
 		if (msg->msg == CURLMSG_DONE)
 		{
+			// msg isn't valid once the easy handle has been removed
+			CURLcode result = msg->data.result;
 			U32 response = 0;
 			easy_active_map_t::iterator iter = mEasyActiveMap.find(msg->easy_handle);
 			if (iter != mEasyActiveMap.end())
 			{
 				Easy* easy = iter->second;
-				response = easy->report(msg->data.result);
+				response = easy->report(result);
+				if (mOwner)
+				{
+					mOwner->requestComplete(easy, response);
+				}
 				removeEasy(easy);
 			}
 			else
@@ -633,9 +684,10 @@ S32 LLCurl::Multi::process()
 				//*TODO: change to llwarns
 				llerrs << "cleaned up curl request completed!" << llendl;
 			}
-			if (response >= 400)
+			if (result != CURLE_OK)
 			{
-				// failure of some sort, inc mErrorCount for debugging and flagging multi for destruction
+				// transport failure, inc mErrorCount for debugging and flagging multi for destruction.
+				// HTTP errors leave the connections usable, so they don't count.
 				++mErrorCount;
 			}
 		}
@@ -643,21 +695,27 @@ S32 LLCurl::Multi::process()
 	return processed;
 }
 
-LLCurl::Easy* LLCurl::Multi::allocEasy()
+LLCurl::Easy* LLCurl::Multi::allocEasy(const std::string& host)
 {
 	Easy* easy = 0;
 
-	if (mEasyFreeList.empty())
+	easy_free_list_t::iterator free_iter = mEasyFreeList.find(host);
+	if (free_iter == mEasyFreeList.end())
+	{
+		free_iter = mEasyFreeList.begin();
+	}
+	if (free_iter == mEasyFreeList.end())
 	{
 		easy = Easy::getEasy();
 	}
 	else
 	{
-		easy = *(mEasyFreeList.begin());
-		mEasyFreeList.erase(easy);
+		easy = free_iter->second;
+		mEasyFreeList.erase(free_iter);
 	}
 	if (easy)
 	{
+		easy->setHost(host);
 		mEasyActiveList.insert(easy);
 		mEasyActiveMap[easy->getCurlHandle()] = easy;
 	}
@@ -682,7 +740,7 @@ void LLCurl::Multi::easyFree(Easy* easy)
 	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
 	{
 		easy->resetState();
-		mEasyFreeList.insert(easy);
+		mEasyFreeList.insert(std::make_pair(easy->getHost(), easy));
 	}
 	else
 	{
@@ -711,110 +769,300 @@ std::string LLCurl::strerror(CURLcode errorcode)
 }
 
 ////////////////////////////////////////////////////////////////////////////
-// For generating a simple request for data
-// using one multi and one easy per request 
+// Prioritized requests for data, scheduled over a shared multi
+
+struct LLCurlRequest::QueuedRequest
+{
+	QueuedRequest(const std::string& url, LLCurl::ResponderPtr responder,
+				  F32 priority, ERequestClass request_class)
+		: mURL(url),
+		  mOffset(0),
+		  mLength(-1),
+		  mPost(false),
+		  mResponder(responder),
+		  mPriority(priority),
+		  mClass(request_class),
+		  mSerial(0),
+		  mQueuedTime(0)
+	{
+	}
+
+	std::string mURL;
+	std::string mHost;
+	headers_t mHeaders;
+	S32 mOffset;
+	S32 mLength;
+	bool mPost;
+	std::string mPostData;
+	LLCurl::ResponderPtr mResponder;
+	F32 mPriority;
+	ERequestClass mClass;
+	U32 mSerial;
+	U64 mQueuedTime;
+};
+
+bool LLCurlRequest::queued_request_compare::operator()(const QueuedRequest* lhs, const QueuedRequest* rhs) const
+{
+	// highest priority first, then first come first served
+	if (lhs->mPriority != rhs->mPriority)
+	{
+		return lhs->mPriority > rhs->mPriority;
+	}
+	return lhs->mSerial < rhs->mSerial;
+}
+
+// Returns the scheme, host and port of url, which is the granularity
+// curl reuses connections at.
+static std::string get_url_host(const std::string& url)
+{
+	std::string::size_type start = url.find("://");
+	start = (start == std::string::npos) ? 0 : start + 3;
+	std::string host = url.substr(0, url.find_first_of("/?#", start));
+	LLStringUtil::toLower(host);
+	return host;
+}
 
 LLCurlRequest::LLCurlRequest() :
 	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mNextSerial(0),
+	mHostLimit(DEFAULT_HOST_REQUEST_LIMIT),
+	mPipelining(false)
 {
 	mThreadID = LLThread::currentID();
+	for (S32 i = 0; i < REQUEST_CLASS_COUNT; ++i)
+	{
+		mClassActive[i] = 0;
+	}
+	mClassLimit[REQUEST_CLASS_TEXTURE] = DEFAULT_TEXTURE_REQUEST_LIMIT;
+	mClassLimit[REQUEST_CLASS_CAPS] = DEFAULT_CAPS_REQUEST_LIMIT;
+	mClassLimit[REQUEST_CLASS_LONG_POLL] = DEFAULT_LONG_POLL_REQUEST_LIMIT;
 }
 
 LLCurlRequest::~LLCurlRequest()
 {
 	llassert_always(mThreadID == LLThread::currentID());
 	for_each(mMultiSet.begin(), mMultiSet.end(), DeletePointer());
+	for_each(mRequestQueue.begin(), mRequestQueue.end(), DeletePointer());
 }
 
 void LLCurlRequest::addMulti()
 {
 	llassert_always(mThreadID == LLThread::currentID());
 	LLCurl::Multi* multi = new LLCurl::Multi();
+	multi->mOwner = this;
+	multi->setPipelining(mPipelining);
 	mMultiSet.insert(multi);
 	mActiveMulti = multi;
-	mActiveRequestCount = 0;
 }
 
-LLCurl::Easy* LLCurlRequest::allocEasy()
+void LLCurlRequest::setClassLimit(ERequestClass request_class, S32 max_active)
 {
-	if (!mActiveMulti ||
-		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
-		mActiveMulti->mErrorCount > 0)
+	mClassLimit[request_class] = llmax(max_active, 1);
+}
+
+void LLCurlRequest::setPipelining(bool pipelining)
+{
+	mPipelining = pipelining;
+	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
+		 iter != mMultiSet.end(); ++iter)
 	{
-		addMulti();
+		(*iter)->setPipelining(pipelining);
 	}
-	llassert_always(mActiveMulti);
-	++mActiveRequestCount;
-	LLCurl::Easy* easy = mActiveMulti->allocEasy();
-	return easy;
 }
 
-bool LLCurlRequest::addEasy(LLCurl::Easy* easy)
+void LLCurlRequest::queueRequest(QueuedRequest* request)
 {
-	llassert_always(mActiveMulti);
-	bool res = mActiveMulti->addEasy(easy);
-	return res;
+	llassert_always(mThreadID == LLThread::currentID());
+	request->mHost = get_url_host(request->mURL);
+	request->mSerial = mNextSerial++;
+	request->mQueuedTime = LLTimer::getTotalTime();
+	mRequestQueue.insert(request);
 }
 
-void LLCurlRequest::get(const std::string& url, LLCurl::ResponderPtr responder)
+void LLCurlRequest::get(const std::string& url, LLCurl::ResponderPtr responder,
+						F32 priority, ERequestClass request_class)
 {
-	getByteRange(url, headers_t(), 0, -1, responder);
+	getByteRange(url, headers_t(), 0, -1, responder, priority, request_class);
 }
 	
+// Requests are dispatched from process(), so failures to start one
+// are reported to the responder with a 499 rather than returned here.
 bool LLCurlRequest::getByteRange(const std::string& url,
 								 const headers_t& headers,
 								 S32 offset, S32 length,
-								 LLCurl::ResponderPtr responder)
+								 LLCurl::ResponderPtr responder,
+								 F32 priority, ERequestClass request_class)
+{
+	QueuedRequest* request = new QueuedRequest(url, responder, priority, request_class);
+	request->mHeaders = headers;
+	request->mOffset = offset;
+	request->mLength = length;
+	queueRequest(request);
+	return true;
+}
+
+bool LLCurlRequest::post(const std::string& url,
+						 const headers_t& headers,
+						 const LLSD& data,
+						 LLCurl::ResponderPtr responder,
+						 F32 priority, ERequestClass request_class)
+{
+	QueuedRequest* request = new QueuedRequest(url, responder, priority, request_class);
+	request->mHeaders = headers;
+	request->mPost = true;
+	std::ostringstream ostr;
+	LLSDSerialize::toXML(data, ostr);
+	request->mPostData = ostr.str();
+	queueRequest(request);
+	return true;
+}
+
+bool LLCurlRequest::isHostFull(const QueuedRequest* request) const
 {
-	LLCurl::Easy* easy = allocEasy();
-	if (!easy)
+	if (request->mClass == REQUEST_CLASS_LONG_POLL)
 	{
+		// parked on the server, so not part of the host's share
 		return false;
 	}
-	easy->prepRequest(url, headers, responder);
-	easy->setopt(CURLOPT_HTTPGET, 1);
-	if (length > 0)
+	host_count_map_t::const_iterator iter = mHostActive.find(request->mHost);
+	return iter != mHostActive.end() && iter->second >= mHostLimit;
+}
+
+void LLCurlRequest::dispatchQueued()
+{
+	request_queue_t::iterator iter = mRequestQueue.begin();
+	while (iter != mRequestQueue.end())
 	{
-		std::string range = llformat("Range: bytes=%d-%d", offset,offset+length-1);
-		easy->slist_append(range.c_str());
+		bool has_room = false;
+		for (S32 i = 0; i < REQUEST_CLASS_COUNT; ++i)
+		{
+			has_room |= mClassActive[i] < mClassLimit[i];
+		}
+		if (!has_room)
+		{
+			break;
+		}
+
+		QueuedRequest* request = *iter;
+		if (mClassActive[request->mClass] >= mClassLimit[request->mClass] ||
+			isHostFull(request))
+		{
+			// lower priority requests to other hosts or classes may still go
+			++iter;
+			continue;
+		}
+		mRequestQueue.erase(iter++);
+		dispatch(request);
+		delete request;
 	}
-	easy->setHeaders();
-	bool res = addEasy(easy);
-	return res;
 }
 
-bool LLCurlRequest::post(const std::string& url,
-						 const headers_t& headers,
-						 const LLSD& data,
-						 LLCurl::ResponderPtr responder)
+bool LLCurlRequest::dispatch(QueuedRequest* request)
 {
-	LLCurl::Easy* easy = allocEasy();
+	if (!mActiveMulti || mActiveMulti->mErrorCount > 0)
+	{
+		addMulti();
+	}
+	llassert_always(mActiveMulti);
+
+	U64 start_time = LLTimer::getTotalTime();
+	LLCurl::Easy* easy = mActiveMulti->allocEasy(request->mHost);
 	if (!easy)
 	{
+		// Can happen with too many open files, act as though the
+		// request failed to connect.
+		llwarns << "Unable to allocate curl handle for " << request->mURL << llendl;
+		Stats& stats = mStats[request->mClass];
+		++stats.mRequests;
+		++stats.mFailures;
+		if (request->mResponder)
+		{
+			LLChannelDescriptors channels;
+			LLIOPipe::buffer_ptr_t buffer(new LLBufferArray);
+			request->mResponder->completedRaw(499, LLCurl::strerror(CURLE_FAILED_INIT), channels, buffer);
+		}
 		return false;
 	}
-	easy->prepRequest(url, headers, responder);
 
-	LLSDSerialize::toXML(data, easy->getInput());
-	S32 bytes = easy->getInput().str().length();
-	
-	easy->setopt(CURLOPT_POST, 1);
-	easy->setopt(CURLOPT_POSTFIELDS, (void*)NULL);
-	easy->setopt(CURLOPT_POSTFIELDSIZE, bytes);
+	easy->prepRequest(request->mURL, request->mHeaders, request->mResponder);
+	if (request->mPost)
+	{
+		easy->getInput().write(request->mPostData.data(), request->mPostData.size());
+		S32 bytes = request->mPostData.size();
+
+		easy->setopt(CURLOPT_POST, 1);
+		easy->setopt(CURLOPT_POSTFIELDS, (void*)NULL);
+		easy->setopt(CURLOPT_POSTFIELDSIZE, bytes);
 
-	easy->slist_append("Content-Type: application/llsd+xml");
+		easy->slist_append("Content-Type: application/llsd+xml");
+		lldebugs << "POSTING: " << bytes << " bytes." << llendl;
+	}
+	else
+	{
+		easy->setopt(CURLOPT_HTTPGET, 1);
+		if (request->mLength > 0)
+		{
+			std::string range = llformat("Range: bytes=%d-%d", request->mOffset, request->mOffset + request->mLength - 1);
+			easy->slist_append(range.c_str());
+		}
+	}
 	easy->setHeaders();
 
-	lldebugs << "POSTING: " << bytes << " bytes." << llendl;
-	bool res = addEasy(easy);
-	return res;
+	easy->setSchedule(request->mClass, request->mQueuedTime, start_time);
+	++mClassActive[request->mClass];
+	if (request->mClass != REQUEST_CLASS_LONG_POLL)
+	{
+		++mHostActive[request->mHost];
+	}
+
+	if (!mActiveMulti->addEasy(easy))
+	{
+		U32 status = easy->report(CURLE_FAILED_INIT);
+		requestComplete(easy, status);
+		mActiveMulti->removeEasy(easy);
+		return false;
+	}
+	return true;
+}
+
+void LLCurlRequest::requestComplete(LLCurl::Easy* easy, U32 status)
+{
+	S32 request_class = easy->getRequestClass();
+	if (request_class < 0 || request_class >= REQUEST_CLASS_COUNT)
+	{
+		return;
+	}
+
+	--mClassActive[request_class];
+	if (request_class != REQUEST_CLASS_LONG_POLL)
+	{
+		host_count_map_t::iterator iter = mHostActive.find(easy->getHost());
+		if (iter != mHostActive.end() && --iter->second <= 0)
+		{
+			mHostActive.erase(iter);
+		}
+	}
+
+	Stats& stats = mStats[request_class];
+	++stats.mRequests;
+	if (status >= 400)
+	{
+		++stats.mFailures;
+	}
+	F64 queue_wait = (F64)(easy->getStartTime() - easy->getQueuedTime()) * SEC_PER_USEC;
+	stats.mQueueWait += queue_wait;
+	stats.mMaxQueueWait = llmax(stats.mMaxQueueWait, queue_wait);
+	stats.mTransferTime += (F64)(LLTimer::getTotalTime() - easy->getStartTime()) * SEC_PER_USEC;
+
+	easy->setSchedule(-1, 0, 0);
 }
 	
 // Note: call once per frame
 S32 LLCurlRequest::process()
 {
 	llassert_always(mThreadID == LLThread::currentID());
+	dispatchQueued();
+
 	S32 res = 0;
 	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
 		 iter != mMultiSet.end(); )
@@ -832,18 +1080,20 @@ S32 LLCurlRequest::process()
 	return res;
 }
 
-S32 LLCurlRequest::getQueued()
+S32 LLCurlRequest::getActive() const
 {
-	llassert_always(mThreadID == LLThread::currentID());
-	S32 queued = 0;
-	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
-		 iter != mMultiSet.end(); )
+	S32 active = 0;
+	for (S32 i = 0; i < REQUEST_CLASS_COUNT; ++i)
 	{
-		curlmulti_set_t::iterator curiter = iter++;
-		LLCurl::Multi* multi = *curiter;
-		queued += multi->mQueued;
+		active += mClassActive[i];
 	}
-	return queued;
+	return active;
+}
+
+S32 LLCurlRequest::getQueued()
+{
+	llassert_always(mThreadID == LLThread::currentID());
+	return getActive() + getPending();
 }
 
 ////////////////////////////////////////////////////////////////////////////
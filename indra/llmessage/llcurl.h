@@ -37,6 +37,8 @@
 
 #include "linden_common.h"
 
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -185,30 +187,109 @@ namespace boost
 };
 
 
+/**
+ * @class LLCurlRequest
+ * @brief Schedules HTTP requests over a shared curl multi handle.
+ *
+ * Requests are queued and dispatched from process() in priority
+ * order, subject to a concurrency limit per request class and a limit
+ * on the connections used per host. Easy handles are kept per host so
+ * that curl can reuse their connections for the next request to the
+ * same host. Instances are bound to the thread which created them.
+ */
 class LLCurlRequest
 {
 public:
 	typedef std::vector<std::string> headers_t;
+
+	/**
+	 * @brief Request classes with separate concurrency budgets.
+	 *
+	 * Long polls are held open by the server, so they do not count
+	 * against the per host limit and can't starve short requests.
+	 */
+	enum ERequestClass
+	{
+		REQUEST_CLASS_TEXTURE,
+		REQUEST_CLASS_CAPS,
+		REQUEST_CLASS_LONG_POLL,
+		REQUEST_CLASS_COUNT
+	};
+
+	/**
+	 * @brief Running totals for the requests of one class.
+	 */
+	struct Stats
+	{
+		Stats() : mRequests(0), mFailures(0), mQueueWait(0.0), mMaxQueueWait(0.0), mTransferTime(0.0) {}
+		U32 mRequests;			// completed requests
+		U32 mFailures;			// completed with a status of 400 or more
+		F64 mQueueWait;			// seconds spent waiting for a slot
+		F64 mMaxQueueWait;
+		F64 mTransferTime;		// seconds from dispatch to completion
+	};
 	
 	LLCurlRequest();
 	~LLCurlRequest();
 
-	void get(const std::string& url, LLCurl::ResponderPtr responder);
-	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder);
-	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder);
+	void get(const std::string& url, LLCurl::ResponderPtr responder,
+			 F32 priority = 0.f, ERequestClass request_class = REQUEST_CLASS_CAPS);
+	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder,
+					  F32 priority = 0.f, ERequestClass request_class = REQUEST_CLASS_TEXTURE);
+	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder,
+			  F32 priority = 0.f, ERequestClass request_class = REQUEST_CLASS_CAPS);
+
+	// Note: call once per frame. Dispatches queued requests and
+	// completes finished ones, returns the number of curl messages.
 	S32  process();
+
+	// Requests dispatched to curl plus requests waiting for a slot
 	S32  getQueued();
+	S32  getPending() const { return (S32)mRequestQueue.size(); }
+	S32  getActive() const;
+
+	void setClassLimit(ERequestClass request_class, S32 max_active);
+	void setHostLimit(S32 max_per_host) { mHostLimit = max_per_host; }
+
+	// Asks curl to pipeline GETs on connections it already has open
+	// to the same host. Needs libcurl 7.16.0 or later.
+	void setPipelining(bool pipelining);
+
+	const Stats& getStats(ERequestClass request_class) const { return mStats[request_class]; }
+
+	// Called by LLCurl::Multi when a scheduled request finishes
+	void requestComplete(LLCurl::Easy* easy, U32 status);
 
 private:
+	struct QueuedRequest;
+	struct queued_request_compare
+	{
+		bool operator()(const QueuedRequest* lhs, const QueuedRequest* rhs) const;
+	};
+
 	void addMulti();
-	LLCurl::Easy* allocEasy();
-	bool addEasy(LLCurl::Easy* easy);
+	void queueRequest(QueuedRequest* request);
+	void dispatchQueued();
+	bool dispatch(QueuedRequest* request);
+	bool isHostFull(const QueuedRequest* request) const;
 	
 private:
 	typedef std::set<LLCurl::Multi*> curlmulti_set_t;
 	curlmulti_set_t mMultiSet;
 	LLCurl::Multi* mActiveMulti;
-	S32 mActiveRequestCount;
+
+	typedef std::set<QueuedRequest*, queued_request_compare> request_queue_t;
+	request_queue_t mRequestQueue;
+	U32 mNextSerial;
+
+	typedef std::map<std::string, S32> host_count_map_t;
+	host_count_map_t mHostActive;
+	S32 mHostLimit;
+	S32 mClassActive[REQUEST_CLASS_COUNT];
+	S32 mClassLimit[REQUEST_CLASS_COUNT];
+	Stats mStats[REQUEST_CLASS_COUNT];
+	bool mPipelining;
+	
 	U32 mThreadID; // debug
 };
 
@@ -665,15 +665,16 @@ bool LLHTTPAssetStorage::deletePendingRequest(LLAssetStorage::ERequestType rt,
 				if (pending->end() != result)
 				{
 					// This request was found in the pending list.  Move it to the end!
+					// (splice, the download queue's index points into the list)
 					LLAssetRequest* pending_req = *result;
-					pending->remove(pending_req);
 
 					if (!pending_req->mIsUserWaiting)				//A user is waiting on this request.  Toss it.
 					{
-						pending->push_back(pending_req);
+						pending->splice(pending->end(), *pending, result);
 					}
 					else
 					{
+						pending->erase(result);
 						if (pending_req->mUpCallback)	//Clean up here rather than _callUploadCallbacks because this request is already cleared the req.
 						{
 							pending_req->mUpCallback(pending_req->getUUID(), pending_req->mUserData, -1, LL_EXSTAT_REQUEST_DROPPED);
@@ -721,14 +722,8 @@ void LLHTTPAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::ETyp
 	// that we always want them first, even if they're out of order.
 	//
 	
-	if (req->getType() == LLAssetType::AT_TEXTURE)
-	{
-		mPendingDownloads.push_back(req);
-	}
-	else
-	{
-		mPendingDownloads.push_front(req);
-	}
+	// Requests for an asset that's already queued just wait for that download.
+	mPendingDownloads.add(req, req->getType() != LLAssetType::AT_TEXTURE);
 }
 
 LLAssetRequest* LLHTTPAssetStorage::findNextRequest(LLAssetStorage::request_list_t& pending, 
@@ -764,7 +759,7 @@ void LLHTTPAssetStorage::checkForTimeouts()
 {
 	CURLMcode mcode;
 	LLAssetRequest *req;
-	while ( (req = findNextRequest(mPendingDownloads, mRunningDownloads)) )
+	while ( (req = findNextRequest(mPendingDownloads.getQueue(), mRunningDownloads)) )
 	{
 		// Setup this curl download request
 		// We need to generate a new request here
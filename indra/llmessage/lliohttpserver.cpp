@@ -57,10 +57,20 @@
 #include <boost/tokenizer.hpp>
 
 static const char HTTP_VERSION_STR[] = "HTTP/1.0";
+static const char HTTP_VERSION_1_1_STR[] = "HTTP/1.1";
+
+// How long a persistent connection may sit idle between requests.
+static const F32 HTTP_KEEP_ALIVE_SECS = 15.0f;
+
+// Keys used in the request context to tell the response header how
+// the connection is being handled.
+static const std::string CONTEXT_HTTP_VERSION("http-version");
+static const std::string CONTEXT_KEEP_ALIVE("keep-alive");
 const std::string CONTEXT_REQUEST("request");
 const std::string CONTEXT_RESPONSE("response");
 const std::string CONTEXT_VERB("verb");
 const std::string CONTEXT_HEADERS("headers");
+const std::string CONTEXT_STREAMING("streaming");
 const std::string HTTP_VERB_GET("GET");
 const std::string HTTP_VERB_PUT("PUT");
 const std::string HTTP_VERB_POST("POST");
@@ -398,11 +408,15 @@ void LLHTTPPipe::unlockChain()
  * bytes on CHANNEL_OUT (or the size of the buffer in io pipe versions
  * prior to 2) prepend that data to the request in an HTTP format, and
  * supply all normal HTTP response headers.
+ *
+ * If the handler in front of it is streaming, see CONTEXT_STREAMING,
+ * the headers go out with the first piece and every piece is framed
+ * as a chunk.
  */
 class LLHTTPResponseHeader : public LLIOPipe
 {
 public:
-	LLHTTPResponseHeader() {}
+	LLHTTPResponseHeader() : mHeaderSent(false) {}
 	virtual ~LLHTTPResponseHeader() {}
 
 protected:
@@ -420,8 +434,28 @@ protected:
 		LLPumpIO* pump);
 	//@}
 
+	/** 
+	 * @brief Write the status line and headers.
+	 *
+	 * @param content_length The body length, or a negative number
+	 * for a chunked body.
+	 */
+	void buildHeader(std::ostream& ostr, LLSD& context, S32 content_length);
+
+	/** 
+	 * @brief Move whatever is on the in channel out as one chunk,
+	 * followed by the terminating chunk if this is the last one.
+	 */
+	void sendChunk(
+		const LLChannelDescriptors& channels,
+		buffer_ptr_t& buffer,
+		bool last);
+
 protected:
 	S32 mCode;
+
+	// true once a chunked response has started.
+	bool mHeaderSent;
 };
 
 
@@ -438,51 +472,146 @@ LLIOPipe::EStatus LLHTTPResponseHeader::process_impl(
 {
 	PUMP_DEBUG;
 	LLMemType m1(LLMemType::MTYPE_IO_HTTP_SERVER);
+	const LLSD& const_context = context;
+	bool streaming = const_context[CONTEXT_RESPONSE][CONTEXT_STREAMING].asBoolean();
+	if(streaming && !mHeaderSent)
+	{
+		// A body can only go out as it is produced if the client
+		// speaks HTTP/1.1 and the connection stays open, otherwise
+		// hold on to it until the handler is done.
+		bool chunked =
+			(const_context[CONTEXT_REQUEST][CONTEXT_HTTP_VERSION].asString()
+				== HTTP_VERSION_1_1_STR)
+			&& const_context[CONTEXT_REQUEST][CONTEXT_KEEP_ALIVE].asBoolean();
+		if(!chunked || (0 == buffer->count(channels.in())))
+		{
+			return STATUS_BREAK;
+		}
+		PUMP_DEBUG;
+		std::ostringstream ostr;
+		buildHeader(ostr, context, -1);
+		std::string header = ostr.str();
+		buffer->prepend(channels.out(), (U8*)header.c_str(), header.size());
+		mHeaderSent = true;
+	}
+	if(mHeaderSent)
+	{
+		PUMP_DEBUG;
+		sendChunk(channels, buffer, !streaming);
+		return streaming ? STATUS_OK : STATUS_DONE;
+	}
 	if(eos)
 	{
 		PUMP_DEBUG;
 		//mGotEOS = true;
 		std::ostringstream ostr;
-		std::string message = context[CONTEXT_RESPONSE]["statusMessage"];
-		
-		int code = context[CONTEXT_RESPONSE]["statusCode"];
-		if (code < 200)
+		buildHeader(ostr, context, buffer->countAfter(channels.in(), NULL));
+
+		LLChangeChannel change(channels.in(), channels.out());
+		std::for_each(buffer->beginSegment(), buffer->endSegment(), change);
+		std::string header = ostr.str();
+		buffer->prepend(channels.out(), (U8*)header.c_str(), header.size());
+		PUMP_DEBUG;
+		return STATUS_DONE;
+	}
+	PUMP_DEBUG;
+	return STATUS_OK;
+}
+
+void LLHTTPResponseHeader::buildHeader(
+	std::ostream& ostr,
+	LLSD& context,
+	S32 content_length)
+{
+	std::string message = context[CONTEXT_RESPONSE]["statusMessage"];
+	
+	int code = context[CONTEXT_RESPONSE]["statusCode"];
+	if (code < 200)
+	{
+		code = 200;
+		message = "OK";
+	}
+
+	bool http_1_1 = (context[CONTEXT_REQUEST][CONTEXT_HTTP_VERSION].asString()
+					 == HTTP_VERSION_1_1_STR);
+	bool keep_alive = context[CONTEXT_REQUEST][CONTEXT_KEEP_ALIVE].asBoolean();
+	ostr << (http_1_1 ? HTTP_VERSION_1_1_STR : HTTP_VERSION_STR) << " "
+		<< code << " " << message << "\r\n";
+
+	if(content_length < 0)
+	{
+		ostr << "Transfer-Encoding: chunked\r\n";
+	}
+	else if((0 < content_length) || keep_alive)
+	{
+		// a persistent connection needs the length even when it is
+		// zero, since that is the only way to find the next response.
+		ostr << "Content-Length: " << content_length << "\r\n";
+	}
+	if(keep_alive && !http_1_1)
+	{
+		ostr << "Connection: keep-alive\r\n";
+	}
+	else if(!keep_alive && http_1_1)
+	{
+		ostr << "Connection: close\r\n";
+	}
+
+	// *NOTE: This guard can go away once the LLSD static map
+	// iterator is available. Phoenix. 2008-05-09
+	LLSD headers = context[CONTEXT_RESPONSE][CONTEXT_HEADERS];
+	if(headers.isDefined())
+	{
+		LLSD::map_iterator iter = headers.beginMap();
+		LLSD::map_iterator end = headers.endMap();
+		for(; iter != end; ++iter)
 		{
-			code = 200;
-			message = "OK";
+			ostr << (*iter).first << ": " << (*iter).second.asString()
+				<< "\r\n";
 		}
-		
-		ostr << HTTP_VERSION_STR << " " << code << " " << message << "\r\n";
+	}
+	ostr << "\r\n";
+}
 
-		S32 content_length = buffer->countAfter(channels.in(), NULL);
-		if(0 < content_length)
+void LLHTTPResponseHeader::sendChunk(
+	const LLChannelDescriptors& channels,
+	buffer_ptr_t& buffer,
+	bool last)
+{
+	S32 length = buffer->count(channels.in());
+	if(length > 0)
+	{
+		// The chunk size goes right in front of the first segment of
+		// this chunk, which is always behind everything already sent.
+		std::ostringstream ostr;
+		ostr << std::hex << length << "\r\n";
+		std::string size_line = ostr.str();
+		LLBufferArray::segment_iterator_t it = buffer->beginSegment();
+		LLBufferArray::segment_iterator_t end = buffer->endSegment();
+		while((it != end) && !(*it).isOnChannel(channels.in()))
 		{
-			ostr << "Content-Length: " << content_length << "\r\n";
+			++it;
 		}
-		// *NOTE: This guard can go away once the LLSD static map
-		// iterator is available. Phoenix. 2008-05-09
-		LLSD headers = context[CONTEXT_RESPONSE][CONTEXT_HEADERS];
-		if(headers.isDefined())
+		if(it == buffer->beginSegment())
 		{
-			LLSD::map_iterator iter = headers.beginMap();
-			LLSD::map_iterator end = headers.endMap();
-			for(; iter != end; ++iter)
-			{
-				ostr << (*iter).first << ": " << (*iter).second.asString()
-					<< "\r\n";
-			}
+			buffer->prepend(channels.out(), (U8*)size_line.c_str(), size_line.size());
+		}
+		else
+		{
+			--it;
+			buffer->insertAfter(it, channels.out(), (U8*)size_line.c_str(), size_line.size());
 		}
-		ostr << "\r\n";
 
 		LLChangeChannel change(channels.in(), channels.out());
 		std::for_each(buffer->beginSegment(), buffer->endSegment(), change);
-		std::string header = ostr.str();
-		buffer->prepend(channels.out(), (U8*)header.c_str(), header.size());
-		PUMP_DEBUG;
-		return STATUS_DONE;
+		static const char CHUNK_END[] = "\r\n";
+		buffer->append(channels.out(), (U8*)CHUNK_END, sizeof(CHUNK_END) - 1);
+	}
+	if(last)
+	{
+		static const char LAST_CHUNK[] = "0\r\n\r\n";
+		buffer->append(channels.out(), (U8*)LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
 	}
-	PUMP_DEBUG;
-	return STATUS_OK;
 }
 
 
@@ -494,6 +623,13 @@ LLIOPipe::EStatus LLHTTPResponseHeader::process_impl(
  *
  * <b>NOTE:</b> You should not need to create or use one of these, the
  * details are handled by the HTTPResponseFactory.
+ *
+ * Connections are persistent for HTTP/1.1 requests and for HTTP/1.0
+ * requests which ask for keep-alive. Each response is sent from its
+ * own chain and buffer while this pipe waits, locked, on the
+ * connection chain. Once it is written the next request is parsed
+ * out of the connection buffer, so pipelined requests are answered
+ * in order.
  */
 class LLHTTPResponder : public LLIOPipe
 {
@@ -501,6 +637,12 @@ public:
 	LLHTTPResponder(const LLHTTPNode& tree, const LLSD& ctx);
 	~LLHTTPResponder();
 
+	/** 
+	 * @brief Called once the response to a persistent request has
+	 * been written, or has failed.
+	 */
+	void responseComplete(bool success);
+
 protected:
 	/** 
 	 * @brief Read data off of CHANNEL_IN keeping track of last read position.
@@ -534,6 +676,15 @@ protected:
 	 */
 	void markBad(const LLChannelDescriptors& channels, buffer_ptr_t buffer);
 
+	/** 
+	 * @brief Drop the current request from the connection buffer and
+	 * get ready to parse the next one.
+	 *
+	 * @param channels The channels to use in the buffer.
+	 * @param buffer The heap array of processed data.
+	 */
+	void consumeRequest(const LLChannelDescriptors& channels, buffer_ptr_t buffer);
+
 protected:
 	/* @name LLIOPipe virtual implementations
 	 */
@@ -556,7 +707,8 @@ protected:
 		STATE_READING_HEADERS,
 		STATE_LOOKING_FOR_EOS,
 		STATE_DONE,
-		STATE_SHORT_CIRCUIT
+		STATE_SHORT_CIRCUIT,
+		STATE_AWAITING_RESPONSE
 	};
 
 	LLSD mBuildContext;
@@ -570,15 +722,85 @@ protected:
 	S32 mContentLength;
 	LLSD mHeaders;
 
+	// persistent connection state
+	bool mKeepAlive;
+	bool mResponseOK;
+	S32 mChainLock;
+	LLPumpIO* mLockedPump;
+
 	// handle the urls
 	const LLHTTPNode& mRootNode;
 };
 
+/** 
+ * @class LLHTTPResponseWriter
+ * @brief Socket writer which tells the responder when a response on a
+ * persistent connection has gone out.
+ */
+class LLHTTPResponseWriter : public LLIOSocketWriter
+{
+public:
+	LLHTTPResponseWriter(LLSocket::ptr_t socket, LLHTTPResponder* responder) :
+		LLIOSocketWriter(socket),
+		mResponder(responder),
+		mDone(false)
+	{
+	}
+
+	virtual ~LLHTTPResponseWriter()
+	{
+		if(!mDone)
+		{
+			// the response chain died before the response was sent,
+			// so the connection is no longer in a known state.
+			mResponder->responseComplete(false);
+		}
+	}
+
+protected:
+	virtual EStatus process_impl(
+		const LLChannelDescriptors& channels,
+		buffer_ptr_t& buffer,
+		bool& eos,
+		LLSD& context,
+		LLPumpIO* pump)
+	{
+		// the chain reached end of stream as soon as the request was
+		// read, but a streamed response is not done until the handler
+		// says so.
+		const LLSD& const_context = context;
+		bool write_eos = eos
+			&& !const_context[CONTEXT_RESPONSE][CONTEXT_STREAMING].asBoolean();
+		EStatus status = LLIOSocketWriter::process_impl(
+			channels,
+			buffer,
+			write_eos,
+			context,
+			pump);
+		if(STATUS_DONE == status && !mDone)
+		{
+			mDone = true;
+			mResponder->responseComplete(true);
+		}
+		return status;
+	}
+
+protected:
+	// keeps the responder around until the response is out, even if
+	// the connection chain is torn down first.
+	boost::intrusive_ptr<LLHTTPResponder> mResponder;
+	bool mDone;
+};
+
 LLHTTPResponder::LLHTTPResponder(const LLHTTPNode& tree, const LLSD& ctx) :
 	mBuildContext(ctx),
 	mState(STATE_NOTHING),
 	mLastRead(NULL),
 	mContentLength(0),
+	mKeepAlive(false),
+	mResponseOK(true),
+	mChainLock(0),
+	mLockedPump(NULL),
 	mRootNode(tree)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_HTTP_SERVER);
@@ -618,6 +840,65 @@ bool LLHTTPResponder::readLine(
 	return true;
 }
 
+void LLHTTPResponder::responseComplete(bool success)
+{
+	mResponseOK = success;
+	if(mChainLock)
+	{
+		mLockedPump->clearLock(mChainLock);
+		mChainLock = 0;
+		mLockedPump = NULL;
+	}
+}
+
+void LLHTTPResponder::consumeRequest(
+	const LLChannelDescriptors& channels,
+	buffer_ptr_t buffer)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_HTTP_SERVER);
+	U8* last = mLastRead;
+	if(last && (0 < mContentLength))
+	{
+		last = buffer->seek(channels.in(), mLastRead, mContentLength);
+	}
+	if(last)
+	{
+		// Erasing the segments hands their memory back to the heap
+		// buffers, so a connection keeps reusing the same space.
+		LLBufferArray::segment_iterator_t split = buffer->splitAfter(last);
+		LLBufferArray::segment_iterator_t it = buffer->beginSegment();
+		LLBufferArray::segment_iterator_t end = buffer->endSegment();
+		while((split != end) && (it != end))
+		{
+			bool at_split = (it == split);
+			if((*it).isOnChannel(channels.in()))
+			{
+				LLBufferArray::segment_iterator_t erase_it = it++;
+				buffer->eraseSegment(erase_it);
+			}
+			else
+			{
+				++it;
+			}
+			if(at_split)
+			{
+				break;
+			}
+		}
+	}
+
+	mState = STATE_NOTHING;
+	mLastRead = NULL;
+	mVerb.clear();
+	mAbsPathAndQuery.clear();
+	mPath.clear();
+	mQuery.clear();
+	mVersion.clear();
+	mContentLength = 0;
+	mHeaders = LLSD();
+	mKeepAlive = false;
+}
+
 void LLHTTPResponder::markBad(
 	const LLChannelDescriptors& channels,
 	buffer_ptr_t buffer)
@@ -642,6 +923,30 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
 	LLMemType m1(LLMemType::MTYPE_IO_HTTP_SERVER);
 	LLIOPipe::EStatus status = STATUS_OK;
 
+	// waiting on the response to the last request of a persistent
+	// connection.
+	if(STATE_AWAITING_RESPONSE == mState)
+	{
+		if(mChainLock)
+		{
+			return STATUS_BREAK;
+		}
+		if(!mResponseOK)
+		{
+			return STATUS_STOP;
+		}
+		mState = STATE_NOTHING;
+		pump->setTimeoutSeconds(HTTP_KEEP_ALIVE_SECS);
+	}
+
+	if((STATE_NOTHING == mState)
+	   && eos
+	   && (0 == buffer->countAfter(channels.in(), mLastRead)))
+	{
+		// the client closed the connection between requests.
+		return STATUS_STOP;
+	}
+
 	// parsing headers
 	if((STATE_NOTHING == mState) || (STATE_READING_HEADERS == mState))
 	{
@@ -744,6 +1049,19 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
 						// end-o-headers
 						keep_parsing = false;
 						mState = STATE_LOOKING_FOR_EOS;
+
+						// HTTP/1.1 connections persist unless the client
+						// says otherwise, HTTP/1.0 only on request.
+						std::string connection = mHeaders["connection"].asString();
+						LLStringUtil::toLower(connection);
+						if(HTTP_VERSION_1_1_STR == mVersion)
+						{
+							mKeepAlive = (connection != "close");
+						}
+						else
+						{
+							mKeepAlive = (connection == "keep-alive");
+						}
 						break;
 					}
 					char* pos_colon = strchr(buf, ':');
@@ -801,32 +1119,82 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
  			//llinfos << "LLHTTPResponder::process_impl found node for "
 			//	<< mAbsPathAndQuery << llendl;
 
-  			// Copy everything after mLast read to the out.
-			LLBufferArray::segment_iterator_t seg_iter;
-			seg_iter = buffer->splitAfter(mLastRead);
-			if(seg_iter != buffer->endSegment())
+			// We need to copy all of the pipes _after_ this so
+			// that the response goes out correctly.
+			LLPumpIO::links_t current_links;
+			pump->copyCurrentLinkInfo(current_links);
+			LLPumpIO::links_t::iterator link_iter = current_links.begin();
+			LLPumpIO::links_t::iterator links_end = current_links.end();
+			for(; link_iter < links_end; ++link_iter)
 			{
-				LLChangeChannel change(channels.in(), channels.out());
-				++seg_iter;
-				std::for_each(seg_iter, buffer->endSegment(), change);
+				if(this == (*link_iter).mPipe.get())
+				{
+					++link_iter;
+					break;
+				}
+			}
 
-#if 0
-				seg_iter = buffer->beginSegment();
-				char buf[1024];	  /*Flawfinder: ignore*/
-				while(seg_iter != buffer->endSegment())
+			// A persistent connection needs a socket to write the
+			// response to from a chain of its own.
+			bool keep_alive = false;
+			if(mKeepAlive)
+			{
+				for(LLPumpIO::links_t::iterator it = link_iter; it < links_end; ++it)
 				{
-					memcpy(buf, (*seg_iter).data(), (*seg_iter).size());	  /*Flawfinder: ignore*/
-					buf[(*seg_iter).size()] = '\0';
-					llinfos << (*seg_iter).getChannel() << ": " << buf
-							<< llendl;
-					++seg_iter;
+					if(dynamic_cast<LLIOSocketWriter*>((*it).mPipe.get()))
+					{
+						keep_alive = true;
+						break;
+					}
 				}
-#endif
 			}
 
-			//
-			// *FIX: get rid of extra bytes off the end
-			//
+			buffer_ptr_t response_buffer;
+			if(keep_alive)
+			{
+				// Copy just this request's body into a buffer for the
+				// response chain, and leave anything after it on the
+				// connection for the next request.
+				response_buffer.reset(new LLBufferArray);
+				if(0 < mContentLength)
+				{
+					std::vector<U8> body(mContentLength);
+					S32 len = mContentLength;
+					buffer->readAfter(channels.in(), mLastRead, &body[0], len);
+					response_buffer->append(channels.out(), &body[0], len);
+				}
+			}
+			else
+			{
+				response_buffer = buffer;
+
+				// Copy everything after mLast read to the out.
+				LLBufferArray::segment_iterator_t seg_iter;
+				seg_iter = buffer->splitAfter(mLastRead);
+				if(seg_iter != buffer->endSegment())
+				{
+					LLChangeChannel change(channels.in(), channels.out());
+					++seg_iter;
+					std::for_each(seg_iter, buffer->endSegment(), change);
+
+#if 0
+					seg_iter = buffer->beginSegment();
+					char buf[1024];	  /*Flawfinder: ignore*/
+					while(seg_iter != buffer->endSegment())
+					{
+						memcpy(buf, (*seg_iter).data(), (*seg_iter).size());	  /*Flawfinder: ignore*/
+						buf[(*seg_iter).size()] = '\0';
+						llinfos << (*seg_iter).getChannel() << ": " << buf
+								<< llendl;
+						++seg_iter;
+					}
+#endif
+				}
+
+				//
+				// *FIX: get rid of extra bytes off the end
+				//
+			}
 
 			// Set up a chain which will prepend a content length and
 			// HTTP headers.
@@ -839,6 +1207,8 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
 			context[CONTEXT_REQUEST]["remote-port"]
 				= mBuildContext["remote-port"];
 			context[CONTEXT_REQUEST][CONTEXT_HEADERS] = mHeaders;
+			context[CONTEXT_REQUEST][CONTEXT_HTTP_VERSION] = mVersion;
+			context[CONTEXT_REQUEST][CONTEXT_KEEP_ALIVE] = keep_alive;
 
 			const LLChainIOFactory* protocolHandler
 				= node->getProtocolHandler();
@@ -859,22 +1229,21 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
 			LLIOPipe* header = new LLHTTPResponseHeader;
 			chain.push_back(LLIOPipe::ptr_t(header));
 
-			// We need to copy all of the pipes _after_ this so
-			// that the response goes out correctly.
-			LLPumpIO::links_t current_links;
-			pump->copyCurrentLinkInfo(current_links);
-			LLPumpIO::links_t::iterator link_iter = current_links.begin();
-			LLPumpIO::links_t::iterator links_end = current_links.end();
-			bool after_this = false;
 			for(; link_iter < links_end; ++link_iter)
 			{
-				if(after_this)
+				LLIOSocketWriter* writer = keep_alive
+					? dynamic_cast<LLIOSocketWriter*>((*link_iter).mPipe.get())
+					: NULL;
+				if(writer)
 				{
-					chain.push_back((*link_iter).mPipe);
+					// the connection's writer only knows its way
+					// around the connection buffer.
+					chain.push_back(LLIOPipe::ptr_t(
+						new LLHTTPResponseWriter(writer->getDestination(), this)));
 				}
-				else if(this == (*link_iter).mPipe.get())
+				else
 				{
-					after_this = true;
+					chain.push_back((*link_iter).mPipe);
 				}
 			}
 			
@@ -895,11 +1264,30 @@ LLIOPipe::EStatus LLHTTPResponder::process_impl(
 			}
 			pump->addChain(
 				links,
-				buffer,
+				response_buffer,
 				context,
 				DEFAULT_CHAIN_EXPIRY_SECS);
 
-			status = STATUS_STOP;
+			if(keep_alive)
+			{
+				// The response chain has its own copy of the context.
+				// Sleep until the response is written, since the next
+				// response must not go out ahead of this one. The
+				// response chain has its own expiry, so this one
+				// should not time out underneath it.
+				context = LLSD();
+				consumeRequest(channels, buffer);
+				mState = STATE_AWAITING_RESPONSE;
+				mResponseOK = true;
+				mLockedPump = pump;
+				mChainLock = pump->setLock();
+				pump->setTimeoutSeconds(NEVER_CHAIN_EXPIRY_SECS);
+				status = STATUS_BREAK;
+			}
+			else
+			{
+				status = STATUS_STOP;
+			}
 		}
 		else
 		{
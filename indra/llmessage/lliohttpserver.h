@@ -46,6 +46,14 @@ extern const std::string CONTEXT_REQUEST;
 extern const std::string CONTEXT_RESPONSE;
 extern const std::string CONTEXT_VERB;
 extern const std::string CONTEXT_HEADERS;
+
+// Protocol handlers which produce a response body a piece at a time
+// set context[CONTEXT_RESPONSE][CONTEXT_STREAMING] to true and return
+// STATUS_OK with each piece, then clear it and return STATUS_DONE with
+// the last one. On a persistent HTTP/1.1 connection the pieces are
+// sent as they come using chunked transfer encoding, otherwise the
+// body is sent whole once the handler is done.
+extern const std::string CONTEXT_STREAMING;
 extern const std::string HTTP_VERB_GET;
 extern const std::string HTTP_VERB_PUT;
 extern const std::string HTTP_VERB_POST;
@@ -245,6 +245,15 @@ public:
 	LLIOSocketWriter(LLSocket::ptr_t socket);
 	~LLIOSocketWriter();
 
+	/**
+	 * @brief The socket this pipe writes to.
+	 *
+	 * A writer tracks its position in the buffer it was last given,
+	 * so a pipe which sends several responses on one connection
+	 * creates a new writer on the same socket for each of them.
+	 */
+	LLSocket::ptr_t getDestination() const { return mDestination; }
+
 protected:
 	/* @name LLIOPipe virtual implementations
 	 */
@@ -34,6 +34,7 @@
 #define LL_LLMESSAGETEMPLATE_H
 
 #include "lldarray.h"
+#include "lleventtrace.h"
 #include "message.h" // TODO: babbage: Remove...
 #include "llstat.h"
 #include "llstl.h"
@@ -373,6 +374,7 @@ public:
 		if (mHandlerFunc)
 		{
             LLPerfBlock msg_cb_time("msg_cb", mName);
+			LLEventTraceScope trace(LLEventTrace::CAT_MESSAGE, mName);
 			mHandlerFunc(msgsystem, mUserData);
 			return TRUE;
 		}
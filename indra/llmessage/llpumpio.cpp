@@ -68,6 +68,14 @@ static const S32 DEFAULT_POLL_TIMEOUT = 1000;
 static const S32 DEFAULT_POLL_TIMEOUT = 0;
 #endif
 
+// The pollset is sized with room to spare so that conditionals can
+// be added one at a time without rebuilding it.
+static const S32 POLLSET_MIN_CAPACITY = 64;
+
+// Stale timeout heap entries are compacted away once there are this
+// many more of them than running chains.
+static const S32 TIMEOUT_HEAP_SLACK = 64;
+
 // The default (and fallback) expiration time for chains
 const F32 DEFAULT_CHAIN_EXPIRY_SECS = 30.0f;
 extern const F32 SHORT_CHAIN_EXPIRY_SECS = 1.0f;
@@ -173,7 +181,9 @@ LLPumpIO::LLPumpIO(apr_pool_t* pool) :
 	mState(LLPumpIO::NORMAL),
 	mRebuildPollset(false),
 	mPollset(NULL),
-	mPollsetClientID(0),
+	mPollsetCapacity(0),
+	mPollsetCount(0),
+	mNextChainID(0),
 	mNextLock(0),
 	mPool(NULL),
 	mCurrentPool(NULL),
@@ -272,6 +282,7 @@ bool LLPumpIO::setTimeoutSeconds(F32 timeout)
 		return false;
 	}
 	(*mCurrentChain).setTimeoutSeconds(timeout);
+	scheduleTimeout(*mCurrentChain);
 	return true;
 }
 
@@ -281,6 +292,7 @@ void LLPumpIO::adjustTimeoutSeconds(F32 delta)
 	if(mRunningChains.end() != mCurrentChain)
 	{
 		(*mCurrentChain).adjustTimeoutSeconds(delta);
+		scheduleTimeout(*mCurrentChain);
 	}
 }
 
@@ -327,6 +339,13 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 #endif
 		 << " at " << pipe << llendl;
 
+	// conditionals only make sense for a running chain, and not for
+	// the one shot chains run from callback().
+	if(mRunningChains.end() == mCurrentChain)
+	{
+		return false;
+	}
+
 	// remove any matching poll file descriptors for this pipe.
 	LLIOPipe::ptr_t pipe_ptr(pipe);
 	LLChainInfo::conditionals_t::iterator it;
@@ -336,9 +355,9 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 		LLChainInfo::pipe_conditional_t& value = (*it);
 		if(pipe_ptr == value.first)
 		{
+			removeDescriptor(value.second);
 			ll_delete_apr_pollset_fd_client_data()(value);
 			it = (*mCurrentChain).mDescriptors.erase(it);
-			mRebuildPollset = true;
 		}
 		else
 		{
@@ -348,7 +367,6 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 
 	if(!poll)
 	{
-		mRebuildPollset = true;
 		return true;
 	}
 	LLChainInfo::pipe_conditional_t value;
@@ -362,9 +380,10 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 		// *FIX: Should it always be this pool?
 		value.second.p = mPool;
 	}
-	value.second.client_data = new S32(++mPollsetClientID);
+	// the client data identifies the chain to wake when signalled.
+	value.second.client_data = new S32((*mCurrentChain).mChainID);
 	(*mCurrentChain).mDescriptors.push_back(value);
-	mRebuildPollset = true;
+	addDescriptor((*mCurrentChain).mDescriptors.back().second);
 	return true;
 }
 
@@ -455,6 +474,11 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	// Run any pending runners.
 	mRunner.run();
 
+	// Chains whose lock is cleared this pump get processed once even
+	// if they are waiting on a conditional, since whatever they were
+	// locked for may have left them work to do.
+	std::vector<S32> process_ids;
+
 	// We need to move all of the pending heads over to the running
 	// chains.
 	PUMP_DEBUG;
@@ -478,12 +502,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 		if(!mPendingChains.empty())
 		{
 			PUMP_DEBUG;
-			//lldebugs << "Pushing " << mPendingChains.size() << "." << llendl;
-			std::copy(
-				mPendingChains.begin(),
-				mPendingChains.end(),
-				std::back_insert_iterator<running_chains_t>(mRunningChains));
-			mPendingChains.clear();
+			activatePendingChains();
 			PUMP_DEBUG;
 		}
 
@@ -492,14 +511,23 @@ void LLPumpIO::pump(const S32& poll_timeout)
 		if(!mClearLocks.empty())
 		{
 			PUMP_DEBUG;
-			running_chains_t::iterator it = mRunningChains.begin();
-			running_chains_t::iterator end = mRunningChains.end();
-			std::set<S32>::iterator not_cleared = mClearLocks.end();
+			std::set<S32>::iterator it = mClearLocks.begin();
+			std::set<S32>::iterator end = mClearLocks.end();
 			for(; it != end; ++it)
 			{
-				if((*it).mLock && mClearLocks.find((*it).mLock) != not_cleared)
+				chain_locks_t::iterator lock_it = mLockedChains.find(*it);
+				if(lock_it == mLockedChains.end())
+				{
+					continue;
+				}
+				chain_index_t::iterator index_it = mChainIndex.find(lock_it->second);
+				mLockedChains.erase(lock_it);
+				if(index_it != mChainIndex.end()
+				   && (*(index_it->second)).mLock == (*it))
 				{
-					(*it).mLock = 0;
+					(*(index_it->second)).mLock = 0;
+					updateReadiness(*(index_it->second));
+					process_ids.push_back(index_it->first);
 				}
 			}
 			PUMP_DEBUG;
@@ -508,7 +536,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	}
 
 	PUMP_DEBUG;
-	// rebuild the pollset if necessary
+	// rebuild the pollset if it ran out of room
 	if(mRebuildPollset)
 	{
 		PUMP_DEBUG;
@@ -516,163 +544,125 @@ void LLPumpIO::pump(const S32& poll_timeout)
 		mRebuildPollset = false;
 	}
 
-	// Poll based on the last known pollset
-	// *TODO: may want to pass in a poll timeout so it works correctly
-	// in single and multi threaded processes.
+	// Poll the registered descriptors and note which chains they
+	// belong to. Nothing from the poll result is touched after this,
+	// since processing may remove descriptors from the pollset.
 	PUMP_DEBUG;
-	typedef std::map<S32, S32> signal_client_t;
-	signal_client_t signalled_client;
-	const apr_pollfd_t* poll_fd = NULL;
-	if(mPollset)
+	typedef std::map<S32, apr_int16_t> signalled_chains_t;
+	signalled_chains_t signalled_chains;
+	if(mPollset && mPollsetCount > 0)
 	{
 		PUMP_DEBUG;
-		//llinfos << "polling" << llendl;
+		apr_interval_time_t timeout = poll_timeout;
+		if(timeout > 0 && !mChainTimeouts.empty())
+		{
+			// don't sleep through the next chain expiration
+			F64 remaining = mChainTimeouts.top().mExpiresAt
+				- LLFrameTimer::getTotalSeconds();
+			if(remaining <= 0.0)
+			{
+				timeout = 0;
+			}
+			else if(remaining * 1000000.0 < (F64)timeout)
+			{
+				timeout = (apr_interval_time_t)(remaining * 1000000.0);
+			}
+		}
 		S32 count = 0;
-		S32 client_id = 0;
+		const apr_pollfd_t* poll_fd = NULL;
         {
             LLPerfBlock polltime("pump_poll");
-            apr_pollset_poll(mPollset, poll_timeout, &count, &poll_fd);
+            apr_pollset_poll(mPollset, timeout, &count, &poll_fd);
         }
 		PUMP_DEBUG;
 		for(S32 ii = 0; ii < count; ++ii)
 		{
 			ll_debug_poll_fd("Signalled pipe", &poll_fd[ii]);
-			client_id = *((S32*)poll_fd[ii].client_data);
-			signalled_client[client_id] = ii;
+			S32 chain_id = *((S32*)poll_fd[ii].client_data);
+			signalled_chains[chain_id] |= poll_fd[ii].rtnevents;
 		}
 		PUMP_DEBUG;
 	}
 
 	PUMP_DEBUG;
-	// set up for a check to see if each one was signalled
-	signal_client_t::iterator not_signalled = signalled_client.end();
-
-	// Process everything as appropriate
-	//lldebugs << "Running chain count: " << mRunningChains.size() << llendl;
-	running_chains_t::iterator run_chain = mRunningChains.begin();
-	bool process_this_chain = false;
-	while( run_chain != mRunningChains.end() )
+	// Retire or revive chains which have timed out.
+	expireChains();
+
+	// Process every chain with nothing to wait on, every chain which
+	// was signalled and every chain just unlocked. Ids are handed out
+	// in order, so this visits chains in the order they were added to
+	// the pump.
+	process_ids.insert(process_ids.end(), mReadyChains.begin(), mReadyChains.end());
+	signalled_chains_t::iterator signal_it = signalled_chains.begin();
+	signalled_chains_t::iterator signal_end = signalled_chains.end();
+	for(; signal_it != signal_end; ++signal_it)
+	{
+		process_ids.push_back(signal_it->first);
+	}
+	std::sort(process_ids.begin(), process_ids.end());
+	process_ids.erase(
+		std::unique(process_ids.begin(), process_ids.end()),
+		process_ids.end());
+
+	//lldebugs << "Ready chain count: " << process_ids.size() << llendl;
+	std::vector<S32>::iterator id_it = process_ids.begin();
+	std::vector<S32>::iterator id_end = process_ids.end();
+	for(; id_it != id_end; ++id_it)
 	{
 		PUMP_DEBUG;
-		if((*run_chain).mInit
-		   && (*run_chain).mTimer.getStarted()
-		   && (*run_chain).mTimer.hasExpired())
+		chain_index_t::iterator index_it = mChainIndex.find(*id_it);
+		if(index_it == mChainIndex.end())
 		{
-			PUMP_DEBUG;
-			if(handleChainError(*run_chain, LLIOPipe::STATUS_EXPIRED))
-			{
-				// the pipe probably handled the error. If the handler
-				// forgot to reset the expiration then we need to do
-				// that here.
-				if((*run_chain).mTimer.getStarted()
-				   && (*run_chain).mTimer.hasExpired())
-				{
-					PUMP_DEBUG;
-					llinfos << "Error handler forgot to reset timeout. "
-							<< "Resetting to " << DEFAULT_CHAIN_EXPIRY_SECS
-							<< " seconds." << llendl;
-					(*run_chain).setTimeoutSeconds(DEFAULT_CHAIN_EXPIRY_SECS);
-				}
-			}
-			else
-			{
-				PUMP_DEBUG;
-				// it timed out and no one handled it, so we need to
-				// retire the chain
-#if LL_DEBUG_PIPE_TYPE_IN_PUMP
-				lldebugs << "Removing chain "
-						<< (*run_chain).mChainLinks[0].mPipe
-						<< " '"
-						<< typeid(*((*run_chain).mChainLinks[0].mPipe)).name()
-						<< "' because it timed out." << llendl;
-#else
-//				lldebugs << "Removing chain "
-//						<< (*run_chain).mChainLinks[0].mPipe
-//						<< " because we reached the end." << llendl;
-#endif
-				run_chain = mRunningChains.erase(run_chain);
-				continue;
-			}
+			// retired while expiring
+			continue;
 		}
-		PUMP_DEBUG;
+		current_chain_t run_chain = index_it->second;
 		if((*run_chain).mLock)
 		{
-			++run_chain;
 			continue;
 		}
 		PUMP_DEBUG;
 		mCurrentChain = run_chain;
-		
-		if((*run_chain).mDescriptors.empty())
-		{
-			// if there are no conditionals, just process this chain.
-			process_this_chain = true;
-			//lldebugs << "no conditionals - processing" << llendl;
-		}
-		else
+
+		bool process_this_chain = true;
+		signalled_chains_t::iterator signal = signalled_chains.find(*id_it);
+		if(signal != signalled_chains.end())
 		{
 			PUMP_DEBUG;
-			//lldebugs << "checking conditionals" << llendl;
-			// Check if this run chain was signalled. If any file
-			// descriptor is ready for something, then go ahead and
-			// process this chian.
-			process_this_chain = false;
-			if(!signalled_client.empty())
+			static const apr_int16_t POLL_CHAIN_ERROR =
+				APR_POLLHUP | APR_POLLNVAL | APR_POLLERR;
+			apr_int16_t rtnevents = signal->second;
+			if(rtnevents & POLL_CHAIN_ERROR)
 			{
-				PUMP_DEBUG;
-				LLChainInfo::conditionals_t::iterator it;
-				it = (*run_chain).mDescriptors.begin();
-				LLChainInfo::conditionals_t::iterator end;
-				end = (*run_chain).mDescriptors.end();
-				S32 client_id = 0;
-				signal_client_t::iterator signal;
-				for(; it != end; ++it)
+				// Potential eror condition has been returned. If HUP
+				// was one of them, we pass that as the error even
+				// though there may be more. If there are in fact more
+				// errors, we'll just wait for that detection until
+				// the next pump() cycle to catch it so that the logic
+				// here gets no more strained than it already is.
+				process_this_chain = false;
+				LLIOPipe::EStatus error_status;
+				if(rtnevents & APR_POLLHUP)
+					error_status = LLIOPipe::STATUS_LOST_CONNECTION;
+				else
+					error_status = LLIOPipe::STATUS_ERROR;
+				if(!handleChainError(*run_chain, error_status))
 				{
-					PUMP_DEBUG;
-					client_id = *((S32*)((*it).second.client_data));
-					signal = signalled_client.find(client_id);
-					if (signal == not_signalled) continue;
-					static const apr_int16_t POLL_CHAIN_ERROR =
-						APR_POLLHUP | APR_POLLNVAL | APR_POLLERR;
-					const apr_pollfd_t* poll = &(poll_fd[(*signal).second]);
-					if(poll->rtnevents & POLL_CHAIN_ERROR)
-					{
-						// Potential eror condition has been
-						// returned. If HUP was one of them, we pass
-						// that as the error even though there may be
-						// more. If there are in fact more errors,
-						// we'll just wait for that detection until
-						// the next pump() cycle to catch it so that
-						// the logic here gets no more strained than
-						// it already is.
-						LLIOPipe::EStatus error_status;
-						if(poll->rtnevents & APR_POLLHUP)
-							error_status = LLIOPipe::STATUS_LOST_CONNECTION;
-						else
-							error_status = LLIOPipe::STATUS_ERROR;
-						if(handleChainError(*run_chain, error_status)) break;
-						ll_debug_poll_fd("Removing pipe", poll);
-						llwarns << "Removing pipe "
-							<< (*run_chain).mChainLinks[0].mPipe
-							<< " '"
+					llwarns << "Removing pipe "
+						<< (*run_chain).mChainLinks[0].mPipe
+						<< " '"
 #if LL_DEBUG_PIPE_TYPE_IN_PUMP
-							<< typeid(
-								*((*run_chain).mChainLinks[0].mPipe)).name()
+						<< typeid(
+							*((*run_chain).mChainLinks[0].mPipe)).name()
 #endif
-							<< "' because: "
-							<< events_2_string(poll->rtnevents)
-							<< llendl;
-						(*run_chain).mHead = (*run_chain).mChainLinks.end();
-						break;
-					}
-
-					// at least 1 fd got signalled, and there were no
-					// errors. That means we process this chain.
-					process_this_chain = true;
-					break;
+						<< "' because: "
+						<< events_2_string(rtnevents)
+						<< llendl;
+					(*run_chain).mHead = (*run_chain).mChainLinks.end();
 				}
 			}
 		}
+
 		if(process_this_chain)
 		{
 			PUMP_DEBUG;
@@ -686,7 +676,8 @@ void LLPumpIO::pump(const S32& poll_timeout)
 		}
 
 		PUMP_DEBUG;
-		if((*run_chain).mHead == (*run_chain).mChainLinks.end())
+		if((*run_chain).mInit
+		   && (*run_chain).mHead == (*run_chain).mChainLinks.end())
 		{
 #if LL_DEBUG_PIPE_TYPE_IN_PUMP
 			lldebugs << "Removing chain " << (*run_chain).mChainLinks[0].mPipe
@@ -701,21 +692,14 @@ void LLPumpIO::pump(const S32& poll_timeout)
 			PUMP_DEBUG;
 			// This chain is done. Clean up any allocated memory and
 			// erase the chain info.
-			std::for_each(
-				(*run_chain).mDescriptors.begin(),
-				(*run_chain).mDescriptors.end(),
-				ll_delete_apr_pollset_fd_client_data());
-			run_chain = mRunningChains.erase(run_chain);
-
-			// *NOTE: may not always need to rebuild the pollset.
-			mRebuildPollset = true;
+			retireChain(run_chain);
 		}
 		else
 		{
 			PUMP_DEBUG;
-			// this chain needs more processing - just go to the next
-			// chain.
-			++run_chain;
+			// process() may have set conditionals or locks, so
+			// work out whether it still needs a signal to run.
+			updateReadiness(*run_chain);
 		}
 	}
 
@@ -725,6 +709,187 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	END_PUMP_DEBUG;
 }
 
+void LLPumpIO::activatePendingChains()
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	pending_chains_t::iterator it = mPendingChains.begin();
+	pending_chains_t::iterator end = mPendingChains.end();
+	for(; it != end; ++it)
+	{
+		// deal with wrap.
+		do
+		{
+			if(++mNextChainID <= 0)
+			{
+				mNextChainID = 1;
+			}
+		} while(mChainIndex.find(mNextChainID) != mChainIndex.end());
+
+		current_chain_t chain = mRunningChains.insert(mRunningChains.end(), *it);
+		(*chain).mChainID = mNextChainID;
+		mChainIndex[mNextChainID] = chain;
+		scheduleTimeout(*chain);
+		updateReadiness(*chain);
+	}
+	mPendingChains.clear();
+}
+
+void LLPumpIO::scheduleTimeout(LLChainInfo& chain)
+{
+	// any entry already on the heap for this chain is now stale.
+	++chain.mTimerSerial;
+	if(!chain.mChainID || !chain.mTimer.getStarted())
+	{
+		return;
+	}
+
+	if(mChainTimeouts.size() > 2 * mChainIndex.size() + TIMEOUT_HEAP_SLACK)
+	{
+		// chains which keep pushing their timeout out leave a trail of
+		// stale entries, so rebuild the heap from the live chains.
+		chain_timeouts_t live_timeouts;
+		while(!mChainTimeouts.empty())
+		{
+			const LLChainTimeout& timeout = mChainTimeouts.top();
+			chain_index_t::iterator index_it = mChainIndex.find(timeout.mChainID);
+			if(index_it != mChainIndex.end()
+			   && (*(index_it->second)).mTimerSerial == timeout.mSerial)
+			{
+				live_timeouts.push(timeout);
+			}
+			mChainTimeouts.pop();
+		}
+		std::swap(mChainTimeouts, live_timeouts);
+	}
+
+	LLChainTimeout timeout;
+	timeout.mExpiresAt = chain.mTimer.expiresAt();
+	timeout.mChainID = chain.mChainID;
+	timeout.mSerial = chain.mTimerSerial;
+	mChainTimeouts.push(timeout);
+}
+
+void LLPumpIO::updateReadiness(LLChainInfo& chain)
+{
+	if(!chain.mLock && chain.mDescriptors.empty())
+	{
+		mReadyChains.insert(chain.mChainID);
+	}
+	else
+	{
+		mReadyChains.erase(chain.mChainID);
+	}
+	if(chain.mLock)
+	{
+		mLockedChains[chain.mLock] = chain.mChainID;
+	}
+}
+
+void LLPumpIO::expireChains()
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	std::vector<LLChainTimeout> deferred;
+	while(!mChainTimeouts.empty())
+	{
+		PUMP_DEBUG;
+		LLChainTimeout timeout = mChainTimeouts.top();
+		chain_index_t::iterator index_it = mChainIndex.find(timeout.mChainID);
+		if(index_it == mChainIndex.end()
+		   || (*(index_it->second)).mTimerSerial != timeout.mSerial)
+		{
+			// the chain is gone or its timeout was changed.
+			mChainTimeouts.pop();
+			continue;
+		}
+
+		current_chain_t run_chain = index_it->second;
+		if(!(*run_chain).mTimer.hasExpired())
+		{
+			// the earliest live timeout is still in the future.
+			break;
+		}
+		mChainTimeouts.pop();
+
+		if(!(*run_chain).mInit)
+		{
+			// chains only expire after they have been processed once.
+			deferred.push_back(timeout);
+			continue;
+		}
+
+		PUMP_DEBUG;
+		mCurrentChain = run_chain;
+		if(handleChainError(*run_chain, LLIOPipe::STATUS_EXPIRED))
+		{
+			// the pipe probably handled the error. If the handler
+			// forgot to reset the expiration then we need to do
+			// that here.
+			if((*run_chain).mTimer.getStarted()
+			   && (*run_chain).mTimer.hasExpired())
+			{
+				PUMP_DEBUG;
+				llinfos << "Error handler forgot to reset timeout. "
+						<< "Resetting to " << DEFAULT_CHAIN_EXPIRY_SECS
+						<< " seconds." << llendl;
+				(*run_chain).setTimeoutSeconds(DEFAULT_CHAIN_EXPIRY_SECS);
+			}
+			scheduleTimeout(*run_chain);
+		}
+		else
+		{
+			PUMP_DEBUG;
+			// it timed out and no one handled it, so we need to
+			// retire the chain
+#if LL_DEBUG_PIPE_TYPE_IN_PUMP
+			lldebugs << "Removing chain "
+					<< (*run_chain).mChainLinks[0].mPipe
+					<< " '"
+					<< typeid(*((*run_chain).mChainLinks[0].mPipe)).name()
+					<< "' because it timed out." << llendl;
+#else
+//			lldebugs << "Removing chain "
+//					<< (*run_chain).mChainLinks[0].mPipe
+//					<< " because we reached the end." << llendl;
+#endif
+			retireChain(run_chain);
+		}
+	}
+
+	std::vector<LLChainTimeout>::iterator it = deferred.begin();
+	std::vector<LLChainTimeout>::iterator end = deferred.end();
+	for(; it != end; ++it)
+	{
+		mChainTimeouts.push(*it);
+	}
+	mCurrentChain = mRunningChains.end();
+}
+
+void LLPumpIO::retireChain(current_chain_t run_chain)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	LLChainInfo& chain = *run_chain;
+	LLChainInfo::conditionals_t::iterator it = chain.mDescriptors.begin();
+	LLChainInfo::conditionals_t::iterator end = chain.mDescriptors.end();
+	for(; it != end; ++it)
+	{
+		removeDescriptor((*it).second);
+		ll_delete_apr_pollset_fd_client_data()(*it);
+	}
+	chain.mDescriptors.clear();
+
+	mReadyChains.erase(chain.mChainID);
+	if(chain.mLock)
+	{
+		mLockedChains.erase(chain.mLock);
+	}
+	mChainIndex.erase(chain.mChainID);
+	if(mCurrentChain == run_chain)
+	{
+		mCurrentChain = mRunningChains.end();
+	}
+	mRunningChains.erase(run_chain);
+}
+
 //bool LLPumpIO::respond(const chain_t& pipes)
 //{
 //#if LL_THREADS_APR
@@ -854,6 +1019,8 @@ void LLPumpIO::cleanup()
 		apr_pollset_destroy(mPollset);
 		mPollset = NULL;
 	}
+	mPollsetCapacity = 0;
+	mPollsetCount = 0;
 	if(mCurrentPool)
 	{
 		apr_pool_destroy(mCurrentPool);
@@ -872,6 +1039,8 @@ void LLPumpIO::rebuildPollset()
 		apr_pollset_destroy(mPollset);
 		mPollset = NULL;
 	}
+	mPollsetCapacity = 0;
+	mPollsetCount = 0;
 	U32 size = 0;
 	running_chains_t::iterator run_it = mRunningChains.begin();
 	running_chains_t::iterator run_end = mRunningChains.end();
@@ -897,23 +1066,74 @@ void LLPumpIO::rebuildPollset()
 			(void)ll_apr_warn_status(status);
 		}
 
+		// leave room so that new conditionals can be added
+		// incrementally until the pump doubles in size.
+		S32 capacity = llmax((S32)size * 2, POLLSET_MIN_CAPACITY);
+		if(ll_apr_warn_status(apr_pollset_create(&mPollset, capacity, mCurrentPool, 0)))
+		{
+			mPollset = NULL;
+			return;
+		}
+		mPollsetCapacity = capacity;
+
 		// add all of the file descriptors
 		run_it = mRunningChains.begin();
 		LLChainInfo::conditionals_t::iterator fd_it;
 		LLChainInfo::conditionals_t::iterator fd_end;
-		apr_pollset_create(&mPollset, size, mCurrentPool, 0);
 		for(; run_it != run_end; ++run_it)
 		{
 			fd_it = (*run_it).mDescriptors.begin();
 			fd_end = (*run_it).mDescriptors.end();
 			for(; fd_it != fd_end; ++fd_it)
 			{
-				apr_pollset_add(mPollset, &((*fd_it).second));
+				if(APR_SUCCESS == apr_pollset_add(mPollset, &((*fd_it).second)))
+				{
+					++mPollsetCount;
+				}
 			}
 		}
 	}
 }
 
+void LLPumpIO::addDescriptor(apr_pollfd_t& poll)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	if(mRebuildPollset)
+	{
+		// the pending rebuild will pick this one up.
+		return;
+	}
+	if(!mPollset || mPollsetCount >= mPollsetCapacity)
+	{
+		mRebuildPollset = true;
+		return;
+	}
+	apr_status_t status = apr_pollset_add(mPollset, &poll);
+	if(APR_SUCCESS == status)
+	{
+		++mPollsetCount;
+	}
+	else
+	{
+		ll_debug_poll_fd("Failed to add", &poll);
+		mRebuildPollset = true;
+	}
+}
+
+void LLPumpIO::removeDescriptor(apr_pollfd_t& poll)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	if(mRebuildPollset || !mPollset)
+	{
+		// the pending rebuild will leave this one out.
+		return;
+	}
+	if(APR_SUCCESS == apr_pollset_remove(mPollset, &poll))
+	{
+		--mPollsetCount;
+	}
+}
+
 void LLPumpIO::processChain(LLChainInfo& chain)
 {
 	PUMP_DEBUG;
@@ -1159,6 +1379,8 @@ bool LLPumpIO::handleChainError(
 LLPumpIO::LLChainInfo::LLChainInfo() :
 	mInit(false),
 	mLock(0),
+	mChainID(0),
+	mTimerSerial(0),
 	mEOS(false)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
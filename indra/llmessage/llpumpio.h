@@ -35,6 +35,9 @@
 #ifndef LL_LLPUMPIO_H
 #define LL_LLPUMPIO_H
 
+#include <functional>
+#include <map>
+#include <queue>
 #include <set>
 #if LL_LINUX  // needed for PATH_MAX in APR.
 #include <sys/param.h>
@@ -176,18 +179,18 @@ public:
 
 	/** 
 	 * @brief Set up file descriptors for for the running chain.
-	 * @see rebuildPollset()
+	 * @see addDescriptor()
 	 *
 	 * There is currently a limit of one conditional per pipe.
-	 * *NOTE: The internal mechanism for building a pollset based on
-	 * pipe/pollfd/chain generates an epoll error on linux (and
-	 * probably behaves similarly on other platforms) because the
-	 * pollset rebuilder will add each apr_pollfd_t serially. This
-	 * does not matter for pipes on the same chain, since any
-	 * signalled pipe will eventually invoke a call to process(), but
-	 * is a problem if the same apr_pollfd_t is on different
-	 * chains. Once we have more than just network i/o on the pump,
-	 * this might matter.
+	 * The descriptor is added to (or removed from) the pump pollset
+	 * immediately, so changing one conditional no longer costs a
+	 * rebuild of every descriptor on every chain. On linux the apr
+	 * pollset is backed by level triggered epoll.
+	 * *NOTE: The same apr_pollfd_t must not be on different chains,
+	 * since epoll refuses to register a descriptor twice. This does
+	 * not matter for pipes on the same chain, since any signalled
+	 * pipe will eventually invoke a call to process(). Once we have
+	 * more than just network i/o on the pump, this might matter.
 	 * *FIX: Given the structure of the pump and pipe relationship,
 	 * this should probably go through a different mechanism than the
 	 * pump. I think it would be best if the pipe had some kind of
@@ -250,14 +253,17 @@ public:
 	bool copyCurrentLinkInfo(links_t& links) const;
 
 	/** 
-	 * @brief Call this method to call process on all running chains.
+	 * @brief Call this method to call process on all ready chains.
 	 *
-	 * This method iterates through the running chains, and if all
-	 * pipe on a chain are unconditionally ready or if any pipe has
-	 * any conditional processiong condition then process will be
-	 * called on every chain which has requested processing.  that
-	 * chain has a file descriptor ready, <code>process()</code> will
-	 * be called for all pipes which have requested it.
+	 * A chain is ready if none of its pipes has set a conditional
+	 * and it is not locked, if any of its file descriptors has been
+	 * signalled, or if its lock was cleared since the last pump.
+	 * Only ready chains are visited, so chains
+	 * waiting on quiet sockets cost nothing per pump. Chain
+	 * expiration is driven from a timeout heap rather than by
+	 * checking the timer of every chain.
+	 * @param poll_timeout The longest time in microseconds to wait
+	 * in poll. It is cut short by the earliest pending chain timeout.
 	 */
 	void pump(const S32& poll_timeout);
 	void pump();
@@ -344,7 +350,9 @@ protected:
 	EState mState;
 	bool mRebuildPollset;
 	apr_pollset_t* mPollset;
-	S32 mPollsetClientID;
+	S32 mPollsetCapacity;
+	S32 mPollsetCount;
+	S32 mNextChainID;
 	S32 mNextLock;
 	std::set<S32> mClearLocks;
 
@@ -363,6 +371,8 @@ protected:
 		// basic member data
 		bool mInit;
 		S32 mLock;
+		S32 mChainID;
+		U32 mTimerSerial;
 		LLFrameTimer mTimer;
 		links_t::iterator mHead;
 		links_t mChainLinks;
@@ -385,6 +395,40 @@ protected:
 	typedef running_chains_t::iterator current_chain_t;
 	current_chain_t mCurrentChain;
 
+	// Index of running chains by id. Everything else refers to
+	// chains by id so that retiring a chain never leaves a dangling
+	// iterator behind.
+	typedef std::map<S32, current_chain_t> chain_index_t;
+	chain_index_t mChainIndex;
+
+	// Ids of unlocked chains without any conditionals. These are
+	// processed on every pump.
+	typedef std::set<S32> chain_ids_t;
+	chain_ids_t mReadyChains;
+
+	// Lock key to id of the chain holding it.
+	typedef std::map<S32, S32> chain_locks_t;
+	chain_locks_t mLockedChains;
+
+	// Min-heap of pending chain expirations. Entries are not removed
+	// when a chain's timer changes; instead every change bumps the
+	// chain's timer serial and stale entries are dropped on pop.
+	struct LLChainTimeout
+	{
+		F64 mExpiresAt;
+		S32 mChainID;
+		U32 mSerial;
+		bool operator>(const LLChainTimeout& rhs) const
+		{
+			return mExpiresAt > rhs.mExpiresAt;
+		}
+	};
+	typedef std::priority_queue<
+		LLChainTimeout,
+		std::vector<LLChainTimeout>,
+		std::greater<LLChainTimeout> > chain_timeouts_t;
+	chain_timeouts_t mChainTimeouts;
+
 	// structures necessary for doing callbacks
 	// since the callbacks only get one chance to run, we do not have
 	// to maintain a list.
@@ -412,9 +456,47 @@ protected:
 	/** 
 	 * @brief Given the internal state of the chains, rebuild the pollset
 	 * @see setConditional()
+	 *
+	 * This is only needed when the pollset runs out of room, since
+	 * conditionals are otherwise added and removed one at a time.
 	 */
 	void rebuildPollset();
 
+	/** 
+	 * @brief Register one conditional with the pollset.
+	 */
+	void addDescriptor(apr_pollfd_t& poll);
+
+	/** 
+	 * @brief Unregister one conditional from the pollset.
+	 */
+	void removeDescriptor(apr_pollfd_t& poll);
+
+	/** 
+	 * @brief Move pending chains into the running chains.
+	 */
+	void activatePendingChains();
+
+	/** 
+	 * @brief Push the chain's current expiration onto the timeout heap.
+	 */
+	void scheduleTimeout(LLChainInfo& chain);
+
+	/** 
+	 * @brief Update whether the chain is processed without a signal.
+	 */
+	void updateReadiness(LLChainInfo& chain);
+
+	/** 
+	 * @brief Handle every chain whose timeout has passed.
+	 */
+	void expireChains();
+
+	/** 
+	 * @brief Remove a finished chain and all of its bookkeeping.
+	 */
+	void retireChain(current_chain_t chain);
+
 	/** 
 	 * @brief Process the chain passed in.
 	 *
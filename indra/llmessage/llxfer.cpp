@@ -81,6 +81,8 @@ void LLXfer::init (S32 chunk_size)
 	mBufferStartOffset = 0;
 
 	mRetries = 0;
+	mWindowed = FALSE;
+	mOfferWindow = FALSE;
 
 	if (chunk_size < 1)
 	{
@@ -256,14 +258,22 @@ void LLXfer::sendPacket(S32 packet_num)
 		gMessageSystem->sendMessage(mRemoteHost);
 
 		ACKTimer.reset();
-		mWaitingForACK = TRUE;
+		if (mWindowed)
+		{
+			mSendWindow.packetSent(packet_num, LLTimer::getElapsedSeconds());
+		}
+		else
+		{
+			mWaitingForACK = TRUE;
+		}
 	}
 	if (last_packet)
 	{
 		mStatus = e_LL_XFER_COMPLETE;	
 	}
-	else
+	else if (mStatus != e_LL_XFER_COMPLETE)
 	{
+		// with a window open, earlier packets get resent after the last
 		mStatus = e_LL_XFER_IN_PROGRESS;
 	}
 }
@@ -315,6 +325,11 @@ S32 LLXfer::processEOF()
 
 S32 LLXfer::encodePacketNum(S32 packet_num, BOOL is_EOF)
 {
+	// the first packet offers a window, the rest say it is open
+	if (mWindowed || (mOfferWindow && !packet_num))
+	{
+		packet_num |= LL_XFER_WINDOW_FLAG;
+	}
 	if (is_EOF)
 	{
 		packet_num |= 0x80000000;
@@ -35,6 +35,7 @@
 
 #include "message.h"
 #include "lltimer.h"
+#include "llxferwindow.h"
 
 const S32 LL_XFER_LARGE_PAYLOAD = 7680;
 
@@ -78,6 +79,14 @@ class LLXfer
 	LLTimer ACKTimer;
 	S32 mRetries;
 
+	// Set once both ends have agreed to keep several packets in flight,
+	// see LL_XFER_WINDOW_FLAG.
+	BOOL mWindowed;
+	// Set on an outgoing xfer that offers the receiver a window.
+	BOOL mOfferWindow;
+	LLXferSendWindow mSendWindow;
+	LLXferReceiveWindow mReceiveWindow;
+
 	static const U32 XFER_FILE;
 	static const U32 XFER_VFILE;
 	static const U32 XFER_MEM;
@@ -83,6 +83,10 @@ void LLXferManager::init (LLVFS *vfs)
 	// Turn on or off ack throttling
 	mUseAckThrottling = FALSE;
 	setAckThrottleBPS(100000);
+
+	// Offer and accept windowed xfers, each one is negotiated with the
+	// other end so old peers never see the window flag in a confirmation
+	mUseWindowing = TRUE;
 }
 	
 ///////////////////////////////////////////////////////////
@@ -149,6 +153,11 @@ void LLXferManager::setAckThrottleBPS(const F32 bps)
 	mAckThrottle.setRate(actual_rate);
 }
 
+void LLXferManager::setUseWindowing(const BOOL use)
+{
+	mUseWindowing = use;
+}
+
 
 ///////////////////////////////////////////////////////////
 
@@ -157,42 +166,76 @@ void LLXferManager::updateHostStatus()
     LLXfer *xferp;
 	LLHostStatus *host_statusp = NULL;
 
-	for_each(mOutgoingHosts.begin(), mOutgoingHosts.end(), DeletePointer());
-	mOutgoingHosts.clear();
+	// The counts are redone from scratch, but a host we're still sending
+	// to keeps its window and round trip time.
+	status_list_t old_hosts;
+	old_hosts.swap(mOutgoingHosts);
 
 	for (xferp = mSendList; xferp; xferp = xferp->mNext)
 	{
+		host_statusp = NULL;
 		for (status_list_t::iterator iter = mOutgoingHosts.begin();
 			 iter != mOutgoingHosts.end(); ++iter)
 		{
-			host_statusp = *iter;
-			if (host_statusp->mHost == xferp->mRemoteHost)
+			if ((*iter)->mHost == xferp->mRemoteHost)
 			{
+				host_statusp = *iter;
 				break;
 			}
 		}
 		if (!host_statusp)
 		{
-			host_statusp = new LLHostStatus();
-			if (host_statusp)
+			for (status_list_t::iterator iter = old_hosts.begin();
+				 iter != old_hosts.end(); ++iter)
+			{
+				if ((*iter)->mHost == xferp->mRemoteHost)
+				{
+					host_statusp = *iter;
+					host_statusp->mNumActive = 0;
+					host_statusp->mNumPending = 0;
+					old_hosts.erase(iter);
+					break;
+				}
+			}
+			if (!host_statusp)
 			{
+				host_statusp = new LLHostStatus();
 				host_statusp->mHost = xferp->mRemoteHost;
-				mOutgoingHosts.push_front(host_statusp);
 			}
+			mOutgoingHosts.push_front(host_statusp);
 		}
-		if (host_statusp)
+
+		if (xferp->mStatus == e_LL_XFER_PENDING)
 		{
-			if (xferp->mStatus == e_LL_XFER_PENDING)
-			{
-				host_statusp->mNumPending++;
-			}
-			else if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
-			{
-				host_statusp->mNumActive++;
-			}
+			host_statusp->mNumPending++;
+		}
+		else if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
+		{
+			host_statusp->mNumActive++;
 		}
-		
 	}	
+
+	for_each(old_hosts.begin(), old_hosts.end(), DeletePointer());
+}
+
+///////////////////////////////////////////////////////////
+
+LLHostStatus* LLXferManager::getHostStatus(const LLHost& host)
+{
+	for (status_list_t::iterator iter = mOutgoingHosts.begin();
+		 iter != mOutgoingHosts.end(); ++iter)
+	{
+		if ((*iter)->mHost == host)
+		{
+			return *iter;
+		}
+	}
+
+	// not seen since the last updateHostStatus()
+	LLHostStatus* host_statusp = new LLHostStatus();
+	host_statusp->mHost = host;
+	mOutgoingHosts.push_front(host_statusp);
+	return host_statusp;
 }
 
 ///////////////////////////////////////////////////////////
@@ -628,14 +671,31 @@ void LLXferManager::processReceiveData (LLMessageSystem *mesgsys, void ** /*user
 		return;
 	}
 
-	S32 xfer_size;
+	S32 packet_num = decodePacketNum(packetnum);
+	if (mUseWindowing && (packetnum & LL_XFER_WINDOW_FLAG))
+	{
+		// the sender has offered a window, or already has one open
+		xferp->mWindowed = TRUE;
+	}
+	// once offered, every confirmation tells the sender we accept
+	S32 confirm_num = xferp->mWindowed ? (packet_num | LL_XFER_WINDOW_FLAG) : packet_num;
 
-	if (decodePacketNum(packetnum) != xferp->mPacketNum) // is the packet different from what we were expecting?
+	if (packet_num != xferp->mPacketNum) // is the packet different from what we were expecting?
 	{
+		if (xferp->mWindowed && packet_num < xferp->mPacketNum)
+		{
+			// a resend whose confirmation got dropped
+			confirmPacket(mesgsys, id, confirm_num, mesgsys->getSender());
+		}
+		else if (xferp->mWindowed && xferp->mReceiveWindow.add(xferp->mPacketNum, packet_num, isLastPacket(packetnum), fdata_buf, fdata_size))
+		{
+			// early, hold on to it until the packets before it are in
+			confirmPacket(mesgsys, id, confirm_num, mesgsys->getSender());
+		}
 		// confirm it if it was a resend of the last one, since the confirmation might have gotten dropped
-		if (decodePacketNum(packetnum) == (xferp->mPacketNum - 1))
+		else if (packet_num == (xferp->mPacketNum - 1))
 		{
-			llinfos << "Reconfirming xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet " << packetnum << llendl; 			sendConfirmPacket(mesgsys, id, decodePacketNum(packetnum), mesgsys->getSender());
+			llinfos << "Reconfirming xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet " << packetnum << llendl; 			sendConfirmPacket(mesgsys, id, confirm_num, mesgsys->getSender());
 		}
 		else
 		{
@@ -644,54 +704,85 @@ void LLXferManager::processReceiveData (LLMessageSystem *mesgsys, void ** /*user
 		return;		
 	}
 
+	S32 result = receivePacket(xferp, fdata_buf, fdata_size);
+	if (result != LL_ERR_CANNOT_OPEN_FILE)
+	{
+		confirmPacket(mesgsys, id, confirm_num, mesgsys->getSender());
+	}
+
+	// packets that arrived early can go in now
+	BOOL is_last = isLastPacket(packetnum);
+	std::vector<char> early_data;
+	while (result != LL_ERR_CANNOT_OPEN_FILE
+		   && !is_last
+		   && xferp->mReceiveWindow.takeNext(xferp->mPacketNum, early_data, is_last))
+	{
+		result = receivePacket(xferp, early_data.empty() ? NULL : &early_data[0], (S32)early_data.size());
+	}
+	
+	if (result == LL_ERR_CANNOT_OPEN_FILE)
+	{
+			xferp->abort(LL_ERR_CANNOT_OPEN_FILE);
+			removeXfer(xferp,&mReceiveList);
+			startPendingDownloads();
+			return;		
+	}
+
+	if (is_last)
+	{
+		xferp->processEOF();
+		removeXfer(xferp,&mReceiveList);
+		startPendingDownloads();
+	}
+}
+
+///////////////////////////////////////////////////////////
+
+S32 LLXferManager::receivePacket(LLXfer* xferp, char* datap, S32 data_size)
+{
 	S32 result = 0;
 
 	if (xferp->mPacketNum == 0) // first packet has size encoded as additional S32 at beginning of data
 	{
-		ntohmemcpy(&xfer_size,fdata_buf,MVT_S32,sizeof(S32));
+		S32 xfer_size;
+		ntohmemcpy(&xfer_size,datap,MVT_S32,sizeof(S32));
 		
 // do any necessary things on first packet ie. allocate memory
 		xferp->setXferSize(xfer_size);
 
 		// adjust buffer start and size
-		result = xferp->receiveData(&(fdata_buf[sizeof(S32)]),fdata_size-(sizeof(S32)));
+		result = xferp->receiveData(&(datap[sizeof(S32)]),data_size-(sizeof(S32)));
 	}
 	else
 	{
-		result = xferp->receiveData(fdata_buf,fdata_size);
+		result = xferp->receiveData(datap,data_size);
 	}
-	
-	if (result == LL_ERR_CANNOT_OPEN_FILE)
+
+	if (result != LL_ERR_CANNOT_OPEN_FILE)
 	{
-			xferp->abort(LL_ERR_CANNOT_OPEN_FILE);
-			removeXfer(xferp,&mReceiveList);
-			startPendingDownloads();
-			return;		
+		xferp->mPacketNum++;  // expect next packet
 	}
+	return result;
+}
 
-	xferp->mPacketNum++;  // expect next packet
+///////////////////////////////////////////////////////////
 
+void LLXferManager::confirmPacket(LLMessageSystem* mesgsys, U64 id, S32 packetnum, const LLHost& remote_host)
+{
 	if (!mUseAckThrottling)
 	{
 		// No throttling, confirm right away
-		sendConfirmPacket(mesgsys, id, decodePacketNum(packetnum), mesgsys->getSender());
+		sendConfirmPacket(mesgsys, id, packetnum, remote_host);
 	}
 	else
 	{
 		// Throttling, put on queue to be confirmed later.
 		LLXferAckInfo ack_info;
 		ack_info.mID = id;
-		ack_info.mPacketNum = decodePacketNum(packetnum);
-		ack_info.mRemoteHost = mesgsys->getSender();
+		ack_info.mPacketNum = packetnum;
+		ack_info.mRemoteHost = remote_host;
 		mXferAckQueue.push(ack_info);
 	}
-
-	if (isLastPacket(packetnum))
-	{
-		xferp->processEOF();
-		removeXfer(xferp,&mReceiveList);
-		startPendingDownloads();
-	}
 }
 
 ///////////////////////////////////////////////////////////
@@ -927,6 +1018,12 @@ void LLXferManager::processFileRequest (LLMessageSystem *mesgsys, void ** /*user
 		}
 	}
 
+	if (!result && xferp)
+	{
+		// the first packet offers a window, see LL_XFER_WINDOW_FLAG
+		xferp->mOfferWindow = mUseWindowing;
+	}
+
 	if (result)
 	{
 		if (xferp)
@@ -978,13 +1075,44 @@ void LLXferManager::processConfirmation (LLMessageSystem *mesgsys, void ** /*use
 	mesgsys->getS32Fast(_PREHASH_XferID, _PREHASH_Packet, packetNum);
 
 	LLXfer* xferp = findXfer(id, mSendList);
-	if (xferp)
+	if (xferp && xferp->mWindowed)
+	{
+		LLXferSendWindow::packet_list_t resend;
+		xferp->mSendWindow.packetAcked(decodePacketNum(packetNum), LLTimer::getElapsedSeconds(),
+									   getHostStatus(xferp->mRemoteHost)->mWindow, resend);
+		for (LLXferSendWindow::packet_list_t::iterator iter = resend.begin();
+			 iter != resend.end() && xferp->mStatus != e_LL_XFER_ABORTED; ++iter)
+		{
+			xferp->sendPacket(*iter);
+		}
+
+		if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
+		{
+			sendWindow(xferp);
+		}
+		else if (xferp->mStatus == e_LL_XFER_COMPLETE && !xferp->mSendWindow.getNumInFlight())
+		{
+			removeXfer(xferp, &mSendList);
+		}
+	}
+	else if (xferp)
 	{
 //		cout << "confirmed packet #" << packetNum << " ping: "<< xferp->ACKTimer.getElapsedTimeF32() <<  endl;
 		xferp->mWaitingForACK = FALSE;
 		if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
 		{
-			xferp->sendNextPacket();
+			if (xferp->mOfferWindow
+				&& (packetNum & LL_XFER_WINDOW_FLAG)
+				&& decodePacketNum(packetNum) == xferp->mPacketNum)
+			{
+				// the receiver took up the offer and can take packets out of order
+				xferp->mWindowed = TRUE;
+				sendWindow(xferp);
+			}
+			else
+			{
+				xferp->sendNextPacket();
+			}
 		}
 		else
 		{
@@ -995,6 +1123,23 @@ void LLXferManager::processConfirmation (LLMessageSystem *mesgsys, void ** /*use
 
 ///////////////////////////////////////////////////////////
 
+void LLXferManager::sendWindow(LLXfer* xferp)
+{
+	LLHostStatus* host_statusp = getHostStatus(xferp->mRemoteHost);
+
+	// the host's window is shared between the xfers running to it
+	S32 limit = host_statusp->mWindow.getSize() / llmax(host_statusp->mNumActive, 1);
+	limit = llclamp(limit, 1, LL_XFER_MAX_WINDOW);
+
+	while (xferp->mStatus == e_LL_XFER_IN_PROGRESS
+		   && xferp->mSendWindow.canSend(xferp->mPacketNum + 1, limit))
+	{
+		xferp->sendNextPacket();
+	}
+}
+
+///////////////////////////////////////////////////////////
+
 void LLXferManager::retransmitUnackedPackets ()
 {
 	LLXfer *xferp;
@@ -1023,9 +1168,34 @@ void LLXferManager::retransmitUnackedPackets ()
 	xferp = mSendList; 
 	updateHostStatus();
 	F32 et;
+	F64 now = LLTimer::getElapsedSeconds();
 	while (xferp)
 	{
-		if (xferp->mWaitingForACK && ( (et = xferp->ACKTimer.getElapsedTimeF32()) > LL_PACKET_TIMEOUT))
+		if (xferp->mWindowed
+			&& (xferp->mStatus == e_LL_XFER_IN_PROGRESS || xferp->mStatus == e_LL_XFER_COMPLETE))
+		{
+			LLXferSendWindow::packet_list_t resend;
+			if (!xferp->mSendWindow.checkTimeouts(now, getHostStatus(xferp->mRemoteHost)->mWindow,
+												  LL_PACKET_RETRY_LIMIT, resend))
+			{
+				llinfos << "dropping xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet retransmit limit exceeded, xfer dropped" << llendl;
+				xferp->abort(LL_ERR_TCP_TIMEOUT);
+				delp = xferp;
+				xferp = xferp->mNext;
+				removeXfer(delp,&mSendList);
+			}
+			else
+			{
+				for (LLXferSendWindow::packet_list_t::iterator iter = resend.begin();
+					 iter != resend.end() && xferp->mStatus != e_LL_XFER_ABORTED; ++iter)
+				{
+					lldebugs << "resending xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet " << *iter << llendl;
+					xferp->sendPacket(*iter);
+				}
+				xferp = xferp->mNext;
+			}
+		}
+		else if (xferp->mWaitingForACK && ( (et = xferp->ACKTimer.getElapsedTimeF32()) > LL_PACKET_TIMEOUT))
 		{
 			if (xferp->mRetries > LL_PACKET_RETRY_LIMIT)
 			{
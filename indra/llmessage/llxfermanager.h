@@ -56,6 +56,7 @@ class LLHostStatus
 	LLHost mHost;
 	S32    mNumActive;
 	S32    mNumPending;
+	LLXferWindow mWindow;	// shared by the windowed xfers to mHost
 
 	LLHostStatus() {mNumActive = 0; mNumPending = 0;};
 	virtual ~LLHostStatus(){};
@@ -86,6 +87,7 @@ class LLXferManager
 	S32    mMaxIncomingXfers;
 
 	BOOL	mUseAckThrottling; // Use ack throttling to cap file xfer bandwidth
+	BOOL	mUseWindowing; // Offer and accept windowed xfers, see LL_XFER_WINDOW_FLAG
 	LLLinkedQueue<LLXferAckInfo> mXferAckQueue;
 	LLThrottle mAckThrottle;
  public:
@@ -109,6 +111,14 @@ class LLXferManager
 	// implementation methods
 	virtual void startPendingDownloads();
 	virtual void addToList(LLXfer* xferp, LLXfer*& head, BOOL is_priority);
+	LLHostStatus* getHostStatus(const LLHost& host);
+	// Sends packets of a windowed xfer until its share of the host's
+	// window is in flight.
+	void sendWindow(LLXfer* xferp);
+	// Hands a packet to an incoming xfer in order.
+	S32 receivePacket(LLXfer* xferp, char* datap, S32 data_size);
+	// Acks now, or queues the ack when throttling.
+	void confirmPacket(LLMessageSystem* mesgsys, U64 id, S32 packetnum, const LLHost& remote_host);
 	std::multiset<std::string> mExpectedTransfers; // files that are authorized to transfer out
 	std::multiset<std::string> mExpectedRequests;  // files that are authorized to be downloaded on top of
 
@@ -121,6 +131,7 @@ class LLXferManager
 
 	void setUseAckThrottling(const BOOL use);
 	void setAckThrottleBPS(const F32 bps);
+	void setUseWindowing(const BOOL use);
 
 // list management routines
 	virtual LLXfer *findXfer(U64 id, LLXfer *list_head);
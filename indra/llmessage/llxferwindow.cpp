@@ -0,0 +1,225 @@
+/**
+ * @file llxferwindow.cpp
+ * @brief Bookkeeping for xfers with several packets in flight
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llxferwindow.h"
+
+#include "llmath.h"
+
+const S32 LL_XFER_INITIAL_WINDOW = 2;
+const F32 LL_XFER_MIN_TIMEOUT = 0.25f;		// keeps jitter from looking like loss
+const F32 LL_XFER_MAX_TIMEOUT = 3.0f;		// the stop-and-wait packet timeout
+const S32 LL_XFER_LOSS_THRESHOLD = 3;		// later acks before a packet counts as lost
+
+///////////////////////////////////////////////////////////
+
+LLXferWindow::LLXferWindow()
+:	mSize((F32)LL_XFER_INITIAL_WINDOW),
+	mThreshold((F32)LL_XFER_MAX_WINDOW),
+	mRTT(0.f),
+	mRTTVariance(0.f),
+	mHasRTT(FALSE),
+	mLastLossTime(-1000.0)
+{
+}
+
+F32 LLXferWindow::getTimeout() const
+{
+	if (!mHasRTT)
+	{
+		return LL_XFER_MAX_TIMEOUT;
+	}
+	return llclamp(mRTT + 4.f * mRTTVariance, LL_XFER_MIN_TIMEOUT, LL_XFER_MAX_TIMEOUT);
+}
+
+void LLXferWindow::onAck(F32 rtt)
+{
+	if (rtt >= 0.f)
+	{
+		if (!mHasRTT)
+		{
+			mRTT = rtt;
+			mRTTVariance = rtt * 0.5f;
+			mHasRTT = TRUE;
+		}
+		else
+		{
+			mRTTVariance = 0.75f * mRTTVariance + 0.25f * fabsf(mRTT - rtt);
+			mRTT = 0.875f * mRTT + 0.125f * rtt;
+		}
+	}
+
+	if (mSize < mThreshold)
+	{
+		mSize += 1.f;
+	}
+	else
+	{
+		mSize += 1.f / mSize;
+	}
+	mSize = llmin(mSize, (F32)LL_XFER_MAX_WINDOW);
+}
+
+void LLXferWindow::onLoss(F64 now)
+{
+	if (now - mLastLossTime < (mHasRTT ? mRTT : LL_XFER_MAX_TIMEOUT))
+	{
+		return;
+	}
+	mLastLossTime = now;
+	mThreshold = llmax(mSize * 0.5f, (F32)LL_XFER_INITIAL_WINDOW);
+	mSize = mThreshold;
+}
+
+///////////////////////////////////////////////////////////
+
+void LLXferSendWindow::packetSent(S32 packet_num, F64 now)
+{
+	packet_map_t::iterator iter = mInFlight.find(packet_num);
+	if (iter == mInFlight.end())
+	{
+		Packet& packet = mInFlight[packet_num];
+		packet.mSendTime = now;
+		packet.mRetries = 0;
+		packet.mPassedOver = 0;
+	}
+	else
+	{
+		iter->second.mSendTime = now;
+		iter->second.mRetries++;
+		iter->second.mPassedOver = 0;
+	}
+}
+
+BOOL LLXferSendWindow::packetAcked(S32 packet_num, F64 now, LLXferWindow& window, packet_list_t& resend)
+{
+	packet_map_t::iterator acked = mInFlight.find(packet_num);
+	if (acked == mInFlight.end())
+	{
+		// a duplicate, or an ack for a packet sent before the window opened
+		return FALSE;
+	}
+
+	F64 send_time = acked->second.mSendTime;
+	window.onAck(acked->second.mRetries ? -1.f : (F32)(now - send_time));
+
+	// Only packets that went out before this one can have been passed
+	// over by it; resends of older packets may still be on their way.
+	BOOL lost = FALSE;
+	for (packet_map_t::iterator iter = mInFlight.begin(); iter != acked; ++iter)
+	{
+		Packet& packet = iter->second;
+		if (packet.mSendTime <= send_time
+			&& ++packet.mPassedOver == LL_XFER_LOSS_THRESHOLD)
+		{
+			resend.push_back(iter->first);
+			lost = TRUE;
+		}
+	}
+	mInFlight.erase(acked);
+
+	if (lost)
+	{
+		window.onLoss(now);
+	}
+	return TRUE;
+}
+
+BOOL LLXferSendWindow::checkTimeouts(F64 now, LLXferWindow& window, S32 max_retries, packet_list_t& resend)
+{
+	F32 timeout = window.getTimeout();
+	BOOL lost = FALSE;
+	for (packet_map_t::iterator iter = mInFlight.begin(); iter != mInFlight.end(); ++iter)
+	{
+		const Packet& packet = iter->second;
+		// back off on packets that keep getting lost
+		F32 packet_timeout = llmin(timeout * (F32)(1 << llmin(packet.mRetries, 4)), LL_XFER_MAX_TIMEOUT);
+		if (now - packet.mSendTime > packet_timeout)
+		{
+			if (packet.mRetries >= max_retries)
+			{
+				return FALSE;
+			}
+			resend.push_back(iter->first);
+			lost = TRUE;
+		}
+	}
+
+	if (lost)
+	{
+		window.onLoss(now);
+	}
+	return TRUE;
+}
+
+BOOL LLXferSendWindow::canSend(S32 packet_num, S32 limit) const
+{
+	if (mInFlight.empty())
+	{
+		return TRUE;
+	}
+	return (S32)mInFlight.size() < limit
+		&& packet_num < mInFlight.begin()->first + LL_XFER_MAX_WINDOW;
+}
+
+///////////////////////////////////////////////////////////
+
+BOOL LLXferReceiveWindow::add(S32 next, S32 packet_num, BOOL is_last, const char* datap, S32 size)
+{
+	if (packet_num <= next || packet_num >= next + LL_XFER_MAX_WINDOW)
+	{
+		return FALSE;
+	}
+
+	// keep the first copy of a packet that arrives twice
+	if (mBuffered.find(packet_num) == mBuffered.end())
+	{
+		Packet& packet = mBuffered[packet_num];
+		packet.mData.assign(datap, datap + size);
+		packet.mIsLast = is_last;
+	}
+	return TRUE;
+}
+
+BOOL LLXferReceiveWindow::takeNext(S32 next, std::vector<char>& data, BOOL& is_last)
+{
+	packet_map_t::iterator iter = mBuffered.find(next);
+	if (iter == mBuffered.end())
+	{
+		return FALSE;
+	}
+	data.swap(iter->second.mData);
+	is_last = iter->second.mIsLast;
+	mBuffered.erase(iter);
+	return TRUE;
+}
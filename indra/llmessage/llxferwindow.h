@@ -0,0 +1,142 @@
+/**
+ * @file llxferwindow.h
+ * @brief Bookkeeping for xfers with several packets in flight
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLXFERWINDOW_H
+#define LL_LLXFERWINDOW_H
+
+#include <map>
+#include <vector>
+
+/**
+ * Windowed xfers are negotiated through a bit in the packet numbers that
+ * decodePacketNum() already masks off. A sender that can keep several
+ * packets in flight sets it on the first SendXferPacket of an xfer. A
+ * receiver that can take packets out of order echoes it in every
+ * ConfirmXferPacket for that xfer from then on, and a sender that gets the
+ * echo stops waiting for each ack in turn and sets the bit on all its
+ * packets. The bit only ever goes into a confirmation when the sender put
+ * it there first, so senders that don't know about it (OpenSim's choke on
+ * it in a confirmation) never see it, and receivers that don't know about
+ * it mask it off and get one packet at a time as before.
+ */
+const S32 LL_XFER_WINDOW_FLAG = 0x40000000;
+
+// Most packets a sender has in flight for one xfer, and how far ahead of
+// the next packet it expects a receiver will buffer.
+const S32 LL_XFER_MAX_WINDOW = 32;
+
+// Window size and round trip time estimate for the xfers to one host.
+// The window starts small, doubles every round trip until the first loss
+// and then grows by a packet per round trip, halving on each loss.
+class LLXferWindow
+{
+public:
+	LLXferWindow();
+
+	// Packets allowed in flight to the host.
+	S32 getSize() const				{ return (S32)mSize; }
+	// Seconds to wait for an ack before resending a packet.
+	F32 getTimeout() const;
+
+	// rtt is negative for packets that had been resent, since there's no
+	// telling which of the sends was acked.
+	void onAck(F32 rtt);
+	// Losses within a round trip of the last one are taken as the same
+	// congestion and don't shrink the window again.
+	void onLoss(F64 now);
+
+private:
+	F32 mSize;
+	F32 mThreshold;
+	F32 mRTT;
+	F32 mRTTVariance;
+	BOOL mHasRTT;
+	F64 mLastLossTime;
+};
+
+// Packets of one outgoing xfer that have been sent but not acked.
+class LLXferSendWindow
+{
+public:
+	typedef std::vector<S32> packet_list_t;
+
+	// Sending a packet that is still in flight counts as a resend.
+	void packetSent(S32 packet_num, F64 now);
+	// Returns FALSE if packet_num wasn't in flight. Packets sent before
+	// it that have now been passed over by several later acks are taken
+	// as lost and added to resend.
+	BOOL packetAcked(S32 packet_num, F64 now, LLXferWindow& window, packet_list_t& resend);
+	// Adds the packets whose acks are overdue to resend. Returns FALSE if
+	// one of them has already been resent max_retries times.
+	BOOL checkTimeouts(F64 now, LLXferWindow& window, S32 max_retries, packet_list_t& resend);
+
+	// TRUE if packet_num can go out with at most limit packets in flight.
+	// Packets are never sent further ahead of the oldest one in flight
+	// than a receiver will buffer.
+	BOOL canSend(S32 packet_num, S32 limit) const;
+	S32 getNumInFlight() const		{ return (S32)mInFlight.size(); }
+
+private:
+	struct Packet
+	{
+		F64 mSendTime;
+		S32 mRetries;
+		S32 mPassedOver;
+	};
+	typedef std::map<S32, Packet> packet_map_t;
+	packet_map_t mInFlight;
+};
+
+// Packets of one incoming xfer that arrived ahead of their turn.
+class LLXferReceiveWindow
+{
+public:
+	// Keeps a copy of a packet later than next, the one the xfer expects.
+	// Returns FALSE if it is too far ahead to buffer, in which case it
+	// mustn't be acked.
+	BOOL add(S32 next, S32 packet_num, BOOL is_last, const char* datap, S32 size);
+	// Moves packet next out of the buffer, if it has arrived.
+	BOOL takeNext(S32 next, std::vector<char>& data, BOOL& is_last);
+
+	S32 getNumBuffered() const		{ return (S32)mBuffered.size(); }
+
+private:
+	struct Packet
+	{
+		std::vector<char> mData;
+		BOOL mIsLast;
+	};
+	typedef std::map<S32, Packet> packet_map_t;
+	packet_map_t mBuffered;
+};
+
+#endif
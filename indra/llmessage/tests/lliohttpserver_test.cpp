@@ -0,0 +1,386 @@
+/**
+ * @file lliohttpserver_test.cpp
+ * @brief Persistent connection, pipelining and chunked response tests
+ * and a loopback benchmark for LLIOHTTPServer.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lliohttpserver.h"
+#include "../test/lltut.h"
+
+#include "llbufferstream.h"
+#include "llhost.h"
+#include "lliosocket.h"
+#include "llpumpio.h"
+#include "llsd.h"
+#include "lltimer.h"
+
+#include <sstream>
+
+namespace tut
+{
+	static const U16 HTTP_TEST_PORT = 13060;
+
+	class EchoNode : public LLHTTPNode
+	{
+	public:
+		virtual LLSD post(const LLSD& input) const
+		{
+			return input;
+		}
+	};
+
+	// Streams three pieces, one per call, marking the response as
+	// streaming until the last one.
+	class StreamPipe : public LLIOPipe
+	{
+	public:
+		StreamPipe() : mCount(0) {}
+
+	protected:
+		virtual EStatus process_impl(
+			const LLChannelDescriptors& channels,
+			buffer_ptr_t& buffer,
+			bool& eos,
+			LLSD& context,
+			LLPumpIO* pump)
+		{
+			std::ostringstream ostr;
+			ostr << "piece" << mCount << ";";
+			std::string piece = ostr.str();
+			buffer->append(channels.out(), (U8*)piece.c_str(), piece.size());
+			bool last = (++mCount == 3);
+			context[CONTEXT_RESPONSE][CONTEXT_STREAMING] = !last;
+			return last ? STATUS_DONE : STATUS_OK;
+		}
+
+		S32 mCount;
+	};
+
+	struct HTTPKeepAliveData
+	{
+		HTTPKeepAliveData()
+		{
+			LLFrameTimer::updateFrameTime();
+			apr_pool_create(&mPool, NULL);
+			mPump = new LLPumpIO(mPool);
+			LLHTTPNode& root = LLIOHTTPServer::create(mPool, *mPump, HTTP_TEST_PORT);
+			root.addNode("echo", new EchoNode);
+			root.addNode("stream", new LLHTTPNodeForPipe<StreamPipe>);
+			pump(0.1f);
+		}
+
+		~HTTPKeepAliveData()
+		{
+			delete mPump;
+			apr_pool_destroy(mPool);
+		}
+
+		void pump(F32 seconds)
+		{
+			LLTimer timer;
+			timer.setTimerExpirySec(seconds);
+			while(!timer.hasExpired())
+			{
+				LLFrameTimer::updateFrameTime();
+				mPump->pump(1000);
+				mPump->callback();
+			}
+		}
+
+		LLSocket::ptr_t connect()
+		{
+			LLSocket::ptr_t client = LLSocket::create(mPool, LLSocket::STREAM_TCP);
+			LLHost server_host("127.0.0.1", HTTP_TEST_PORT);
+			ensure("connected to server", client->blockingConnect(server_host));
+			return client;
+		}
+
+		void send(LLSocket::ptr_t client, const std::string& data)
+		{
+			const char* start = data.c_str();
+			apr_size_t left = data.size();
+			while(left)
+			{
+				apr_size_t len = left;
+				apr_status_t status = apr_socket_send(client->getSocket(), start, &len);
+				if(!APR_STATUS_IS_EAGAIN(status))
+				{
+					ensure("send", APR_SUCCESS == status);
+				}
+				start += len;
+				left -= len;
+				LLFrameTimer::updateFrameTime();
+				mPump->pump(0);
+				mPump->callback();
+			}
+		}
+
+		std::string post(S32 sequence, const std::string& version,
+			const std::string& extra_headers = "")
+		{
+			std::ostringstream body;
+			body << "<llsd><integer>" << sequence << "</integer></llsd>";
+			std::ostringstream request;
+			request << "POST /echo " << version << "\r\n"
+				<< "Content-Length: " << body.str().size() << "\r\n"
+				<< extra_headers
+				<< "\r\n"
+				<< body.str();
+			return request.str();
+		}
+
+		// Pumps the server until count complete responses have been
+		// read or the connection closes. Returns the response bodies.
+		std::vector<std::string> receive(LLSocket::ptr_t client, S32 count,
+			bool* closed = NULL, std::string* headers = NULL)
+		{
+			std::vector<std::string> bodies;
+			std::string data;
+			LLTimer timer;
+			timer.setTimerExpirySec(10.f);
+			if(closed) *closed = false;
+			while((S32)bodies.size() < count && !timer.hasExpired())
+			{
+				LLFrameTimer::updateFrameTime();
+				mPump->pump(1000);
+				mPump->callback();
+
+				char buf[4096];		/* Flawfinder: ignore */
+				apr_size_t len = sizeof(buf);
+				apr_status_t status = apr_socket_recv(client->getSocket(), buf, &len);
+				data.append(buf, len);
+				if(APR_STATUS_IS_EOF(status))
+				{
+					if(closed) *closed = true;
+				}
+
+				// peel off every complete response
+				while(true)
+				{
+					std::string::size_type end_headers = data.find("\r\n\r\n");
+					if(end_headers == std::string::npos) break;
+					std::string head = data.substr(0, end_headers + 2);
+					std::string::size_type body_start = end_headers + 4;
+					std::string body;
+					std::string::size_type length_pos = head.find("Content-Length: ");
+					if(length_pos != std::string::npos)
+					{
+						S32 length = atoi(head.c_str() + length_pos + 16);
+						if(data.size() < body_start + length) break;
+						body = data.substr(body_start, length);
+						data.erase(0, body_start + length);
+					}
+					else if(head.find("Transfer-Encoding: chunked") != std::string::npos)
+					{
+						std::string::size_type pos = body_start;
+						bool complete = false;
+						while(true)
+						{
+							std::string::size_type line_end = data.find("\r\n", pos);
+							if(line_end == std::string::npos) break;
+							S32 length = strtol(data.c_str() + pos, NULL, 16);
+							if(data.size() < line_end + 2 + length + 2) break;
+							if(0 == length)
+							{
+								pos = line_end + 4;
+								complete = true;
+								break;
+							}
+							body += data.substr(line_end + 2, length);
+							pos = line_end + 2 + length + 2;
+						}
+						if(!complete) break;
+						data.erase(0, pos);
+					}
+					else
+					{
+						// close delimited
+						if(!closed || !*closed) break;
+						body = data.substr(body_start);
+						data.clear();
+					}
+					if(headers) *headers += head;
+					bodies.push_back(body);
+				}
+				if(closed && *closed) break;
+			}
+			return bodies;
+		}
+
+		apr_pool_t* mPool;
+		LLPumpIO* mPump;
+	};
+
+	typedef test_group<HTTPKeepAliveData> HTTPKeepAliveTestGroup;
+	typedef HTTPKeepAliveTestGroup::object HTTPKeepAliveTestObject;
+	HTTPKeepAliveTestGroup httpKeepAliveTestGroup("http keep-alive");
+
+	template<> template<>
+	void HTTPKeepAliveTestObject::test<1>()
+	{
+		// sequential requests on one HTTP/1.1 connection
+		LLSocket::ptr_t client = connect();
+		for(S32 ii = 0; ii < 3; ++ii)
+		{
+			send(client, post(ii, "HTTP/1.1"));
+			bool closed = false;
+			std::string headers;
+			std::vector<std::string> bodies = receive(client, 1, &closed, &headers);
+			ensure_equals("one response", bodies.size(), 1U);
+			ensure("HTTP/1.1 status", headers.find("HTTP/1.1 200 OK\r\n") == 0);
+			ensure("no close", headers.find("Connection: close") == std::string::npos);
+			ensure("still open", !closed);
+			std::ostringstream expected;
+			expected << "<integer>" << ii << "</integer>";
+			ensure("echoed", bodies[0].find(expected.str()) != std::string::npos);
+		}
+	}
+
+	template<> template<>
+	void HTTPKeepAliveTestObject::test<2>()
+	{
+		// pipelined requests come back in order
+		const S32 REQUEST_COUNT = 50;
+		LLSocket::ptr_t client = connect();
+		std::string requests;
+		for(S32 ii = 0; ii < REQUEST_COUNT; ++ii)
+		{
+			requests += post(ii, "HTTP/1.1");
+		}
+		send(client, requests);
+		std::vector<std::string> bodies = receive(client, REQUEST_COUNT);
+		ensure_equals("all responses", (S32)bodies.size(), REQUEST_COUNT);
+		for(S32 ii = 0; ii < REQUEST_COUNT; ++ii)
+		{
+			std::ostringstream expected;
+			expected << "<integer>" << ii << "</integer>";
+			ensure("in order", bodies[ii].find(expected.str()) != std::string::npos);
+		}
+	}
+
+	template<> template<>
+	void HTTPKeepAliveTestObject::test<3>()
+	{
+		// the client can still ask for the connection to be closed,
+		// and HTTP/1.0 clients can ask for it to be kept.
+		LLSocket::ptr_t client = connect();
+		send(client, post(1, "HTTP/1.1", "Connection: close\r\n"));
+		bool closed = false;
+		std::string headers;
+		std::vector<std::string> bodies = receive(client, 2, &closed, &headers);
+		ensure_equals("one response", bodies.size(), 1U);
+		ensure("close header", headers.find("Connection: close\r\n") != std::string::npos);
+		ensure("closed", closed);
+
+		client = connect();
+		send(client, post(2, "HTTP/1.0", "Connection: keep-alive\r\n"));
+		headers.clear();
+		bodies = receive(client, 1, &closed, &headers);
+		ensure_equals("1.0 response", bodies.size(), 1U);
+		ensure("1.0 status", headers.find("HTTP/1.0 200 OK\r\n") == 0);
+		ensure("keep-alive header", headers.find("Connection: keep-alive\r\n") != std::string::npos);
+		send(client, post(3, "HTTP/1.0", "Connection: keep-alive\r\n"));
+		bodies = receive(client, 1, &closed);
+		ensure_equals("second 1.0 response", bodies.size(), 1U);
+		ensure("second echoed", bodies[0].find("<integer>3</integer>") != std::string::npos);
+	}
+
+	template<> template<>
+	void HTTPKeepAliveTestObject::test<4>()
+	{
+		// a streamed response is chunked, and the connection is
+		// usable afterwards.
+		LLSocket::ptr_t client = connect();
+		send(client, "GET /stream HTTP/1.1\r\n\r\n");
+		std::string headers;
+		std::vector<std::string> bodies = receive(client, 1, NULL, &headers);
+		ensure_equals("stream response", bodies.size(), 1U);
+		ensure("chunked", headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+		ensure_equals("stream body", bodies[0], std::string("piece0;piece1;piece2;"));
+
+		send(client, post(4, "HTTP/1.1"));
+		bodies = receive(client, 1);
+		ensure_equals("after stream", bodies.size(), 1U);
+
+		// HTTP/1.0 gets the whole body with a length instead
+		client = connect();
+		send(client, "GET /stream HTTP/1.0\r\n\r\n");
+		headers.clear();
+		bool closed = false;
+		bodies = receive(client, 1, &closed, &headers);
+		ensure_equals("1.0 stream response", bodies.size(), 1U);
+		ensure("not chunked", headers.find("Transfer-Encoding") == std::string::npos);
+		ensure_equals("1.0 stream body", bodies[0], std::string("piece0;piece1;piece2;"));
+	}
+
+	template<> template<>
+	void HTTPKeepAliveTestObject::test<5>()
+	{
+		// Loopback benchmark: the same number of requests over one
+		// persistent connection and over a connection per request.
+		const S32 REQUEST_COUNT = 200;
+
+		LLTimer timer;
+		LLSocket::ptr_t client = connect();
+		for(S32 ii = 0; ii < REQUEST_COUNT; ++ii)
+		{
+			send(client, post(ii, "HTTP/1.1"));
+			ensure_equals("keep-alive response", receive(client, 1).size(), 1U);
+		}
+		F32 keep_alive_secs = timer.getElapsedTimeF32();
+
+		timer.reset();
+		for(S32 ii = 0; ii < REQUEST_COUNT; ++ii)
+		{
+			client = connect();
+			send(client, post(ii, "HTTP/1.0"));
+			bool closed = false;
+			ensure_equals("per connection response", receive(client, 1, &closed).size(), 1U);
+		}
+		F32 per_connection_secs = timer.getElapsedTimeF32();
+
+		timer.reset();
+		std::string requests;
+		for(S32 ii = 0; ii < REQUEST_COUNT; ++ii)
+		{
+			requests += post(ii, "HTTP/1.1");
+		}
+		client = connect();
+		send(client, requests);
+		ensure_equals("pipelined responses", (S32)receive(client, REQUEST_COUNT).size(), REQUEST_COUNT);
+		F32 pipelined_secs = timer.getElapsedTimeF32();
+
+		llinfos << REQUEST_COUNT << " LLSD echo requests: "
+			<< per_connection_secs << "s with a connection each, "
+			<< keep_alive_secs << "s keep-alive, "
+			<< pipelined_secs << "s pipelined" << llendl;
+	}
+}
@@ -41,6 +41,7 @@
 #include "llcontrol.h"
 #include "lldir.h"
 #include "v4color.h"
+#include "llxmlcache.h"
 
 // this library includes
 #include "llbutton.h"
@@ -130,7 +131,7 @@ void LLUICtrlFactory::setupPaths()
 	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_SKINS, "paths.xml");
 
 	LLXMLNodePtr root;
-	BOOL success  = LLXMLNode::parseFile(filename, root, NULL);
+	BOOL success  = LLXMLCache::parseFile(filename, root, NULL);
 	sXUIPaths.clear();
 	
 	if (success)
@@ -184,7 +185,7 @@ bool LLUICtrlFactory::getLayeredXMLNode(const std::string &xui_filename, LLXMLNo
 		}
 	}
 
-	if (!LLXMLNode::parseFile(full_filename, root, NULL))
+	if (!LLXMLCache::parseFile(full_filename, root, NULL))
 	{
 		llwarns << "Problem reading UI description file: " << full_filename << llendl;
 		return false;
@@ -206,7 +207,7 @@ bool LLUICtrlFactory::getLayeredXMLNode(const std::string &xui_filename, LLXMLNo
 			continue;
 		}
 
-		if (!LLXMLNode::parseFile(layer_filename, updateRoot, NULL))
+		if (!LLXMLCache::parseFile(layer_filename, updateRoot, NULL))
 		{
 			llwarns << "Problem reading localized UI description file: " << (*itor) + gDirUtilp->getDirDelimiter() + xui_filename << llendl;
 			return false;
@@ -48,6 +48,7 @@
 #include "v3color.h"
 #include "llrect.h"
 #include "llxmltree.h"
+#include "llxmlcache.h"
 #include "llsdserialize.h"
 
 #if LL_RELEASE_WITH_DEBUG_INFO || LL_DEBUG
@@ -309,6 +310,38 @@ LLPointer<LLControlVariable> LLControlGroup::getControl(const std::string& name)
 		return LLPointer<LLControlVariable>();
 }
 
+LLControlVariable* LLControlGroup::getControl(S32 handle_index)
+{
+	LLControlVariable* control = NULL;
+	if ((U32)handle_index < mHandleTable.size())
+	{
+		control = mHandleTable[handle_index];
+	}
+	return control ? control->getCOAActive() : NULL;
+}
+
+void LLControlGroup::bindHandles(const char* const* names, const eControlType* types, S32 count)
+{
+	mHandleTable.assign(count, (LLControlVariable*)NULL);
+	for (S32 i = 0; i < count; i++)
+	{
+		ctrl_name_table_t::iterator iter = mNameTable.find(names[i]);
+		if (iter == mNameTable.end())
+		{
+			llwarns << "No control " << names[i] << " to bind a handle to" << llendl;
+		}
+		else if (!iter->second->isType(types[i]))
+		{
+			llwarns << "Control " << names[i] << " isn't a " << typeEnumToString(types[i])
+					<< ", not binding a handle to it" << llendl;
+		}
+		else
+		{
+			mHandleTable[i] = iter->second;
+		}
+	}
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -335,6 +368,7 @@ LLControlGroup::~LLControlGroup()
 
 void LLControlGroup::cleanup()
 {
+	mHandleTable.clear();
 	mNameTable.clear();
 }
 
@@ -649,6 +683,81 @@ LLSD LLControlGroup::getLLSD(const std::string& name)
 	return LLSD();
 }
 
+// Handles are only bound to controls of their own type, so the getters
+// below don't check it again.
+
+BOOL LLControlGroup::getBOOL(LLControlHandle<TYPE_BOOLEAN> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return control->mValues.back().asBoolean();
+	CONTROL_ERRS << "Unbound BOOL control handle " << handle.mIndex << llendl;
+	return FALSE;
+}
+
+S32 LLControlGroup::getS32(LLControlHandle<TYPE_S32> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return control->mValues.back().asInteger();
+	CONTROL_ERRS << "Unbound S32 control handle " << handle.mIndex << llendl;
+	return 0;
+}
+
+F32 LLControlGroup::getF32(LLControlHandle<TYPE_F32> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return (F32) control->mValues.back().asReal();
+	CONTROL_ERRS << "Unbound F32 control handle " << handle.mIndex << llendl;
+	return 0.0f;
+}
+
+U32 LLControlGroup::getU32(LLControlHandle<TYPE_U32> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return control->mValues.back().asInteger();
+	CONTROL_ERRS << "Unbound U32 control handle " << handle.mIndex << llendl;
+	return 0;
+}
+
+std::string LLControlGroup::getString(LLControlHandle<TYPE_STRING> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return control->mValues.back().asString();
+	CONTROL_ERRS << "Unbound string control handle " << handle.mIndex << llendl;
+	return LLStringUtil::null;
+}
+
+LLVector3 LLControlGroup::getVector3(LLControlHandle<TYPE_VEC3> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return LLVector3(control->mValues.back());
+	CONTROL_ERRS << "Unbound LLVector3 control handle " << handle.mIndex << llendl;
+	return LLVector3::zero;
+}
+
+LLRect LLControlGroup::getRect(LLControlHandle<TYPE_RECT> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return LLRect(control->mValues.back());
+	CONTROL_ERRS << "Unbound rect control handle " << handle.mIndex << llendl;
+	return LLRect::null;
+}
+
+LLColor4 LLControlGroup::getColor4(LLControlHandle<TYPE_COL4> handle)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		return LLColor4(control->mValues.back());
+	CONTROL_ERRS << "Unbound LLColor4 control handle " << handle.mIndex << llendl;
+	return LLColor4::white;
+}
+
 BOOL LLControlGroup::controlExists(const std::string& name)
 {
 	ctrl_name_table_t::iterator iter = mNameTable.find(name);
@@ -837,6 +946,51 @@ void LLControlGroup::setValue(const std::string& name, const LLSD& val)
 	}
 }
 
+void LLControlGroup::setBOOL(LLControlHandle<TYPE_BOOLEAN> handle, BOOL val)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		control->set(val);
+	else
+		CONTROL_ERRS << "Unbound BOOL control handle " << handle.mIndex << llendl;
+}
+
+void LLControlGroup::setS32(LLControlHandle<TYPE_S32> handle, S32 val)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		control->set(val);
+	else
+		CONTROL_ERRS << "Unbound S32 control handle " << handle.mIndex << llendl;
+}
+
+void LLControlGroup::setF32(LLControlHandle<TYPE_F32> handle, F32 val)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		control->set(val);
+	else
+		CONTROL_ERRS << "Unbound F32 control handle " << handle.mIndex << llendl;
+}
+
+void LLControlGroup::setU32(LLControlHandle<TYPE_U32> handle, U32 val)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		control->set((LLSD::Integer) val);
+	else
+		CONTROL_ERRS << "Unbound U32 control handle " << handle.mIndex << llendl;
+}
+
+void LLControlGroup::setString(LLControlHandle<TYPE_STRING> handle, const std::string& val)
+{
+	LLControlVariable* control = getControl(handle.mIndex);
+	if (control)
+		control->set(val);
+	else
+		CONTROL_ERRS << "Unbound string control handle " << handle.mIndex << llendl;
+}
+
 //---------------------------------------------------------------
 // Load and save
 //---------------------------------------------------------------
@@ -1099,19 +1253,28 @@ U32 LLControlGroup::loadFromFile(const std::string& filename, bool set_default_v
 	std::string name;
 	LLSD settings;
 	LLSD control_map;
-	llifstream infile;
-	infile.open(filename);
-	if(!infile.is_open())
+	if(!LLFile::isfile(filename))
 	{
 		llwarns << "Cannot find file " << filename << " to load." << llendl;
 		return 0;
 	}
 
-	S32 ret = LLSDSerialize::fromXML(settings, infile);
+	// Default settings ship with the viewer, so they're worth caching.
+	// User settings are saved on every exit and would never hit.
+	S32 ret;
+	if (set_default_values)
+	{
+		ret = LLXMLCache::loadLLSD(filename, settings);
+	}
+	else
+	{
+		llifstream infile;
+		infile.open(filename);
+		ret = LLSDSerialize::fromXML(settings, infile);
+	}
 
 	if (ret <= 0)
 	{
-		infile.close();
 		llwarns << "Unable to open LLSD control file " << filename << ". Trying Legacy Method." << llendl;		
 		return loadFromFileLegacy(filename, TRUE, TYPE_STRING);
 	}
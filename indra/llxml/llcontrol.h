@@ -169,12 +169,23 @@ private:
 
 };
 
+// A control that is looked up by name once, by LLControlGroup::bindHandles(),
+// and by index from then on. The type is part of the handle, so passing a
+// BOOL setting to getF32() won't compile. newview generates a handle for
+// every setting in settings.xml; see generate_settings_handles.py.
+template <eControlType TYPE>
+struct LLControlHandle
+{
+	S32 mIndex;
+};
+
 //const U32 STRING_CACHE_SIZE = 10000;
 class LLControlGroup : public LLControlGroupReader
 {
 protected:
 	typedef std::map<std::string, LLPointer<LLControlVariable> > ctrl_name_table_t;
 	ctrl_name_table_t mNameTable;
+	std::vector<LLControlVariable*> mHandleTable;	// bound by bindHandles()
 	std::set<std::string> mWarnings;
 	std::string mTypeString[TYPE_COUNT];
 
@@ -187,6 +198,12 @@ public:
 	void cleanup();
 	
 	LLPointer<LLControlVariable> getControl(const std::string& name);
+	LLControlVariable* getControl(S32 handle_index);
+
+	// Binds the handle with index i to the control named names[i]. Controls
+	// that don't exist or aren't of types[i] are warned about, and their
+	// handles stay unbound.
+	void bindHandles(const char* const* names, const eControlType* types, S32 count);
 
 	struct ApplyFunctor
 	{
@@ -231,6 +248,15 @@ public:
 	LLColor4	getColor4(const std::string& name);
 	LLColor3	getColor3(const std::string& name);
 
+	BOOL		getBOOL(LLControlHandle<TYPE_BOOLEAN> handle);
+	S32			getS32(LLControlHandle<TYPE_S32> handle);
+	F32			getF32(LLControlHandle<TYPE_F32> handle);
+	U32			getU32(LLControlHandle<TYPE_U32> handle);
+	std::string	getString(LLControlHandle<TYPE_STRING> handle);
+	LLVector3	getVector3(LLControlHandle<TYPE_VEC3> handle);
+	LLRect		getRect(LLControlHandle<TYPE_RECT> handle);
+	LLColor4	getColor4(LLControlHandle<TYPE_COL4> handle);
+
 	void	setBOOL(const std::string& name, BOOL val);
 	void	setS32(const std::string& name, S32 val);
 	void	setF32(const std::string& name, F32 val);
@@ -244,6 +270,12 @@ public:
 	void	setColor3(const std::string& name, const LLColor3 &val);
 	void    setLLSD(const std::string& name, const LLSD& val);
 	void	setValue(const std::string& name, const LLSD& val);
+
+	void	setBOOL(LLControlHandle<TYPE_BOOLEAN> handle, BOOL val);
+	void	setS32(LLControlHandle<TYPE_S32> handle, S32 val);
+	void	setF32(LLControlHandle<TYPE_F32> handle, F32 val);
+	void	setU32(LLControlHandle<TYPE_U32> handle, U32 val);
+	void	setString(LLControlHandle<TYPE_STRING> handle, const std::string& val);
 	
 	
 	BOOL    controlExists(const std::string& name);
@@ -0,0 +1,566 @@
+/**
+ * @file llxmlcache.cpp
+ * @brief Binary copies of XML files that are read at every startup
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llxmlcache.h"
+
+#include "llfile.h"
+#include "llmd5.h"
+#include "llmemorystream.h"
+#include "llsd.h"
+#include "llsdserialize.h"
+#include "llstringtable.h"
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if LL_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string LLXMLCache::sCacheDir;
+S32 LLXMLCache::sHits = 0;
+S32 LLXMLCache::sMisses = 0;
+
+// Bump this whenever the layout of a cached file changes.
+const U32 XML_CACHE_VERSION = 1;
+
+// Nodes nested deeper than this are taken to mean a damaged file.
+const S32 XML_CACHE_MAX_DEPTH = 256;
+
+// What a cached file starts with. It's followed by the source file's path,
+// so that two paths with the same MD5 can't be mixed up, and then the data.
+struct LLXMLCacheHeader
+{
+	char mMagic[4];
+	U32 mVersion;
+	U32 mFlags;			// LLXMLCache::EKind, and how XML was parsed
+	U32 mSourceSize;
+	S64 mSourceTime;
+	U32 mPathLength;
+	U32 mDataLength;
+};
+
+//-----------------------------------------------------------------------------
+// LLMappedFile
+//-----------------------------------------------------------------------------
+
+// A whole file mapped read only into memory, so reading a cached copy
+// doesn't need a buffer or a copy of its own.
+class LLMappedFile
+{
+public:
+	LLMappedFile() : mData(NULL), mSize(0) {}
+	~LLMappedFile();
+
+	bool open(const std::string& filename);
+
+	const U8* getData() const	{ return mData; }
+	U32 getSize() const			{ return mSize; }
+
+private:
+	const U8* mData;
+	U32 mSize;
+};
+
+LLMappedFile::~LLMappedFile()
+{
+	if (mData)
+	{
+#if LL_WINDOWS
+		UnmapViewOfFile(mData);
+#else
+		munmap((void*)mData, mSize);
+#endif
+	}
+}
+
+bool LLMappedFile::open(const std::string& filename)
+{
+#if LL_WINDOWS
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	HANDLE file = CreateFileW((LPCWSTR)utf16filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	DWORD size = GetFileSize(file, NULL);
+	HANDLE mapping = NULL;
+	if (size != INVALID_FILE_SIZE && size > 0)
+	{
+		mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (mapping)
+	{
+		// the view keeps the mapping and the file open
+		mData = (const U8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat file_status;
+	off_t size = 0;
+	if (fstat(file, &file_status) == 0)
+	{
+		size = file_status.st_size;
+	}
+	if (size > 0)
+	{
+		void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			mData = (const U8*)data;
+		}
+	}
+	::close(file);
+#endif
+	if (mData)
+	{
+		mSize = (U32)size;
+	}
+	return mData != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// LLXMLCacheNodeWriter
+//-----------------------------------------------------------------------------
+
+// Writes out a tree of LLXMLNodes. Each name is written once, up front, so
+// that reading the tree back only looks each one up in gStringTable once.
+class LLXMLCacheNodeWriter
+{
+public:
+	// Everything written so far, names first.
+	std::string getData() const;
+
+	void writeNode(const LLXMLNode* node);
+
+private:
+	static void writeU32(std::string& out, U32 value);
+	static void writeString(std::string& out, const std::string& value);
+
+	std::string mNodes;
+	std::map<const LLStringTableEntry*, U32> mNameIndices;
+	std::vector<const LLStringTableEntry*> mNames;
+};
+
+// static
+void LLXMLCacheNodeWriter::writeU32(std::string& out, U32 value)
+{
+	out.append((const char*)&value, sizeof(value));
+}
+
+// static
+void LLXMLCacheNodeWriter::writeString(std::string& out, const std::string& value)
+{
+	writeU32(out, (U32)value.size());
+	out.append(value);
+}
+
+std::string LLXMLCacheNodeWriter::getData() const
+{
+	std::string data;
+	writeU32(data, (U32)mNames.size());
+	for (std::vector<const LLStringTableEntry*>::const_iterator iter = mNames.begin();
+		 iter != mNames.end(); ++iter)
+	{
+		writeString(data, *iter ? (*iter)->mString : "");
+	}
+	data.append(mNodes);
+	return data;
+}
+
+void LLXMLCacheNodeWriter::writeNode(const LLXMLNode* node)
+{
+	const LLStringTableEntry* name = node->getName();
+	std::map<const LLStringTableEntry*, U32>::iterator name_iter = mNameIndices.find(name);
+	if (name_iter == mNameIndices.end())
+	{
+		name_iter = mNameIndices.insert(std::make_pair(name, (U32)mNames.size())).first;
+		mNames.push_back(name);
+	}
+	writeU32(mNodes, name_iter->second);
+	writeU32(mNodes, node->mIsAttribute);
+	writeU32(mNodes, node->mType);
+	writeU32(mNodes, node->mEncoding);
+	writeU32(mNodes, node->mVersionMajor);
+	writeU32(mNodes, node->mVersionMinor);
+	writeU32(mNodes, node->mLength);
+	writeU32(mNodes, node->mPrecision);
+	writeString(mNodes, node->mID);
+	writeString(mNodes, node->getValue());
+
+	writeU32(mNodes, (U32)node->mAttributes.size());
+	for (LLXMLAttribList::const_iterator iter = node->mAttributes.begin();
+		 iter != node->mAttributes.end(); ++iter)
+	{
+		writeNode(iter->second);
+	}
+
+	// in document order rather than name order
+	writeU32(mNodes, node->getChildCount());
+	if (node->mChildren.notNull())
+	{
+		for (LLXMLNodePtr child = node->mChildren->head; child.notNull(); child = child->mNext)
+		{
+			writeNode(child);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLXMLCacheNodeReader
+//-----------------------------------------------------------------------------
+
+// Reads back what LLXMLCacheNodeWriter wrote, checking every length against
+// the end of the data on the way.
+class LLXMLCacheNodeReader
+{
+public:
+	LLXMLCacheNodeReader(const U8* data, U32 length)
+	:	mPos(data),
+		mEnd(data + length)
+	{
+	}
+
+	bool read(LLXMLNodePtr& node);
+
+private:
+	bool readU32(U32& value);
+	bool readString(std::string& value);
+	bool readNode(LLXMLNode* parent, LLXMLNodePtr& node, S32 depth);
+
+	const U8* mPos;
+	const U8* mEnd;
+	std::vector<LLStringTableEntry*> mNames;
+};
+
+bool LLXMLCacheNodeReader::readU32(U32& value)
+{
+	if (mEnd - mPos < (S32)sizeof(value))
+	{
+		return false;
+	}
+	memcpy(&value, mPos, sizeof(value));
+	mPos += sizeof(value);
+	return true;
+}
+
+bool LLXMLCacheNodeReader::readString(std::string& value)
+{
+	U32 length;
+	if (!readU32(length) || (U32)(mEnd - mPos) < length)
+	{
+		return false;
+	}
+	value.assign((const char*)mPos, length);
+	mPos += length;
+	return true;
+}
+
+bool LLXMLCacheNodeReader::read(LLXMLNodePtr& node)
+{
+	U32 num_names;
+	if (!readU32(num_names) || num_names > (U32)(mEnd - mPos))
+	{
+		return false;
+	}
+	mNames.reserve(num_names);
+	std::string name;
+	for (U32 i = 0; i < num_names; i++)
+	{
+		if (!readString(name))
+		{
+			return false;
+		}
+		mNames.push_back(gStringTable.addStringEntry(name));
+	}
+	return readNode(NULL, node, 0) && mPos == mEnd;
+}
+
+bool LLXMLCacheNodeReader::readNode(LLXMLNode* parent, LLXMLNodePtr& node, S32 depth)
+{
+	U32 name_index, is_attribute, type, encoding;
+	if (depth > XML_CACHE_MAX_DEPTH
+		|| !readU32(name_index) || name_index >= mNames.size()
+		|| !readU32(is_attribute)
+		|| !readU32(type)
+		|| !readU32(encoding))
+	{
+		return false;
+	}
+
+	node = new LLXMLNode(mNames[name_index], is_attribute);
+	// added before its own children, as the parser does, so that adding
+	// them doesn't walk the whole subtree each time
+	if (parent)
+	{
+		parent->addChild(node);
+	}
+
+	std::string value;
+	if (!readU32(node->mVersionMajor)
+		|| !readU32(node->mVersionMinor)
+		|| !readU32(node->mLength)
+		|| !readU32(node->mPrecision)
+		|| !readString(node->mID)
+		|| !readString(value))
+	{
+		return false;
+	}
+	node->setValue(value);
+	node->mType = (LLXMLNode::ValueType)type;
+	node->mEncoding = (LLXMLNode::Encoding)encoding;
+
+	for (S32 list = 0; list < 2; list++)
+	{
+		// attributes, then children
+		U32 count;
+		if (!readU32(count))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < count; i++)
+		{
+			LLXMLNodePtr child;
+			if (!readNode(node, child, depth + 1))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// LLXMLCache
+//-----------------------------------------------------------------------------
+
+// static
+void LLXMLCache::setCacheDir(const std::string& dir)
+{
+	if (!dir.empty() && !LLFile::isdir(dir))
+	{
+		LLFile::mkdir(dir);
+	}
+	sCacheDir = dir;
+}
+
+// static
+std::string LLXMLCache::getCacheFilename(const std::string& filename)
+{
+	char digest[33];		/* Flawfinder: ignore */
+	LLMD5 md5((const unsigned char*)filename.c_str());
+	md5.hex_digest(digest);
+#if LL_WINDOWS
+	return sCacheDir + "\\" + digest + ".xmlc";
+#else
+	return sCacheDir + "/" + digest + ".xmlc";
+#endif
+}
+
+// static
+U32 LLXMLCache::getFlags(EKind kind)
+{
+	U32 flags = kind;
+	if (kind == KIND_XML_NODE)
+	{
+		// these change what the parser makes of the same file
+		flags |= LLXMLNode::sStripEscapedStrings ? 0x100 : 0;
+		flags |= LLXMLNode::sStripWhitespaceValues ? 0x200 : 0;
+	}
+	return flags;
+}
+
+// static
+S32 LLXMLCache::read(const std::string& filename, EKind kind, LLXMLNodePtr* node, LLSD* sd)
+{
+	llstat source_status;
+	if (LLFile::stat(filename, &source_status) != 0)
+	{
+		return 0;
+	}
+
+	LLMappedFile cached;
+	if (!cached.open(getCacheFilename(filename)))
+	{
+		return 0;
+	}
+
+	LLXMLCacheHeader header;
+	if (cached.getSize() < sizeof(header))
+	{
+		return 0;
+	}
+	memcpy(&header, cached.getData(), sizeof(header));
+	if (memcmp(header.mMagic, "LLXC", 4) != 0
+		|| header.mVersion != XML_CACHE_VERSION
+		|| header.mFlags != getFlags(kind)
+		|| header.mSourceSize != (U32)source_status.st_size
+		|| header.mSourceTime != (S64)source_status.st_mtime
+		|| header.mPathLength != filename.size()
+		|| cached.getSize() != sizeof(header) + header.mPathLength + header.mDataLength)
+	{
+		return 0;
+	}
+	const U8* path = cached.getData() + sizeof(header);
+	if (memcmp(path, filename.c_str(), header.mPathLength) != 0)
+	{
+		return 0;
+	}
+	const U8* data = path + header.mPathLength;
+
+	if (kind == KIND_XML_NODE)
+	{
+		LLXMLCacheNodeReader reader(data, header.mDataLength);
+		return reader.read(*node) ? 1 : 0;
+	}
+	LLMemoryStream stream(data, header.mDataLength);
+	return LLSDSerialize::fromBinary(*sd, stream, header.mDataLength);
+}
+
+// static
+void LLXMLCache::write(const std::string& filename, EKind kind, const std::string& data)
+{
+	llstat source_status;
+	if (LLFile::stat(filename, &source_status) != 0)
+	{
+		return;
+	}
+
+	LLXMLCacheHeader header;
+	memcpy(header.mMagic, "LLXC", 4);
+	header.mVersion = XML_CACHE_VERSION;
+	header.mFlags = getFlags(kind);
+	header.mSourceSize = (U32)source_status.st_size;
+	header.mSourceTime = (S64)source_status.st_mtime;
+	header.mPathLength = (U32)filename.size();
+	header.mDataLength = (U32)data.size();
+
+	// written aside and renamed into place, so that another instance never
+	// maps a half written file
+	std::string cache_filename = getCacheFilename(filename);
+	std::string temp_filename = cache_filename + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Couldn't write XML cache file " << temp_filename << llendl;
+		return;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, fp) == 1
+				   && fwrite(filename.c_str(), 1, filename.size(), fp) == filename.size()
+				   && fwrite(data.c_str(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	if (written)
+	{
+		LLFile::remove(cache_filename);
+		written = LLFile::rename(temp_filename, cache_filename) == 0;
+	}
+	if (!written)
+	{
+		llwarns << "Couldn't write XML cache file " << cache_filename << llendl;
+		LLFile::remove(temp_filename);
+	}
+}
+
+// static
+bool LLXMLCache::parseFile(const std::string& filename, LLXMLNodePtr& node, LLXMLNode* defaults_tree)
+{
+	if (sCacheDir.empty())
+	{
+		return LLXMLNode::parseFile(filename, node, defaults_tree);
+	}
+
+	if (read(filename, KIND_XML_NODE, &node, NULL) > 0)
+	{
+		node->setDefault(defaults_tree);
+		node->updateDefault();
+		sHits++;
+		return true;
+	}
+
+	if (!LLXMLNode::parseFile(filename, node, defaults_tree))
+	{
+		return false;
+	}
+	sMisses++;
+	LLXMLCacheNodeWriter writer;
+	writer.writeNode(node);
+	write(filename, KIND_XML_NODE, writer.getData());
+	return true;
+}
+
+// static
+S32 LLXMLCache::loadLLSD(const std::string& filename, LLSD& sd)
+{
+	if (!sCacheDir.empty())
+	{
+		S32 count = read(filename, KIND_LLSD, NULL, &sd);
+		if (count > 0)
+		{
+			sHits++;
+			return count;
+		}
+		sd.clear();
+	}
+
+	llifstream infile;
+	infile.open(filename);
+	if (!infile.is_open())
+	{
+		return LLSDParser::PARSE_FAILURE;
+	}
+	S32 count = LLSDSerialize::fromXML(sd, infile);
+	infile.close();
+
+	if (count > 0 && !sCacheDir.empty())
+	{
+		sMisses++;
+		std::ostringstream data;
+		LLSDSerialize::toBinary(sd, data);
+		write(filename, KIND_LLSD, data.str());
+	}
+	return count;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file llxmlcache.h
+ * @brief Binary copies of XML files that are read at every startup
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLXMLCACHE_H
+#define LL_LLXMLCACHE_H
+
+#include "llxmlnode.h"
+
+class LLSD;
+
+// The settings files and XUI descriptions the viewer reads at startup hardly
+// ever change, but used to be parsed as XML on every launch. The first time
+// one of them is read, what came out of the parse is written to the cache
+// directory in a compact binary form, and later launches map that file into
+// memory and rebuild from it instead.
+//
+// A cached copy is only used while the source file's size and modification
+// time match the ones it was made from, so editing a skin or settings file
+// takes effect as before. Anything wrong with a cached copy (missing,
+// truncated, from another version) just means falling back to the XML.
+class LLXMLCache
+{
+public:
+	// Caching is off until this is called with a directory, which is
+	// created if needs be. An empty dir turns it off again.
+	static void setCacheDir(const std::string& dir);
+	static const std::string& getCacheDir()		{ return sCacheDir; }
+
+	// Same as LLXMLNode::parseFile(), via the cache.
+	static bool parseFile(const std::string& filename, LLXMLNodePtr& node, LLXMLNode* defaults_tree);
+
+	// Reads an LLSD XML file into sd, via the cache. Returns what
+	// LLSDSerialize::fromXML() would, so <= 0 on failure.
+	static S32 loadLLSD(const std::string& filename, LLSD& sd);
+
+	// files that were read from and written to the cache since startup
+	static S32 sHits;
+	static S32 sMisses;
+
+private:
+	enum EKind
+	{
+		KIND_XML_NODE = 1,
+		KIND_LLSD = 2
+	};
+
+	static std::string getCacheFilename(const std::string& filename);
+	static U32 getFlags(EKind kind);
+	// Fills in node or sd from filename's cached copy. Returns how many
+	// things were read, so <= 0 if there's no usable copy.
+	static S32 read(const std::string& filename, EKind kind, LLXMLNodePtr* node, LLSD* sd);
+	static void write(const std::string& filename, EKind kind, const std::string& data);
+
+	static std::string sCacheDir;
+};
+
+#endif // LL_LLXMLCACHE_H
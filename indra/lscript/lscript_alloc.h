@@ -39,6 +39,9 @@
 #include "lscript_byteconvert.h"
 #include "lscript_library.h"
 
+#include <map>
+#include <set>
+
 void reset_hp_to_safe_spot(const U8 *buffer);
 
 
@@ -117,6 +120,64 @@ inline void bytestream2alloc_entry(LLScriptAllocEntry &entry, U8 *buffer, S32 &o
 	}
 }
 
+// Free blocks of one script's heap, indexed so lsa_heap_add_data() can find
+// room without walking the block chain from HR. Runs of neighbouring free
+// blocks are bucketed by their combined size, and allocation takes the same
+// block the walk would: the first run with room. It also merges what the
+// walk would have merged on the way there and moves HP the same way, so
+// the heap, and the free memory a script sees, come out exactly as they
+// would without it. Whoever owns the buffer attaches one and invalidates it
+// whenever the heap is replaced; heaps without one fall back to the walk.
+class LLScriptHeapFreeList
+{
+public:
+	LLScriptHeapFreeList();
+	~LLScriptHeapFreeList();
+
+	void attach(U8 *buffer);
+	void detach();
+	// The index is re-read from the block chain the next time it's needed.
+	void invalidate()				{ mDirty = TRUE; }
+
+	// The index for buffer, brought up to date, or NULL if there isn't one
+	// or its block chain doesn't hang together.
+	static LLScriptHeapFreeList *getInstance(const U8 *buffer);
+
+	// Finds and writes the header of a block with room for size bytes of
+	// data, as the walk in lsa_heap_add_data() would. Returns the header's
+	// offset, or 0 if the heap would run into the stack.
+	S32 allocate(U8 type, S32 size, S32 heapsize);
+	// The block at offset has just been freed.
+	void release(S32 offset);
+
+	S32 getNumFreeBlocks() const	{ return (S32)mBlocks.size(); }
+	S32 getNumFreeRuns() const		{ return (S32)mRuns.size(); }
+
+private:
+	void clear();
+	void rebuild();
+	S32 find(S32 size) const;
+	void addRun(S32 offset, S32 size);
+	void removeRun(S32 offset);
+	void mergeRun(S32 offset);
+
+	static S32 getSizeClass(S32 size);
+
+	enum { NUM_SIZE_CLASSES = 32 };
+
+	typedef std::map<S32, S32> block_map_t;
+	block_map_t mBlocks;	// header offset -> size of data, as in the chain
+	block_map_t mRuns;		// first header offset -> size once merged
+	std::set<S32> mSizeClasses[NUM_SIZE_CLASSES];
+	std::set<S32> mUnmergedRuns;
+	U8 *mBuffer;
+	BOOL mDirty;
+	BOOL mValid;
+
+	typedef std::map<const U8 *, LLScriptHeapFreeList *> instance_map_t;
+	static instance_map_t sInstances;
+};
+
 // create a heap from the HR to TM
 BOOL lsa_create_heap(U8 *heap_start, S32 size);
 void lsa_fprint_heap(U8 *buffer, LLFILE *fp);
@@ -6565,7 +6565,7 @@ int yyerror(const char *fmt, ...)
 //#define EMIT_CIL_ASSEMBLER
 
 BOOL lscript_compile(const char* src_filename, const char* dst_filename,
-					 const char* err_filename, BOOL compile_to_mono, const char* class_name, BOOL is_god_like)
+					 const char* err_filename, BOOL compile_to_mono, const char* class_name, BOOL is_god_like, BOOL optimize)
 {
 	BOOL			b_parse_ok = FALSE;
 	BOOL			b_dummy = FALSE;
@@ -6607,6 +6607,7 @@ BOOL lscript_compile(const char* src_filename, const char* dst_filename,
 			}
 
 			gScriptp->mGodLike = is_god_like;
+			gScriptp->mCompileToMono = compile_to_mono;
 			
 			gScriptp->setClassName(class_name);
 
@@ -6620,6 +6621,10 @@ BOOL lscript_compile(const char* src_filename, const char* dst_filename,
 			gScriptp->recurse(yyout, 0, 0, LSCP_TYPE,		 LSPRUNE_INVALID, b_dummy, NULL, type, type, b_dummy_count, NULL, NULL, 0, NULL, 0, NULL);
 			if (!gErrorToText.getErrors())
 			{
+				if (optimize)
+				{
+					gScriptp->recurse(yyout, 0, 0, LSCP_OPTIMIZE, LSPRUNE_INVALID, b_dummy, NULL, type, type, b_dummy_count, NULL, NULL, 0, NULL, 0, NULL);
+				}
 				gScriptp->recurse(yyout, 0, 0, LSCP_RESOURCE, LSPRUNE_INVALID,		 b_dummy, NULL, type, type, b_dummy_count, NULL, NULL, 0, NULL, 0, NULL);
 #ifdef EMERGENCY_DEBUG_PRINTOUTS
 				gScriptp->recurse(yyout, 0, 0, LSCP_EMIT_ASSEMBLY, LSPRUNE_INVALID,  b_dummy, NULL, type, type, b_dummy_count, NULL, NULL, 0, NULL, 0, NULL);
@@ -6658,7 +6663,7 @@ BOOL lscript_compile(char *filename, BOOL compile_to_mono, BOOL is_god_like = FA
 	sprintf(err_filename, "%s.out", filename);
 	char class_name[MAX_STRING];
 	sprintf(class_name, "%s", filename);
-	return lscript_compile(src_filename, NULL, err_filename, compile_to_mono, class_name, is_god_like);
+	return lscript_compile(src_filename, NULL, err_filename, compile_to_mono, class_name, is_god_like, TRUE);
 }
 
 
@@ -70,6 +70,13 @@ public:
 	U8					*mCodeChunk;
 	S32					mCurrentOffset;
 	LLScriptJumpTable	*mJumpTable;
+
+private:
+	// Makes room for size more bytes after mCurrentOffset, at least
+	// doubling the chunk so that appending stays linear.
+	void reserve(S32 size);
+
+	S32					mAllocatedSize;
 };
 
 class LLScriptScriptCodeChunk
@@ -51,6 +51,8 @@ typedef enum e_lscript_compile_pass
 	LSCP_TO_STACK,
 	LSCP_BUILD_FUNCTION_ARGS,
 	LSCP_EMIT_CIL_ASSEMBLY,
+	LSCP_COUNT_REFERENCES,
+	LSCP_OPTIMIZE,
 	LSCP_EOF
 } LSCRIPTCompilePass;
 
@@ -85,6 +87,11 @@ public:
 
 	virtual ~LLScriptFilePosition() {}
 
+	// Parse tree nodes are carved out of gAllocationManager's arena, and
+	// go back to it all at once when the compile is done.
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
+
 	virtual void recurse(LLFILE *fp, S32 tabs, S32 tabsize, 
 						LSCRIPTCompilePass pass, LSCRIPTPruneType ptype, BOOL &prunearg, 
 						LLScriptScope *scope, LSCRIPTType &type, LSCRIPTType basetype, U64 &count, 
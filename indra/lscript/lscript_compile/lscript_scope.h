@@ -279,7 +279,7 @@ class LLScriptScopeEntry
 {
 public:
 	LLScriptScopeEntry(const char *identifier, LSCRIPTIdentifierType idtype, LSCRIPTType type, S32 count = 0)
-		: mIdentifier(identifier), mIDType(idtype), mType(type), mOffset(0), mSize(0), mAssignable(NULL), mCount(count), mLibraryNumber(0)
+		: mIdentifier(identifier), mIDType(idtype), mType(type), mOffset(0), mSize(0), mAssignable(NULL), mCount(count), mLibraryNumber(0), mReferences(0), mAssignments(0)
 	{
 	}
 
@@ -295,6 +295,9 @@ public:
 	U16							mLibraryNumber;
 	LLScriptArgString			mFunctionArgs;
 	LLScriptArgString			mLocals;
+	// Filled in by LSCP_COUNT_REFERENCES for the optimizer.
+	S32							mReferences;	// reads, writes and calls
+	S32							mAssignments;	// writes only
 };
 
 class LLScriptScope
@@ -44,6 +44,89 @@
 
 //#define LSL_INCLUDE_DEBUG_INFO
 
+// Blocks the parse tree is allocated from. A large script fills a few
+// dozen of these instead of making tens of thousands of heap allocations.
+const size_t LSCRIPT_ARENA_BLOCK_SIZE = 64 * 1024;
+const size_t LSCRIPT_ARENA_ALIGNMENT = 16;
+
+LLScriptAllocationManager::LLScriptAllocationManager()
+:	mBlockUsed(0)
+{
+}
+
+LLScriptAllocationManager::~LLScriptAllocationManager()
+{
+	deleteAllocations();
+}
+
+void *LLScriptAllocationManager::allocate(size_t size)
+{
+	size = (size + LSCRIPT_ARENA_ALIGNMENT - 1) & ~(LSCRIPT_ARENA_ALIGNMENT - 1);
+	if (mBlocks.empty() || mBlockUsed + size > mBlockSizes.back())
+	{
+		size_t block_size = llmax(size, LSCRIPT_ARENA_BLOCK_SIZE);
+		mBlocks.push_back(new U8[block_size]);
+		mBlockSizes.push_back(block_size);
+		mBlockUsed = 0;
+	}
+	void *ptr = mBlocks.back() + mBlockUsed;
+	mBlockUsed += size;
+	return ptr;
+}
+
+BOOL LLScriptAllocationManager::owns(void *ptr) const
+{
+	for (size_t i = 0; i < mBlocks.size(); i++)
+	{
+		if ((U8 *)ptr >= mBlocks[i] && (U8 *)ptr < mBlocks[i] + mBlockSizes[i])
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void LLScriptAllocationManager::deleteAllocations()
+{
+	// Some nodes are added more than once. Node destructors only free what
+	// the lexer allocated, like names and string constants; the nodes
+	// themselves go with the blocks.
+	std::sort(mAllocationList.begin(), mAllocationList.end());
+	mAllocationList.erase(std::unique(mAllocationList.begin(), mAllocationList.end()), mAllocationList.end());
+	for (std::vector<LLScriptFilePosition *>::iterator iter = mAllocationList.begin();
+		 iter != mAllocationList.end(); ++iter)
+	{
+		(*iter)->~LLScriptFilePosition();
+	}
+	mAllocationList.clear();
+
+	for (std::vector<U8 *>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		delete [] *iter;
+	}
+	mBlocks.clear();
+	mBlockSizes.clear();
+	mBlockUsed = 0;
+}
+
+void *LLScriptFilePosition::operator new(size_t size)
+{
+	if (gAllocationManager)
+	{
+		return gAllocationManager->allocate(size);
+	}
+	return ::operator new(size);
+}
+
+void LLScriptFilePosition::operator delete(void *ptr)
+{
+	// Nodes in the arena are only freed with the rest of it.
+	if (!gAllocationManager || !gAllocationManager->owns(ptr))
+	{
+		::operator delete(ptr);
+	}
+}
+
 
 static void print_cil_box(LLFILE* fp, LSCRIPTType type)
 {
@@ -549,6 +632,13 @@ void LLScriptSAIdentifier::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCom
 			}
 			break;
 		}
+	case LSCP_COUNT_REFERENCES:
+		mIdentifier->mScopeEntry->mReferences++;
+		if (mNextp)
+		{
+			mNextp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		}
+		break;
 	default:
 		mIdentifier->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		if (mNextp)
@@ -4038,6 +4128,575 @@ void LLScriptExpression::gonext(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompil
 	}
 }
 
+// Helpers for LSCP_OPTIMIZE, which runs between LSCP_TYPE and
+// LSCP_RESOURCE. Parents optimize their children first and then replace
+// them with whatever fold_expression() or fold_statement() hands back.
+// New nodes go to gAllocationManager the way the parser's do, and the
+// ones they replace are left for it to free.
+
+static BOOL is_constant(LLScriptExpression *exp, LSCRIPTType type)
+{
+	return exp->mType == LET_CONSTANT
+		&& ((LLScriptConstantExpression *)exp)->mConstant->mType == type;
+}
+
+static S32 get_constant_integer(LLScriptExpression *exp)
+{
+	return ((LLScriptConstantInteger *)((LLScriptConstantExpression *)exp)->mConstant)->mValue;
+}
+
+static F32 get_constant_float(LLScriptExpression *exp)
+{
+	return ((LLScriptConstantFloat *)((LLScriptConstantExpression *)exp)->mConstant)->mValue;
+}
+
+static const char *get_constant_string(LLScriptExpression *exp)
+{
+	return ((LLScriptConstantString *)((LLScriptConstantExpression *)exp)->mConstant)->mValue;
+}
+
+// Integer or float constants, as a float.
+static BOOL get_constant_number(LLScriptExpression *exp, F32 &value)
+{
+	if (is_constant(exp, LST_INTEGER))
+	{
+		value = (F32)get_constant_integer(exp);
+		return TRUE;
+	}
+	if (is_constant(exp, LST_FLOATINGPOINT))
+	{
+		value = get_constant_float(exp);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// Conditions are tested the same way for both types.
+static BOOL get_constant_condition(LLScriptExpression *exp, BOOL &value)
+{
+	F32 number;
+	if (get_constant_number(exp, number))
+	{
+		value = (number != 0.f);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// Mono does float math in double precision, so folding it here in single
+// precision could change a script's results. Integers that a float holds
+// exactly convert the same way on both.
+static BOOL can_fold_float_math()
+{
+	return !gScriptp->mCompileToMono;
+}
+
+static BOOL is_exact_float(S32 value)
+{
+	return value >= -(1 << 24) && value <= (1 << 24);
+}
+
+static LLScriptExpression *make_constant(LLScriptExpression *old, LLScriptConstant *constant)
+{
+	gAllocationManager->addAllocation(constant);
+	LLScriptExpression *exp = new LLScriptConstantExpression(old->mLineNumber, old->mColumnNumber, constant);
+	gAllocationManager->addAllocation(exp);
+	exp->mReturnType = constant->mType;
+	exp->mNextp = old->mNextp;
+	return exp;
+}
+
+static LLScriptExpression *make_constant_integer(LLScriptExpression *old, S32 value)
+{
+	return make_constant(old, new LLScriptConstantInteger(old->mLineNumber, old->mColumnNumber, value));
+}
+
+static LLScriptExpression *make_constant_float(LLScriptExpression *old, F32 value)
+{
+	return make_constant(old, new LLScriptConstantFloat(old->mLineNumber, old->mColumnNumber, value));
+}
+
+static LLScriptExpression *make_constant_string(LLScriptExpression *old, const std::string &value)
+{
+	char *copy = new char[value.size() + 1];
+	memcpy(copy, value.c_str(), value.size() + 1);		/* Flawfinder: ignore */
+	return make_constant(old, new LLScriptConstantString(old->mLineNumber, old->mColumnNumber, copy));
+}
+
+static LLScriptExpression *replace_expression(LLScriptExpression *old, LLScriptExpression *exp)
+{
+	exp->mNextp = old->mNextp;
+	return exp;
+}
+
+// Integer constants where a float is wanted are stored as floats, which
+// saves the cast at run time.
+static LLScriptExpression *promote_constant(LLScriptExpression *exp, LSCRIPTType type)
+{
+	if (type == LST_FLOATINGPOINT && is_constant(exp, LST_INTEGER))
+	{
+		return make_constant_float(exp, (F32)get_constant_integer(exp));
+	}
+	return exp;
+}
+
+// Reads of global integers and floats that are never assigned to.
+static LLScriptExpression *fold_global(LLScriptLValue *lvalue)
+{
+	LLScriptScopeEntry *entry = lvalue->mIdentifier->mScopeEntry;
+	if (lvalue->mAccessor
+		|| entry->mIDType != LIT_GLOBAL
+		|| entry->mAssignments
+		|| (entry->mType != LST_INTEGER && entry->mType != LST_FLOATINGPOINT))
+	{
+		return lvalue;
+	}
+
+	F32 fvalue = 0.f;
+	S32 ivalue = 0;
+	LLScriptSimpleAssignable *assignable = entry->mAssignable;
+	if (assignable)
+	{
+		if (assignable->mType != LSSAT_CONSTANT)
+		{
+			return lvalue;
+		}
+		LLScriptConstant *constant = ((LLScriptSAConstant *)assignable)->mConstant;
+		if (constant->mType == LST_INTEGER)
+		{
+			ivalue = ((LLScriptConstantInteger *)constant)->mValue;
+			fvalue = (F32)ivalue;
+		}
+		else if (constant->mType == LST_FLOATINGPOINT)
+		{
+			fvalue = ((LLScriptConstantFloat *)constant)->mValue;
+		}
+		else
+		{
+			return lvalue;
+		}
+	}
+
+	if (entry->mType == LST_INTEGER)
+	{
+		return make_constant_integer(lvalue, ivalue);
+	}
+	return make_constant_float(lvalue, fvalue);
+}
+
+static LLScriptExpression *fold_unary(LLScriptExpression *exp, LLScriptExpression *operand)
+{
+	switch(exp->mType)
+	{
+	case LET_PARENTHESIS:
+		if (operand->mType == LET_CONSTANT)
+		{
+			return replace_expression(exp, operand);
+		}
+		break;
+	case LET_UNARY_MINUS:
+		if (is_constant(operand, LST_INTEGER))
+		{
+			return make_constant_integer(exp, (S32)(0 - (U32)get_constant_integer(operand)));
+		}
+		if (is_constant(operand, LST_FLOATINGPOINT))
+		{
+			return make_constant_float(exp, -get_constant_float(operand));
+		}
+		break;
+	case LET_BOOLEAN_NOT:
+		if (is_constant(operand, LST_INTEGER))
+		{
+			return make_constant_integer(exp, !get_constant_integer(operand));
+		}
+		break;
+	case LET_BIT_NOT:
+		if (is_constant(operand, LST_INTEGER))
+		{
+			return make_constant_integer(exp, ~get_constant_integer(operand));
+		}
+		break;
+	case LET_CAST:
+		if (operand->mType != LET_CONSTANT)
+		{
+			break;
+		}
+		if (operand->mReturnType == exp->mReturnType)
+		{
+			return replace_expression(exp, operand);
+		}
+		if (is_constant(operand, LST_INTEGER))
+		{
+			S32 value = get_constant_integer(operand);
+			if (exp->mReturnType == LST_FLOATINGPOINT
+				&& (can_fold_float_math() || is_exact_float(value)))
+			{
+				return make_constant_float(exp, (F32)value);
+			}
+			if (exp->mReturnType == LST_STRING)
+			{
+				return make_constant_string(exp, llformat("%d", value));
+			}
+		}
+		else if (is_constant(operand, LST_FLOATINGPOINT))
+		{
+			F32 value = get_constant_float(operand);
+			// leave the out of range ones to do whatever they do at run time
+			if (exp->mReturnType == LST_INTEGER
+				&& value > -2147483648.f && value < 2147483648.f)
+			{
+				return make_constant_integer(exp, (S32)value);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return exp;
+}
+
+static LLScriptExpression *fold_integers(LLScriptExpression *exp, S32 left, S32 right)
+{
+	switch(exp->mType)
+	{
+	// wrap around the way the VMs do
+	case LET_PLUS:			return make_constant_integer(exp, (S32)((U32)left + (U32)right));
+	case LET_MINUS:			return make_constant_integer(exp, (S32)((U32)left - (U32)right));
+	case LET_TIMES:			return make_constant_integer(exp, (S32)((U32)left * (U32)right));
+	case LET_DIVIDE:
+		// division by zero is a run time error, and both VMs special case -1
+		if (right == 0 || right == -1)
+		{
+			break;
+		}
+		return make_constant_integer(exp, left / right);
+	case LET_MOD:
+		if (right == 0 || right == -1)
+		{
+			break;
+		}
+		return make_constant_integer(exp, left % right);
+	case LET_BIT_AND:		return make_constant_integer(exp, left & right);
+	case LET_BIT_OR:		return make_constant_integer(exp, left | right);
+	case LET_BIT_XOR:		return make_constant_integer(exp, left ^ right);
+	case LET_BOOLEAN_AND:	return make_constant_integer(exp, left && right);
+	case LET_BOOLEAN_OR:	return make_constant_integer(exp, left || right);
+	case LET_SHIFT_LEFT:
+		if (right < 0 || right > 31)
+		{
+			break;
+		}
+		return make_constant_integer(exp, (S32)((U32)left << right));
+	case LET_SHIFT_RIGHT:
+		if (right < 0 || right > 31)
+		{
+			break;
+		}
+		return make_constant_integer(exp, left >> right);
+	case LET_EQUALITY:		return make_constant_integer(exp, left == right);
+	case LET_NOT_EQUALS:	return make_constant_integer(exp, left != right);
+	case LET_LESS_EQUALS:	return make_constant_integer(exp, left <= right);
+	case LET_GREATER_EQUALS:	return make_constant_integer(exp, left >= right);
+	case LET_LESS_THAN:		return make_constant_integer(exp, left < right);
+	case LET_GREATER_THAN:	return make_constant_integer(exp, left > right);
+	default:
+		break;
+	}
+	return exp;
+}
+
+static LLScriptExpression *fold_floats(LLScriptExpression *exp, F32 left, F32 right)
+{
+	switch(exp->mType)
+	{
+	case LET_EQUALITY:		return make_constant_integer(exp, left == right);
+	case LET_NOT_EQUALS:	return make_constant_integer(exp, left != right);
+	case LET_LESS_EQUALS:	return make_constant_integer(exp, left <= right);
+	case LET_GREATER_EQUALS:	return make_constant_integer(exp, left >= right);
+	case LET_LESS_THAN:		return make_constant_integer(exp, left < right);
+	case LET_GREATER_THAN:	return make_constant_integer(exp, left > right);
+	default:
+		break;
+	}
+
+	if (!can_fold_float_math())
+	{
+		return exp;
+	}
+	F32 result;
+	switch(exp->mType)
+	{
+	case LET_PLUS:			result = left + right;		break;
+	case LET_MINUS:			result = left - right;		break;
+	case LET_TIMES:			result = left * right;		break;
+	case LET_DIVIDE:
+		if (right == 0.f)
+		{
+			return exp;
+		}
+		result = left / right;
+		break;
+	default:
+		return exp;
+	}
+	return make_constant_float(exp, result);
+}
+
+static LLScriptExpression *fold_binary(LLScriptExpression *exp, LLScriptExpression *left, LLScriptExpression *right)
+{
+	if (is_constant(left, LST_INTEGER) && is_constant(right, LST_INTEGER))
+	{
+		return fold_integers(exp, get_constant_integer(left), get_constant_integer(right));
+	}
+
+	F32 fleft, fright;
+	if (get_constant_number(left, fleft) && get_constant_number(right, fright))
+	{
+		if ((is_constant(left, LST_INTEGER) && !is_exact_float(get_constant_integer(left)))
+			|| (is_constant(right, LST_INTEGER) && !is_exact_float(get_constant_integer(right))))
+		{
+			return exp;
+		}
+		return fold_floats(exp, fleft, fright);
+	}
+
+	if (exp->mType == LET_PLUS
+		&& is_constant(left, LST_STRING) && is_constant(right, LST_STRING))
+	{
+		return make_constant_string(exp, std::string(get_constant_string(left)) + get_constant_string(right));
+	}
+	return exp;
+}
+
+// Returns the constant exp folds to, or exp itself. Its operands have
+// already been through LSCP_OPTIMIZE. Never called on assignment targets.
+static LLScriptExpression *fold_expression(LLScriptExpression *exp)
+{
+	switch(exp->mType)
+	{
+	case LET_LVALUE:
+		return fold_global((LLScriptLValue *)exp);
+	case LET_PARENTHESIS:
+		return fold_unary(exp, ((LLScriptParenthesis *)exp)->mExpression);
+	case LET_UNARY_MINUS:
+		return fold_unary(exp, ((LLScriptUnaryMinus *)exp)->mExpression);
+	case LET_BOOLEAN_NOT:
+		return fold_unary(exp, ((LLScriptBooleanNot *)exp)->mExpression);
+	case LET_BIT_NOT:
+		return fold_unary(exp, ((LLScriptBitNot *)exp)->mExpression);
+	case LET_CAST:
+		return fold_unary(exp, ((LLScriptTypeCast *)exp)->mExpression);
+	case LET_EQUALITY:
+		return fold_binary(exp, ((LLScriptEquality *)exp)->mLeftSide, ((LLScriptEquality *)exp)->mRightSide);
+	case LET_NOT_EQUALS:
+		return fold_binary(exp, ((LLScriptNotEquals *)exp)->mLeftSide, ((LLScriptNotEquals *)exp)->mRightSide);
+	case LET_LESS_EQUALS:
+		return fold_binary(exp, ((LLScriptLessEquals *)exp)->mLeftSide, ((LLScriptLessEquals *)exp)->mRightSide);
+	case LET_GREATER_EQUALS:
+		return fold_binary(exp, ((LLScriptGreaterEquals *)exp)->mLeftSide, ((LLScriptGreaterEquals *)exp)->mRightSide);
+	case LET_LESS_THAN:
+		return fold_binary(exp, ((LLScriptLessThan *)exp)->mLeftSide, ((LLScriptLessThan *)exp)->mRightSide);
+	case LET_GREATER_THAN:
+		return fold_binary(exp, ((LLScriptGreaterThan *)exp)->mLeftSide, ((LLScriptGreaterThan *)exp)->mRightSide);
+	case LET_PLUS:
+		return fold_binary(exp, ((LLScriptPlus *)exp)->mLeftSide, ((LLScriptPlus *)exp)->mRightSide);
+	case LET_MINUS:
+		return fold_binary(exp, ((LLScriptMinus *)exp)->mLeftSide, ((LLScriptMinus *)exp)->mRightSide);
+	case LET_TIMES:
+		return fold_binary(exp, ((LLScriptTimes *)exp)->mLeftSide, ((LLScriptTimes *)exp)->mRightSide);
+	case LET_DIVIDE:
+		return fold_binary(exp, ((LLScriptDivide *)exp)->mLeftSide, ((LLScriptDivide *)exp)->mRightSide);
+	case LET_MOD:
+		return fold_binary(exp, ((LLScriptMod *)exp)->mLeftSide, ((LLScriptMod *)exp)->mRightSide);
+	case LET_BIT_AND:
+		return fold_binary(exp, ((LLScriptBitAnd *)exp)->mLeftSide, ((LLScriptBitAnd *)exp)->mRightSide);
+	case LET_BIT_OR:
+		return fold_binary(exp, ((LLScriptBitOr *)exp)->mLeftSide, ((LLScriptBitOr *)exp)->mRightSide);
+	case LET_BIT_XOR:
+		return fold_binary(exp, ((LLScriptBitXor *)exp)->mLeftSide, ((LLScriptBitXor *)exp)->mRightSide);
+	case LET_BOOLEAN_AND:
+		return fold_binary(exp, ((LLScriptBooleanAnd *)exp)->mLeftSide, ((LLScriptBooleanAnd *)exp)->mRightSide);
+	case LET_BOOLEAN_OR:
+		return fold_binary(exp, ((LLScriptBooleanOr *)exp)->mLeftSide, ((LLScriptBooleanOr *)exp)->mRightSide);
+	case LET_SHIFT_LEFT:
+		return fold_binary(exp, ((LLScriptShiftLeft *)exp)->mLeftSide, ((LLScriptShiftLeft *)exp)->mRightSide);
+	case LET_SHIFT_RIGHT:
+		return fold_binary(exp, ((LLScriptShiftRight *)exp)->mLeftSide, ((LLScriptShiftRight *)exp)->mRightSide);
+	default:
+		return exp;
+	}
+}
+
+// Bumps the assignment count of the variable an assignment or increment
+// writes to.
+static void count_assignment(LLScriptExpression *lvalue)
+{
+	((LLScriptLValue *)lvalue)->mIdentifier->mScopeEntry->mAssignments++;
+}
+
+static BOOL contains_label(LLScriptStatement *statement)
+{
+	if (!statement)
+	{
+		return FALSE;
+	}
+	switch(statement->mType)
+	{
+	case LSSMT_LABEL:
+		return TRUE;
+	case LSSMT_SEQUENCE:
+		return contains_label(((LLScriptStatementSequence *)statement)->mFirstp)
+			|| contains_label(((LLScriptStatementSequence *)statement)->mSecondp);
+	case LSSMT_COMPOUND_STATEMENT:
+		return contains_label(((LLScriptCompoundStatement *)statement)->mStatement);
+	case LSSMT_IF:
+		return contains_label(((LLScriptIf *)statement)->mStatement);
+	case LSSMT_IF_ELSE:
+		return contains_label(((LLScriptIfElse *)statement)->mStatement1)
+			|| contains_label(((LLScriptIfElse *)statement)->mStatement2);
+	case LSSMT_FOR:
+		return contains_label(((LLScriptFor *)statement)->mStatement);
+	case LSSMT_DO_WHILE:
+		return contains_label(((LLScriptDoWhile *)statement)->mStatement);
+	case LSSMT_WHILE:
+		return contains_label(((LLScriptWhile *)statement)->mStatement);
+	default:
+		return FALSE;
+	}
+}
+
+static LLScriptStatement *replace_statement(LLScriptStatement *old, LLScriptStatement *statement)
+{
+	statement->mNextp = old->mNextp;
+	return statement;
+}
+
+static LLScriptStatement *make_noop(LLScriptStatement *old)
+{
+	LLScriptStatement *noop = new LLScriptNOOP(old->mLineNumber, old->mColumnNumber);
+	gAllocationManager->addAllocation(noop);
+	return replace_statement(old, noop);
+}
+
+// Returns what statement can be replaced with once its parts have been
+// through LSCP_OPTIMIZE: the branch a constant condition always takes, a
+// NOOP for code that can't run or does nothing, or statement itself.
+// Code with a label in it stays, since a jump could still reach it.
+static LLScriptStatement *fold_statement(LLScriptStatement *statement)
+{
+	if (!statement)
+	{
+		return NULL;
+	}
+
+	BOOL condition;
+	switch(statement->mType)
+	{
+	case LSSMT_EXPRESSION:
+		{
+			LLScriptExpression *exp = ((LLScriptExpressionStatement *)statement)->mExpression;
+			if (exp->mType == LET_CONSTANT || exp->mType == LET_LVALUE)
+			{
+				return make_noop(statement);
+			}
+		}
+		break;
+	case LSSMT_DECLARATION:
+		{
+			LLScriptDeclaration *declaration = (LLScriptDeclaration *)statement;
+			if (!declaration->mIdentifier->mScopeEntry->mReferences
+				&& (!declaration->mExpression || declaration->mExpression->mType == LET_CONSTANT))
+			{
+				return make_noop(statement);
+			}
+		}
+		break;
+	case LSSMT_IF:
+		{
+			LLScriptIf *if_statement = (LLScriptIf *)statement;
+			if (get_constant_condition(if_statement->mExpression, condition))
+			{
+				if (condition)
+				{
+					return replace_statement(statement, if_statement->mStatement);
+				}
+				if (!contains_label(if_statement->mStatement))
+				{
+					return make_noop(statement);
+				}
+			}
+		}
+		break;
+	case LSSMT_IF_ELSE:
+		{
+			LLScriptIfElse *if_else = (LLScriptIfElse *)statement;
+			if (get_constant_condition(if_else->mExpression, condition))
+			{
+				if (condition && !contains_label(if_else->mStatement2))
+				{
+					return replace_statement(statement, if_else->mStatement1);
+				}
+				if (!condition && !contains_label(if_else->mStatement1))
+				{
+					return replace_statement(statement, if_else->mStatement2);
+				}
+			}
+		}
+		break;
+	case LSSMT_FOR:
+		{
+			LLScriptFor *for_statement = (LLScriptFor *)statement;
+			if (get_constant_condition(for_statement->mExpression, condition))
+			{
+				if (condition)
+				{
+					for_statement->mAlwaysTrue = TRUE;
+				}
+				else if (!for_statement->mSequence && !contains_label(for_statement->mStatement))
+				{
+					return make_noop(statement);
+				}
+			}
+		}
+		break;
+	case LSSMT_WHILE:
+		{
+			LLScriptWhile *while_statement = (LLScriptWhile *)statement;
+			if (get_constant_condition(while_statement->mExpression, condition))
+			{
+				if (condition)
+				{
+					while_statement->mAlwaysTrue = TRUE;
+				}
+				else if (!contains_label(while_statement->mStatement))
+				{
+					return make_noop(statement);
+				}
+			}
+		}
+		break;
+	case LSSMT_DO_WHILE:
+		{
+			LLScriptDoWhile *do_while = (LLScriptDoWhile *)statement;
+			if (get_constant_condition(do_while->mExpression, condition))
+			{
+				if (condition)
+				{
+					do_while->mAlwaysTrue = TRUE;
+				}
+				else
+				{
+					return replace_statement(statement, do_while->mStatement);
+				}
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return statement;
+}
+
 void LLScriptForExpressionList::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass pass, LSCRIPTPruneType ptype, BOOL &prunearg, LLScriptScope *scope, LSCRIPTType &type, LSCRIPTType basetype, U64 &count, LLScriptByteCodeChunk *chunk, LLScriptByteCodeChunk *heap, S32 stacksize, LLScriptScopeEntry *entry, S32 entrycount, LLScriptLibData **ldata)
 {
 	if (gErrorToText.getErrors())
@@ -4135,6 +4794,14 @@ void LLScriptForExpressionList::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRI
 			}
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mFirstp = fold_expression(mFirstp);
+		if (mSecondp)
+		{
+			mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		}
+		break;
 	default:
 		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		if (mSecondp)
@@ -4266,6 +4933,14 @@ void LLScriptFuncExpressionList::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCR
 			}
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mFirstp = promote_constant(fold_expression(mFirstp), entry->mFunctionArgs.getType(entrycount));
+		if (mSecondp)
+		{
+			mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount + 1, NULL);
+		}
+		break;
 	default:
 		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		if (mSecondp)
@@ -4352,6 +5027,14 @@ void LLScriptListExpressionList::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCR
 			}
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mFirstp = fold_expression(mFirstp);
+		if (mSecondp)
+		{
+			mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		}
+		break;
 	default:
 		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		if (mSecondp)
@@ -4703,6 +5386,9 @@ void LLScriptLValue::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 			fprintf(fp, "Unexpected LValue!\n");
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		mIdentifier->mScopeEntry->mReferences++;
+		break;
 	default:
 		mIdentifier->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -4823,6 +5509,8 @@ void store2stack(LLScriptExpression *exp, LLScriptExpression *lv, LLScriptByteCo
 	LLScriptLValue *lvalue = (LLScriptLValue *)lv;
 	LLScriptIdentifier *ident = lvalue->mIdentifier;
 	LSCRIPTType rettype = exp->mReturnType;
+	// the store and pop forms are the LOAD*P opcodes
+	BOOL pop = exp->mStoreAndPop;
 
 	if (exp->mRightType != LST_NULL)
 	{
@@ -4835,62 +5523,62 @@ void store2stack(LLScriptExpression *exp, LLScriptExpression *lv, LLScriptByteCo
 	case LST_FLOATINGPOINT:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STORE]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADP : LOPC_STORE]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREG]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGP : LOPC_STOREG]);
 		}
 		break;
 	case LST_KEY:
 	case LST_STRING:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STORES]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADSP : LOPC_STORES]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREGS]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGSP : LOPC_STOREGS]);
 		}
 		break;
 	case LST_LIST:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREL]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADLP : LOPC_STOREL]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREGL]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGLP : LOPC_STOREGL]);
 		}
 		break;
 	case LST_VECTOR:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREV]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADVP : LOPC_STOREV]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREGV]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGVP : LOPC_STOREGV]);
 		}
 		break;
 	case LST_QUATERNION:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREQ]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADQP : LOPC_STOREQ]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREGQ]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGQP : LOPC_STOREGQ]);
 		}
 		break;
 	default:
 		if (ident->mScopeEntry->mIDType == LIT_VARIABLE)
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STORE]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADP : LOPC_STORE]);
 		}
 		else
 		{
-			chunk->addByte(LSCRIPTOpCodes[LOPC_STOREG]);
+			chunk->addByte(LSCRIPTOpCodes[pop ? LOPC_LOADGP : LOPC_STOREG]);
 		}
 		break;
 	}
@@ -4945,6 +5633,19 @@ void LLScriptAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = promote_constant(fold_expression(mRightSide), mReturnType);
+		if (mRightSide->mType == LET_CONSTANT)
+		{
+			mRightType = mRightSide->mReturnType;
+		}
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5083,6 +5784,15 @@ void LLScriptAddAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5183,6 +5893,15 @@ void LLScriptSubAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5362,6 +6081,15 @@ void LLScriptMulAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5479,6 +6207,15 @@ void LLScriptDivAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5567,6 +6304,15 @@ void LLScriptModAssignment::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			print_cil_assignment(fp, mLValue, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mLValue);
+		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLValue->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5679,6 +6425,12 @@ void LLScriptEquality::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompile
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_eq(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5748,6 +6500,12 @@ void LLScriptNotEquals::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompil
 		    fprintf(fp, "ceq\n"); // Compare result of first compare equal with 0 to get compare not equal.
 		}    
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5816,6 +6574,12 @@ void LLScriptLessEquals::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_lte(fp);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5884,6 +6648,12 @@ void LLScriptGreaterEquals::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_gte(fp);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -5950,6 +6720,12 @@ void LLScriptLessThan::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompile
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_lt(fp);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6016,6 +6792,12 @@ void LLScriptGreaterThan::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTComp
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_gt(fp);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6076,6 +6858,12 @@ void LLScriptPlus::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_add(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6136,6 +6924,12 @@ void LLScriptMinus::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_sub(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6196,6 +6990,12 @@ void LLScriptTimes::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_mul(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6256,6 +7056,12 @@ void LLScriptDivide::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 		print_cil_numeric_cast(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		print_cil_div(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6314,6 +7120,12 @@ void LLScriptMod::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		print_cil_mod(fp, mLeftSide->mReturnType, mRightSide->mReturnType);
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6370,6 +7182,12 @@ void LLScriptBitAnd::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "and\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6426,6 +7244,12 @@ void LLScriptBitOr::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "or\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6482,6 +7306,12 @@ void LLScriptBitXor::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "xor\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6544,6 +7374,12 @@ void LLScriptBooleanAnd::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
                 fprintf(fp, "ldc.i4.0\n");
                 fprintf(fp, "ceq\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6604,6 +7440,12 @@ void LLScriptBooleanOr::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompil
 		fprintf(fp, "ldc.i4.0\n");
 		fprintf(fp, "ceq\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6660,6 +7502,12 @@ void LLScriptShiftLeft::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompil
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "call int32 [LslUserScript]LindenLab.SecondLife.LslUserScript::ShiftLeft(int32, int32)\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6717,6 +7565,12 @@ void LLScriptShiftRight::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "call int32 [LslUserScript]LindenLab.SecondLife.LslUserScript::ShiftRight(int32, int32)\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mLeftSide = fold_expression(mLeftSide);
+		mRightSide = fold_expression(mRightSide);
+		break;
 	default:
 		mLeftSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mRightSide->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -6751,6 +7605,10 @@ void LLScriptParenthesis::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTComp
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mReturnType = mLeftType = type;
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -6804,6 +7662,10 @@ void LLScriptUnaryMinus::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
 			print_cil_neg(fp, mLeftType);
 	    }
 	    break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -6854,6 +7716,10 @@ void LLScriptBooleanNot::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompi
 		fprintf(fp, "ldc.i4.0\n");
 		fprintf(fp, "ceq\n"); // If f(e) is (e == 0), f(e) returns 1 if e is 0 and 0 otherwise, therefore f(e) implements boolean not.
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -6903,6 +7769,10 @@ void LLScriptBitNot::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		fprintf(fp, "not\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -7011,6 +7881,10 @@ void LLScriptPreIncrement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCom
 			print_cil_assignment(fp, mExpression, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mExpression);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -7119,6 +7993,10 @@ void LLScriptPreDecrement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCom
 			print_cil_assignment(fp, mExpression, entry);
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mExpression);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -7170,6 +8048,10 @@ void LLScriptTypeCast::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompile
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		print_cil_cast(fp, mRightType, mType->mType);
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mType->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -7285,6 +8167,14 @@ void LLScriptVectorInitializer::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRI
 		// Call named ctor, which leaves new Vector on stack, so it can be saved in to local or argument just like a primitive type.
 		fprintf(fp, "call class [ScriptTypes]LindenLab.SecondLife.Vector class [LslUserScript]LindenLab.SecondLife.LslUserScript::'CreateVector'(float32, float32, float32)\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression2->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression3->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression1 = promote_constant(fold_expression(mExpression1), LST_FLOATINGPOINT);
+		mExpression2 = promote_constant(fold_expression(mExpression2), LST_FLOATINGPOINT);
+		mExpression3 = promote_constant(fold_expression(mExpression3), LST_FLOATINGPOINT);
+		break;
 	default:
 		mExpression1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mExpression2->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -7426,6 +8316,16 @@ void LLScriptQuaternionInitializer::recurse(LLFILE *fp, S32 tabs, S32 tabsize, L
 		// Call named ctor, which leaves new Vector on stack, so it can be saved in to local or argument just like a primitive type.
 		fprintf(fp, "call class [ScriptTypes]LindenLab.SecondLife.Quaternion class [LslUserScript]LindenLab.SecondLife.LslUserScript::'CreateQuaternion'(float32, float32, float32, float32)\n");
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression2->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression3->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression4->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression1 = promote_constant(fold_expression(mExpression1), LST_FLOATINGPOINT);
+		mExpression2 = promote_constant(fold_expression(mExpression2), LST_FLOATINGPOINT);
+		mExpression3 = promote_constant(fold_expression(mExpression3), LST_FLOATINGPOINT);
+		mExpression4 = promote_constant(fold_expression(mExpression4), LST_FLOATINGPOINT);
+		break;
 	default:
 		mExpression1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mExpression2->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -7652,6 +8552,10 @@ void LLScriptPostIncrement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			fprintf(fp, "pop\n"); 
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mExpression);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -7794,6 +8698,10 @@ void LLScriptPostDecrement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCo
 			fprintf(fp, "pop\n"); 
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		count_assignment(mExpression);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -8002,6 +8910,15 @@ void LLScriptFunctionCall::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCom
 			fprintf(fp, ")\n");
 		}
 		break;
+	case LSCP_COUNT_REFERENCES:
+		mIdentifier->mScopeEntry->mReferences++;
+		if (mExpressionList)
+			mExpressionList->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		break;
+	case LSCP_OPTIMIZE:
+		if (mExpressionList)
+			mExpressionList->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, mIdentifier->mScopeEntry, 0, NULL);
+		break;
 	default:
 		mIdentifier->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		if (mExpressionList)
@@ -8048,6 +8965,10 @@ void LLScriptPrint::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 		print_cil_cast(fp, mLeftType, LST_STRING);
  	        fprintf(fp, "call void class [LslLibrary]LindenLab.SecondLife.Library::Print(string)");
 	        break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -8190,6 +9111,12 @@ void LLScriptStatementSequence::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRI
 			mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, return_type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mFirstp = fold_statement(mFirstp);
+		mSecondp = fold_statement(mSecondp);
+		break;
 	default:
 		mFirstp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mSecondp->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -8634,6 +9561,13 @@ void LLScriptReturn::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 		}
 		fprintf(fp, "ret\n");
 		break;
+	case LSCP_OPTIMIZE:
+		if (mExpression)
+		{
+			mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+			mExpression = fold_expression(mExpression);
+		}
+		break;
 	default:
 		if (mExpression)
 		{
@@ -8674,6 +9608,11 @@ void LLScriptExpressionStatement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSC
 		break;
 	case LSCP_EMIT_BYTE_CODE:
 		mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		if (mExpression->mStoreAndPop)
+		{
+			// the store already popped it
+			break;
+		}
 		switch(mExpression->mReturnType)
 		{
 		case LST_INTEGER:
@@ -8704,6 +9643,25 @@ void LLScriptExpressionStatement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSC
 			fprintf(fp, "pop\n");
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		switch(mExpression->mType)
+		{
+		case LET_ASSIGNMENT:
+		case LET_ADD_ASSIGN:
+		case LET_SUB_ASSIGN:
+		case LET_MUL_ASSIGN:
+		case LET_DIV_ASSIGN:
+		case LET_MOD_ASSIGN:
+		case LET_PRE_INCREMENT:
+		case LET_PRE_DECREMENT:
+			mExpression->mStoreAndPop = TRUE;
+			break;
+		default:
+			break;
+		}
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
@@ -8828,6 +9786,12 @@ void LLScriptIf::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass p
 			fprintf(fp, "LabelTempJump%d:\n", tjump);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		mStatement = fold_statement(mStatement);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -8925,6 +9889,14 @@ void LLScriptIfElse::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 			fprintf(fp, "LabelTempJump%d:\n", tjump2);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mStatement1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mStatement2->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		mStatement1 = fold_statement(mStatement1);
+		mStatement2 = fold_statement(mStatement2);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mStatement1->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -9005,11 +9977,14 @@ void LLScriptFor::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass
 			if(mSequence)
 				mSequence->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			chunk->addLabel(jumpname1);
-			mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPNIF]);
-			chunk->addByte(LSCRIPTTypeByte[mType]);
-			chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
-			chunk->addJump(jumpname2);
+			if (!mAlwaysTrue)
+			{
+				mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPNIF]);
+				chunk->addByte(LSCRIPTTypeByte[mType]);
+				chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
+				chunk->addJump(jumpname2);
+			}
 			if(mStatement)
 				mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			if(mExpressionList)
@@ -9027,9 +10002,12 @@ void LLScriptFor::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass
 			if(mSequence)
 				mSequence->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			fprintf(fp, "LabelTempJump%d:\n", tjump1);
-			mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			print_cil_if_test(fp, mExpression->mReturnType);
-			fprintf(fp, "brfalse LabelTempJump%d\n", tjump2);
+			if (!mAlwaysTrue)
+			{
+				mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				print_cil_if_test(fp, mExpression->mReturnType);
+				fprintf(fp, "brfalse LabelTempJump%d\n", tjump2);
+			}
 			if(mStatement)
 				mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			if(mExpressionList)
@@ -9038,6 +10016,17 @@ void LLScriptFor::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePass
 			fprintf(fp, "LabelTempJump%d:\n", tjump2);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		if(mSequence)
+			mSequence->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		if(mExpressionList)
+			mExpressionList->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		if(mStatement)
+			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression = fold_expression(mExpression);
+		mStatement = fold_statement(mStatement);
+		break;
 	default:
 		if(mSequence)
 			mSequence->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -9101,9 +10090,16 @@ void LLScriptDoWhile::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompileP
 
 			chunk->addLabel(jumpname1);
 			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPIF]);
-			chunk->addByte(LSCRIPTTypeByte[mType]);
+			if (mAlwaysTrue)
+			{
+				chunk->addByte(LSCRIPTOpCodes[LOPC_JUMP]);
+			}
+			else
+			{
+				mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPIF]);
+				chunk->addByte(LSCRIPTTypeByte[mType]);
+			}
 			chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
 			chunk->addJump(jumpname1);
 		}
@@ -9113,11 +10109,24 @@ void LLScriptDoWhile::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompileP
 			S32 tjump1 =  gTempJumpCount++;
 			fprintf(fp, "LabelTempJump%d:\n", tjump1);
 			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			print_cil_if_test(fp, mExpression->mReturnType);
-			fprintf(fp, "brtrue LabelTempJump%d\n", tjump1);
+			if (mAlwaysTrue)
+			{
+				fprintf(fp, "br LabelTempJump%d\n", tjump1);
+			}
+			else
+			{
+				mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				print_cil_if_test(fp, mExpression->mReturnType);
+				fprintf(fp, "brtrue LabelTempJump%d\n", tjump1);
+			}
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mStatement = fold_statement(mStatement);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -9178,11 +10187,14 @@ void LLScriptWhile::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 			snprintf(jumpname2, sizeof(jumpname2), "##Temp Jump %d##", gTempJumpCount++); 	/* Flawfinder: ignore */
 
 			chunk->addLabel(jumpname1);
-			mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPNIF]);
-			chunk->addByte(LSCRIPTTypeByte[mType]);
-			chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
-			chunk->addJump(jumpname2);
+			if (!mAlwaysTrue)
+			{
+				mExpression->recurse(fp, tabs, tabsize, LSCP_TO_STACK, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				chunk->addByte(LSCRIPTOpCodes[LOPC_JUMPNIF]);
+				chunk->addByte(LSCRIPTTypeByte[mType]);
+				chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
+				chunk->addJump(jumpname2);
+			}
 			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			chunk->addByte(LSCRIPTOpCodes[LOPC_JUMP]);
 			chunk->addBytes(LSCRIPTDataSize[LST_INTEGER]);
@@ -9195,14 +10207,23 @@ void LLScriptWhile::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePas
 			S32 tjump1 =  gTempJumpCount++;
 			S32 tjump2 =  gTempJumpCount++;
 			fprintf(fp, "LabelTempJump%d:\n", tjump1);
-			mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
-			print_cil_if_test(fp, mExpression->mReturnType);
-			fprintf(fp, "brfalse LabelTempJump%d\n", tjump2);
+			if (!mAlwaysTrue)
+			{
+				mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+				print_cil_if_test(fp, mExpression->mReturnType);
+				fprintf(fp, "brfalse LabelTempJump%d\n", tjump2);
+			}
 			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 			fprintf(fp, "br LabelTempJump%d\n", tjump1);
 			fprintf(fp, "LabelTempJump%d:\n", tjump2);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+		mStatement = fold_statement(mStatement);
+		mExpression = fold_expression(mExpression);
+		break;
 	default:
 		mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
@@ -9439,6 +10460,13 @@ void LLScriptDeclaration::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTComp
 		}
 		fprintf(fp, "stloc.s %d\n", mIdentifier->mScopeEntry->mCount);
 		break;
+	case LSCP_OPTIMIZE:
+		if (mExpression)
+		{
+			mExpression->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+			mExpression = promote_constant(fold_expression(mExpression), mIdentifier->mScopeEntry->mType);
+		}
+		break;
 	default:
 		if (mExpression)
 		{
@@ -9518,6 +10546,13 @@ void LLScriptCompoundStatement::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRI
 			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, mStatementScope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		}
 		break;
+	case LSCP_OPTIMIZE:
+		if (mStatement)
+		{
+			mStatement->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+			mStatement = fold_statement(mStatement);
+		}
+		break;
 	default:
 		if (mStatement)
 		{
@@ -10574,7 +11609,7 @@ S32 LLScriptScript::getSize()
 LLScriptScript::LLScriptScript(LLScritpGlobalStorage *globals, 
 							   LLScriptState *states) :
     LLScriptFilePosition(0, 0),
-	mStates(states), mGlobalScope(NULL), mGlobals(NULL), mGlobalFunctions(NULL), mGodLike(FALSE)
+	mStates(states), mGlobalScope(NULL), mGlobals(NULL), mGlobalFunctions(NULL), mGodLike(FALSE), mCompileToMono(FALSE)
 {
 	const char DEFAULT_BYTECODE_FILENAME[] = "lscript.lso";
 
@@ -10726,6 +11761,71 @@ void LLScriptScript::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 			mGlobalFunctions->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		mStates->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
 		break;
+	case LSCP_OPTIMIZE:
+		{
+			// fold constants and drop dead code, knowing which variables
+			// are ever assigned to
+			recurse(fp, tabs, tabsize, LSCP_COUNT_REFERENCES, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+			if (mGlobalFunctions)
+				mGlobalFunctions->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+			mStates->recurse(fp, tabs, tabsize, pass, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+
+			// then drop the globals and functions that nothing refers to
+			// any more, which can leave others unreferenced in turn
+			LLScriptGlobalVariable *global;
+			LLScriptGlobalFunctions *function;
+			BOOL removed = TRUE;
+			while (removed)
+			{
+				for (global = mGlobals; global; global = global->mNextp)
+				{
+					global->mIdentifier->mScopeEntry->mReferences = 0;
+					global->mIdentifier->mScopeEntry->mAssignments = 0;
+				}
+				for (function = mGlobalFunctions; function; function = function->mNextp)
+				{
+					function->mIdentifier->mScopeEntry->mReferences = 0;
+				}
+				recurse(fp, tabs, tabsize, LSCP_COUNT_REFERENCES, ptype, prunearg, scope, type, basetype, count, chunk, heap, stacksize, entry, entrycount, NULL);
+
+				removed = FALSE;
+				LLScriptGlobalVariable **globalp = &mGlobals;
+				while (*globalp)
+				{
+					if (!(*globalp)->mIdentifier->mScopeEntry->mReferences)
+					{
+						*globalp = (*globalp)->mNextp;
+						removed = TRUE;
+					}
+					else
+					{
+						globalp = &(*globalp)->mNextp;
+					}
+				}
+				LLScriptGlobalFunctions **functionp = &mGlobalFunctions;
+				while (*functionp)
+				{
+					if (!(*functionp)->mIdentifier->mScopeEntry->mReferences)
+					{
+						*functionp = (*functionp)->mNextp;
+						removed = TRUE;
+					}
+					else
+					{
+						functionp = &(*functionp)->mNextp;
+					}
+				}
+			}
+
+			// the functions that are left get new slots in the jump table
+			S32 function_count = 0;
+			for (function = mGlobalFunctions; function; function = function->mNextp)
+			{
+				function->mIdentifier->mScopeEntry->mCount = function_count++;
+			}
+			mGlobalScope->mFunctionCount = function_count;
+		}
+		break;
 	case LSCP_RESOURCE:
 		// first determine resource counts for globals
 		count = 0;
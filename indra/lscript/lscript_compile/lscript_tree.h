@@ -948,7 +948,7 @@ class LLScriptExpression : public LLScriptFilePosition
 {
 public:
 	LLScriptExpression(S32 line, S32 col, LSCRIPTExpressionType type)
-		: LLScriptFilePosition(line, col), mType(type), mNextp(NULL), mLeftType(LST_NULL), mRightType(LST_NULL), mReturnType(LST_NULL)
+		: LLScriptFilePosition(line, col), mType(type), mNextp(NULL), mLeftType(LST_NULL), mRightType(LST_NULL), mReturnType(LST_NULL), mStoreAndPop(FALSE)
 	{
 	}
 
@@ -967,6 +967,9 @@ public:
 	LSCRIPTExpressionType	mType;
 	LLScriptExpression		*mNextp;
 	LSCRIPTType				mLeftType, mRightType, mReturnType;
+	// Set by LSCP_OPTIMIZE on an assignment whose result is thrown away,
+	// so store2stack() emits a store and pop instead of a store.
+	BOOL					mStoreAndPop;
 
 };
 
@@ -2008,7 +2011,7 @@ class LLScriptFor : public LLScriptStatement
 {
 public:
 	LLScriptFor(S32 line, S32 col, LLScriptExpression *sequence, LLScriptExpression *expression, LLScriptExpression *expressionlist, LLScriptStatement *statement)
-		: LLScriptStatement(line, col, LSSMT_FOR), mSequence(sequence), mExpression(expression), mExpressionList(expressionlist), mStatement(statement), mType(LST_NULL)
+		: LLScriptStatement(line, col, LSSMT_FOR), mSequence(sequence), mExpression(expression), mExpressionList(expressionlist), mStatement(statement), mType(LST_NULL), mAlwaysTrue(FALSE)
 	{
 	}
 
@@ -2024,13 +2027,14 @@ public:
 	LLScriptExpression		*mExpressionList;
 	LLScriptStatement		*mStatement;
 	LSCRIPTType				mType;
+	BOOL					mAlwaysTrue;	// set by LSCP_OPTIMIZE
 };
 
 class LLScriptDoWhile : public LLScriptStatement
 {
 public:
 	LLScriptDoWhile(S32 line, S32 col, LLScriptStatement *statement, LLScriptExpression *expression)
-		: LLScriptStatement(line, col, LSSMT_DO_WHILE), mStatement(statement), mExpression(expression), mType(LST_NULL)
+		: LLScriptStatement(line, col, LSSMT_DO_WHILE), mStatement(statement), mExpression(expression), mType(LST_NULL), mAlwaysTrue(FALSE)
 	{
 	}
 
@@ -2044,13 +2048,14 @@ public:
 	LLScriptStatement		*mStatement;
 	LLScriptExpression		*mExpression;
 	LSCRIPTType				mType;
+	BOOL					mAlwaysTrue;	// set by LSCP_OPTIMIZE
 };
 
 class LLScriptWhile : public LLScriptStatement
 {
 public:
 	LLScriptWhile(S32 line, S32 col, LLScriptExpression *expression, LLScriptStatement *statement)
-		: LLScriptStatement(line, col, LSSMT_WHILE), mExpression(expression), mStatement(statement), mType(LST_NULL)
+		: LLScriptStatement(line, col, LSSMT_WHILE), mExpression(expression), mStatement(statement), mType(LST_NULL), mAlwaysTrue(FALSE)
 	{
 	}
 
@@ -2064,6 +2069,7 @@ public:
 	LLScriptExpression			*mExpression;
 	LLScriptStatement			*mStatement;
 	LSCRIPTType					mType;
+	BOOL						mAlwaysTrue;	// set by LSCP_OPTIMIZE
 };
 
 // local variables
@@ -2297,32 +2303,40 @@ public:
 	LLScriptGlobalVariable	*mGlobals;
 	LLScriptGlobalFunctions	*mGlobalFunctions;
 	BOOL					mGodLike;
+	BOOL					mCompileToMono;
 
 private:
 	std::string mBytecodeDest;
 	char mClassName[MAX_STRING];
 };
 
+// Owns the parse tree. Nodes are allocated from large blocks rather than
+// one at a time, and deleteAllocations() destroys them and frees the
+// blocks in one go.
 class LLScriptAllocationManager
 {
 public:
-	LLScriptAllocationManager() {}
-	~LLScriptAllocationManager() 
-	{
-		mAllocationList.deleteAllData();
-	}
+	LLScriptAllocationManager();
+	~LLScriptAllocationManager();
 
+	void *allocate(size_t size);
+	// TRUE if ptr came from allocate().
+	BOOL owns(void *ptr) const;
+
+	// Adding a node twice is harmless.
 	void addAllocation(LLScriptFilePosition *ptr)
 	{
-		mAllocationList.addData(ptr);
+		mAllocationList.push_back(ptr);
 	}
 
-	void deleteAllocations()
-	{
-		mAllocationList.deleteAllData();
-	}
+	void deleteAllocations();
+
+	std::vector<LLScriptFilePosition *> mAllocationList;
 
-	LLLinkedList<LLScriptFilePosition> mAllocationList;
+private:
+	std::vector<U8 *> mBlocks;
+	std::vector<size_t> mBlockSizes;
+	size_t mBlockUsed;
 };
 
 extern LLScriptAllocationManager *gAllocationManager;
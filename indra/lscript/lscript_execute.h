@@ -33,6 +33,7 @@
 #ifndef LL_LSCRIPT_EXECUTE_H
 #define LL_LSCRIPT_EXECUTE_H
 
+#include "lscript_alloc.h"
 #include "lscript_byteconvert.h"
 #include "linked_lists.h"
 #include "lscript_library.h"
@@ -539,6 +540,7 @@ public:
 
 	U32						mInstructionCount;
 	U8						*mBuffer;
+	LLScriptHeapFreeList	mFreeList;
 	LLScriptEventData		mEventData;
 	U8*						mBytecode; // Initial state and bytecode.
 	U32						mBytecodeSize;
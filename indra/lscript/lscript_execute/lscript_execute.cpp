@@ -108,10 +108,15 @@ LLScriptExecuteLSL2::LLScriptExecuteLSL2(const U8* bytecode, U32 bytecode_size)
 	mBytecode = new U8[mBytecodeSize];
 	memcpy(mBytecode, bytecode, mBytecodeSize);
 	init();
+
+	// only a full size image can be indexed, since the last heap block
+	// runs up to the top of memory
+	mFreeList.attach(mBuffer);
 }
 
 LLScriptExecuteLSL2::~LLScriptExecuteLSL2()
 {
+	mFreeList.detach();
 	delete[] mBuffer;
 	delete[] mBytecode;
 }
@@ -667,6 +672,7 @@ S32 LLScriptExecuteLSL2::readState(U8 *src)
 	S32 hr = get_register(mBuffer, LREG_HR);
 	S32 tm = get_register(mBuffer, LREG_TM);
 	memset(mBuffer + hr, 0, tm - hr);
+	mFreeList.invalidate();
 
 	S32 src_offset = 0;
 	S32 dest_offset = 0;
@@ -739,6 +745,7 @@ void LLScriptExecuteLSL2::reset()
 	S32 src_offset = 0;
 
 	bytestream2bytestream(mBuffer, dest_offset, src, src_offset, size);
+	mFreeList.invalidate();
 }
 
 S32 LLScriptExecuteLSL2::getMajorVersion() const
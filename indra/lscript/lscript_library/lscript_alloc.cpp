@@ -92,6 +92,334 @@ S32 lsa_heap_top(U8 *heap_start, S32 maxtop)
 	return offset + entry.mSize;
 }
 
+LLScriptHeapFreeList::instance_map_t LLScriptHeapFreeList::sInstances;
+
+LLScriptHeapFreeList::LLScriptHeapFreeList()
+:	mBuffer(NULL),
+	mDirty(FALSE),
+	mValid(FALSE)
+{
+}
+
+LLScriptHeapFreeList::~LLScriptHeapFreeList()
+{
+	detach();
+}
+
+void LLScriptHeapFreeList::attach(U8 *buffer)
+{
+	detach();
+	mBuffer = buffer;
+	mDirty = TRUE;
+	sInstances[mBuffer] = this;
+}
+
+void LLScriptHeapFreeList::detach()
+{
+	if (mBuffer)
+	{
+		sInstances.erase(mBuffer);
+		mBuffer = NULL;
+	}
+	clear();
+}
+
+void LLScriptHeapFreeList::clear()
+{
+	mBlocks.clear();
+	mRuns.clear();
+	for (S32 i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		mSizeClasses[i].clear();
+	}
+	mUnmergedRuns.clear();
+	mDirty = FALSE;
+	mValid = FALSE;
+}
+
+// static
+LLScriptHeapFreeList *LLScriptHeapFreeList::getInstance(const U8 *buffer)
+{
+	instance_map_t::iterator iter = sInstances.find(buffer);
+	if (iter == sInstances.end())
+	{
+		return NULL;
+	}
+	LLScriptHeapFreeList *free_list = iter->second;
+	if (free_list->mDirty)
+	{
+		free_list->rebuild();
+	}
+	return free_list->mValid ? free_list : NULL;
+}
+
+void LLScriptHeapFreeList::rebuild()
+{
+	clear();
+
+	S32 hr = get_register(mBuffer, LREG_HR);
+	S32 offset = hr;
+	S32 run_offset = 0;
+	LLScriptAllocEntry entry;
+	while (1)
+	{
+		if (  (offset < hr)
+			||(offset > MAX_HEAP_SIZE - SIZEOF_SCRIPT_ALLOC_ENTRY))
+		{
+			clear();
+			return;
+		}
+		S32 read_offset = offset;
+		bytestream2alloc_entry(entry, mBuffer, read_offset);
+		if (  (entry.mSize < 0)
+			||(entry.mType >= LST_EOF))
+		{
+			clear();
+			return;
+		}
+
+		if (entry.mType)
+		{
+			run_offset = 0;
+		}
+		else
+		{
+			mBlocks[offset] = entry.mSize;
+			if (run_offset)
+			{
+				mRuns[run_offset] += entry.mSize + SIZEOF_SCRIPT_ALLOC_ENTRY;
+			}
+			else
+			{
+				run_offset = offset;
+				mRuns[run_offset] = entry.mSize;
+			}
+		}
+
+		// the last block runs off the top of memory
+		if (offset + SIZEOF_SCRIPT_ALLOC_ENTRY + entry.mSize >= MAX_HEAP_SIZE)
+		{
+			break;
+		}
+		offset += SIZEOF_SCRIPT_ALLOC_ENTRY + entry.mSize;
+	}
+
+	block_map_t runs;
+	runs.swap(mRuns);
+	for (block_map_t::iterator iter = runs.begin(); iter != runs.end(); ++iter)
+	{
+		addRun(iter->first, iter->second);
+	}
+	mValid = TRUE;
+}
+
+// static
+S32 LLScriptHeapFreeList::getSizeClass(S32 size)
+{
+	// four byte steps up to 64 bytes, which covers everything but strings
+	// and lists, then powers of two
+	if (size <= 64)
+	{
+		return size > 0 ? (size - 1) >> 2 : 0;
+	}
+	S32 size_class = 16;
+	for (size = (size - 1) >> 6; size > 1 && size_class < NUM_SIZE_CLASSES - 1; size >>= 1)
+	{
+		size_class++;
+	}
+	return size_class;
+}
+
+// The first run with room for size bytes, which is where the walk stops.
+S32 LLScriptHeapFreeList::find(S32 size) const
+{
+	S32 size_class = getSizeClass(size);
+	S32 offset = 0;
+
+	// runs in the request's own class may still be too small
+	const std::set<S32> &runs = mSizeClasses[size_class];
+	for (std::set<S32>::const_iterator iter = runs.begin(); iter != runs.end(); ++iter)
+	{
+		if (mRuns.find(*iter)->second >= size)
+		{
+			offset = *iter;
+			break;
+		}
+	}
+
+	// but the first in any bigger one will do
+	for (size_class++; size_class < NUM_SIZE_CLASSES; size_class++)
+	{
+		const std::set<S32> &bigger = mSizeClasses[size_class];
+		if (  (!bigger.empty())
+			&&(!offset || *bigger.begin() < offset))
+		{
+			offset = *bigger.begin();
+		}
+	}
+	return offset;
+}
+
+// The block at offset has to be indexed already.
+void LLScriptHeapFreeList::addRun(S32 offset, S32 size)
+{
+	mRuns[offset] = size;
+	mSizeClasses[getSizeClass(size)].insert(offset);
+	if (mBlocks.find(offset)->second != size)
+	{
+		mUnmergedRuns.insert(offset);
+	}
+}
+
+void LLScriptHeapFreeList::removeRun(S32 offset)
+{
+	block_map_t::iterator iter = mRuns.find(offset);
+	if (iter != mRuns.end())
+	{
+		mSizeClasses[getSizeClass(iter->second)].erase(offset);
+		mUnmergedRuns.erase(offset);
+		mRuns.erase(iter);
+	}
+}
+
+// Makes the run at offset one block, as the walk does to runs it passes.
+void LLScriptHeapFreeList::mergeRun(S32 offset)
+{
+	S32 size = mRuns.find(offset)->second;
+	block_map_t::iterator iter = mBlocks.find(offset);
+	iter->second = size;
+	for (++iter; iter != mBlocks.end() && iter->first < offset + SIZEOF_SCRIPT_ALLOC_ENTRY + size; )
+	{
+		mBlocks.erase(iter++);
+	}
+	mUnmergedRuns.erase(offset);
+
+	LLScriptAllocEntry entry;
+	S32 header_offset = offset;
+	bytestream2alloc_entry(entry, mBuffer, header_offset);
+	entry.mSize = size;
+	header_offset = offset;
+	alloc_entry2bytestream(mBuffer, header_offset, entry);
+}
+
+S32 LLScriptHeapFreeList::allocate(U8 type, S32 size, S32 heapsize)
+{
+	S32 hr = get_register(mBuffer, LREG_HR);
+	S32 current_offset = find(size);
+	if (!current_offset)
+	{
+		return 0;
+	}
+
+	// the walk merges every run it passes on the way
+	while (  (!mUnmergedRuns.empty())
+		   &&(*mUnmergedRuns.begin() < current_offset))
+	{
+		mergeRun(*mUnmergedRuns.begin());
+	}
+
+	// and the blocks of this one only until there's room
+	S32 run_size = mRuns.find(current_offset)->second;
+	removeRun(current_offset);
+	block_map_t::iterator iter = mBlocks.find(current_offset);
+	S32 block_size = iter->second;
+	BOOL b_moved = current_offset != hr;
+	while (block_size < size)
+	{
+		block_map_t::iterator next = iter;
+		++next;
+		block_size += next->second + SIZEOF_SCRIPT_ALLOC_ENTRY;
+		mBlocks.erase(next);
+		b_moved = TRUE;
+	}
+	mBlocks.erase(iter);
+
+	// and it bumps HP each time it moves or merges
+	S32 new_hp = current_offset + size + 2*SIZEOF_SCRIPT_ALLOC_ENTRY;
+	if (b_moved)
+	{
+		if (new_hp >= hr + heapsize)
+		{
+			invalidate();
+			return 0;
+		}
+		if (new_hp > get_register(mBuffer, LREG_HP))
+		{
+			set_register(mBuffer, LREG_HP, new_hp);
+		}
+	}
+
+	LLScriptAllocEntry entry;
+	S32 offset = current_offset;
+	bytestream2alloc_entry(entry, mBuffer, offset);
+	entry.mSize = block_size;
+
+	S32 rest_offset = current_offset + SIZEOF_SCRIPT_ALLOC_ENTRY + block_size;
+	if (block_size >= size + SIZEOF_SCRIPT_ALLOC_ENTRY + 4)
+	{
+		LLScriptAllocEntry rest;
+		rest.mSize = block_size - SIZEOF_SCRIPT_ALLOC_ENTRY - size;
+		entry.mSize = size;
+		rest_offset = current_offset + SIZEOF_SCRIPT_ALLOC_ENTRY + size;
+		offset = rest_offset;
+		alloc_entry2bytestream(mBuffer, offset, rest);
+		mBlocks[rest_offset] = rest.mSize;
+		addRun(rest_offset, run_size - SIZEOF_SCRIPT_ALLOC_ENTRY - size);
+		if (new_hp >= hr + heapsize)
+		{
+			invalidate();
+			return 0;
+		}
+		if (new_hp > get_register(mBuffer, LREG_HP))
+		{
+			set_register(mBuffer, LREG_HP, new_hp);
+		}
+	}
+	else if (rest_offset < current_offset + SIZEOF_SCRIPT_ALLOC_ENTRY + run_size)
+	{
+		// the blocks that weren't needed are still a run
+		addRun(rest_offset, run_size - SIZEOF_SCRIPT_ALLOC_ENTRY - block_size);
+	}
+
+	entry.mType = type;
+	entry.mReferenceCount = 1;
+	offset = current_offset;
+	alloc_entry2bytestream(mBuffer, offset, entry);
+	return current_offset;
+}
+
+// The freed block stays a block of its own in the chain, as it always has,
+// but joins the runs either side of it.
+void LLScriptHeapFreeList::release(S32 offset)
+{
+	LLScriptAllocEntry entry;
+	S32 read_offset = offset;
+	bytestream2alloc_entry(entry, mBuffer, read_offset);
+	mBlocks[offset] = entry.mSize;
+
+	S32 run_offset = offset;
+	S32 run_size = entry.mSize;
+	block_map_t::iterator next = mRuns.find(offset + SIZEOF_SCRIPT_ALLOC_ENTRY + entry.mSize);
+	if (next != mRuns.end())
+	{
+		run_size += next->second + SIZEOF_SCRIPT_ALLOC_ENTRY;
+		removeRun(next->first);
+	}
+
+	block_map_t::iterator prev = mRuns.lower_bound(offset);
+	if (prev != mRuns.begin())
+	{
+		--prev;
+		if (prev->first + SIZEOF_SCRIPT_ALLOC_ENTRY + prev->second == offset)
+		{
+			run_offset = prev->first;
+			run_size += prev->second + SIZEOF_SCRIPT_ALLOC_ENTRY;
+			removeRun(run_offset);
+		}
+	}
+	addRun(run_offset, run_size);
+}
+
 
 // adding to heap
 //	if block is empty
@@ -113,49 +441,13 @@ S32 lsa_heap_top(U8 *heap_start, S32 maxtop)
 //			move to next block
 //			go to start of algorithm
 
-S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_delete)
+// the original first fit search, for heaps without an LLScriptHeapFreeList
+static S32 lsa_heap_walk_for_block(U8 *buffer, U8 type, S32 size, S32 heapsize)
 {
-	if (get_register(buffer, LREG_FR))
-		return 1;
 	LLScriptAllocEntry entry, nextentry;
 	S32 hr = get_register(buffer, LREG_HR);
 	S32 hp = get_register(buffer, LREG_HP);
 	S32 current_offset, next_offset, offset = hr;
-	S32 size = 0;
-
-	switch(data->mType)
-	{
-	case LST_INTEGER:
-		size = 4;
-		break;
-	case LST_FLOATINGPOINT:
-		size = 4;
-		break;
-	case LST_KEY:
-	        // NOTE: babbage: defensive as some library calls set data to NULL
-	        size = data->mKey ? (S32)strlen(data->mKey) + 1 : 1; /*Flawfinder: ignore*/
-		break;
-	case LST_STRING:
-                // NOTE: babbage: defensive as some library calls set data to NULL
-            	size = data->mString ? (S32)strlen(data->mString) + 1 : 1; /*Flawfinder: ignore*/
-		break;
-	case LST_LIST:
-		//	list data		4 bytes of number of entries followed by number of pointer
-		size = 4 + 4*data->getListLength();
-		if (data->checkForMultipleLists())
-		{
-			set_fault(buffer, LSRF_NESTING_LISTS);
-		}
-		break;
-	case LST_VECTOR:
-		size = 12;
-		break;
-	case LST_QUATERNION:
-		size = 16;
-		break;
-	default:
-		break;
-	}
 
 	current_offset = offset;
 	bytestream2alloc_entry(entry, buffer, offset);
@@ -169,45 +461,29 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 			{
 				offset = current_offset;
 				lsa_split_block(buffer, offset, size, entry);
-				entry.mType = data->mType;
-				entry.mSize = size;
-				entry.mReferenceCount = 1;
-				offset = current_offset;
-				alloc_entry2bytestream(buffer, offset, entry);
-				lsa_insert_data(buffer, offset, data, entry, heapsize);
-				hp = get_register(buffer, LREG_HP);
 				S32 new_hp = current_offset + size + 2*SIZEOF_SCRIPT_ALLOC_ENTRY;
 				if (new_hp >= hr + heapsize)
 				{
 					break;
 				}
+				entry.mType = type;
+				entry.mSize = size;
+				entry.mReferenceCount = 1;
+				offset = current_offset;
+				alloc_entry2bytestream(buffer, offset, entry);
 				if (new_hp > hp)
 				{
 					set_register(buffer, LREG_HP, new_hp);
-					hp = get_register(buffer, LREG_HP);
 				}
-				if (b_delete)
-					delete data;
-	// this bit of nastiness is to get around that code paths to local variables can result in lack of initialization
-	// and function clean up of ref counts isn't based on scope (a mistake, I know)
-				if (current_offset <= hp)
-					return current_offset - hr + 1;
-				else
-					return hp - hr + 1;
+				return current_offset;
 			}
 			else if (entry.mSize >= size)
 			{
-				entry.mType = data->mType;
+				entry.mType = type;
 				entry.mReferenceCount = 1;
 				offset = current_offset;
 				alloc_entry2bytestream(buffer, offset, entry);
-				lsa_insert_data(buffer, offset, data, entry, heapsize);
-				hp = get_register(buffer, LREG_HP);
-				if (b_delete)
-					delete data;
-	// this bit of nastiness is to get around that code paths to local variables can result in lack of initialization
-	// and function clean up of ref counts isn't based on scope (a mistake, I know)
-				return current_offset - hr + 1;
+				return current_offset;
 			}
 		}
 		offset += entry.mSize;
@@ -246,11 +522,85 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 			break;
 		}
 	} while (1);
-	set_fault(buffer, LSRF_STACK_HEAP_COLLISION);
-	reset_hp_to_safe_spot(buffer);
+	return 0;
+}
+
+// Finds room for a block with size bytes of data and writes its header.
+// Returns the header's offset, or 0 after setting a stack-heap collision.
+static S32 lsa_heap_alloc_block(U8 *buffer, U8 type, S32 size, S32 heapsize)
+{
+	S32 block;
+	LLScriptHeapFreeList *free_list = LLScriptHeapFreeList::getInstance(buffer);
+	if (free_list)
+	{
+		block = free_list->allocate(type, size, heapsize);
+	}
+	else
+	{
+		block = lsa_heap_walk_for_block(buffer, type, size, heapsize);
+	}
+
+	if (!block)
+	{
+		set_fault(buffer, LSRF_STACK_HEAP_COLLISION);
+		reset_hp_to_safe_spot(buffer);
+	}
+	return block;
+}
+
+S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_delete)
+{
+	if (get_register(buffer, LREG_FR))
+		return 1;
+	S32 hr = get_register(buffer, LREG_HR);
+	S32 size = 0;
+
+	switch(data->mType)
+	{
+	case LST_INTEGER:
+		size = 4;
+		break;
+	case LST_FLOATINGPOINT:
+		size = 4;
+		break;
+	case LST_KEY:
+	        // NOTE: babbage: defensive as some library calls set data to NULL
+	        size = data->mKey ? (S32)strlen(data->mKey) + 1 : 1; /*Flawfinder: ignore*/
+		break;
+	case LST_STRING:
+                // NOTE: babbage: defensive as some library calls set data to NULL
+            	size = data->mString ? (S32)strlen(data->mString) + 1 : 1; /*Flawfinder: ignore*/
+		break;
+	case LST_LIST:
+		//	list data		4 bytes of number of entries followed by number of pointer
+		size = 4 + 4*data->getListLength();
+		if (data->checkForMultipleLists())
+		{
+			set_fault(buffer, LSRF_NESTING_LISTS);
+		}
+		break;
+	case LST_VECTOR:
+		size = 12;
+		break;
+	case LST_QUATERNION:
+		size = 16;
+		break;
+	default:
+		break;
+	}
+
+	S32 current_offset = lsa_heap_alloc_block(buffer, data->mType, size, heapsize);
+	if (current_offset)
+	{
+		LLScriptAllocEntry entry(size, data->mType);
+		S32 offset = current_offset + SIZEOF_SCRIPT_ALLOC_ENTRY;
+		lsa_insert_data(buffer, offset, data, entry, heapsize);
+	}
 	if (b_delete)
 		delete data;
-	return 0;
+	// this bit of nastiness is to get around that code paths to local variables can result in lack of initialization
+	// and function clean up of ref counts isn't based on scope (a mistake, I know)
+	return current_offset ? current_offset - hr + 1 : 0;
 }
 
 // split block
@@ -504,6 +854,7 @@ void lsa_decrease_ref_count(U8 *buffer, S32 offset)
 	bytestream2alloc_entry(entry, buffer, offset);
 
 	entry.mReferenceCount--;
+	BOOL b_freed = FALSE;
 
 	if (entry.mReferenceCount < 0)
 	{
@@ -512,6 +863,7 @@ void lsa_decrease_ref_count(U8 *buffer, S32 offset)
 	}
 	else if (!entry.mReferenceCount)
 	{
+		b_freed = entry.mType != LST_NULL;
 		if (entry.mType == LST_LIST)
 		{
 			S32 i, num = bytestream2integer(buffer, offset);
@@ -524,7 +876,15 @@ void lsa_decrease_ref_count(U8 *buffer, S32 offset)
 		entry.mType = LST_NULL;
 	}
 
+	// an index that has to be re-read must still see this block in use
+	LLScriptHeapFreeList *free_list = b_freed ? LLScriptHeapFreeList::getInstance(buffer) : NULL;
+	S32 block_offset = orig_offset;
 	alloc_entry2bytestream(buffer, orig_offset, entry);
+
+	if (free_list)
+	{
+		free_list->release(block_offset);
+	}
 }
 
 char gLSAStringRead[TOP_OF_MEMORY];		/*Flawfinder: ignore*/
@@ -660,72 +1020,70 @@ LLScriptLibData *lsa_get_list_ptr(U8 *buffer, S32 &offset, BOOL b_dec_ref)
 	return tip;
 }
 
-S32 lsa_cat_strings(U8 *buffer, S32 offset1, S32 offset2, S32 heapsize)
+// Finds the block of the string or key at address, returning its data
+// offset and the length of the text, or -1 after setting a fault.
+static S32 lsa_find_string(U8 *buffer, S32 address, S32 &length)
 {
-	if (get_register(buffer, LREG_FR))
-		return 0;
-	LLScriptLibData *string1;
-	LLScriptLibData *string2;
-	if (offset1 != offset2)
-	{
-		string1 = lsa_get_data(buffer, offset1, TRUE);
-		string2 = lsa_get_data(buffer, offset2, TRUE);
-	}
-	else
+	S32 offset = address + get_register(buffer, LREG_HR) - 1;
+	if (  (offset < get_register(buffer, LREG_HR))
+		||(offset >= get_register(buffer, LREG_HP)))
 	{
-		string1 = lsa_get_data(buffer, offset1, TRUE);
-		string2 = lsa_get_data(buffer, offset2, TRUE);
+		set_fault(buffer, LSRF_BOUND_CHECK_ERROR);
+		return -1;
 	}
-
-	if (  (!string1)
-		||(!string2))
+	LLScriptAllocEntry entry;
+	bytestream2alloc_entry(entry, buffer, offset);
+	if (  (entry.mType != LST_STRING)
+		&&(entry.mType != LST_KEY))
 	{
 		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete string1;
-		delete string2;
-		return 0;
+		return -1;
 	}
 
-	char *test1 = NULL, *test2 = NULL;
+	// a reused block can be bigger than the string in it
+	S32 max_length = llmin(entry.mSize, MAX_HEAP_SIZE - offset);
+	const U8 *end = (const U8 *)memchr(buffer + offset, 0, max_length);
+	length = end ? (S32)(end - (buffer + offset)) : max_length;
+	return offset;
+}
 
-	if (string1->mType == LST_STRING)
-	{
-		test1 = string1->mString;
-	}
-	else if (string1->mType == LST_KEY)
-	{
-		test1 = string1->mKey;
-	}
-	if (string2->mType == LST_STRING)
-	{
-		test2 = string2->mString;
-	}
-	else if (string2->mType == LST_KEY)
+S32 lsa_cat_strings(U8 *buffer, S32 offset1, S32 offset2, S32 heapsize)
+{
+	if (get_register(buffer, LREG_FR))
+		return 0;
+
+	S32 length1, length2;
+	S32 text1 = lsa_find_string(buffer, offset1, length1);
+	S32 text2 = lsa_find_string(buffer, offset2, length2);
+	if (  (text1 < 0)
+		||(text2 < 0))
 	{
-		test2 = string2->mKey;
+		return 0;
 	}
-
-	if (  (!test1)
-		||(!test2))
+	if (length1 + length2 >= (S32)sizeof(gLSAStringRead))
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete string1;
-		delete string2;
+		set_fault(buffer, LSRF_STACK_HEAP_COLLISION);
+		reset_hp_to_safe_spot(buffer);
 		return 0;
 	}
 
-	S32 size = (S32)strlen(test1) + (S32)strlen(test2) + 1;			/*Flawfinder: ignore*/
+	// join them outside the heap, so the operands can be released first
+	// and the result can reuse their space, as it always could
+	memcpy(gLSAStringRead, buffer + text1, length1);			/*Flawfinder: ignore*/
+	memcpy(gLSAStringRead + length1, buffer + text2, length2);	/*Flawfinder: ignore*/
+	gLSAStringRead[length1 + length2] = 0;
 
-	LLScriptLibData *string3 = new LLScriptLibData;
-	string3->mType = LST_STRING;
-	string3->mString = new char[size];
-	strcpy(string3->mString, test1);			/*Flawfinder: ignore*/
-	strcat(string3->mString, test2);			/*Flawfinder: ignore*/
+	lsa_decrease_ref_count(buffer, offset1);
+	lsa_decrease_ref_count(buffer, offset2);
 
-	delete string1;
-	delete string2;
-
-	return lsa_heap_add_data(buffer, string3, heapsize, TRUE);
+	S32 size = length1 + length2 + 1;
+	S32 block = lsa_heap_alloc_block(buffer, LST_STRING, size, heapsize);
+	if (!block)
+	{
+		return 0;
+	}
+	memcpy(buffer + block + SIZEOF_SCRIPT_ALLOC_ENTRY, gLSAStringRead, size);	/*Flawfinder: ignore*/
+	return block - get_register(buffer, LREG_HR) + 1;
 }
 
 S32 lsa_cmp_strings(U8 *buffer, S32 offset1, S32 offset2)
@@ -0,0 +1,146 @@
+#!/usr/bin/env python
+# @file generate_settings_handles.py
+# @brief Generate typed LLControlHandles for every setting in settings.xml.
+#
+# $LicenseInfo:firstyear=2010&license=viewergpl$
+#
+# Copyright (c) 2010, Linden Research, Inc.
+#
+# Second Life Viewer Source Code
+# The source code in this file ("Source Code") is provided by Linden Lab
+# to you under the terms of the GNU General Public License, version 2.0
+# ("GPL"), unless you have obtained a separate licensing agreement
+# ("Other License"), formally executed by you and Linden Lab.  Terms of
+# the GPL can be found in doc/GPL-license.txt in this distribution, or
+# online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+#
+# There are special exceptions to the terms and conditions of the GPL as
+# it is applied to this Source Code. View the full text of the exception
+# in the file doc/FLOSS-exception.txt in this software distribution, or
+# online at
+# http://secondlifegrid.net/programs/open_source/licensing/flossexception
+#
+# By copying, modifying or distributing this software, you acknowledge
+# that you have read and understood your obligations described above,
+# and agree to abide by those obligations.
+#
+# ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+# WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+# COMPLETENESS OR PERFORMANCE.
+# $/LicenseInfo$
+
+"""\
+Usage: generate_settings_handles.py settings.xml output.h output.cpp
+
+Writes a header with one LLControlHandle constant per setting, in the
+LLSavedSettings namespace, and a source file with the tables that
+LLControlGroup::bindHandles() looks them up with. Files named in the
+settings file's Include array are read too, as LLControlGroup does.
+"""
+
+import os, re, sys
+from xml.dom.minidom import parse
+
+# settings.xml type names, as in LLControlGroup::typeStringToEnum()
+TYPES = {
+    'U32' : 'TYPE_U32',
+    'S32' : 'TYPE_S32',
+    'F32' : 'TYPE_F32',
+    'Boolean' : 'TYPE_BOOLEAN',
+    'String' : 'TYPE_STRING',
+    'Vector3' : 'TYPE_VEC3',
+    'Vector3D' : 'TYPE_VEC3D',
+    'Rect' : 'TYPE_RECT',
+    'Color4' : 'TYPE_COL4',
+    'Color3' : 'TYPE_COL3',
+    'Color4u' : 'TYPE_COL4U',
+    'LLSD' : 'TYPE_LLSD',
+    }
+
+def elements(node):
+    return [child for child in node.childNodes if child.nodeType == child.ELEMENT_NODE]
+
+def text(node):
+    return ''.join([child.data for child in node.childNodes if child.nodeType == child.TEXT_NODE]).strip()
+
+def read_settings(filename, settings, seen_names, seen_files):
+    if filename in seen_files:
+        return
+    seen_files.add(filename)
+    top = elements(parse(filename).documentElement)[0]
+    children = elements(top)
+    for key, value in zip(children[0::2], children[1::2]):
+        name = text(key)
+        if name == 'Include':
+            for include in elements(value):
+                read_settings(os.path.join(os.path.dirname(filename), text(include)), settings, seen_names, seen_files)
+            continue
+        fields = elements(value)
+        for field, field_value in zip(fields[0::2], fields[1::2]):
+            if text(field) == 'Type':
+                # the first declaration wins, as it does at run time
+                if name not in seen_names:
+                    seen_names.add(name)
+                    settings.append((name, TYPES[text(field_value)]))
+                break
+
+def identifier(name):
+    return re.sub(r'[^A-Za-z0-9_]', '_', name)
+
+def write(filename, contents):
+    # always written, even if nothing changed, so that the outputs end up
+    # newer than the settings files and the build doesn't run this again
+    open(filename, 'w').write(contents)
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__)
+        return 1
+    settings_name, header_name, source_name = sys.argv[1:]
+
+    settings = []
+    read_settings(os.path.abspath(settings_name), settings, set(), set())
+
+    header = ['// Generated from %s by generate_settings_handles.py, do not edit.' % os.path.basename(settings_name),
+              '',
+              '#ifndef LL_LLVIEWERSETTINGSHANDLES_H',
+              '#define LL_LLVIEWERSETTINGSHANDLES_H',
+              '',
+              '#include "llcontrol.h"',
+              '',
+              'namespace LLSavedSettings',
+              '{']
+    for index, (name, type) in enumerate(settings):
+        header.append('\tconst LLControlHandle<%s> %s = { %d };' % (type, identifier(name), index))
+    header += ['',
+               '\tconst S32 COUNT = %d;' % len(settings),
+               '\textern const char* const sNames[COUNT];',
+               '\textern const eControlType sTypes[COUNT];',
+               '}',
+               '',
+               '#endif',
+               '']
+
+    source = ['// Generated from %s by generate_settings_handles.py, do not edit.' % os.path.basename(settings_name),
+              '',
+              '#include "llviewerprecompiledheaders.h"',
+              '',
+              '#include "llviewersettingshandles.h"',
+              '',
+              'const char* const LLSavedSettings::sNames[LLSavedSettings::COUNT] =',
+              '{']
+    source += ['\t"%s",' % name for name, type in settings]
+    source += ['};',
+               '',
+               'const eControlType LLSavedSettings::sTypes[LLSavedSettings::COUNT] =',
+               '{']
+    source += ['\t%s,' % type for name, type in settings]
+    source += ['};',
+               '']
+
+    write(header_name, '\n'.join(header))
+    write(source_name, '\n'.join(source))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -93,7 +93,9 @@
 #include "llworkerthread.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltexlayerbake.h"
 #include "llimageworker.h"
+#include "lllogchat.h"
 
 // <edit>
 #include "llao.h" //for setting up listener
@@ -110,6 +112,8 @@
 #include "llpolymesh.h"
 #include "llcachename.h"
 #include "llaudioengine.h"
+#include "llaudiodecodethread.h"
+#include "lltaskbatch.h"
 #include "llstreamingaudio.h"
 #include "llviewermenu.h"
 #include "llselectmgr.h"
@@ -158,6 +162,8 @@
 
 // includes for idle() idleShutdown()
 #include "llviewercontrol.h"
+#include "llviewersettingshandles.h"
+#include "llxmlcache.h"
 #include "lleventnotifier.h"
 #include "llcallbacklist.h"
 #include "pipeline.h"
@@ -608,6 +614,12 @@ bool LLAppViewer::init()
 	gDirUtilp->setSkinFolder("default");
 
 	initLogging();
+
+	// Parsed copies of settings and XUI files. This has to be set up before
+	// the default settings are read, so it can't follow CacheLocation.
+	std::string cache_dir = gDirUtilp->getCacheDir(true);
+	LLFile::mkdir(cache_dir);
+	LLXMLCache::setCacheDir(cache_dir + gDirUtilp->getDirDelimiter() + "xmlcache");
 	
 	// <edit>
 	gDeleteScheduler = new LLDeleteScheduler();
@@ -1071,6 +1083,8 @@ bool LLAppViewer::mainLoop()
  					work_pending += LLAppViewer::getTextureCache()->update(1); // unpauses the texture cache thread
  					work_pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
  					work_pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+					work_pending += LLTexLayerBakeThread::updateClass(1); // unpauses the avatar bake threads
+					work_pending += LLAudioDecodeThread::updateClass(1); // unpauses the sound decode threads
 					io_pending += LLVFSThread::updateClass(1);
 					io_pending += LLLFSThread::updateClass(1);
 					if (io_pending > 1000)
@@ -1424,6 +1438,8 @@ bool LLAppViewer::cleanup()
 		pending += LLAppViewer::getTextureCache()->update(1); // unpauses the worker thread
 		pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+		pending += LLTexLayerBakeThread::updateClass(0);
+		pending += LLAudioDecodeThread::updateClass(0);
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
 		if (pending == 0)
@@ -1439,6 +1455,10 @@ bool LLAppViewer::cleanup()
 	
 	// Delete workers first
 	// shotdown all worker threads before deleting them in case of co-dependencies
+	LLLogChat::cleanupClass();
+	LLTexLayerBakeThread::cleanupClass();
+	LLAudioDecodeThread::cleanupClass();
+	LLTaskBatchThread::cleanupClass();
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
 	sImageDecodeThread->shutdown();
@@ -1558,6 +1578,26 @@ bool LLAppViewer::initThreads()
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
 	LLImage::initClass();
 
+	// Avatar bakes composited on the CPU (AvatarBakeOnCPU)
+	LLTexLayerBakeThread::initClass(gSavedSettings.getS32("AvatarBakeThreads"), enable_threads && true);
+
+	// Vorbis sound decoding
+	LLAudioDecodeThread::initClass(gSavedSettings.getS32("AudioDecodeThreads"), enable_threads && true);
+
+	// Helpers for octree frustum culling and volume face geometry generation,
+	// one pool big enough for whichever wants more
+	S32 cull_helpers = gSavedSettings.getS32("RenderCullThreads");
+	S32 rebuild_helpers = gSavedSettings.getS32("RenderRebuildThreads");
+	LLTaskBatchThread::initClass(llmax(cull_helpers, rebuild_helpers), enable_threads && true);
+	LLSpatialCullBatch::initClass(cull_helpers);
+	LLVolumeGeometryBatch::initClass(rebuild_helpers);
+
+	// Chat and IM transcripts
+	if (enable_threads)
+	{
+		LLLogChat::initClass();
+	}
+
 	// *FIX: no error handling here!
 	return true;
 }
@@ -1762,6 +1802,10 @@ bool LLAppViewer::initConfiguration()
 	//Signals will be shared between linked vars.
 	gSavedSettings.connectCOAVars(gSavedPerAccountSettings);
 
+	// look up the generated LLSavedSettings handles once, now that every
+	// setting has been declared
+	gSavedSettings.bindHandles(LLSavedSettings::sNames, LLSavedSettings::sTypes, LLSavedSettings::COUNT);
+
 	// - set procedural settings 
 	gSavedSettings.setString("ClientSettingsFile", 
         gDirUtilp->getExpandedFilename(LL_PATH_USER_SETTINGS, getSettingsFilename("Default", "Global")));
@@ -577,7 +577,8 @@ void LLFloaterCompileQueue::compile(const std::string& filename,
 	const BOOL compile_to_mono = FALSE;
 	if(!lscript_compile(filename.c_str(), dst_filename.c_str(),
 						err_filename.c_str(), compile_to_mono,
-						uuid_string.c_str(), gAgent.isGodlike()))
+						uuid_string.c_str(), gAgent.isGodlike(),
+						gSavedSettings.getBOOL("LSLOptimize")))
 	{
 		llwarns << "compile failed" << llendl;
 		removeItemByItemID(item_id);
@@ -38,6 +38,7 @@
 
 #include "llviewercontrol.h"
 #include "llvolume.h"
+#include "llvolumexform.h"
 #include "m3math.h"
 #include "v3color.h"
 
@@ -900,6 +901,22 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 							   const S32 &f,
 								const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
 								const U16 &index_offset)
+{
+	LLFaceGeometryJob job;
+	if (!setupGeometryJob(volume, f, mat_vert, mat_normal, index_offset, job))
+	{
+		return FALSE;
+	}
+
+	job.mapDestination();
+	job.build();
+	return TRUE;
+}
+
+BOOL LLFace::setupGeometryJob(const LLVolume& volume,
+							   const S32 &f,
+								const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
+								const U16 &index_offset, LLFaceGeometryJob& job)
 {
 	const LLVolumeFace &vf = volume.getVolumeFace(f);
 	S32 num_vertices = (S32)vf.mVertices.size();
@@ -920,13 +937,13 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		}
 	}
 
-	LLStrider<LLVector3> vertices;
-	LLStrider<LLVector2> tex_coords;
-	LLStrider<LLVector2> tex_coords2;
-	LLStrider<LLVector3> normals;
-	LLStrider<LLColor4U> colors;
-	LLStrider<LLVector3> binormals;
-	LLStrider<U16> indicesp;
+	job.mFace = this;
+	job.mVolumeFace = &vf;
+	job.mNumVertices = num_vertices;
+	job.mNumIndices = num_indices;
+	job.mIndexOffset = index_offset;
+	job.mMatVert = mat_vert;
+	job.mMatNormal = mat_normal;
 
 	BOOL full_rebuild = mDrawablep->isState(LLDrawable::REBUILD_VOLUME);
 	
@@ -940,6 +957,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	{
 		scale = mVObjp->getScale();
 	}
+	job.mScale = scale;
 	
 	BOOL rebuild_pos = full_rebuild || mDrawablep->isState(LLDrawable::REBUILD_POSITION);
 	BOOL rebuild_color = full_rebuild || mDrawablep->isState(LLDrawable::REBUILD_COLOR);
@@ -950,39 +968,19 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	const LLTextureEntry *tep = mVObjp->getTE(f);
 	U8  bump_code = tep ? tep->getBumpmap() : 0;
 
-	if (rebuild_pos)
-	{
-		mVertexBuffer->getVertexStrider(vertices, mGeomIndex);
-	}
-	if (rebuild_normal)
-	{
-		mVertexBuffer->getNormalStrider(normals, mGeomIndex);
-	}
-	if (rebuild_binormal)
-	{
-		mVertexBuffer->getBinormalStrider(binormals, mGeomIndex);
-	}
-
-	if (rebuild_tcoord)
-	{
-		mVertexBuffer->getTexCoord0Strider(tex_coords, mGeomIndex);
-		if (bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
-		{
-			mVertexBuffer->getTexCoord1Strider(tex_coords2, mGeomIndex);
-		}
-	}
-	if (rebuild_color)
-	{	
-		mVertexBuffer->getColorStrider(colors, mGeomIndex);
-	}
+	job.mRebuildIndices = full_rebuild;
+	job.mRebuildPos = rebuild_pos;
+	job.mRebuildNormal = rebuild_normal;
+	job.mRebuildBinormal = rebuild_binormal;
+	job.mRebuildTCoord = rebuild_tcoord;
+	job.mRebuildTCoord2 = rebuild_tcoord && bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1);
+	job.mRebuildColor = rebuild_color;
 
 	F32 r = 0, os = 0, ot = 0, ms = 0, mt = 0, cos_ang = 0, sin_ang = 0;
 	
 	BOOL is_static = mDrawablep->isStatic();
 	BOOL is_global = is_static;
 
-	LLVector3 center_sum(0.f, 0.f, 0.f);
-	
 	if (is_global)
 	{
 		setState(GLOBAL);
@@ -992,10 +990,6 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		clearState(GLOBAL);
 	}
 
-	LLVector2 tmin, tmax;
-	
-	
-
 	if (rebuild_tcoord)
 	{
 		if (tep)
@@ -1045,6 +1039,18 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		}
 	}
 
+	job.mCosAng = cos_ang;
+	job.mSinAng = sin_ang;
+	job.mOffsetS = os;
+	job.mOffsetT = ot;
+	job.mScaleS = ms;
+	job.mScaleT = mt;
+	job.mUseTextureMatrix = tex_mode && mTextureMatrix;
+	if (job.mUseTextureMatrix)
+	{
+		job.mTextureMatrix = *mTextureMatrix;
+	}
+
 	LLColor4U color = tep->getColor();
 
 	if (rebuild_color)
@@ -1062,27 +1068,15 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			color.mV[3] = U8 (alpha[tep->getShiny()] * 255);
 		}
 	}
-
-    // INDICES
-	if (full_rebuild)
-	{
-		mVertexBuffer->getIndexStrider(indicesp, mIndicesIndex);
-		for (U16 i = 0; i < num_indices; i++)
-		{
-			*indicesp++ = vf.mIndices[i] + index_offset;
-		}
-	}
-	
+	job.mColor = color;
 	
 	//bump setup
-	LLVector3 binormal_dir( -sin_ang, cos_ang, 0 );
-	LLVector3 bump_s_primary_light_ray;
-	LLVector3 bump_t_primary_light_ray;
+	job.mBinormalDir.setVec(-sin_ang, cos_ang, 0);
 
-	LLQuaternion bump_quat;
-	if (mDrawablep->isActive())
+	job.mUseBumpQuat = mDrawablep->isActive();
+	if (job.mUseBumpQuat)
 	{
-		bump_quat = LLQuaternion(mDrawablep->getRenderMatrix());
+		job.mBumpQuat = LLQuaternion(mDrawablep->getRenderMatrix());
 	}
 	
 	if (bump_code)
@@ -1129,8 +1123,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		LLVector3   moon_ray = gSky.getMoonDirection();
 		LLVector3& primary_light_ray = (sun_ray.mV[VZ] > 0) ? sun_ray : moon_ray;
 
-		bump_s_primary_light_ray = offset_multiple * s_scale * primary_light_ray;
-		bump_t_primary_light_ray = offset_multiple * t_scale * primary_light_ray;
+		job.mBumpSPrimaryLightRay = offset_multiple * s_scale * primary_light_ray;
+		job.mBumpTPrimaryLightRay = offset_multiple * t_scale * primary_light_ray;
 	}
 		
 	U8 texgen = getTextureEntry()->getTexGen();
@@ -1138,20 +1132,136 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	{ //planar texgen needs binormals
 		mVObjp->getVolume()->genBinormals(f);
 	}
+	job.mTexGen = texgen;
+
+	if (rebuild_tcoord)
+	{
+		mTexExtents[0].setVec(0,0);
+		mTexExtents[1].setVec(1,1);
+		xform(mTexExtents[0], cos_ang, sin_ang, os, ot, ms, mt);
+		xform(mTexExtents[1], cos_ang, sin_ang, os, ot, ms, mt);		
+	}
+
+	mLastVertexBuffer = mVertexBuffer;
+	mLastGeomCount = mGeomCount;
+	mLastGeomIndex = mGeomIndex;
+	mLastIndicesCount = mIndicesCount;
+	mLastIndicesIndex = mIndicesIndex;
+
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// LLFaceGeometryJob
+//-----------------------------------------------------------------------------
+
+LLFaceGeometryJob::LLFaceGeometryJob()
+:	mFace(NULL),
+	mVolumeFace(NULL),
+	mNumVertices(0),
+	mNumIndices(0),
+	mIndexOffset(0),
+	mRebuildIndices(FALSE),
+	mRebuildPos(FALSE),
+	mRebuildNormal(FALSE),
+	mRebuildBinormal(FALSE),
+	mRebuildTCoord(FALSE),
+	mRebuildTCoord2(FALSE),
+	mRebuildColor(FALSE),
+	mTexGen(LLTextureEntry::TEX_GEN_DEFAULT),
+	mUseTextureMatrix(FALSE),
+	mCosAng(1.f), mSinAng(0.f), mOffsetS(0.f), mOffsetT(0.f), mScaleS(1.f), mScaleT(1.f),
+	mUseBumpQuat(FALSE)
+{
+}
+
+void LLFaceGeometryJob::mapDestination()
+{
+	LLVertexBuffer* buffer = mFace->mVertexBuffer;
+	S32 geom_index = mFace->getGeomIndex();
+
+	if (mRebuildIndices)
+	{
+		buffer->getIndexStrider(mIndices, mFace->getIndicesStart());
+	}
+	if (mRebuildPos)
+	{
+		buffer->getVertexStrider(mVertices, geom_index);
+	}
+	if (mRebuildNormal)
+	{
+		buffer->getNormalStrider(mNormals, geom_index);
+	}
+	if (mRebuildBinormal)
+	{
+		buffer->getBinormalStrider(mBinormals, geom_index);
+	}
+	if (mRebuildTCoord)
+	{
+		buffer->getTexCoord0Strider(mTexCoords, geom_index);
+	}
+	if (mRebuildTCoord2)
+	{
+		buffer->getTexCoord1Strider(mTexCoords2, geom_index);
+	}
+	if (mRebuildColor)
+	{	
+		buffer->getColorStrider(mColors, geom_index);
+	}
+}
 
-	for (S32 i = 0; i < num_vertices; i++)
+template <class T>
+static void stage_array(BOOL rebuild, S32 count, std::vector<T>& staged, LLStrider<T>& strider)
+{
+	if (rebuild && count > 0)
 	{
-		if (rebuild_tcoord)
+		staged.resize(count);
+		strider = &staged[0];
+	}
+}
+
+void LLFaceGeometryJob::stage()
+{
+	stage_array(mRebuildIndices, mNumIndices, mStagedIndices, mIndices);
+	stage_array(mRebuildPos, mNumVertices, mStagedVertices, mVertices);
+	stage_array(mRebuildNormal, mNumVertices, mStagedNormals, mNormals);
+	stage_array(mRebuildBinormal, mNumVertices, mStagedBinormals, mBinormals);
+	stage_array(mRebuildTCoord, mNumVertices, mStagedTexCoords, mTexCoords);
+	stage_array(mRebuildTCoord2, mNumVertices, mStagedTexCoords2, mTexCoords2);
+	stage_array(mRebuildColor, mNumVertices, mStagedColors, mColors);
+}
+
+void LLFaceGeometryJob::build()
+{
+	const LLVolumeFace& vf = *mVolumeFace;
+
+    // INDICES
+	if (mRebuildIndices)
+	{
+		LLStrider<U16> indicesp = mIndices;
+		for (U16 i = 0; i < mNumIndices; i++)
+		{
+			*indicesp++ = vf.mIndices[i] + mIndexOffset;
+		}
+	}
+
+	LLStrider<LLVector2> tex_coords = mTexCoords;
+	LLStrider<LLVector2> tex_coords2 = mTexCoords2;
+	LLStrider<LLColor4U> colors = mColors;
+
+	for (S32 i = 0; i < mNumVertices; i++)
+	{
+		if (mRebuildTCoord)
 		{
 			LLVector2 tc = vf.mVertices[i].mTexCoord;
 		
-			if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
+			if (mTexGen != LLTextureEntry::TEX_GEN_DEFAULT)
 			{
 				LLVector3 vec = vf.mVertices[i].mPosition; 
 			
-				vec.scaleVec(scale);
+				vec.scaleVec(mScale);
 
-				switch (texgen)
+				switch (mTexGen)
 				{
 					case LLTextureEntry::TEX_GEN_PLANAR:
 						planarProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
@@ -1167,82 +1277,76 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 				}		
 			}
 
-			if (tex_mode && mTextureMatrix)
+			if (mUseTextureMatrix)
 			{
 				LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-				tmp = tmp * *mTextureMatrix;
+				tmp = tmp * mTextureMatrix;
 				tc.mV[0] = tmp.mV[0];
 				tc.mV[1] = tmp.mV[1];
 			}
 			else
 			{
-				xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
+				xform(tc, mCosAng, mSinAng, mOffsetS, mOffsetT, mScaleS, mScaleT);
 			}
 
 			*tex_coords++ = tc;
 		
-			if (bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
+			if (mRebuildTCoord2)
 			{
 				LLVector3 tangent = vf.mVertices[i].mBinormal % vf.mVertices[i].mNormal;
 
 				LLMatrix3 tangent_to_object;
 				tangent_to_object.setRows(tangent, vf.mVertices[i].mBinormal, vf.mVertices[i].mNormal);
-				LLVector3 binormal = binormal_dir * tangent_to_object;
-				binormal = binormal * mat_normal;
+				LLVector3 binormal = mBinormalDir * tangent_to_object;
+				binormal = binormal * mMatNormal;
 				
-				if (mDrawablep->isActive())
+				if (mUseBumpQuat)
 				{
-					binormal *= bump_quat;
+					binormal *= mBumpQuat;
 				}
 
 				binormal.normVec();
-				tc += LLVector2( bump_s_primary_light_ray * tangent, bump_t_primary_light_ray * binormal );
+				tc += LLVector2( mBumpSPrimaryLightRay * tangent, mBumpTPrimaryLightRay * binormal );
 				
 				*tex_coords2++ = tc;
 			}	
 		}
 			
-		if (rebuild_pos)
-		{
-			*vertices++ = vf.mVertices[i].mPosition * mat_vert;
-		}
-		
-		if (rebuild_normal)
+		if (mRebuildColor)
 		{
-			LLVector3 normal = vf.mVertices[i].mNormal * mat_normal;
-			normal.normVec();
-			
-			*normals++ = normal;
-		}
-		
-		if (rebuild_binormal)
-		{
-			LLVector3 binormal = vf.mVertices[i].mBinormal * mat_normal;
-			binormal.normVec();
-			*binormals++ = binormal;
-		}
-		
-		if (rebuild_color)
-		{
-			*colors++ = color;		
+			*colors++ = mColor;		
 		}
 	}
 
-	if (rebuild_tcoord)
+	if (mNumVertices > 0 && (mRebuildPos || mRebuildNormal || mRebuildBinormal))
 	{
-		mTexExtents[0].setVec(0,0);
-		mTexExtents[1].setVec(1,1);
-		xform(mTexExtents[0], cos_ang, sin_ang, os, ot, ms, mt);
-		xform(mTexExtents[1], cos_ang, sin_ang, os, ot, ms, mt);		
+		LLStrider<LLVector3> none;
+		LLVolumeXform::transform(&vf.mVertices[0], mNumVertices, mMatVert, mMatNormal,
+								 mRebuildPos ? mVertices : none,
+								 mRebuildNormal ? mNormals : none,
+								 mRebuildBinormal ? mBinormals : none);
 	}
+}
 
-	mLastVertexBuffer = mVertexBuffer;
-	mLastGeomCount = mGeomCount;
-	mLastGeomIndex = mGeomIndex;
-	mLastIndicesCount = mIndicesCount;
-	mLastIndicesIndex = mIndicesIndex;
+template <class T>
+static void commit_array(const std::vector<T>& staged, LLStrider<T>& dst)
+{
+	for (typename std::vector<T>::const_iterator iter = staged.begin(); iter != staged.end(); ++iter)
+	{
+		*dst++ = *iter;
+	}
+}
 
-	return TRUE;
+void LLFaceGeometryJob::commit()
+{
+	mapDestination();
+	commit_array(mStagedIndices, mIndices);
+	commit_array(mStagedVertices, mVertices);
+	commit_array(mStagedNormals, mNormals);
+	commit_array(mStagedBinormals, mBinormals);
+	commit_array(mStagedTexCoords, mTexCoords);
+	commit_array(mStagedTexCoords2, mTexCoords2);
+	commit_array(mStagedColors, mColors);
 }
 
 const F32 LEAST_IMPORTANCE = 0.05f ;
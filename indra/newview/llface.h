@@ -39,6 +39,7 @@
 #include "v2math.h"
 #include "v3math.h"
 #include "v4math.h"
+#include "m3math.h"
 #include "m4math.h"
 #include "v4coloru.h"
 #include "llquaternion.h"
@@ -49,8 +50,10 @@
 #include "llstat.h"
 #include "lldrawable.h"
 
+class LLFace;
 class LLFacePool;
 class LLVolume;
+class LLVolumeFace;
 class LLViewerImage;
 class LLTextureEntry;
 class LLVertexProgram;
@@ -60,6 +63,79 @@ class LLGeometryManager;
 const F32 MIN_ALPHA_SIZE = 1024.f;
 const F32 MIN_TEX_ANIM_SIZE = 512.f;
 
+// Everything LLFace::getGeometryVolume() needs to fill in a face's vertex
+// data, gathered by LLFace::setupGeometryJob() on the main thread. build()
+// only reads the volume face and the values copied here, so it can run on
+// any thread as long as the volume isn't changed meanwhile. It writes
+// through the striders, which point either straight into the face's vertex
+// buffer (mapDestination()) or at private staging arrays (stage()) that
+// commit() copies into the vertex buffer later on the main thread.
+class LLFaceGeometryJob
+{
+public:
+	LLFaceGeometryJob();
+
+	void mapDestination();
+	void stage();
+	void build();
+	void commit();
+
+	LLFace* getFace() const		{ return mFace; }
+	S32 getNumVertices() const	{ return mNumVertices; }
+
+private:
+	friend class LLFace;
+
+	LLFace* mFace;
+	const LLVolumeFace* mVolumeFace;
+	S32 mNumVertices;
+	S32 mNumIndices;
+	U16 mIndexOffset;
+
+	BOOL mRebuildIndices;
+	BOOL mRebuildPos;
+	BOOL mRebuildNormal;
+	BOOL mRebuildBinormal;
+	BOOL mRebuildTCoord;
+	BOOL mRebuildTCoord2;
+	BOOL mRebuildColor;
+
+	LLMatrix4 mMatVert;
+	LLMatrix3 mMatNormal;
+
+	// texture coordinates
+	U8 mTexGen;
+	LLVector3 mScale;
+	BOOL mUseTextureMatrix;
+	LLMatrix4 mTextureMatrix;
+	F32 mCosAng, mSinAng, mOffsetS, mOffsetT, mScaleS, mScaleT;
+
+	// bump map texture coordinates
+	LLVector3 mBinormalDir;
+	LLVector3 mBumpSPrimaryLightRay;
+	LLVector3 mBumpTPrimaryLightRay;
+	BOOL mUseBumpQuat;
+	LLQuaternion mBumpQuat;
+
+	LLColor4U mColor;
+
+	LLStrider<LLVector3> mVertices;
+	LLStrider<LLVector3> mNormals;
+	LLStrider<LLVector3> mBinormals;
+	LLStrider<LLVector2> mTexCoords;
+	LLStrider<LLVector2> mTexCoords2;
+	LLStrider<LLColor4U> mColors;
+	LLStrider<U16> mIndices;
+
+	std::vector<LLVector3> mStagedVertices;
+	std::vector<LLVector3> mStagedNormals;
+	std::vector<LLVector3> mStagedBinormals;
+	std::vector<LLVector2> mStagedTexCoords;
+	std::vector<LLVector2> mStagedTexCoords2;
+	std::vector<LLColor4U> mStagedColors;
+	std::vector<U16> mStagedIndices;
+};
+
 class LLFace
 {
 public:
@@ -144,6 +220,13 @@ public:
 						const S32 &f,
 						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
 						const U16 &index_offset);
+	// The main thread half of getGeometryVolume(), for filling in the vertex
+	// data elsewhere with an LLFaceGeometryJob. Returns FALSE if the face
+	// doesn't fit in its vertex buffer.
+	BOOL setupGeometryJob(const LLVolume& volume,
+						const S32 &f,
+						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
+						const U16 &index_offset, LLFaceGeometryJob& job);
 
 	// For avatar
 	U16			 getGeometryAvatar(
@@ -88,6 +88,7 @@ static struct ft_display_info ft_display_table[] =
 	{ LLFastTimer::FTM_INVENTORY,			"  Inventory Update",	&LLColor4::purple6, 1 },
 	{ LLFastTimer::FTM_AUTO_SELECT,			"   Open and Select",	&LLColor4::red, 0 },
 	{ LLFastTimer::FTM_FILTER,				"   Filter",			&LLColor4::red2, 0 },
+	{ LLFastTimer::FTM_FILTER_INDEX,		"    Name Index",		&LLColor4::red1, 0 },
 	{ LLFastTimer::FTM_ARRANGE,				"   Arrange",			&LLColor4::red3, 0 },
 	{ LLFastTimer::FTM_REFRESH,				"   Refresh",			&LLColor4::red4, 0 },
 	{ LLFastTimer::FTM_SORT,				"   Sort",				&LLColor4::red5, 0 },
@@ -155,6 +156,8 @@ static struct ft_display_info ft_display_table[] =
 	{ LLFastTimer::FTM_REBUILD_OCCLUSION_VB,"    Occlusion",		&LLColor4::cyan5, 0 },
 	{ LLFastTimer::FTM_REBUILD_VBO,			"    VBO Rebuild",	&LLColor4::red4, 0 },
 	{ LLFastTimer::FTM_REBUILD_VOLUME_VB,	"     Volume",		&LLColor4::blue1, 0 },
+	{ LLFastTimer::FTM_REBUILD_VOLUME_GEN,	"      Generate",	&LLColor4::blue2, 0 },
+	{ LLFastTimer::FTM_REBUILD_VOLUME_COMMIT,"      Commit",		&LLColor4::blue3, 0 },
 //	{ LLFastTimer::FTM_REBUILD_NONE_VB,		"      Unknown",	&LLColor4::cyan5, 0 },
 //	{ LLFastTimer::FTM_REBUILD_BRIDGE_VB,	"     Bridge",		&LLColor4::blue2, 0 },
 //	{ LLFastTimer::FTM_REBUILD_HUD_VB,		"     HUD",			&LLColor4::blue3, 0 },
@@ -226,6 +229,7 @@ LLFastTimerView::LLFastTimerView(const std::string& name, const LLRect& rect)
 	mDisplayCenter = 1;
 	mDisplayCalls = 0;
 	mDisplayHz = 0;
+	mDisplayThreads = 0;
 	mScrollIndex = 0;
 	mHoverIndex = -1;
 	mHoverBarIndex = -1;
@@ -253,6 +257,7 @@ LLFastTimerView::LLFastTimerView(const std::string& name, const LLRect& rect)
 			llassert(level < FTV_DISPLAY_NUM);
 			ft_display_table[i].desc = text;
 			ft_display_table[i].level = level;
+			LLFastTimer::setTimerName(ft_display_table[i].timer, text);
 			if (level > 0)
 			{
 				ft_display_table[i].parent = pidx[level-1];
@@ -324,6 +329,10 @@ BOOL LLFastTimerView::handleMouseDown(S32 x, S32 y, MASK mask)
 			}
 		}
 	}
+	else if ((mask & MASK_ALT) && (mask & MASK_SHIFT) && (mask & MASK_CONTROL))
+	{
+		mDisplayThreads = !mDisplayThreads;
+	}
 	else if (mask & MASK_ALT)
 	{
 		if (mask & MASK_SHIFT)
@@ -511,6 +520,16 @@ void LLFastTimerView::draw()
 		LLFontGL::getFontMonospace()->renderUTF8(std::string("[Right-Click log selected] [ALT-Click toggle counts] [ALT-SHIFT-Click sub hidden]"),
 										 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
 		y -= (texth + 2);
+		LLFontGL::getFontMonospace()->renderUTF8(std::string("[ALT-CTRL-SHIFT-Click toggle threads]"),
+										 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
+		y -= (texth + 2);
+	}
+
+	if (mDisplayThreads)
+	{
+		drawThreadTimers(xleft, y);
+		LLView::draw();
+		return;
 	}
 
 	// Calc the total ticks
@@ -1132,6 +1151,33 @@ void LLFastTimerView::draw()
 	LLView::draw();
 }
 
+void LLFastTimerView::drawThreadTimers(S32 x, S32 y)
+{
+	F64 iclock_freq = 1000.0 / (F64)LLFastTimer::countsPerSecond();
+	S32 texth = (S32)LLFontGL::getFontMonospace()->getLineHeight();
+
+	std::vector<LLFastTimer::ThreadStats> stats;
+	LLFastTimer::getThreadStats(stats);
+
+	for (std::vector<LLFastTimer::ThreadStats>::iterator iter = stats.begin();
+		 iter != stats.end() && y > 0; ++iter)
+	{
+		y -= (texth + 2);
+		LLFontGL::getFontMonospace()->renderUTF8(iter->mName, 0, x, y, LLColor4::yellow, LLFontGL::LEFT, LLFontGL::TOP);
+		y -= (texth + 2);
+
+		for (std::vector<LLFastTimer::ThreadTimerStats>::iterator timer = iter->mTimers.begin();
+			 timer != iter->mTimers.end() && y > 0; ++timer)
+		{
+			std::string tdesc = llformat("%*s%s: %.2f ms (%.1f calls)", (timer->mDepth + 1) * 2, "",
+										 LLFastTimer::getTimerName(timer->mTimer).c_str(),
+										 timer->mCountAverage * iclock_freq, timer->mCallAverage);
+			LLFontGL::getFontMonospace()->renderUTF8(tdesc, 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
+			y -= (texth + 2);
+		}
+	}
+}
+
 F64 LLFastTimerView::getTime(LLFastTimer::EFastTimerType tidx)
 {
 	// Find table index
@@ -52,6 +52,10 @@ public:
 	S32 getLegendIndex(S32 y);
 	F64 getTime(LLFastTimer::EFastTimerType tidx);
 	
+private:
+	// Lists what every thread timed, as a call tree, from the top left.
+	void drawThreadTimers(S32 x, S32 y);
+
 private:	
 	S32* mBarStart;
 	S32* mBarEnd;
@@ -59,6 +63,7 @@ private:
 	S32 mDisplayCenter;
 	S32 mDisplayCalls;
 	S32 mDisplayHz;
+	S32 mDisplayThreads;
 	U64 mAvgCountTotal;
 	U64 mMaxCountTotal;
 	LLRect mBarRect;
@@ -196,6 +196,15 @@ void LLFloaterStats::buildStats()
 	stat_barp->mPrecision = 1;
 	stat_barp->mPerSec = FALSE;
 
+	stat_barp = texture_statviewp->addStat("Time To Full Res", &(gImageList.sTimeToFullResStat), "DebugStatModeTimeToFullRes");
+	stat_barp->setUnitLabel(" sec");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 1;
+	stat_barp->mPerSec = FALSE;
+
 	
 	// Network statistics
 	LLStatView *net_statviewp = stat_viewp->addStatView("network stat view", "Network", "OpenDebugStatNet", rect);
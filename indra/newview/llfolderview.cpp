@@ -168,6 +168,8 @@ LLFolderViewItem::LLFolderViewItem( const std::string& name, LLUIImagePtr icon,
 	mStringMatchOffset(std::string::npos),
 	mControlLabelRotation(0.f),
 	mRoot( root ),
+	mNameIndexed(FALSE),
+	mNameIndexStamp(0),
 	mDragAndDropTarget(FALSE),
 	mIsLoading(FALSE)
 {
@@ -359,6 +361,11 @@ void LLFolderViewItem::refresh()
 		mSearchableLabelDesc.assign(searchable_label_desc);
 		mSearchableLabelAll.assign(searchable_label_all);
 
+		if (mRoot && mNameIndexed)
+		{
+			mRoot->updateItemIndex(this);
+		}
+
 		dirtyFilter();
 		// some part of label has changed, so overall width has potentially changed
 		if (mParentFolder)
@@ -2751,6 +2758,7 @@ LLFolderView::~LLFolderView( void )
 	mItems.clear();
 	mFolders.clear();
 
+	mNameIndex.clear();
 	mItemMap.clear();
 }
 
@@ -2940,10 +2948,18 @@ void LLFolderView::filter( LLInventoryFilter& filter )
 {
 	LLFastTimer t2(LLFastTimer::FTM_FILTER);
 	static const LLCachedControl<S32> filter_items_per_frame("FilterItemsPerFrame",500);
+	static const LLCachedControl<F32> filter_time_slice_ms("FilterTimeSliceMS",4.f);
 	filter.setFilterCount(llclamp((S32)filter_items_per_frame, 1, 5000));
+	filter.startFilterTimeSlice(llclamp((F32)filter_time_slice_ms, 0.f, 100.f) * 0.001f);
 
 	if (getCompletedFilterGeneration() < filter.getCurrentGeneration())
 	{
+		// narrow the substring search down to index candidates so the per
+		// item check becomes a stamp compare. This is a no-op unless the
+		// search string or search mode changed since the last frame.
+		BOOL split_words = filter.getSearchType() == 3 || filter.getPartialSearch();
+		mNameIndex.updateQuery(filter.getFilterSubString(), split_words, filter.getCurrentGeneration());
+
 		mFiltered = FALSE;
 		mMinWidth = 0;
 		LLFolderViewFolder::filter(filter);
@@ -4271,6 +4287,8 @@ void LLFolderView::deleteAllChildren()
 	mRenamer = NULL;
 	mRenameItem = NULL;
 	clearSelection();
+	// the index must not outlive the views it points at
+	mNameIndex.clear();
 	LLView::deleteAllChildren();
 }
 
@@ -4364,12 +4382,28 @@ void LLFolderView::setShowSingleSelection(BOOL show)
 
 void LLFolderView::addItemID(const LLUUID& id, LLFolderViewItem* itemp)
 {
-	mItemMap[id] = itemp;
+	LLFolderViewItem*& entry = mItemMap[id];
+	if (entry && entry != itemp)
+	{
+		mNameIndex.removeItem(entry);
+	}
+	entry = itemp;
+	mNameIndex.indexItem(itemp);
 }
 
 void LLFolderView::removeItemID(const LLUUID& id)
 {
-	mItemMap.erase(id);
+	std::map<LLUUID, LLFolderViewItem*>::iterator map_it = mItemMap.find(id);
+	if (map_it != mItemMap.end())
+	{
+		mNameIndex.removeItem(map_it->second);
+		mItemMap.erase(map_it);
+	}
+}
+
+void LLFolderView::updateItemIndex(LLFolderViewItem* itemp)
+{
+	mNameIndex.indexItem(itemp);
 }
 
 LLFolderViewItem* LLFolderView::getItemByID(const LLUUID& id)
@@ -4657,6 +4691,7 @@ LLInventoryFilter::LLInventoryFilter(const std::string& name) :
 	mMustPassGeneration = S32_MAX;
 	mMinRequiredGeneration = 0;
 	mFilterCount = 0;
+	mFilterSliceSeconds = 0.f;
 	mNextFilterGeneration = mFilterGeneration + 1;
 
 	mLastLogoff = gSavedPerAccountSettings.getU32("LastLogoff");
@@ -4672,6 +4707,15 @@ LLInventoryFilter::~LLInventoryFilter()
 
 BOOL LLInventoryFilter::check(LLFolderViewItem* item) 
 {
+	// items the name index has ruled out can't contain the substring,
+	// so skip the string search entirely
+	const LLFolderViewNameIndex& name_index = item->getRoot()->getNameIndex();
+	if (name_index.isQueryActive(mFilterGeneration) && !name_index.isCandidate(item))
+	{
+		mSubStringMatchOffset = std::string::npos;
+		return FALSE;
+	}
+
 	LLFolderViewEventListener* listener = item->getListener();
 	const LLUUID& item_id = listener->getUUID();
 	const LLInventoryObject *obj = gInventory.getObject(item_id);
@@ -4740,6 +4784,29 @@ BOOL LLInventoryFilter::check(LLFolderViewItem* item)
 	return passed;
 }
 
+void LLInventoryFilter::startFilterTimeSlice(F32 seconds)
+{
+	mFilterSliceSeconds = seconds;
+	mFilterSliceTimer.reset();
+}
+
+void LLInventoryFilter::decrementFilterCount()
+{
+	mFilterCount--;
+
+	// reading the clock costs more than checking an item against an
+	// indexed filter, so only sample it every few items
+	const S32 TIME_CHECK_INTERVAL = 32;
+	if (mFilterSliceSeconds > 0.f
+		&& mFilterCount > 0
+		&& (mFilterCount % TIME_CHECK_INTERVAL) == 0
+		&& mFilterSliceTimer.getElapsedTimeF32() > mFilterSliceSeconds)
+	{
+		// out of time for this frame, resume from here next frame
+		mFilterCount = -1;
+	}
+}
+
 const std::string LLInventoryFilter::getFilterSubString(BOOL trim)
 {
 	return mFilterSubString;
@@ -55,6 +55,7 @@
 #include "llviewerimage.h"
 #include "lldepthstack.h"
 #include "lltooldraganddrop.h"
+#include "llfolderviewnameindex.h"
 
 class LLMenuGL;
 
@@ -236,7 +237,10 @@ public:
 
 	void setFilterCount(S32 count) { mFilterCount = count; }
 	S32 getFilterCount() { return mFilterCount; }
-	void decrementFilterCount() { mFilterCount--; }
+	void decrementFilterCount();
+
+	// bounds a filter pass by wall clock as well as by item count
+	void startFilterTimeSlice(F32 seconds);
 	
 	void markDefault();
 	void resetDefault();
@@ -280,6 +284,8 @@ protected:
 	S32				mFilterCount;
 	S32				mNextFilterGeneration;
 	EFilterBehavior mFilterBehavior;
+	LLTimer			mFilterSliceTimer;
+	F32				mFilterSliceSeconds;
 
 private:
 	U32 mLastLogoff;
@@ -334,6 +340,7 @@ class LLFolderViewItem : public LLUICtrl
 {
 protected:
 	friend class LLFolderViewEventListener;
+	friend class LLFolderViewNameIndex;
 
 
 	static const LLFontGL*		sFont;
@@ -379,6 +386,8 @@ protected:
 	std::string::size_type		mStringMatchOffset;
 	F32							mControlLabelRotation;
 	LLFolderView*				mRoot;
+	BOOL						mNameIndexed;
+	U32							mNameIndexStamp;
 	BOOL						mDragAndDropTarget;
 	BOOL                            mIsLoading;
 	LLTimer                         mTimeSinceRequestStart;
@@ -912,6 +921,10 @@ public:
 	void removeItemID(const LLUUID& id);
 	LLFolderViewItem* getItemByID(const LLUUID& id);
 
+	// called when the searchable labels of a registered item change
+	void updateItemIndex(LLFolderViewItem* itemp);
+	const LLFolderViewNameIndex& getNameIndex() const { return mNameIndex; }
+
 	void	doIdle();						// Real idle routine
 	static void idle(void* user_data);		// static glue to doIdle()
 
@@ -973,6 +986,7 @@ protected:
 	S32								mSignalSelectCallback;
 	S32								mMinWidth;
 	std::map<LLUUID, LLFolderViewItem*> mItemMap;
+	LLFolderViewNameIndex			mNameIndex;
 	BOOL							mDragAndDropThisFrame;
 
 };
@@ -0,0 +1,267 @@
+/**
+ * @file llfolderviewnameindex.cpp
+ * @brief Trigram index of folder view item labels used to accelerate
+ * inventory substring filtering.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llfolderviewnameindex.h"
+
+#include <sstream>
+
+#include "llfolderview.h"
+
+LLFolderViewNameIndex::LLFolderViewNameIndex()
+:	mQuerySplitWords(FALSE),
+	mQueryActive(FALSE),
+	mQueryGeneration(-1),
+	mQueryStamp(1),
+	mNumCandidates(0)
+{
+}
+
+LLFolderViewNameIndex::~LLFolderViewNameIndex()
+{
+	clear();
+}
+
+//static
+void LLFolderViewNameIndex::appendTrigrams(const std::string& label, trigram_list_t& trigrams)
+{
+	if (label.size() < 3)
+	{
+		return;
+	}
+
+	// work on raw bytes so that the index agrees with std::string::find()
+	// for multibyte UTF-8 labels as well
+	const U8* chars = (const U8*)label.data();
+	U32 trigram = ((U32)chars[0] << 8) | (U32)chars[1];
+	for (std::string::size_type i = 2; i < label.size(); ++i)
+	{
+		trigram = ((trigram << 8) | (U32)chars[i]) & 0x00ffffff;
+		trigrams.push_back(trigram);
+	}
+}
+
+//static
+void LLFolderViewNameIndex::sortUnique(trigram_list_t& trigrams)
+{
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+//static
+BOOL LLFolderViewNameIndex::containsAll(const trigram_list_t& haystack, const trigram_list_t& needles)
+{
+	// both lists are sorted, so this is a linear merge
+	return std::includes(haystack.begin(), haystack.end(), needles.begin(), needles.end());
+}
+
+void LLFolderViewNameIndex::markCandidate(LLFolderViewItem* item)
+{
+	if (item->mNameIndexStamp != mQueryStamp)
+	{
+		item->mNameIndexStamp = mQueryStamp;
+		mNumCandidates++;
+	}
+}
+
+void LLFolderViewNameIndex::indexItem(LLFolderViewItem* item)
+{
+	if (!item)
+	{
+		return;
+	}
+
+	// a substring of one label need not be a substring of the combined
+	// label, so each searchable label contributes its own trigrams
+	trigram_list_t trigrams;
+	appendTrigrams(item->mSearchableLabel, trigrams);
+	appendTrigrams(item->mSearchableLabelCreator, trigrams);
+	appendTrigrams(item->mSearchableLabelDesc, trigrams);
+	appendTrigrams(item->mSearchableLabelAll, trigrams);
+	sortUnique(trigrams);
+
+	item_trigram_map_t::iterator found_it = mItemTrigrams.find(item);
+	if (found_it != mItemTrigrams.end())
+	{
+		if (found_it->second == trigrams)
+		{
+			// label text changed in a way that didn't affect the index
+			return;
+		}
+		removeItem(item);
+	}
+
+	for (trigram_list_t::iterator it = trigrams.begin(); it != trigrams.end(); ++it)
+	{
+		mPostings[*it].insert(item);
+	}
+
+	// new or relabeled items must be judged against the live query so
+	// that results stay valid without resolving the query again
+	if (mQueryActive && containsAll(trigrams, mQueryTrigrams))
+	{
+		markCandidate(item);
+	}
+
+	item->mNameIndexed = TRUE;
+	mItemTrigrams[item].swap(trigrams);
+}
+
+void LLFolderViewNameIndex::removeItem(LLFolderViewItem* item)
+{
+	item_trigram_map_t::iterator found_it = mItemTrigrams.find(item);
+	if (found_it == mItemTrigrams.end())
+	{
+		return;
+	}
+
+	const trigram_list_t& trigrams = found_it->second;
+	for (trigram_list_t::const_iterator it = trigrams.begin(); it != trigrams.end(); ++it)
+	{
+		posting_map_t::iterator posting_it = mPostings.find(*it);
+		if (posting_it != mPostings.end())
+		{
+			posting_it->second.erase(item);
+			if (posting_it->second.empty())
+			{
+				mPostings.erase(posting_it);
+			}
+		}
+	}
+
+	if (mQueryActive && item->mNameIndexStamp == mQueryStamp)
+	{
+		mNumCandidates--;
+	}
+	item->mNameIndexed = FALSE;
+	item->mNameIndexStamp = 0;
+	mItemTrigrams.erase(found_it);
+}
+
+void LLFolderViewNameIndex::clear()
+{
+	for (item_trigram_map_t::iterator it = mItemTrigrams.begin(); it != mItemTrigrams.end(); ++it)
+	{
+		it->first->mNameIndexed = FALSE;
+		it->first->mNameIndexStamp = 0;
+	}
+	mPostings.clear();
+	mItemTrigrams.clear();
+	mQueryTrigrams.clear();
+	mQueryString.clear();
+	mQueryActive = FALSE;
+	mQueryGeneration = -1;
+	mNumCandidates = 0;
+}
+
+BOOL LLFolderViewNameIndex::updateQuery(const std::string& filter_substring, BOOL split_words, S32 filter_generation)
+{
+	LLFastTimer t(LLFastTimer::FTM_FILTER_INDEX);
+
+	mQueryGeneration = filter_generation;
+	if (filter_substring == mQueryString && split_words == mQuerySplitWords)
+	{
+		// only other filter terms changed, candidates are still valid
+		return mQueryActive;
+	}
+
+	mQueryString = filter_substring;
+	mQuerySplitWords = split_words;
+	mQueryTrigrams.clear();
+
+	if (split_words)
+	{
+		std::istringstream words(filter_substring);
+		std::string word;
+		while (words >> word)
+		{
+			appendTrigrams(word, mQueryTrigrams);
+		}
+	}
+	else
+	{
+		appendTrigrams(filter_substring, mQueryTrigrams);
+	}
+	sortUnique(mQueryTrigrams);
+
+	// stamps from the previous query become stale by bumping the stamp
+	if (++mQueryStamp == 0)
+	{
+		// wrapped around, so old stamps could alias the new one
+		for (item_trigram_map_t::iterator it = mItemTrigrams.begin(); it != mItemTrigrams.end(); ++it)
+		{
+			it->first->mNameIndexStamp = 0;
+		}
+		mQueryStamp = 1;
+	}
+	mNumCandidates = 0;
+	mQueryActive = !mQueryTrigrams.empty();
+	if (!mQueryActive)
+	{
+		return FALSE;
+	}
+
+	// seed from the rarest trigram, then confirm the others per item
+	const item_set_t* rarest = NULL;
+	for (trigram_list_t::iterator it = mQueryTrigrams.begin(); it != mQueryTrigrams.end(); ++it)
+	{
+		posting_map_t::iterator posting_it = mPostings.find(*it);
+		if (posting_it == mPostings.end())
+		{
+			// nothing can match
+			return TRUE;
+		}
+		if (!rarest || posting_it->second.size() < rarest->size())
+		{
+			rarest = &posting_it->second;
+		}
+	}
+
+	for (item_set_t::const_iterator it = rarest->begin(); it != rarest->end(); ++it)
+	{
+		item_trigram_map_t::iterator trigram_it = mItemTrigrams.find(*it);
+		if (trigram_it != mItemTrigrams.end() && containsAll(trigram_it->second, mQueryTrigrams))
+		{
+			markCandidate(*it);
+		}
+	}
+
+	return TRUE;
+}
+
+BOOL LLFolderViewNameIndex::isCandidate(const LLFolderViewItem* item) const
+{
+	// items the index has never seen can't be ruled out
+	return !item->mNameIndexed || item->mNameIndexStamp == mQueryStamp;
+}
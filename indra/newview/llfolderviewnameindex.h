@@ -0,0 +1,114 @@
+/**
+ * @file llfolderviewnameindex.h
+ * @brief Trigram index of folder view item labels used to accelerate
+ * inventory substring filtering.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFOLDERVIEWNAMEINDEX_H
+#define LL_LLFOLDERVIEWNAMEINDEX_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class LLFolderViewItem;
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Class LLFolderViewNameIndex
+//
+// Inverted index from label trigrams to the folder view items whose
+// searchable labels contain them. Every substring of length three or
+// more of a label is made of trigrams of that label, so an item that
+// lacks any trigram of the filter string can be rejected without
+// running a string search. The index is conservative: candidates
+// still have to be confirmed by LLInventoryFilter::check().
+//
+// The index is owned by LLFolderView and kept current as items are
+// added, relabeled and removed, so a new filter string only costs a
+// walk over the shortest posting list rather than over the tree.
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class LLFolderViewNameIndex
+{
+public:
+	LLFolderViewNameIndex();
+	~LLFolderViewNameIndex();
+
+	// (Re)indexes the item under the union of the trigrams of all its
+	// searchable labels, so one index serves every search type.
+	void indexItem(LLFolderViewItem* item);
+	void removeItem(LLFolderViewItem* item);
+	void clear();
+
+	// Resolves the filter string to a candidate set. When split_words
+	// is set every whitespace separated word must match, mirroring
+	// LLInventoryFilter::check(). Returns TRUE if the index can narrow
+	// this query, FALSE if it is too short to contain a trigram.
+	BOOL updateQuery(const std::string& filter_substring, BOOL split_words, S32 filter_generation);
+
+	// TRUE if the current query was resolved for this filter generation
+	// and can be used to reject items.
+	BOOL isQueryActive(S32 filter_generation) const { return mQueryActive && mQueryGeneration == filter_generation; }
+
+	// Only meaningful while isQueryActive() holds. Items that are not
+	// indexed are always candidates.
+	BOOL isCandidate(const LLFolderViewItem* item) const;
+
+	S32 getNumItems() const { return (S32)mItemTrigrams.size(); }
+	S32 getNumTrigrams() const { return (S32)mPostings.size(); }
+	S32 getNumCandidates() const { return mNumCandidates; }
+
+private:
+	typedef std::vector<U32> trigram_list_t;
+	typedef std::set<LLFolderViewItem*> item_set_t;
+	typedef std::map<U32, item_set_t> posting_map_t;
+	typedef std::map<LLFolderViewItem*, trigram_list_t> item_trigram_map_t;
+
+	static void appendTrigrams(const std::string& label, trigram_list_t& trigrams);
+	static void sortUnique(trigram_list_t& trigrams);
+	static BOOL containsAll(const trigram_list_t& haystack, const trigram_list_t& needles);
+
+	void markCandidate(LLFolderViewItem* item);
+
+private:
+	posting_map_t		mPostings;
+	item_trigram_map_t	mItemTrigrams;
+
+	trigram_list_t		mQueryTrigrams;
+	std::string			mQueryString;
+	BOOL				mQuerySplitWords;
+	BOOL				mQueryActive;
+	S32					mQueryGeneration;
+	U32					mQueryStamp;
+	S32					mNumCandidates;
+};
+
+#endif // LL_LLFOLDERVIEWNAMEINDEX_H
@@ -36,8 +36,193 @@
 #include "llappviewer.h"
 #include "llfloaterchat.h"
 #include "llviewercontrol.h"
+#include "llthread.h"
 
-const S32 LOG_RECALL_SIZE = 2048;
+#include <algorithm>
+
+const S32 LOG_RECALL_LINES = 40;
+const S32 LOG_RECALL_BLOCK_SIZE = 2048;
+const S32 LOG_RECALL_MAX_SIZE = 65536;	// never scans further back than this
+const S32 LOG_MAX_OPEN_FILES = 8;
+const U32 LOG_FLUSH_INTERVAL_MS = 250;
+
+//
+// LLLogChatWriter
+//
+// Appends transcript lines on its own thread. Busy group chats would
+// otherwise open, append to and close a file for every line on the main
+// thread. The writer waits for a burst of lines to build up, writes them
+// all, and flushes each file once. The most recently used files stay open.
+//
+class LLLogChatWriter : public LLThread
+{
+public:
+	LLLogChatWriter();
+	~LLLogChatWriter();
+
+	void addLine(const std::string& log_name, const std::string& line);
+	// Writes out whatever has been queued so far, on the calling thread.
+	void flush();
+
+protected:
+	virtual bool runCondition();
+	virtual void run();
+
+private:
+	LLFILE* getFile(const std::string& log_name);
+
+	typedef std::vector<std::pair<std::string, std::string> > line_list_t;
+	line_list_t mQueue;		// guarded by mRunCondition
+
+	typedef std::list<std::pair<std::string, LLFILE*> > file_list_t;
+	file_list_t mFiles;		// most recently used first
+	LLMutex mFileMutex;		// held while writing to mFiles
+};
+
+LLLogChatWriter::LLLogChatWriter()
+:	LLThread("Chat Log Writer"),
+	mFileMutex(NULL)
+{
+}
+
+LLLogChatWriter::~LLLogChatWriter()
+{
+	// The thread writes out whatever is left before it stops.
+	setQuitting();
+	for (S32 timeout = 100; timeout > 0 && !isStopped(); timeout--)
+	{
+		ms_sleep(100);
+		LLThread::yield();
+	}
+	if (!isStopped())
+	{
+		llwarns << "Chat log writer timed out!" << llendl;
+	}
+
+	LLMutexLock lock(&mFileMutex);
+	for (file_list_t::iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+	{
+		fclose(iter->second);
+	}
+	mFiles.clear();
+}
+
+void LLLogChatWriter::addLine(const std::string& log_name, const std::string& line)
+{
+	lockData();
+	mQueue.push_back(std::make_pair(log_name, line));
+	unlockData();
+	wake();
+}
+
+//virtual
+bool LLLogChatWriter::runCondition()
+{
+	return !mQueue.empty();
+}
+
+//virtual
+void LLLogChatWriter::run()
+{
+	while (1)
+	{
+		// sleeps until there are lines to write
+		checkPause();
+		if (isQuitting())
+		{
+			break;
+		}
+		// let the rest of a burst of chat catch up
+		ms_sleep(LOG_FLUSH_INTERVAL_MS);
+		flush();
+	}
+	flush();
+}
+
+void LLLogChatWriter::flush()
+{
+	LLMutexLock lock(&mFileMutex);
+
+	line_list_t lines;
+	lockData();
+	lines.swap(mQueue);
+	unlockData();
+	if (lines.empty())
+	{
+		return;
+	}
+
+	for (line_list_t::iterator iter = lines.begin(); iter != lines.end(); ++iter)
+	{
+		LLFILE* fp = getFile(iter->first);
+		if (fp)
+		{
+			fprintf(fp, "%s\n", iter->second.c_str());
+		}
+	}
+	for (file_list_t::iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+	{
+		fflush(iter->second);
+	}
+}
+
+LLFILE* LLLogChatWriter::getFile(const std::string& log_name)
+{
+	for (file_list_t::iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+	{
+		if (iter->first == log_name)
+		{
+			mFiles.splice(mFiles.begin(), mFiles, iter);
+			return iter->second;
+		}
+	}
+
+	LLFILE* fp = LLFile::fopen(log_name, "a"); 		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		llinfos << "Couldn't open chat history log!" << llendl;
+		return NULL;
+	}
+	mFiles.push_front(std::make_pair(log_name, fp));
+	if ((S32)mFiles.size() > LOG_MAX_OPEN_FILES)
+	{
+		fclose(mFiles.back().second);
+		mFiles.pop_back();
+	}
+	return fp;
+}
+
+//
+// LLLogChat
+//
+
+LLLogChatWriter* LLLogChat::sWriter = NULL;
+
+//static
+void LLLogChat::initClass()
+{
+	if (!sWriter)
+	{
+		sWriter = new LLLogChatWriter();
+		sWriter->start();
+		// A thread that hasn't got going yet can't be told to quit, and
+		// would lose its queue if cleanupClass() came first.
+		for (S32 timeout = 100; timeout > 0 && sWriter->isStopped(); timeout--)
+		{
+			ms_sleep(10);
+		}
+	}
+}
+
+//static
+void LLLogChat::cleanupClass()
+{
+	if (sWriter)
+	{
+		delete sWriter;
+		sWriter = NULL;
+	}
+}
 
 //static
 std::string LLLogChat::makeLogFileName(std::string filename)
@@ -100,6 +285,12 @@ void LLLogChat::saveHistory(std::string filename, std::string line)
 		return;
 	}
 
+	if (sWriter)
+	{
+		sWriter->addLine(makeLogFileName(filename), line);
+		return;
+	}
+
 	LLFILE* fp = LLFile::fopen(LLLogChat::makeLogFileName(filename), "a"); 		/*Flawfinder: ignore*/
 	if (!fp)
 	{
@@ -121,7 +312,12 @@ void LLLogChat::loadHistory(std::string filename , void (*callback)(ELogLineType
 		return ;
 	}
 
-	LLFILE* fptr = LLFile::fopen(makeLogFileName(filename), "r");		/*Flawfinder: ignore*/
+	if (sWriter)
+	{
+		sWriter->flush();
+	}
+
+	LLFILE* fptr = LLFile::fopen(makeLogFileName(filename), "rb");		/*Flawfinder: ignore*/
 	if (!fptr)
 	{
 		//LLUIString message = LLFloaterChat::getInstance()->getString("IM_logging_string");
@@ -129,39 +325,62 @@ void LLLogChat::loadHistory(std::string filename , void (*callback)(ELogLineType
 		callback(LOG_EMPTY,LLStringUtil::null,userdata);
 		return;			//No previous conversation with this name.
 	}
-	else
+
+	// Read blocks backwards from the end until there are enough whole
+	// lines, however long they are.
+	std::string tail;
+	S32 pos = 0;
+	if (!fseek(fptr, 0, SEEK_END))
 	{
-		char buffer[LOG_RECALL_SIZE];		/*Flawfinder: ignore*/
-		char *bptr;
-		S32 len;
-		bool firstline=TRUE;
-
-		if ( fseek(fptr, (LOG_RECALL_SIZE - 1) * -1  , SEEK_END) )		
-		{	//File is smaller than recall size.  Get it all.
-			firstline = FALSE;
-			if ( fseek(fptr, 0, SEEK_SET) )
-			{
-				fclose(fptr);
-				return;
-			}
+		pos = (S32)ftell(fptr);
+	}
+	S32 size = pos;
+	S32 newlines = 0;
+	while (pos > 0 && newlines <= LOG_RECALL_LINES && size - pos < LOG_RECALL_MAX_SIZE)
+	{
+		char buffer[LOG_RECALL_BLOCK_SIZE];		/*Flawfinder: ignore*/
+		S32 len = llmin(pos, LOG_RECALL_BLOCK_SIZE);
+		pos -= len;
+		if (fseek(fptr, pos, SEEK_SET)
+			|| fread(buffer, 1, len, fptr) != (size_t)len)
+		{
+			llwarns << "Couldn't read chat history log!" << llendl;
+			tail.clear();
+			break;
 		}
+		newlines += (S32)std::count(buffer, buffer + len, '\n');
+		tail.insert(0, buffer, len);
+	}
+	fclose(fptr);
+
+	std::vector<std::string> lines;
+	std::string::size_type start = 0;
+	std::string::size_type end;
+	while ((end = tail.find('\n', start)) != std::string::npos)
+	{
+		lines.push_back(tail.substr(start, end - start));
+		start = end + 1;
+	}
+	if (start < tail.size())
+	{
+		// the last line hasn't got its newline yet
+		lines.push_back(tail.substr(start));
+	}
+	if (pos > 0 && !lines.empty())
+	{
+		// the scan started part way through this one
+		lines.erase(lines.begin());
+	}
 
-		while ( fgets(buffer, LOG_RECALL_SIZE, fptr)  && !feof(fptr) ) 
+	S32 first = llmax(0, (S32)lines.size() - LOG_RECALL_LINES);
+	for (S32 i = first; i < (S32)lines.size(); i++)
+	{
+		std::string& line = lines[i];
+		if (!line.empty() && line[line.size() - 1] == '\r')
 		{
-			len = strlen(buffer) - 1;		/*Flawfinder: ignore*/
-			for ( bptr = (buffer + len); (*bptr == '\n' || *bptr == '\r') && bptr>buffer; bptr--)	*bptr='\0';
-			
-			if (!firstline)
-			{
-				callback(LOG_LINE,std::string(buffer),userdata);
-			}
-			else
-			{
-				firstline = FALSE;
-			}
+			line.erase(line.size() - 1);
 		}
-		callback(LOG_END,LLStringUtil::null,userdata);
-		
-		fclose(fptr);
+		callback(LOG_LINE,line,userdata);
 	}
+	callback(LOG_END,LLStringUtil::null,userdata);
 }
@@ -34,6 +34,8 @@
 #ifndef LL_LLLOGCHAT_H
 #define LL_LLLOGCHAT_H
 
+class LLLogChatWriter;
+
 class LLLogChat
 {
 public:
@@ -43,14 +45,25 @@ public:
 		LOG_LINE,
 		LOG_END
 	};
+	// Starts and stops the thread that writes transcripts. Lines saved
+	// without it are written straight away.
+	static void initClass();
+	static void cleanupClass();
+
 	static std::string timestamp(bool withdate = false);
 	static std::string makeLogFileName(std::string(filename));
+	// Queues line for the writer thread, which reaches the disk within
+	// LOG_FLUSH_INTERVAL_MS.
 	static void saveHistory(std::string filename, std::string line);
+	// Calls back with the last LOG_RECALL_LINES lines of the transcript,
+	// including any still queued.
 	static void loadHistory(std::string filename, 
 		                    void (*callback)(ELogLineType,std::string,void*), 
 							void* userdata);
 private:
 	static std::string cleanFileName(std::string filename);
+
+	static LLLogChatWriter* sWriter;
 };
 
 #endif
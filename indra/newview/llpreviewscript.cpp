@@ -1454,7 +1454,8 @@ void LLPreviewLSL::uploadAssetLegacy(const std::string& filename,
 						err_filename.c_str(),
 						compile_to_mono,
 						asset_id.asString().c_str(),
-						gAgent.isGodlike()))
+						gAgent.isGodlike(),
+						gSavedSettings.getBOOL("LSLOptimize")))
 	{
 		llinfos << "Compile failed!" << llendl;
 		//char command[256];
@@ -2332,7 +2333,8 @@ void LLLiveLSLEditor::uploadAssetLegacy(const std::string& filename,
 						err_filename.c_str(),
 						compile_to_mono,
 						asset_id.asString().c_str(),
-						gAgent.isGodlike()))
+						gAgent.isGodlike(),
+						gSavedSettings.getBOOL("LSLOptimize")))
 	{
 		// load the error file into the error scrolllist
 		llinfos << "Compile failed!" << llendl;
@@ -1521,28 +1521,39 @@ public:
 	
 	virtual void traverse(const LLSpatialGroup::TreeNode* n)
 	{
-		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
+		const LLSpatialGroup::OctreeNode* node = (const LLSpatialGroup::OctreeNode*) n;
+		LLSpatialGroup* group = (LLSpatialGroup*) node->getListener(0);
 
-		if (earlyFail(group))
+		S32 res = mRes;
+		if (needsFrustumCheck(group, mRes))
 		{
-			return;
-		}
-		
-		if (mRes == 2 || 
-			(mRes && group->isState(LLSpatialGroup::SKIP_FRUSTUM_CHECK)))
-		{	//fully in, just add everything
-			LLSpatialGroup::OctreeTraveler::traverse(n);
+			res = frustumCheck(group);
 		}
-		else
+
+		traverseGroup(node, res);
+		mRes = 0;
+	}
+
+	//traverse() for a group whose frustum result is already known, with the
+	//children that need it tested in one batch like classify() does
+	void traverseGroup(const LLSpatialGroup::OctreeNode* node, S32 res)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) node->getListener(0);
+
+		if (earlyFail(group) || !res)
 		{
-			mRes = frustumCheck(group);
-				
-			if (mRes)
-			{ //at least partially in, run on down
-				LLSpatialGroup::OctreeTraveler::traverse(n);
-			}
+			return;
+		}
 
-			mRes = 0;
+		//at least partially in, run on down
+		mRes = res;
+		node->accept(this);
+
+		S32 child_results[8];
+		checkChildren(node, res, child_results);
+		for (U32 i = 0; i < node->getChildCount(); i++)
+		{
+			traverseGroup(node->getChild(i), child_results[i]);
 		}
 	}
 	
@@ -1566,6 +1577,37 @@ public:
 		return res;
 	}
 
+	//frustumCheck() on up to 8 groups at once
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, S32 count, S32* results)
+	{
+		batchCheck(groups, count, results, TRUE);
+		for (S32 i = 0; i < count; i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin(results[i], AABBSphereIntersect(groups[i]->mExtents[0], groups[i]->mExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+			}
+		}
+	}
+
+	void batchCheck(LLSpatialGroup* const* groups, S32 count, S32* results, BOOL no_far_clip)
+	{
+		llassert(count <= 8);
+		F32 center[3][8];
+		F32 radius[3][8];
+		for (S32 i = 0; i < count; i++)
+		{
+			for (U32 j = 0; j < 3; j++)
+			{
+				center[j][i] = groups[i]->mBounds[0].mV[j];
+				radius[j][i] = groups[i]->mBounds[1].mV[j];
+			}
+		}
+		const F32* const center_ptr[3] = { center[0], center[1], center[2] };
+		const F32* const radius_ptr[3] = { radius[0], radius[1], radius[2] };
+		mCamera->AABBInFrustumBatch(center_ptr, radius_ptr, count, results, no_far_clip);
+	}
+
 	virtual bool checkObjects(const LLSpatialGroup::OctreeNode* branch, const LLSpatialGroup* group)
 	{
 		if (branch->getElementCount() == 0) //no elements
@@ -1611,6 +1653,116 @@ public:
 		}
 	}
 
+	//frustum half of traverse() for LLSpatialCullBatch, safe on any thread since it
+	//only reads bounds and states; each subtree gets its parent's result explicitly
+	void classify(const LLSpatialGroup::OctreeNode* node, S32 parent_res, BOOL recurse, LLSpatialCullBatch::record_list_t& records)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) node->getListener(0);
+
+		S32 res = parent_res;
+		if (needsFrustumCheck(group, parent_res))
+		{
+			res = frustumCheck(group);
+		}
+
+		classifyGroup(node, res, recurse, records);
+	}
+
+	static bool needsFrustumCheck(const LLSpatialGroup* group, S32 parent_res)
+	{
+		return !(parent_res == 2 ||
+			(parent_res && group->isState(LLSpatialGroup::SKIP_FRUSTUM_CHECK)));
+	}
+
+	void classifyGroup(const LLSpatialGroup::OctreeNode* node, S32 res, BOOL recurse, LLSpatialCullBatch::record_list_t& records)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) node->getListener(0);
+
+		U32 index = records.size();
+		LLSpatialCullBatch::Record record;
+		record.mGroup = group;
+		record.mFrustumResult = res;
+		record.mCheckObjects = FALSE;
+		records.push_back(record);
+
+		if (res)
+		{
+			mRes = res;
+			records[index].mCheckObjects = checkObjects(node, group);
+
+			if (recurse)
+			{
+				S32 child_results[8];
+				checkChildren(node, res, child_results);
+				for (U32 i = 0; i < node->getChildCount(); i++)
+				{
+					classifyGroup(node->getChild(i), child_results[i], TRUE, records);
+				}
+			}
+		}
+
+		records[index].mSkipTo = records.size();
+	}
+
+	//frustum results for all of node's children given its own res, with the
+	//ones that need testing run through frustumCheckGroups() in one batch
+	void checkChildren(const LLSpatialGroup::OctreeNode* node, S32 res, S32* results)
+	{
+		const U32 count = node->getChildCount();
+		llassert(count <= 8);
+		LLSpatialGroup* check_groups[8];
+		S32 check_results[8];
+		bool checked[8];
+		S32 num_checks = 0;
+		for (U32 i = 0; i < count; i++)
+		{
+			LLSpatialGroup* child = (LLSpatialGroup*) node->getChild(i)->getListener(0);
+			checked[i] = needsFrustumCheck(child, res);
+			if (checked[i])
+			{
+				check_groups[num_checks++] = child;
+			}
+		}
+
+		if (num_checks)
+		{
+			frustumCheckGroups(check_groups, num_checks, check_results);
+		}
+
+		num_checks = 0;
+		for (U32 i = 0; i < count; i++)
+		{
+			results[i] = checked[i] ? check_results[num_checks++] : res;
+		}
+	}
+
+	//the rest of traverse() on the main thread, in the same order
+	void replay(const LLSpatialCullBatch::record_list_t& records)
+	{
+		U32 i = 0;
+		while (i < records.size())
+		{
+			const LLSpatialCullBatch::Record& record = records[i];
+			if (earlyFail(record.mGroup))
+			{
+				i = record.mSkipTo;
+				continue;
+			}
+
+			if (record.mFrustumResult)
+			{
+				mRes = record.mFrustumResult;
+				preprocess(record.mGroup);
+				if (record.mCheckObjects)
+				{
+					processGroup(record.mGroup);
+				}
+			}
+			i++;
+		}
+		mRes = 0;
+	}
+
 	LLCamera *mCamera;
 	S32 mRes;
 };
@@ -1631,6 +1783,11 @@ public:
 		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
 		return res;
 	}
+
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, S32 count, S32* results)
+	{
+		batchCheck(groups, count, results, TRUE);
+	}
 };
 
 class LLOctreeCullShadow : public LLOctreeCull
@@ -1648,6 +1805,11 @@ public:
 	{
 		return mCamera->AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]);
 	}
+
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, S32 count, S32* results)
+	{
+		batchCheck(groups, count, results, FALSE);
+	}
 };
 
 class LLOctreeCullVisExtents: public LLOctreeCullShadow
@@ -1885,9 +2047,8 @@ BOOL LLSpatialPartition::visibleObjectsInFrustum(LLCamera& camera)
 	return vis.mResult;
 }
 
-S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select)
+void LLSpatialPartition::cullRebound()
 {
-	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
 #endif
@@ -1903,7 +2064,13 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->validate();
 #endif
+}
 
+S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select)
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+
+	cullRebound();
 	
 	if (for_select)
 	{
@@ -1932,6 +2099,121 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 
+//picks the same culler as cull()
+void LLSpatialPartition::cullClassify(LLCamera& camera, const LLSpatialGroup::OctreeNode* node, S32 parent_result, BOOL recurse, LLSpatialCullBatch::record_list_t& records)
+{
+	if (LLPipeline::sShadowRender)
+	{
+		LLOctreeCullShadow culler(&camera);
+		culler.classify(node, parent_result, recurse, records);
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		LLOctreeCullNoFarClip culler(&camera);
+		culler.classify(node, parent_result, recurse, records);
+	}
+	else
+	{
+		LLOctreeCull culler(&camera);
+		culler.classify(node, parent_result, recurse, records);
+	}
+}
+
+void LLSpatialPartition::cullReplay(LLCamera& camera, const LLSpatialCullBatch::record_list_t& records)
+{
+	if (LLPipeline::sShadowRender)
+	{
+		LLOctreeCullShadow culler(&camera);
+		culler.replay(records);
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		LLOctreeCullNoFarClip culler(&camera);
+		culler.replay(records);
+	}
+	else
+	{
+		LLOctreeCull culler(&camera);
+		culler.replay(records);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLSpatialCullBatch
+//-----------------------------------------------------------------------------
+
+//static
+S32 LLSpatialCullBatch::sMaxHelpers = 0;
+
+LLSpatialCullBatch::LLSpatialCullBatch()
+{
+}
+
+LLSpatialCullBatch::~LLSpatialCullBatch()
+{
+}
+
+void LLSpatialCullBatch::addPartition(LLSpatialPartition* part, LLCamera* camera)
+{
+	part->cullRebound();
+
+	//the root is cheap, so classify it here and hand out its subtrees
+	Task root;
+	root.mPartition = part;
+	root.mCamera = camera;
+	root.mNode = part->mOctree;
+	root.mParentResult = 0;
+	part->cullClassify(*camera, part->mOctree, 0, FALSE, root.mRecords);
+	mTasks.push_back(root);
+
+	S32 root_result = root.mRecords[0].mFrustumResult;
+	if (!root_result)
+	{
+		return;
+	}
+
+	for (U32 i = 0; i < part->mOctree->getChildCount(); i++)
+	{
+		Task task;
+		task.mPartition = part;
+		task.mCamera = camera;
+		task.mNode = part->mOctree->getChild(i);
+		task.mParentResult = root_result;
+		mPendingTasks.push_back(mTasks.size());
+		mTasks.push_back(task);
+	}
+}
+
+void LLSpatialCullBatch::runTask(S32 index)
+{
+	Task& task = mTasks[mPendingTasks[index]];
+	task.mPartition->cullClassify(*task.mCamera, task.mNode, task.mParentResult, TRUE, task.mRecords);
+}
+
+void LLSpatialCullBatch::cull()
+{
+	LLFastTimer ftm(LLFastTimer::FTM_FRUSTUM_CULL);
+
+	run(mPendingTasks.size(), sMaxHelpers);
+
+	for (std::vector<Task>::iterator iter = mTasks.begin(); iter != mTasks.end(); ++iter)
+	{
+		iter->mPartition->cullReplay(*iter->mCamera, iter->mRecords);
+	}
+}
+
+//static
+void LLSpatialCullBatch::initClass(S32 max_helpers)
+{
+	sMaxHelpers = llmax(max_helpers, 0);
+
+	//LLCamera's frustum checks initialize function statics on first use,
+	//which must not race between helpers
+	LLCamera camera;
+	camera.AABBInFrustum(LLVector3::zero, LLVector3::all_one);
+	camera.AABBInFrustumNoFarClip(LLVector3::zero, LLVector3::all_one);
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group)
 {
 	const F32 vel = SG_OCCLUSION_FUDGE*2.f;
@@ -43,6 +43,7 @@
 #include "llcubemap.h"
 #include "lldrawpool.h"
 #include "llface.h"
+#include "lltaskbatch.h"
 
 #include <queue>
 
@@ -322,6 +323,54 @@ public:
 	virtual LLVertexBuffer* createVertexBuffer(U32 type_mask, U32 usage);
 };
 
+//cull of a set of partitions split into octree subtrees that are checked against
+//the frustum on LLTaskBatchThreads, then replayed in traversal order on the main
+//thread, which does the occlusion checks and fills in the cull result
+class LLSpatialCullBatch : public LLTaskBatch
+{
+public:
+	struct Record
+	{
+		LLSpatialGroup* mGroup;
+		U32 mSkipTo;			//index of the first record after this group's subtree
+		S32 mFrustumResult;		//0 outside, 1 partially inside, 2 fully inside
+		BOOL mCheckObjects;		//passed LLOctreeCull::checkObjects()
+	};
+	typedef std::vector<Record> record_list_t;
+
+	LLSpatialCullBatch();
+
+	//camera must stay valid until cull() returns
+	void addPartition(LLSpatialPartition* part, LLCamera* camera);
+
+	//MAIN THREAD
+	void cull();
+
+	//max_helpers is RenderCullThreads
+	static void initClass(S32 max_helpers);
+	static BOOL hasHelpers() { return sMaxHelpers > 0 && LLTaskBatchThread::isInitialized(); }
+
+protected:
+	virtual ~LLSpatialCullBatch();
+
+	/*virtual*/ void runTask(S32 index);
+
+private:
+	struct Task
+	{
+		LLSpatialPartition* mPartition;
+		LLCamera* mCamera;
+		const LLSpatialGroup::OctreeNode* mNode;
+		S32 mParentResult;
+		record_list_t mRecords;
+	};
+
+	std::vector<Task> mTasks;			//in traversal order
+	std::vector<U32> mPendingTasks;		//tasks that still need classifying
+
+	static S32 sMaxHelpers;
+};
+
 class LLSpatialPartition: public LLGeometryManager
 {
 public:
@@ -355,6 +404,11 @@ public:
 
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results = NULL, BOOL for_select = FALSE); // Cull on arbitrary frustum
+
+	//the pieces of cull() that LLSpatialCullBatch runs separately
+	void cullRebound();
+	void cullClassify(LLCamera& camera, const LLSpatialGroup::OctreeNode* node, S32 parent_result, BOOL recurse, LLSpatialCullBatch::record_list_t& records);
+	void cullReplay(LLCamera& camera, const LLSpatialCullBatch::record_list_t& records);
 	
 	BOOL isVisible(const LLVector3& v);
 	
@@ -548,6 +602,37 @@ public:
 	LLCloudPartition();
 };
 
+//vertex data for the faces of one rebuildGeom() call, generated into staging
+//buffers on LLTaskBatchThreads and copied into the vertex buffers on the
+//main thread (implemented in LLVOVolume.cpp)
+class LLVolumeGeometryBatch : public LLTaskBatch
+{
+public:
+	LLVolumeGeometryBatch();
+
+	//MAIN THREAD, returns FALSE if the face doesn't fit in its vertex buffer
+	BOOL addFace(LLFace* facep, const LLVolume& volume, S32 te_idx,
+				const LLMatrix4& mat_vert, const LLMatrix3& mat_normal, U16 index_offset);
+
+	//MAIN THREAD, generates the geometry of every face added and hands it to the vertex buffers
+	void build();
+
+	//max_helpers is RenderRebuildThreads
+	static void initClass(S32 max_helpers);
+	static BOOL hasHelpers() { return sMaxHelpers > 0 && LLTaskBatchThread::isInitialized(); }
+
+protected:
+	virtual ~LLVolumeGeometryBatch();
+
+	/*virtual*/ void runTask(S32 index);
+
+private:
+	std::vector<LLFaceGeometryJob> mJobs;
+	U32 mNumVertices;
+
+	static S32 sMaxHelpers;
+};
+
 //class for wrangling geometry out of volumes (implemented in LLVOVolume.cpp)
 class LLVolumeGeometryManager: public LLGeometryManager
 {
@@ -556,7 +641,7 @@ public:
 	virtual void rebuildGeom(LLSpatialGroup* group);
 	virtual void rebuildMesh(LLSpatialGroup* group);
 	virtual void getGeometry(LLSpatialGroup* group);
-	void genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort = FALSE);
+	void genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort = FALSE, LLVolumeGeometryBatch* batch = NULL);
 	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
 
 };
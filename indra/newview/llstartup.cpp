@@ -77,6 +77,7 @@
 #include "lluserrelations.h"
 #include "llversionviewer.h"
 #include "llvfs.h"
+#include "llxmlcache.h"
 #include "llxorcipher.h"	// saved password, MAC address
 #include "message.h"
 #include "v3math.h"
@@ -1008,6 +1009,7 @@ bool idle_startup()
 				gXferManager->setUseAckThrottling(TRUE);
 				gXferManager->setAckThrottleBPS(xfer_throttle_bps);
 			}
+			gXferManager->setUseWindowing(gSavedSettings.getBOOL("XferWindowing"));
 			gAssetStorage = new LLViewerAssetStorage(msg, gXferManager, gVFS);
 
 
@@ -1281,6 +1283,15 @@ bool idle_startup()
 
 			gSavedSettings.setBOOL("FirstRunThisInstall", FALSE);
 
+			// how long it takes from launch to having something for the user to do
+			static bool logged_startup_time = false;
+			if (!logged_startup_time)
+			{
+				logged_startup_time = true;
+				LL_INFOS("AppInit") << "Login screen up " << LLFrameTimer::getElapsedSeconds() << "s after launch, "
+					<< LLXMLCache::sHits << " XML files read from the cache, " << LLXMLCache::sMisses << " parsed and cached" << LL_ENDL;
+			}
+
 			LLStartUp::setStartupState( STATE_LOGIN_WAIT );		// Wait for user input
 		}
 		else
@@ -45,6 +45,7 @@
 #include "lltexlayer.h"
 #include "llui.h"
 #include "llvfile.h"
+#include "llviewercontrol.h"
 #include "llviewerimagelist.h"
 #include "llviewerimagelist.h"
 #include "llviewerregion.h"
@@ -64,6 +65,17 @@ using namespace LLVOAvatarDefines;
 // static
 S32 LLTexLayerSetBuffer::sGLByteCount = 0;
 
+// Copies a raw image for an LLTexLayerBake, which must not share references with the main thread.
+static LLPointer<LLImageRaw> copy_raw_for_bake(LLImageRaw* image_raw)
+{
+	LLPointer<LLImageRaw> copy;
+	if (image_raw && image_raw->getData())
+	{
+		copy = new LLImageRaw(image_raw->getData(), image_raw->getWidth(), image_raw->getHeight(), image_raw->getComponents());
+	}
+	return copy;
+}
+
 //-----------------------------------------------------------------------------
 // LLBakedUploadData()
 //-----------------------------------------------------------------------------
@@ -87,6 +99,35 @@ LLBakedUploadData::LLBakedUploadData( LLVOAvatar* avatar,
 	}
 }
 
+//-----------------------------------------------------------------------------
+// LLTexLayerUploadBake
+//-----------------------------------------------------------------------------
+LLTexLayerUploadBake::LLTexLayerUploadBake(S32 width, S32 height)
+	:
+	LLTexLayerBake(width, height)
+{
+}
+
+LLTexLayerUploadBake::~LLTexLayerUploadBake()
+{
+}
+
+// Called on the baking thread
+void LLTexLayerUploadBake::postBake()
+{
+	if (!getSuccess() || !getBakedImage())
+	{
+		return;
+	}
+
+	LLPointer<LLImageJ2C> compressed_image = new LLImageJ2C;
+	compressed_image->setRate(0.f);
+	if (compressed_image->encode(getBakedImage(), LINDEN_J2C_COMMENT_PREFIX "RGBHM"))
+	{
+		mCompressedImage = compressed_image;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerSetBuffer
 // The composite image that a LLTexLayerSet writes to.  Each LLTexLayerSet has one.
@@ -143,6 +184,13 @@ void LLTexLayerSetBuffer::requestUpdate()
 	// If we're in the middle of uploading a baked texture, we don't care about it any more.
 	// When it's downloaded, ignore it.
 	mUploadID.setNull();
+
+	// Likewise a software bake that hasn't finished yet; bake again from the new data.
+	if (mBake.notNull())
+	{
+		mBake = NULL;
+		mNeedsUpload = TRUE;
+	}
 }
 
 void LLTexLayerSetBuffer::requestUpload()
@@ -161,6 +209,7 @@ void LLTexLayerSetBuffer::cancelUpload()
 		mNeedsUpload = FALSE;
 	}
 	mUploadPending = FALSE;
+	mBake = NULL;
 }
 
 void LLTexLayerSetBuffer::pushProjection()
@@ -186,6 +235,12 @@ void LLTexLayerSetBuffer::popProjection()
 
 BOOL LLTexLayerSetBuffer::needsRender()
 {
+	// Called every frame, so this is where software bakes get picked up
+	if (mBake.notNull() && mBake->isDone())
+	{
+		finishBake();
+	}
+
 	LLVOAvatar* avatar = mTexLayerSet->getAvatar();
 	BOOL upload_now = mNeedsUpload && mTexLayerSet->isLocalTextureDataFinal() && gAgent.mNumPendingQueries == 0;
 	BOOL needs_update = (mNeedsUpdate || upload_now) && !avatar->mAppearanceAnimating;
@@ -250,7 +305,11 @@ BOOL LLTexLayerSetBuffer::render()
 		{
 			if (mTexLayerSet->isVisible())
 			{
-				readBackAndUpload();
+				static const LLCachedControl<bool> bake_on_cpu("AvatarBakeOnCPU", false);
+				if (!bake_on_cpu || !startBake())
+				{
+					readBackAndUpload();
+				}
 			}
 			else
 			{
@@ -349,13 +408,69 @@ void LLTexLayerSetBuffer::readBackAndUpload()
 	
 	LLPointer<LLImageJ2C> compressedImage = new LLImageJ2C;
 	compressedImage->setRate(0.f);
+	if (!compressedImage->encode(baked_image, comment_text))
+	{
+		compressedImage = NULL;
+	}
+
+	uploadBakedImage(compressedImage);
+
+	delete [] baked_color_data;
+}
+
+// Hands the bake for upload to LLTexLayerBakeThread rather than reading it
+// back from GL. Returns FALSE if it can't, in which case the caller falls
+// back on readBackAndUpload(). finishBake() picks up the result.
+BOOL LLTexLayerSetBuffer::startBake()
+{
+	LLPointer<LLTexLayerUploadBake> bake = new LLTexLayerUploadBake(mWidth, mHeight);
+	if (!mTexLayerSet->captureBake(bake))
+	{
+		return FALSE;
+	}
+
+	// Replaces any bake still in flight, whose inputs are out of date now.
+	mBake = bake;
+	mNeedsUpload = FALSE;
+	LLTexLayerBakeThread::queueBake(bake);
+	return TRUE;
+}
+
+void LLTexLayerSetBuffer::finishBake()
+{
+	LLPointer<LLTexLayerUploadBake> bake = mBake;
+	mBake = NULL;
+
+	if (!bake->getSuccess())
+	{
+		llinfos << "Failed attempt to bake " << mTexLayerSet->getBodyRegion() << llendl;
+		mUploadPending = FALSE;
+		return;
+	}
+
+	llinfos << "Baked " << mTexLayerSet->getBodyRegion() << " on CPU in " << bake->getBakeTime() << "s" << llendl;
+	LLViewerStats::getInstance()->incStat(LLViewerStats::ST_TEX_BAKES);
+
+	llassert( gAgent.getAvatarObject() == mTexLayerSet->getAvatar() );
+
+	// We won't need our caches since we're baked now.
+	mTexLayerSet->deleteCaches();
+
+	uploadBakedImage(bake->getCompressedImage());
+}
+
+// Stores the encoded bake in the VFS and uploads it. compressed_image is NULL
+// if encoding failed.
+void LLTexLayerSetBuffer::uploadBakedImage(LLImageJ2C* compressed_image)
+{
+	LLPointer<LLImageJ2C> compressedImage = compressed_image;
 	LLTransactionID tid;
 	LLAssetID asset_id;
 	tid.generate();
 	asset_id = tid.makeAssetID(gAgent.getSecureSessionID());
 
 	BOOL res = false;
-	if( compressedImage->encode(baked_image, comment_text))
+	if( compressedImage.notNull() )
 	{
 		res = LLVFile::writeFile(compressedImage->getData(), compressedImage->getDataSize(),
 								 gVFS, asset_id, LLAssetType::AT_TEXTURE);
@@ -422,8 +537,6 @@ void LLTexLayerSetBuffer::readBackAndUpload()
 		mUploadPending = FALSE;
 		llinfos << "unable to create baked upload file" << llendl;
 	}
-
-	delete [] baked_color_data;
 }
 
 
@@ -915,6 +1028,42 @@ void LLTexLayerSet::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_
 	}
 }
 
+// Fills in bake with everything render() and gatherAlphaMasks() would use,
+// so it can be baked off the main thread. Expects render() to have run
+// this frame. Returns FALSE if some input can't be captured.
+BOOL LLTexLayerSet::captureBake(LLTexLayerBake* bake)
+{
+	const LLTexLayerSetInfo *info = getInfo();
+
+	bake->mIsVisible = mIsVisible;
+	bake->mClearAlpha = info->mClearAlpha;
+	if (!info->mStaticAlphaFileName.empty())
+	{
+		bake->mHasStaticAlpha = TRUE;
+		bake->mStaticAlphaImage = copy_raw_for_bake(gTexStaticImageList.getImageRaw(info->mStaticAlphaFileName));
+	}
+
+	bake->mLayers.resize(mLayerList.size());
+	for (U32 i = 0; i < mLayerList.size(); i++)
+	{
+		if (!mLayerList[i]->captureBake(bake->mLayers[i]))
+		{
+			return FALSE;
+		}
+	}
+
+	bake->mMaskLayers.resize(mMaskLayerList.size());
+	for (U32 i = 0; i < mMaskLayerList.size(); i++)
+	{
+		if (!mMaskLayerList[i]->captureBake(bake->mMaskLayers[i]))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerInfo
 //-----------------------------------------------------------------------------
@@ -1831,6 +1980,74 @@ BOOL LLTexLayer::isInvisibleAlphaMask()
 	return FALSE;
 }
 
+// See LLTexLayerSet::captureBake()
+BOOL LLTexLayer::captureBake(LLTexLayerBake::Layer& layer)
+{
+	const LLTexLayerInfo *info = getInfo();
+	LLVOAvatar* avatar = mTexLayerSet->getAvatar();
+
+	layer.mName = info->mName;
+	layer.mColorSpecified = findNetColor(&layer.mNetColor);
+	if (avatar->mIsDummy)
+	{
+		layer.mColorSpecified = TRUE;
+		layer.mNetColor = LLVOAvatar::getDummyColor();
+	}
+	layer.mComposited = (getRenderPass() == RP_COLOR || getRenderPass() == RP_BUMP);
+	layer.mWriteAllChannels = info->mWriteAllChannels;
+	layer.mUseLocalTextureAlphaOnly = info->mUseLocalTextureAlphaOnly;
+
+	if (info->mLocalTexture >= 0 && info->mLocalTexture < TEX_NUM_INDICES)
+	{
+		ETextureIndex te = (ETextureIndex)info->mLocalTexture;
+		layer.mHasLocalTexture = TRUE;
+
+		// Same rules as render(): no GL image or the default texture means nothing is drawn
+		LLImageGL* image_gl = NULL;
+		if (avatar->getLocalTextureGL(te, &image_gl) && image_gl &&
+			avatar->getLocalTextureID(te) != IMG_DEFAULT_AVATAR)
+		{
+			LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+			if (!avatar->getLocalTextureRaw(te, image_raw) || !image_raw->getData())
+			{
+				return FALSE;
+			}
+			layer.mLocalImage = image_raw;
+		}
+	}
+	else if (info->mLocalTexture != -1)
+	{
+		// Out of range, which render() treats as a texture it can't get
+		layer.mHasLocalTexture = TRUE;
+	}
+
+	if (!info->mStaticImageFileName.empty())
+	{
+		layer.mHasStaticImage = TRUE;
+		layer.mStaticImageIsMask = info->mStaticImageIsMask;
+		layer.mStaticImage = copy_raw_for_bake(gTexStaticImageList.getImageRaw(info->mStaticImageFileName));
+	}
+
+	layer.mHasAlphaParams = !mParamAlphaList.empty();
+	if (layer.mHasAlphaParams)
+	{
+		LLTexLayerParamAlpha* first_param = mParamAlphaList.front();
+		layer.mFirstAlphaMultiply = first_param && first_param->getMultiplyBlend();
+		for (alpha_list_t::iterator iter = mParamAlphaList.begin(); iter != mParamAlphaList.end(); iter++)
+		{
+			LLTexLayerBake::AlphaParam param;
+			if ((*iter)->captureBake(param))
+			{
+				layer.mAlphaParams.push_back(param);
+			}
+		}
+	}
+
+	layer.mWantsAlphaData = !mMaskedMorphs.empty();
+
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerParamAlphaInfo
 //-----------------------------------------------------------------------------
@@ -2133,6 +2350,36 @@ BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 	return success;
 }
 
+// Captures what render() would draw for LLTexLayerBake. Returns FALSE if
+// the param is skipped.
+BOOL LLTexLayerParamAlpha::captureBake(LLTexLayerBake::AlphaParam& param)
+{
+	if( getSkip() )
+	{
+		return FALSE;
+	}
+
+	F32 effective_weight = ( mTexLayer->getTexLayerSet()->getAvatar()->getSex() & getSex() ) ? mCurWeight : getDefaultWeight();
+	param.mMultiplyBlend = getInfo()->mMultiplyBlend;
+	param.mWeight = effective_weight;
+
+	if( !getInfo()->mStaticImageFileName.empty() && !mStaticImageInvalid && mStaticImageTGA.notNull() )
+	{
+		if( mStaticImageRaw.notNull() && effective_weight == mCachedEffectiveWeight )
+		{
+			// render() already processed the gradient for this weight
+			param.mImage = copy_raw_for_bake(mStaticImageRaw);
+		}
+		else
+		{
+			param.mImage = new LLImageRaw;
+			mStaticImageTGA->decodeAndProcess( param.mImage, getInfo()->mDomain, effective_weight );
+		}
+	}
+
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexGlobalColorInfo
 //-----------------------------------------------------------------------------
@@ -2465,7 +2712,8 @@ LLStringTable LLTexStaticImageList::sImageNames(16384);
 LLTexStaticImageList::LLTexStaticImageList()
 	:
 	mGLBytes( 0 ),
-	mTGABytes( 0 )
+	mTGABytes( 0 ),
+	mRawBytes( 0 )
 {}
 
 LLTexStaticImageList::~LLTexStaticImageList()
@@ -2477,30 +2725,56 @@ void LLTexStaticImageList::dumpByteCount()
 {
 	llinfos << "Avatar Static Textures " <<
 		"KB GL:" << (mGLBytes / 1024) <<
-		"KB TGA:" << (mTGABytes / 1024) << "KB" << llendl;
+		"KB TGA:" << (mTGABytes / 1024) <<
+		"KB Raw:" << (mRawBytes / 1024) << "KB" << llendl;
 }
 
 void LLTexStaticImageList::deleteCachedImages()
 {
-	if( mGLBytes || mTGABytes )
+	if( mGLBytes || mTGABytes || mRawBytes )
 	{
 		llinfos << "Clearing Static Textures " <<
 			"KB GL:" << (mGLBytes / 1024) <<
-			"KB TGA:" << (mTGABytes / 1024) << "KB" << llendl;
+			"KB TGA:" << (mTGABytes / 1024) <<
+			"KB Raw:" << (mRawBytes / 1024) << "KB" << llendl;
 
 		//mStaticImageLists uses LLPointers, clear() will cause deletion
 		
 		mStaticImageListTGA.clear();
 		mStaticImageListGL.clear();
+		mStaticImageListRaw.clear();
 		
 		mGLBytes = 0;
 		mTGABytes = 0;
+		mRawBytes = 0;
 	}
 }
 
 // Note: in general, for a given image image we'll call either getImageTga() or getImageGL().
 // We call getImageTga() if the image is used as an alpha gradient.
 // Otherwise, we call getImageGL()
+// Software bakes (see LLTexLayerBake) call getImageRaw() where the GL path calls getImageGL().
+
+// Returns the decoded data from a tga file named file_name.
+// Caches the result to speed identical subsequent requests.
+LLImageRaw* LLTexStaticImageList::getImageRaw(const std::string& file_name)
+{
+	const char *namekey = sImageNames.addString(file_name);
+	image_raw_map_t::iterator iter = mStaticImageListRaw.find(namekey);
+	if( iter != mStaticImageListRaw.end() )
+	{
+		return iter->second;
+	}
+
+	LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+	if( !loadImageRaw( file_name, image_raw ) )
+	{
+		return NULL;
+	}
+	mStaticImageListRaw[ namekey ] = image_raw;
+	mRawBytes += image_raw->getDataSize();
+	return image_raw;
+}
 
 // Returns an LLImageTGA that contains the encoded data from a tga file named file_name.
 // Caches the result to speed identical subsequent requests.
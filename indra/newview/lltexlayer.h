@@ -38,6 +38,7 @@
 #include "lldynamictexture.h"
 #include "llrect.h"
 #include "llstring.h"
+#include "lltexlayerbake.h"
 #include "lluuid.h"
 #include "llviewerimage.h"
 #include "llviewervisualparam.h"
@@ -51,6 +52,7 @@ class LLTexLayerSet;
 class LLTexLayerInfo;
 class LLTexLayer;
 class LLImageGL;
+class LLImageJ2C;
 class LLImageTGA;
 class LLTexGlobalColorInfo;
 class LLTexLayerParamAlphaInfo;
@@ -200,6 +202,28 @@ protected:
 	
 };
 
+//-----------------------------------------------------------------------------
+// LLTexLayerUploadBake
+// A software bake of a layer set for upload, which is also encoded on the
+// baking thread. See LLTexLayerSetBuffer::startBake().
+//-----------------------------------------------------------------------------
+class LLTexLayerUploadBake : public LLTexLayerBake
+{
+public:
+	LLTexLayerUploadBake(S32 width, S32 height);
+
+	/*virtual*/ void		postBake();
+
+	// NULL if the bake or its encoding failed
+	LLImageJ2C*				getCompressedImage()	{ return mCompressedImage; }
+
+protected:
+	/*virtual*/ ~LLTexLayerUploadBake();
+
+private:
+	LLPointer<LLImageJ2C>	mCompressedImage;
+};
+
 //-----------------------------------------------------------------------------
 // LLTexLayerSetBuffer
 // The composite image that a LLTexLayerSet writes to.  Each LLTexLayerSet has one.
@@ -222,6 +246,8 @@ public:
 	BOOL					uploadPending() { return mUploadPending; }
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
 	void					readBackAndUpload();
+	BOOL					startBake();
+	void					finishBake();
 
 	static void				onTextureUploadComplete( const LLUUID& uuid,
 													 void* userdata,
@@ -234,6 +260,7 @@ public:
 private:
 	void					pushProjection();
 	void					popProjection();
+	void					uploadBakedImage(LLImageJ2C* compressed_image);
 
 private:
 	BOOL					mNeedsUpdate;
@@ -241,6 +268,7 @@ private:
 	BOOL					mUploadPending;
 	LLUUID					mUploadID;		// Identifys the current upload process (null if none).  Used to avoid overlaps (eg, when the user rapidly makes two changes outside of Face Edit)
 	LLTexLayerSet*			mTexLayerSet;
+	LLPointer<LLTexLayerUploadBake> mBake;	// software bake in flight, if any
 
 	static S32				sGLByteCount;
 };
@@ -279,6 +307,7 @@ public:
 	void					deleteCaches();
 	void					gatherAlphaMasks(U8 *data, S32 width, S32 height);
 	void					applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components);
+	BOOL					captureBake(LLTexLayerBake* bake);
 	const std::string		getBodyRegion() 				{ return mInfo->mBodyRegion; }
 	BOOL					hasComposite()					{ return (mComposite != NULL); }
 	LLVOAvatarDefines::EBakedTextureIndex getBakedTexIndex() { return mBakedTexIndex; }
@@ -353,6 +382,7 @@ public:
 	BOOL					blendAlphaTexture(S32 x, S32 y, S32 width, S32 height);
 	BOOL					isVisibilityMask() const;
 	BOOL					isInvisibleAlphaMask();
+	BOOL					captureBake(LLTexLayerBake::Layer& layer);
 
 protected:
 	LLTexLayerSet*			mTexLayerSet;
@@ -409,6 +439,7 @@ public:
 
 	// New functions
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
+	BOOL					captureBake(LLTexLayerBake::AlphaParam& param);
 	BOOL					getSkip();
 	void					deleteCaches();
 	LLTexLayer*				getTexLayer()		{ return mTexLayer; }
@@ -530,12 +561,15 @@ private:
 
 	typedef std::map< const char *, LLPointer<LLImageGL> > image_gl_map_t;
 	typedef std::map< const char *, LLPointer<LLImageTGA> > image_tga_map_t;
+	typedef std::map< const char *, LLPointer<LLImageRaw> > image_raw_map_t;
 	image_gl_map_t mStaticImageListGL;
 	image_tga_map_t mStaticImageListTGA;
+	image_raw_map_t mStaticImageListRaw;
 
 public:
 	S32 mGLBytes;
 	S32 mTGABytes;
+	S32 mRawBytes;
 };
 
 // Used by LLTexLayerSetBuffer for a callback.
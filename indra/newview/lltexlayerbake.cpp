@@ -0,0 +1,813 @@
+/**
+ * @file lltexlayerbake.cpp
+ * @brief Software compositing of avatar texture bakes, off the render thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexlayerbake.h"
+
+#include "llmath.h"
+#include "lltimer.h"
+
+// GL compares against the alpha reference with GL_GREATER, see LLRender::setAlphaRejectSettings()
+const F32 BAKE_ALPHA_REJECT = 0.01f;
+
+static inline U8 bake_to_u8(F32 value)
+{
+	// Unsigned normalized fixed point conversion, as for an RGBA8 render target
+	return (U8)(llclampf(value) * 255.f + 0.5f);
+}
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeTarget
+//-----------------------------------------------------------------------------
+
+LLTexLayerBakeTarget::LLTexLayerBakeTarget(S32 width, S32 height)
+	:
+	mImage(new LLImageRaw(width, height, 4)),
+	mWidth(width),
+	mHeight(height),
+	mColor(1.f, 1.f, 1.f, 1.f),
+	mWriteColor(TRUE),
+	mWriteAlpha(TRUE),
+	mAlphaTest(TRUE),		// LLGLSUIDefault
+	mSrcFactor(BF_SRC_ALPHA),	// LLRender::BT_ALPHA
+	mDstFactor(BF_ONE_MINUS_SRC_ALPHA),
+	mTextureBlend(TB_MULT)
+{
+	memset(mImage->getData(), 0, width * height * 4);
+}
+
+void LLTexLayerBakeTarget::setColorMask(BOOL write_color, BOOL write_alpha)
+{
+	mWriteColor = write_color;
+	mWriteAlpha = write_alpha;
+}
+
+void LLTexLayerBakeTarget::setBlendFunc(EBlendFactor sfactor, EBlendFactor dfactor)
+{
+	mSrcFactor = sfactor;
+	mDstFactor = dfactor;
+}
+
+// static
+F32 LLTexLayerBakeTarget::getFactor(EBlendFactor factor, F32 src_alpha, F32 dst_alpha)
+{
+	switch (factor)
+	{
+	case BF_ZERO:					return 0.f;
+	case BF_ONE:					return 1.f;
+	case BF_SRC_ALPHA:				return src_alpha;
+	case BF_ONE_MINUS_SRC_ALPHA:	return 1.f - src_alpha;
+	case BF_DEST_ALPHA:				return dst_alpha;
+	case BF_ONE_MINUS_DEST_ALPHA:	return 1.f - dst_alpha;
+	default:
+		llassert(0);
+		return 0.f;
+	}
+}
+
+void LLTexLayerBakeTarget::blendPixel(U8* dst, const F32* src) const
+{
+	if (mAlphaTest && !(src[3] > BAKE_ALPHA_REJECT))
+	{
+		return;
+	}
+
+	const F32 dst_alpha = dst[3] * (1.f / 255.f);
+	const F32 src_factor = getFactor(mSrcFactor, src[3], dst_alpha);
+	const F32 dst_factor = getFactor(mDstFactor, src[3], dst_alpha);
+
+	if (mWriteColor)
+	{
+		for (S32 c = 0; c < 3; c++)
+		{
+			dst[c] = bake_to_u8(src[c] * src_factor + dst[c] * (1.f / 255.f) * dst_factor);
+		}
+	}
+	if (mWriteAlpha)
+	{
+		dst[3] = bake_to_u8(src[3] * src_factor + dst_alpha * dst_factor);
+	}
+}
+
+void LLTexLayerBakeTarget::drawRect()
+{
+	F32 src[4];
+	for (S32 c = 0; c < 4; c++)
+	{
+		src[c] = llclampf(mColor.mV[c]);
+	}
+	if (mAlphaTest && !(src[3] > BAKE_ALPHA_REJECT))
+	{
+		return;
+	}
+
+	U8* dst = mImage->getData();
+	const S32 pixels = mWidth * mHeight;
+	for (S32 i = 0; i < pixels; i++)
+	{
+		blendPixel(dst, src);
+		dst += 4;
+	}
+}
+
+void LLTexLayerBakeTarget::drawImage(const LLImageRaw* image, BOOL is_alpha)
+{
+	if (!image)
+	{
+		return;
+	}
+	llassert(image->getWidth() == mWidth && image->getHeight() == mHeight);
+	if (image->getWidth() != mWidth || image->getHeight() != mHeight)
+	{
+		return;
+	}
+
+	// Which channels the texture supplies, by GL format:
+	// GL_LUMINANCE, GL_ALPHA, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA
+	const S32 components = image->getComponents();
+	const BOOL has_color = !(components == 1 && is_alpha);
+	const BOOL has_alpha = (components == 2 || components == 4 || (components == 1 && is_alpha));
+	const S32 alpha_offset = components - 1;
+
+	F32 color[4];
+	for (S32 c = 0; c < 4; c++)
+	{
+		color[c] = llclampf(mColor.mV[c]);
+	}
+	const BOOL modulate = (mTextureBlend == TB_MULT);
+
+	const U8* in = image->getData();
+	U8* dst = mImage->getData();
+	const S32 pixels = mWidth * mHeight;
+	F32 src[4];
+	for (S32 i = 0; i < pixels; i++)
+	{
+		if (has_color)
+		{
+			for (S32 c = 0; c < 3; c++)
+			{
+				// Luminance is replicated into all three channels
+				const F32 texel = in[components >= 3 ? c : 0] * (1.f / 255.f);
+				src[c] = modulate ? color[c] * texel : texel;
+			}
+		}
+		else
+		{
+			src[0] = color[0];
+			src[1] = color[1];
+			src[2] = color[2];
+		}
+
+		if (has_alpha)
+		{
+			const F32 texel = in[alpha_offset] * (1.f / 255.f);
+			src[3] = modulate ? color[3] * texel : texel;
+		}
+		else
+		{
+			src[3] = color[3];
+		}
+
+		blendPixel(dst, src);
+		in += components;
+		dst += 4;
+	}
+}
+
+// static
+LLPointer<LLImageRaw> LLTexLayerBakeTarget::fitImage(LLImageRaw* image, S32 width, S32 height)
+{
+	LLPointer<LLImageRaw> fitted = image;
+	if (!image || (image->getWidth() == width && image->getHeight() == height))
+	{
+		return fitted;
+	}
+
+	const S32 components = image->getComponents();
+
+	// Box filter by halves down to the last level that is still at least
+	// as big as the target, which is the mip level GL would sample.
+	while ((fitted->getWidth() >= 2 * width) || (fitted->getHeight() >= 2 * height))
+	{
+		const S32 in_width = fitted->getWidth();
+		const S32 step_x = (in_width >= 2 * width) ? 2 : 1;
+		const S32 step_y = (fitted->getHeight() >= 2 * height) ? 2 : 1;
+		const S32 out_width = in_width / step_x;
+		const S32 out_height = fitted->getHeight() / step_y;
+		const S32 samples = step_x * step_y;
+
+		LLPointer<LLImageRaw> half = new LLImageRaw(out_width, out_height, components);
+		const U8* in = fitted->getData();
+		U8* out = half->getData();
+		for (S32 y = 0; y < out_height; y++)
+		{
+			const U8* row0 = in + (y * step_y) * in_width * components;
+			const U8* row1 = in + (y * step_y + step_y - 1) * in_width * components;
+			for (S32 x = 0; x < out_width; x++)
+			{
+				const S32 x0 = (x * step_x) * components;
+				const S32 x1 = (x * step_x + step_x - 1) * components;
+				for (S32 c = 0; c < components; c++)
+				{
+					S32 sum = row0[x0 + c];
+					if (step_x == 2)
+					{
+						sum += row0[x1 + c];
+					}
+					if (step_y == 2)
+					{
+						sum += row1[x0 + c];
+						if (step_x == 2)
+						{
+							sum += row1[x1 + c];
+						}
+					}
+					*out++ = (U8)((sum + samples / 2) / samples);
+				}
+			}
+		}
+		fitted = half;
+	}
+
+	if (fitted->getWidth() == width && fitted->getHeight() == height)
+	{
+		return fitted;
+	}
+
+	// GL_LINEAR with GL_CLAMP_TO_EDGE, sampling at pixel centers
+	const S32 in_width = fitted->getWidth();
+	const S32 in_height = fitted->getHeight();
+	const F32 scale_x = (F32)in_width / (F32)width;
+	const F32 scale_y = (F32)in_height / (F32)height;
+
+	LLPointer<LLImageRaw> scaled = new LLImageRaw(width, height, components);
+	const U8* in = fitted->getData();
+	U8* out = scaled->getData();
+	for (S32 y = 0; y < height; y++)
+	{
+		const F32 fy = llclamp(((F32)y + 0.5f) * scale_y - 0.5f, 0.f, (F32)(in_height - 1));
+		const S32 y0 = (S32)fy;
+		const S32 y1 = llmin(y0 + 1, in_height - 1);
+		const F32 wy = fy - (F32)y0;
+		for (S32 x = 0; x < width; x++)
+		{
+			const F32 fx = llclamp(((F32)x + 0.5f) * scale_x - 0.5f, 0.f, (F32)(in_width - 1));
+			const S32 x0 = (S32)fx;
+			const S32 x1 = llmin(x0 + 1, in_width - 1);
+			const F32 wx = fx - (F32)x0;
+
+			const U8* p00 = in + (y0 * in_width + x0) * components;
+			const U8* p01 = in + (y0 * in_width + x1) * components;
+			const U8* p10 = in + (y1 * in_width + x0) * components;
+			const U8* p11 = in + (y1 * in_width + x1) * components;
+			for (S32 c = 0; c < components; c++)
+			{
+				const F32 top = p00[c] + (p01[c] - p00[c]) * wx;
+				const F32 bottom = p10[c] + (p11[c] - p10[c]) * wx;
+				*out++ = (U8)llclamp((S32)(top + (bottom - top) * wy + 0.5f), 0, 255);
+			}
+		}
+	}
+	return scaled;
+}
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBake
+//-----------------------------------------------------------------------------
+
+LLTexLayerBake::AlphaParam::AlphaParam()
+	:
+	mMultiplyBlend(FALSE),
+	mWeight(0.f)
+{
+}
+
+LLTexLayerBake::Layer::Layer()
+	:
+	mColorSpecified(FALSE),
+	mComposited(TRUE),
+	mWriteAllChannels(FALSE),
+	mUseLocalTextureAlphaOnly(FALSE),
+	mHasLocalTexture(FALSE),
+	mHasStaticImage(FALSE),
+	mStaticImageIsMask(FALSE),
+	mHasAlphaParams(FALSE),
+	mFirstAlphaMultiply(FALSE),
+	mWantsAlphaData(FALSE)
+{
+	mNetColor.setToWhite();
+}
+
+LLTexLayerBake::LLTexLayerBake(S32 width, S32 height)
+	:
+	mWidth(width),
+	mHeight(height),
+	mIsVisible(TRUE),
+	mClearAlpha(TRUE),
+	mHasStaticAlpha(FALSE),
+	mDone(FALSE),
+	mSuccess(FALSE),
+	mBakeTime(0.f)
+{
+}
+
+LLTexLayerBake::~LLTexLayerBake()
+{
+}
+
+void LLTexLayerBake::bake()
+{
+	LLTimer timer;
+
+	fitImages();
+
+	LLTexLayerBakeTarget target(mWidth, mHeight);
+	mSuccess = render(target);
+
+	// As in LLTexLayerSetBuffer::readBackAndUpload(), the color is read
+	// back first, since gathering the alpha masks reuses the target.
+	const S32 pixels = mWidth * mHeight;
+	mBakedImage = new LLImageRaw(mWidth, mHeight, 5);
+	U8* baked_data = mBakedImage->getData();
+	const U8* color_data = target.getImage()->getData();
+	for (S32 i = 0; i < pixels; i++)
+	{
+		baked_data[5 * i + 0] = color_data[4 * i + 0];
+		baked_data[5 * i + 1] = color_data[4 * i + 1];
+		baked_data[5 * i + 2] = color_data[4 * i + 2];
+		baked_data[5 * i + 3] = color_data[4 * i + 3];
+	}
+
+	std::vector<U8> mask_data(pixels);
+	gatherAlphaMasks(target, &mask_data[0]);
+	for (S32 i = 0; i < pixels; i++)
+	{
+		baked_data[5 * i + 4] = mask_data[i];
+	}
+
+	mBakeTime = timer.getElapsedTimeF32();
+}
+
+void LLTexLayerBake::fitImage(LLPointer<LLImageRaw>& image)
+{
+	if (image.notNull())
+	{
+		image = LLTexLayerBakeTarget::fitImage(image, mWidth, mHeight);
+	}
+}
+
+void LLTexLayerBake::fitImages()
+{
+	fitImage(mStaticAlphaImage);
+	for (S32 pass = 0; pass < 2; pass++)
+	{
+		layer_list_t& layers = pass ? mMaskLayers : mLayers;
+		for (layer_list_t::iterator iter = layers.begin(); iter != layers.end(); ++iter)
+		{
+			Layer& layer = *iter;
+			fitImage(layer.mLocalImage);
+			fitImage(layer.mStaticImage);
+			for (alpha_param_list_t::iterator param_iter = layer.mAlphaParams.begin();
+				 param_iter != layer.mAlphaParams.end(); ++param_iter)
+			{
+				fitImage(param_iter->mImage);
+			}
+		}
+	}
+}
+
+// The functions below follow their GL counterparts in lltexlayer.cpp
+// draw for draw, including where they leave state behind for the next
+// draw, so a change to one must be made to the other.
+
+// See LLTexLayerSet::render()
+BOOL LLTexLayerBake::render(LLTexLayerBakeTarget& target)
+{
+	BOOL success = TRUE;
+
+	// clear buffer area to ensure we don't pick up UI elements
+	target.setAlphaTest(FALSE);
+	target.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+	target.drawRect();
+	target.setAlphaTest(TRUE);
+
+	if (mIsVisible)
+	{
+		// composite color layers
+		for (layer_list_t::iterator iter = mLayers.begin(); iter != mLayers.end(); ++iter)
+		{
+			Layer& layer = *iter;
+			if (layer.mComposited)
+			{
+				success &= renderLayer(target, layer);
+			}
+		}
+
+		renderAlphaMaskTextures(target, FALSE);
+	}
+	else
+	{
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ZERO);
+		target.setAlphaTest(FALSE);
+		target.setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+		target.drawRect();
+		target.setAlphaTest(TRUE);
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_SRC_ALPHA, LLTexLayerBakeTarget::BF_ONE_MINUS_SRC_ALPHA);
+	}
+
+	return success;
+}
+
+// See LLTexLayer::render()
+BOOL LLTexLayerBake::renderLayer(LLTexLayerBakeTarget& target, Layer& layer)
+{
+	BOOL success = TRUE;
+
+	// If you can't see the layer, don't render it.
+	if (is_approx_zero(layer.mNetColor.mV[VW]))
+	{
+		return success;
+	}
+
+	BOOL alpha_mask_specified = FALSE;
+	if (layer.mHasAlphaParams)
+	{
+		renderAlphaMasks(target, layer, layer.mNetColor);
+		alpha_mask_specified = TRUE;
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_DEST_ALPHA, LLTexLayerBakeTarget::BF_ONE_MINUS_DEST_ALPHA);
+	}
+
+	target.setColor(layer.mNetColor);
+
+	if (layer.mWriteAllChannels)
+	{
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ZERO);
+	}
+	else if (layer.mUseLocalTextureAlphaOnly)
+	{
+		// Use the alpha channel only
+		target.setColorMask(FALSE, TRUE);
+	}
+
+	if (layer.mHasLocalTexture && !layer.mUseLocalTextureAlphaOnly && layer.mLocalImage.notNull())
+	{
+		target.setAlphaTest(!layer.mWriteAllChannels);
+		target.drawImage(layer.mLocalImage, FALSE);
+		target.setAlphaTest(TRUE);
+	}
+
+	if (layer.mHasStaticImage)
+	{
+		if (layer.mStaticImage.notNull())
+		{
+			target.drawImage(layer.mStaticImage, layer.mStaticImageIsMask);
+		}
+		else
+		{
+			success = FALSE;
+		}
+	}
+
+	if ((!layer.mHasLocalTexture || layer.mUseLocalTextureAlphaOnly) &&
+		!layer.mHasStaticImage &&
+		layer.mColorSpecified)
+	{
+		target.setAlphaTest(FALSE);
+		target.setColor(layer.mNetColor);
+		target.drawRect();
+		target.setAlphaTest(TRUE);
+	}
+
+	if (alpha_mask_specified || layer.mWriteAllChannels)
+	{
+		// Restore standard blend func value
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_SRC_ALPHA, LLTexLayerBakeTarget::BF_ONE_MINUS_SRC_ALPHA);
+	}
+
+	if (layer.mUseLocalTextureAlphaOnly)
+	{
+		// Restore color + alpha mode.
+		target.setColorMask(TRUE, TRUE);
+	}
+
+	return success;
+}
+
+// See LLTexLayer::renderAlphaMasks() and LLTexLayerParamAlpha::render()
+BOOL LLTexLayerBake::renderAlphaMasks(LLTexLayerBakeTarget& target, Layer& layer, const LLColor4& color)
+{
+	BOOL success = TRUE;
+
+	target.setColorMask(FALSE, TRUE);
+
+	// Note: if the first param is a mulitply, multiply against the current buffer's alpha
+	if (!layer.mFirstAlphaMultiply)
+	{
+		// Clear the alpha
+		target.setAlphaTest(FALSE);
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ZERO);
+		target.setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+		target.drawRect();
+	}
+
+	// Accumulate alphas
+	target.setAlphaTest(FALSE);
+	target.setColor(LLColor4(1.f, 1.f, 1.f, 1.f));
+
+	for (alpha_param_list_t::iterator iter = layer.mAlphaParams.begin(); iter != layer.mAlphaParams.end(); ++iter)
+	{
+		const AlphaParam& param = *iter;
+		if (param.mMultiplyBlend)
+		{
+			// Multiplication: approximates a min() function
+			target.setBlendFunc(LLTexLayerBakeTarget::BF_DEST_ALPHA, LLTexLayerBakeTarget::BF_ZERO);
+		}
+		else
+		{
+			// Addition: approximates a max() function
+			target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ONE);
+		}
+
+		if (param.mImage.notNull())
+		{
+			// Drawn with whatever the current color is, as in GL
+			target.drawImage(param.mImage, TRUE);
+		}
+		else
+		{
+			target.setColor(LLColor4(0.f, 0.f, 0.f, param.mWeight));
+			target.drawRect();
+		}
+	}
+
+	// Approximates a min() function
+	target.setBlendFunc(LLTexLayerBakeTarget::BF_DEST_ALPHA, LLTexLayerBakeTarget::BF_ZERO);
+
+	// Accumulate the alpha component of the texture
+	if (layer.mHasLocalTexture && layer.mLocalImage.notNull() && layer.mLocalImage->getComponents() == 4)
+	{
+		target.drawImage(layer.mLocalImage, FALSE);
+	}
+
+	if (layer.mHasStaticImage && layer.mStaticImage.notNull())
+	{
+		const S32 components = layer.mStaticImage->getComponents();
+		if (components == 4 || (components == 1 && layer.mStaticImageIsMask))
+		{
+			target.drawImage(layer.mStaticImage, layer.mStaticImageIsMask);
+		}
+	}
+
+	// Draw a rectangle with the layer color to multiply the alpha by that color's alpha.
+	if (color.mV[VW] != 1.f)
+	{
+		target.setColor(color);
+		target.drawRect();
+	}
+
+	target.setAlphaTest(TRUE);
+	target.setColorMask(TRUE, TRUE);
+
+	if (success && layer.mWantsAlphaData)
+	{
+		const S32 pixels = mWidth * mHeight;
+		if (layer.mAlphaData.isNull())
+		{
+			layer.mAlphaData = new LLImageRaw(mWidth, mHeight, 1);
+		}
+		U8* alpha_data = layer.mAlphaData->getData();
+		const U8* color_data = target.getImage()->getData();
+		for (S32 i = 0; i < pixels; i++)
+		{
+			alpha_data[i] = color_data[4 * i + 3];
+		}
+	}
+
+	return success;
+}
+
+// See LLTexLayerSet::renderAlphaMaskTextures() and LLTexLayer::blendAlphaTexture()
+void LLTexLayerBake::renderAlphaMaskTextures(LLTexLayerBakeTarget& target, BOOL force_clear)
+{
+	target.setColorMask(FALSE, TRUE);
+	target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ZERO);
+
+	// (Optionally) replace alpha with a single component image from a tga file.
+	if (mHasStaticAlpha)
+	{
+		if (mStaticAlphaImage.notNull())
+		{
+			// The GL path draws this under LLGLSUIDefault, alpha test and all
+			target.setAlphaTest(TRUE);
+			target.setTextureBlendType(LLTexLayerBakeTarget::TB_REPLACE);
+			target.drawImage(mStaticAlphaImage, TRUE);
+		}
+	}
+	else if (force_clear || mClearAlpha || !mMaskLayers.empty())
+	{
+		// Set the alpha channel to one (clean up after previous blending)
+		target.setAlphaTest(FALSE);
+		target.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		target.drawRect();
+		target.setAlphaTest(TRUE);
+	}
+
+	// (Optional) Mask out part of the baked texture with alpha masks
+	// will still have an effect even if mClearAlpha is set or the alpha component was replaced
+	if (!mMaskLayers.empty())
+	{
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_DEST_ALPHA, LLTexLayerBakeTarget::BF_ZERO);
+		target.setTextureBlendType(LLTexLayerBakeTarget::TB_REPLACE);
+		target.setAlphaTest(FALSE);
+		for (layer_list_t::iterator iter = mMaskLayers.begin(); iter != mMaskLayers.end(); ++iter)
+		{
+			const Layer& layer = *iter;
+			if (layer.mHasStaticImage)
+			{
+				target.drawImage(layer.mStaticImage, layer.mStaticImageIsMask);
+			}
+			else if (layer.mHasLocalTexture)
+			{
+				target.drawImage(layer.mLocalImage, FALSE);
+			}
+		}
+		target.setAlphaTest(TRUE);
+	}
+
+	target.setTextureBlendType(LLTexLayerBakeTarget::TB_MULT);
+	target.setColorMask(TRUE, TRUE);
+	target.setBlendFunc(LLTexLayerBakeTarget::BF_SRC_ALPHA, LLTexLayerBakeTarget::BF_ONE_MINUS_SRC_ALPHA);
+}
+
+// See LLTexLayerSet::gatherAlphaMasks()
+void LLTexLayerBake::gatherAlphaMasks(LLTexLayerBakeTarget& target, U8* data)
+{
+	const S32 size = mWidth * mHeight;
+
+	memset(data, 255, size);
+
+	for (layer_list_t::iterator iter = mLayers.begin(); iter != mLayers.end(); ++iter)
+	{
+		Layer& layer = *iter;
+		if (!layer.mHasAlphaParams)
+		{
+			continue;
+		}
+
+		// Only layers with masked morphs keep their alpha, see LLTexLayer::renderAlphaMasks()
+		if (renderAlphaMasks(target, layer, layer.mNetColor) && layer.mWantsAlphaData)
+		{
+			const U8* alpha_data = layer.mAlphaData->getData();
+			for (S32 i = 0; i < size; i++)
+			{
+				U16 result_alpha = data[i];
+				result_alpha *= (alpha_data[i] + 1);
+				result_alpha = result_alpha >> 8;
+				data[i] = (U8)result_alpha;
+			}
+		}
+	}
+
+	// Set alpha back to that of our alpha masks.
+	renderAlphaMaskTextures(target, TRUE);
+}
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeThread
+//-----------------------------------------------------------------------------
+
+// static
+LLTexLayerBakeThread::thread_list_t LLTexLayerBakeThread::sThreads;
+
+LLTexLayerBakeThread::LLTexLayerBakeThread(bool threaded)
+	: LLQueuedThread("texlayerbake", threaded)
+{
+}
+
+LLTexLayerBakeThread::handle_t LLTexLayerBakeThread::addBake(LLTexLayerBake* bake, U32 priority)
+{
+	handle_t handle = generateHandle();
+	BakeRequest* req = new BakeRequest(handle, priority, bake);
+	if (!addRequest(req))
+	{
+		req->deleteRequest();
+		handle = nullHandle();
+	}
+	return handle;
+}
+
+//static
+void LLTexLayerBakeThread::initClass(S32 num_threads, bool threaded)
+{
+	llassert(sThreads.empty());
+	num_threads = llmax(num_threads, 1);
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		sThreads.push_back(new LLTexLayerBakeThread(threaded));
+	}
+}
+
+//static
+S32 LLTexLayerBakeThread::updateClass(U32 max_time_ms)
+{
+	S32 pending = 0;
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		pending += (*iter)->update(max_time_ms);
+	}
+	return pending;
+}
+
+//static
+void LLTexLayerBakeThread::cleanupClass()
+{
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		LLTexLayerBakeThread* thread = *iter;
+		thread->setQuitting();
+		while (thread->getPending())
+		{
+			thread->update(0);
+		}
+		delete thread;
+	}
+	sThreads.clear();
+}
+
+//static
+void LLTexLayerBakeThread::queueBake(LLTexLayerBake* bake, U32 priority)
+{
+	LLTexLayerBakeThread* best = NULL;
+	S32 best_pending = 0;
+	for (thread_list_t::iterator iter = sThreads.begin(); iter != sThreads.end(); ++iter)
+	{
+		S32 pending = (*iter)->getPending();
+		if (!best || pending < best_pending)
+		{
+			best = *iter;
+			best_pending = pending;
+		}
+	}
+
+	if (!best || best->addBake(bake, priority) == nullHandle())
+	{
+		// No threads (or shutting down): bake in place so the caller still gets a result
+		bake->bake();
+		bake->postBake();
+		bake->setDone();
+	}
+}
+
+LLTexLayerBakeThread::BakeRequest::BakeRequest(handle_t handle, U32 priority, LLTexLayerBake* bake)
+	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	  mBake(bake)
+{
+}
+
+LLTexLayerBakeThread::BakeRequest::~BakeRequest()
+{
+}
+
+void LLTexLayerBakeThread::BakeRequest::deleteRequest()
+{
+	LLQueuedThread::QueuedRequest::deleteRequest();
+}
+
+// Called from the baking thread (or the main thread when not threaded)
+bool LLTexLayerBakeThread::BakeRequest::processRequest()
+{
+	mBake->bake();
+	mBake->postBake();
+	mBake->setDone();
+	return true;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file lltexlayerbake.h
+ * @brief Software compositing of avatar texture bakes, off the render thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXLAYERBAKE_H
+#define LL_LLTEXLAYERBAKE_H
+
+#include <string>
+#include <vector>
+#include "llimage.h"
+#include "llqueuedthread.h"
+#include "v4color.h"
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeTarget
+// A software stand-in for the render target LLTexLayerSetBuffer composites
+// into. It only implements the fixed function state the tex layer code
+// touches (current color, color mask, blend function, alpha test and
+// texture environment), and every draw covers the whole target, just like
+// gl_rect_2d_simple() and gl_rect_2d_simple_tex() do there.
+//-----------------------------------------------------------------------------
+class LLTexLayerBakeTarget
+{
+public:
+	enum EBlendFactor
+	{
+		BF_ZERO,
+		BF_ONE,
+		BF_SRC_ALPHA,
+		BF_ONE_MINUS_SRC_ALPHA,
+		BF_DEST_ALPHA,
+		BF_ONE_MINUS_DEST_ALPHA
+	};
+
+	enum ETextureBlend
+	{
+		TB_MULT,		// GL_MODULATE
+		TB_REPLACE		// GL_REPLACE
+	};
+
+	LLTexLayerBakeTarget(S32 width, S32 height);
+
+	void					setColor(const LLColor4& color)			{ mColor = color; }
+	void					setColorMask(BOOL write_color, BOOL write_alpha);
+	void					setBlendFunc(EBlendFactor sfactor, EBlendFactor dfactor);
+	void					setAlphaTest(BOOL enable)				{ mAlphaTest = enable; }
+	void					setTextureBlendType(ETextureBlend type)	{ mTextureBlend = type; }
+
+	// Fills the target with the current color.
+	void					drawRect();
+	// Draws image over the whole target, combined with the current color by
+	// the texture environment. The image must already be the size of the
+	// target (see fitImage()). Single component images are luminance unless
+	// is_alpha is set, which matches a GL_ALPHA texture.
+	void					drawImage(const LLImageRaw* image, BOOL is_alpha);
+
+	LLImageRaw*				getImage()								{ return mImage; }
+	S32						getWidth() const						{ return mWidth; }
+	S32						getHeight() const						{ return mHeight; }
+
+	// Returns image resampled to width by height. Power of two reductions
+	// are box filtered like mip levels, whatever is left is sampled
+	// bilinearly with clamped edges. Returns image itself if it already fits.
+	static LLPointer<LLImageRaw> fitImage(LLImageRaw* image, S32 width, S32 height);
+
+private:
+	void					blendPixel(U8* dst, const F32* src) const;
+	static F32				getFactor(EBlendFactor factor, F32 src_alpha, F32 dst_alpha);
+
+private:
+	LLPointer<LLImageRaw>	mImage;
+	S32						mWidth;
+	S32						mHeight;
+	LLColor4				mColor;
+	BOOL					mWriteColor;
+	BOOL					mWriteAlpha;
+	BOOL					mAlphaTest;
+	EBlendFactor			mSrcFactor;
+	EBlendFactor			mDstFactor;
+	ETextureBlend			mTextureBlend;
+};
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBake
+// Everything LLTexLayerSet::render() and LLTexLayerSet::gatherAlphaMasks()
+// read from the avatar, captured on the main thread so the bake can be
+// composited on any thread. bake() replays the same sequence of draws on an
+// LLTexLayerBakeTarget and produces the 5 channel (RGBHM) image that
+// LLTexLayerSetBuffer::readBackAndUpload() would encode.
+//
+// All images here are private copies: LLImageRaw's reference count isn't
+// thread safe, so nothing may be shared with the main thread's caches.
+//-----------------------------------------------------------------------------
+class LLTexLayerBake : public LLThreadSafeRefCount
+{
+public:
+	struct AlphaParam
+	{
+		AlphaParam();
+
+		BOOL					mMultiplyBlend;
+		F32						mWeight;		// drawn as a constant when there is no image
+		LLPointer<LLImageRaw>	mImage;			// processed alpha gradient, drawn as GL_ALPHA
+	};
+	typedef std::vector<AlphaParam> alpha_param_list_t;
+
+	struct Layer
+	{
+		Layer();
+
+		std::string				mName;
+		LLColor4				mNetColor;
+		BOOL					mColorSpecified;
+		BOOL					mComposited;		// RP_COLOR or RP_BUMP, drawn by render()
+		BOOL					mWriteAllChannels;
+		BOOL					mUseLocalTextureAlphaOnly;
+
+		BOOL					mHasLocalTexture;	// the layer references a local texture
+		LLPointer<LLImageRaw>	mLocalImage;		// NULL if that texture is unset or the default
+
+		BOOL					mHasStaticImage;	// the layer names a static image
+		BOOL					mStaticImageIsMask;
+		LLPointer<LLImageRaw>	mStaticImage;		// NULL if it failed to load
+
+		BOOL					mHasAlphaParams;
+		BOOL					mFirstAlphaMultiply;
+		alpha_param_list_t		mAlphaParams;		// only those that aren't skipped
+
+		// Layers with masked morphs contribute their alpha to the bake's mask
+		// channel; bake() leaves a copy of that alpha in mAlphaData.
+		BOOL					mWantsAlphaData;
+		LLPointer<LLImageRaw>	mAlphaData;
+	};
+	typedef std::vector<Layer> layer_list_t;
+
+	LLTexLayerBake(S32 width, S32 height);
+
+	// Runs on the baking thread.
+	void					bake();
+	// Called on the baking thread after bake(), for work on the result such
+	// as encoding it.
+	virtual void			postBake() {}
+
+	// Set once bake() and postBake() have returned.
+	BOOL					isDone()				{ return mDone ? TRUE : FALSE; }
+	void					setDone()				{ mDone = TRUE; }
+
+	BOOL					getSuccess() const		{ return mSuccess; }
+	LLImageRaw*				getBakedImage()			{ return mBakedImage; }
+	F32						getBakeTime() const		{ return mBakeTime; }
+
+public:
+	S32						mWidth;
+	S32						mHeight;
+	BOOL					mIsVisible;
+	BOOL					mClearAlpha;
+	BOOL					mHasStaticAlpha;
+	LLPointer<LLImageRaw>	mStaticAlphaImage;
+	layer_list_t			mLayers;			// all other layers, in order
+	layer_list_t			mMaskLayers;		// visibility masks
+
+protected:
+	virtual ~LLTexLayerBake();
+
+private:
+	void					fitImages();
+	void					fitImage(LLPointer<LLImageRaw>& image);
+	BOOL					render(LLTexLayerBakeTarget& target);
+	BOOL					renderLayer(LLTexLayerBakeTarget& target, Layer& layer);
+	BOOL					renderAlphaMasks(LLTexLayerBakeTarget& target, Layer& layer, const LLColor4& color);
+	void					renderAlphaMaskTextures(LLTexLayerBakeTarget& target, BOOL force_clear);
+	void					gatherAlphaMasks(LLTexLayerBakeTarget& target, U8* data);
+
+private:
+	LLAtomic32<BOOL>		mDone;
+	BOOL					mSuccess;
+	LLPointer<LLImageRaw>	mBakedImage;
+	F32						mBakeTime;
+};
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeThread
+// The threads LLTexLayerBakes run on. Like LLVFSThread this is a static
+// pool, set up by initClass(); a bake goes to whichever thread has the
+// fewest requests pending, so bakes of different regions run side by side.
+//-----------------------------------------------------------------------------
+class LLTexLayerBakeThread : public LLQueuedThread
+{
+	class BakeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~BakeRequest(); // use deleteRequest()
+
+	public:
+		BakeRequest(handle_t handle, U32 priority, LLTexLayerBake* bake);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void deleteRequest();
+
+	private:
+		LLPointer<LLTexLayerBake> mBake;
+	};
+
+public:
+	LLTexLayerBakeThread(bool threaded = true);
+
+	handle_t				addBake(LLTexLayerBake* bake, U32 priority);
+
+	static void				initClass(S32 num_threads, bool threaded = true);
+	static S32				updateClass(U32 max_time_ms);
+	static void				cleanupClass();
+	static BOOL				isInitialized()			{ return !sThreads.empty(); }
+	// Poll bake->isDone() from the main thread for the result.
+	static void				queueBake(LLTexLayerBake* bake, U32 priority = PRIORITY_NORMAL);
+
+private:
+	typedef std::vector<LLTexLayerBakeThread*> thread_list_t;
+	static thread_list_t	sThreads;
+};
+
+#endif // LL_LLTEXLAYERBAKE_H
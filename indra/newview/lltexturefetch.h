@@ -36,6 +36,7 @@
 #include "lldir.h"
 #include "llimage.h"
 #include "lluuid.h"
+#include "lluuidmap.h"
 #include "llworkerthread.h"
 #include "llcurl.h"
 #include "lltextureinfo.h"
@@ -117,7 +118,7 @@ private:
 	LLCurlRequest* mCurlGetRequest;
 	
 	// Map of all requests by UUID
-	typedef std::map<LLUUID,LLTextureFetchWorker*> map_t;
+	typedef LLUUIDMap<LLTextureFetchWorker*> map_t;
 	map_t mRequestMap;
 
 	// Set of requests that require network data
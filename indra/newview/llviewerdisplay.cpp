@@ -39,6 +39,7 @@
 #include "llglheaders.h"
 #include "llagent.h"
 #include "llviewercontrol.h"
+#include "llviewersettingshandles.h"
 #include "llcoord.h"
 #include "llcriticaldamp.h"
 #include "lldir.h"
@@ -210,7 +211,7 @@ void display_stats()
 		gRecentFrameCount = 0;
 		gRecentFPSTime.reset();
 	}
-	F32 fps_log_freq = gSavedSettings.getF32("FPSLogFrequency");
+	F32 fps_log_freq = gSavedSettings.getF32(LLSavedSettings::FPSLogFrequency);
 	if (fps_log_freq > 0.f && gRecentFPSTime.getElapsedTimeF32() >= fps_log_freq)
 	{
 		F32 fps = gRecentFrameCount / fps_log_freq;
@@ -218,7 +219,7 @@ void display_stats()
 		gRecentFrameCount = 0;
 		gRecentFPSTime.reset();
 	}
-	F32 mem_log_freq = gSavedSettings.getF32("MemoryLogFrequency");
+	F32 mem_log_freq = gSavedSettings.getF32(LLSavedSettings::MemoryLogFrequency);
 	if (mem_log_freq > 0.f && gRecentMemoryTime.getElapsedTimeF32() >= mem_log_freq)
 	{
 		gMemoryAllocated = getCurrentRSS();
@@ -330,8 +331,8 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 
 	LLImageGL::updateStats(gFrameTimeSeconds);
 	
-	LLVOAvatar::sRenderName = gSavedSettings.getS32("RenderName");
-	LLVOAvatar::sRenderGroupTitles = !gSavedSettings.getBOOL("RenderHideGroupTitleAll");
+	LLVOAvatar::sRenderName = gSavedSettings.getS32(LLSavedSettings::RenderName);
+	LLVOAvatar::sRenderGroupTitles = !gSavedSettings.getBOOL(LLSavedSettings::RenderHideGroupTitleAll);
 	
 	gPipeline.mBackfaceCull = TRUE;
 	gFrameCount++;
@@ -373,7 +374,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			// Transition to REQUESTED.  Viewer has sent some kind
 			// of TeleportRequest to the source simulator
 			gTeleportDisplayTimer.reset();
-			if(!gSavedSettings.getBOOL("AscentDisableTeleportScreens"))gViewerWindow->setShowProgress(TRUE);
+			if(!gSavedSettings.getBOOL(LLSavedSettings::AscentDisableTeleportScreens))gViewerWindow->setShowProgress(TRUE);
 			gViewerWindow->setProgressPercent(0);
 			gAgent.setTeleportState( LLAgent::TELEPORT_REQUESTED );
 			gAgent.setTeleportMessage(
@@ -401,14 +402,14 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			gAgent.setTeleportMessage(
 				LLAgent::sTeleportProgressMessages["arriving"]);
 			gImageList.mForceResetTextureStats = TRUE;
-			if(!gSavedSettings.getBOOL("AscentDisableTeleportScreens"))gAgent.resetView(TRUE, TRUE);
+			if(!gSavedSettings.getBOOL(LLSavedSettings::AscentDisableTeleportScreens))gAgent.resetView(TRUE, TRUE);
 			break;
 
 		case LLAgent::TELEPORT_ARRIVING:
 			// Make the user wait while content "pre-caches"
 			{
 				F32 arrival_fraction = (gTeleportArrivalTimer.getElapsedTimeF32() / TELEPORT_ARRIVAL_DELAY);
-				if( arrival_fraction > 1.f || gSavedSettings.getBOOL("AscentDisableTeleportScreens"))
+				if( arrival_fraction > 1.f || gSavedSettings.getBOOL(LLSavedSettings::AscentDisableTeleportScreens))
 				{
 					arrival_fraction = 1.f;
 					LLFirstUse::useTeleport();
@@ -488,10 +489,10 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 	if (gSavedDrawDistance > 0.0f && gAgent.getTeleportState() == LLAgent::TELEPORT_NONE)
 	{
 		if (gTeleportArrivalTimer.getElapsedTimeF32() >=
-			(F32)gSavedSettings.getU32("SpeedRezInterval"))
+			(F32)gSavedSettings.getU32(LLSavedSettings::SpeedRezInterval))
 		{
 			gTeleportArrivalTimer.reset();
-			F32 current = gSavedSettings.getF32("RenderFarClip");
+			F32 current = gSavedSettings.getF32(LLSavedSettings::RenderFarClip);
 			if (gSavedDrawDistance > current)
 			{
 				current *= 2.0;
@@ -499,12 +500,12 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 				{
 					current = gSavedDrawDistance;
 				}
-				gSavedSettings.setF32("RenderFarClip", current);
+				gSavedSettings.setF32(LLSavedSettings::RenderFarClip, current);
 			}
 			if (current >= gSavedDrawDistance)
 			{
 				gSavedDrawDistance = 0.0f;
-				gSavedSettings.setF32("SavedRenderFarClip", 0.0f);
+				gSavedSettings.setF32(LLSavedSettings::SavedRenderFarClip, 0.0f);
 			}
 		}
 	}
@@ -637,7 +638,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		LLPipeline::sUseOcclusion = 
 				(!gUseWireframe
 				&& LLFeatureManager::getInstance()->isFeatureAvailable("UseOcclusion") 
-				&& gSavedSettings.getBOOL("UseOcclusion") 
+				&& gSavedSettings.getBOOL(LLSavedSettings::UseOcclusion) 
 				&& gGLManager.mHasOcclusionQuery) ? 2 : 0;
 
 		if (LLPipeline::sUseOcclusion && LLPipeline::sRenderDeferred)
@@ -645,10 +646,10 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			LLPipeline::sUseOcclusion = 3;
 		}
 
-		LLPipeline::sFastAlpha = gSavedSettings.getBOOL("RenderFastAlpha");
-		LLPipeline::sUseFarClip = gSavedSettings.getBOOL("RenderUseFarClip");
-		LLVOAvatar::sMaxVisible = gSavedSettings.getS32("RenderAvatarMaxVisible");
-		LLPipeline::sDelayVBUpdate = gSavedSettings.getBOOL("RenderDelayVBUpdate");
+		LLPipeline::sFastAlpha = gSavedSettings.getBOOL(LLSavedSettings::RenderFastAlpha);
+		LLPipeline::sUseFarClip = gSavedSettings.getBOOL(LLSavedSettings::RenderUseFarClip);
+		LLVOAvatar::sMaxVisible = gSavedSettings.getS32(LLSavedSettings::RenderAvatarMaxVisible);
+		LLPipeline::sDelayVBUpdate = gSavedSettings.getBOOL(LLSavedSettings::RenderDelayVBUpdate);
 
 		S32 occlusion = LLPipeline::sUseOcclusion;
 		if (gDepthDirty)
@@ -970,7 +971,7 @@ void render_hud_attachments()
 		hud_cam.setAxes(LLVector3(1,0,0), LLVector3(0,1,0), LLVector3(0,0,1));
 		LLViewerCamera::updateFrustumPlanes(hud_cam, TRUE);
 
-		bool render_particles = gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_PARTICLES) && gSavedSettings.getBOOL("RenderHUDParticles");
+		bool render_particles = gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_PARTICLES) && gSavedSettings.getBOOL(LLSavedSettings::RenderHUDParticles);
 		
 		//only render hud objects
 		U32 mask = gPipeline.getRenderTypeMask();
@@ -1259,7 +1260,7 @@ void render_ui_3d()
 	// Debugging stuff goes before the UI.
 
 	// Coordinate axes
-	if (gSavedSettings.getBOOL("ShowAxes"))
+	if (gSavedSettings.getBOOL(LLSavedSettings::ShowAxes))
 	{
 		draw_axes();
 	}
@@ -381,7 +381,10 @@ void LLViewerImage::init(bool firstinit)
 	{
 		mDecodePriority = 0.f;
 		mInImageList = 0;
+		mPriorityHeapIndex = -1;
 	}
+	mPriorityVirtualSize = 0.f;
+	mWaitingForFullRes = FALSE;
 	mIsMediaTexture = FALSE;
 
 	mBoostLevel =  LLViewerImageBoostLevel::BOOST_NONE;
@@ -622,6 +625,12 @@ BOOL LLViewerImage::createTexture(S32 usename/*= 0*/)
 		res = LLImageGL::createGLTexture(mRawDiscardLevel, mRawImage, usename);
 	}
 
+	if (res && mWaitingForFullRes && getDiscardLevel() >= 0 && getDiscardLevel() <= mDesiredDiscardLevel)
+	{
+		mWaitingForFullRes = FALSE;
+		gImageList.addTimeToFullRes(mFullResTimer.getElapsedTimeF32());
+	}
+
 	//
 	// Iterate through the list of image loading callbacks to see
 	// what sort of data they need.
@@ -668,6 +677,14 @@ void LLViewerImage::addTextureStats(F32 virtual_size, BOOL needs_gltexture) cons
 	{
 		mMaxVirtualSize = virtual_size;
 	}	
+
+	if (mInImageList && virtual_size > 10.f && virtual_size > mPriorityVirtualSize * 1.25f)
+	{
+		// Wanted noticeably bigger than when the decode priority was last
+		// calculated (usually it just came into view), don't wait for the
+		// round robin update to get to it.
+		gImageList.requestPriorityUpdate(const_cast<LLViewerImage*>(this), virtual_size);
+	}
 }
 
 void LLViewerImage::resetTextureStats()
@@ -696,7 +713,11 @@ void LLViewerImage::processTextureStats()
 	//	return ;
 	//}
 
+	// No priority update requests from our own faces, this is the update.
+	mPriorityVirtualSize = F32_MAX;
 	updateVirtualSize() ;
+	mPriorityVirtualSize = mMaxVirtualSize;
+
 	// Generate the request priority and render priority
 	if (mDontDiscard || !getUseMipMaps())
 	{
@@ -1368,6 +1389,7 @@ void LLViewerImage::setIsMissingAsset()
 		mFetchPriority = 0;
 	}
 	mIsMissingAsset = TRUE;
+	mWaitingForFullRes = FALSE;
 }
 
 //============================================================================
@@ -348,6 +348,8 @@ public:
 	F32 mDiscardVirtualSize;		// Virtual size used to calculate desired discard
 	
 	S8  mInImageList;				// TRUE if image is in list (in which case don't reset priority!)
+	S32 mPriorityHeapIndex;			// Position in LLViewerImageList's priority update heap, -1 if not in it
+	F32 mPriorityVirtualSize;		// mMaxVirtualSize when the texture stats were last processed
 	S8  mIsMediaTexture;			// TRUE if image is being replaced by media (in which case don't update)
 
 	// Various info regarding image requests
@@ -364,6 +366,8 @@ public:
 	// Timers
 	LLFrameTimer mLastPacketTimer;		// Time since last packet.
 	LLFrameTimer mLastReferencedTimer;
+	LLFrameTimer mFullResTimer;		// Time since the image started waiting for its desired discard level
+	BOOL mWaitingForFullRes;
 
 	std::map<std::string,std::pair<std::string,unsigned int> > decodedComment;
 
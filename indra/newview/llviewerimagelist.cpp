@@ -49,6 +49,7 @@
 #include "llvfs.h"
 #include "llvfile.h"
 #include "llvfsthread.h"
+#include "llxmlcache.h"
 #include "llxmltree.h"
 #include "message.h"
 
@@ -64,6 +65,7 @@
 #include "llappviewer.h"
 
 #include <sys/stat.h>
+#include <algorithm>
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -81,11 +83,26 @@ LLStat LLViewerImageList::sGLTexMemStat(32, TRUE);
 LLStat LLViewerImageList::sGLBoundMemStat(32, TRUE);
 LLStat LLViewerImageList::sRawMemStat(32, TRUE);
 LLStat LLViewerImageList::sFormattedMemStat(32, TRUE);
+LLStat LLViewerImageList::sTimeToFullResStat(32, TRUE);
+
+static void set_priority_heap_index(LLViewerImage* &imagep, const S32 index)
+{
+	imagep->mPriorityHeapIndex = index;
+}
+
+static S32 get_priority_heap_index(LLViewerImage* const &imagep)
+{
+	return imagep->mPriorityHeapIndex;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
 LLViewerImageList::LLViewerImageList() 
 	: mForceResetTextureStats(FALSE),
+	mPriorityUpdateHeap(&set_priority_heap_index, &get_priority_heap_index),
+	mNextTimeToFullRes(0),
+	mTimeToFullResMedian(0.f),
+	mTimeToFullResChanged(FALSE),
 	mUpdateStats(FALSE),
 	mMaxResidentTexMemInMegaBytes(0),
 	mMaxTotalTextureMemInMegaBytes(0)
@@ -276,6 +293,8 @@ void LLViewerImageList::shutdown()
 	// Flush all of the references
 	mLoadingStreamList.clear();
 	mCreateTextureList.clear();
+	mPriorityUpdateHeap.clear();
+	mPriorityUpdatedImages.clear();
 	
 	mUUIDMap.clear();
 	
@@ -502,6 +521,8 @@ void LLViewerImageList::deleteImage(LLViewerImage *image)
 			mCallbackList.erase((LLViewerImage*)image);
 		}
 
+		mPriorityUpdateHeap.remove(image);
+
 		llverify(mUUIDMap.erase(image->getID()) == 1);
 		sNumImages--;
 		removeImageFromList(image);
@@ -518,6 +539,26 @@ void LLViewerImageList::dirtyImage(LLViewerImage *image)
 	mDirtyTextureList.insert(image);
 }
 
+void LLViewerImageList::requestPriorityUpdate(LLViewerImage *image, F32 virtual_size)
+{
+	mPriorityUpdateHeap.raise(virtual_size, image);
+}
+
+void LLViewerImageList::addTimeToFullRes(F32 seconds)
+{
+	const U32 MAX_SAMPLES = 128;
+	if (mTimeToFullRes.size() < MAX_SAMPLES)
+	{
+		mTimeToFullRes.push_back(seconds);
+	}
+	else
+	{
+		mTimeToFullRes[mNextTimeToFullRes] = seconds;
+		mNextTimeToFullRes = (mNextTimeToFullRes + 1) % MAX_SAMPLES;
+	}
+	mTimeToFullResChanged = TRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 
 void LLViewerImageList::updateImages(F32 max_time)
@@ -531,6 +572,17 @@ void LLViewerImageList::updateImages(F32 max_time)
 	sGLBoundMemStat.addValue((F32)BYTES_TO_MEGA_BYTES(LLImageGL::sBoundTextureMemoryInBytes));
 	sRawMemStat.addValue((F32)BYTES_TO_MEGA_BYTES(LLImageRaw::sGlobalRawMemory));
 	sFormattedMemStat.addValue((F32)BYTES_TO_MEGA_BYTES(LLImageFormatted::sGlobalFormattedMemory));
+	if (mTimeToFullResChanged)
+	{
+		std::vector<F32> samples(mTimeToFullRes);
+		std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+		mTimeToFullResMedian = samples[samples.size() / 2];
+		mTimeToFullResChanged = FALSE;
+	}
+	if (!mTimeToFullRes.empty())
+	{
+		sTimeToFullResStat.addValue(mTimeToFullResMedian);
+	}
 
 	llpushcallstacks ;
 
@@ -582,6 +634,34 @@ void LLViewerImageList::updateImages(F32 max_time)
 
 void LLViewerImageList::updateImagesDecodePriorities()
 {
+	// Images that were just asked for at a larger size go first, biggest first.
+	// They are fetched right away too, see updateImagesFetchTextures().
+	mPriorityUpdatedImages.clear();
+	{
+		const S32 max_update_count = 256;
+		LLViewerImage* imagep;
+		while ((S32)mPriorityUpdatedImages.size() < max_update_count && mPriorityUpdateHeap.pop(&imagep))
+		{
+			if (imagep->isDeleted())
+			{
+				continue;
+			}
+			imagep->mLastReferencedTimer.reset();
+
+			updateImageDecodePriority(imagep);
+
+			S32 cur_discard = imagep->getDiscardLevel();
+			S32 desired_discard = imagep->getDesiredDiscardLevel();
+			if (!imagep->mWaitingForFullRes && desired_discard <= MAX_DISCARD_LEVEL &&
+				(cur_discard < 0 || cur_discard > desired_discard))
+			{
+				imagep->mWaitingForFullRes = TRUE;
+				imagep->mFullResTimer.reset();
+			}
+			mPriorityUpdatedImages.push_back(imagep);
+		}
+	}
+
 	// Update the decode priority for N images each frame
 	{
 		const size_t max_update_count = llmin((S32) (1024*gFrameIntervalSeconds) + 1, 32); //target 1024 textures per second
@@ -631,6 +711,8 @@ void LLViewerImageList::updateImagesDecodePriorities()
 				}
 				else if(imagep->isInactive())
 				{
+					// out of sight before it got there, don't count it
+					imagep->mWaitingForFullRes = FALSE;
 					if (imagep->mLastReferencedTimer.getElapsedTimeF32() > MAX_INACTIVE_TIME)
 					{
 						imagep->setDeletionCandidate() ;
@@ -646,24 +728,29 @@ void LLViewerImageList::updateImagesDecodePriorities()
 				}
 			}
 
-			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
-			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
-			}
+			updateImageDecodePriority(imagep);
 			update_counter--;
 		}
 	}
 }
 
+void LLViewerImageList::updateImageDecodePriority(LLViewerImage* imagep)
+{
+	imagep->processTextureStats();
+	F32 old_priority = imagep->getDecodePriority();
+	F32 old_priority_test = llmax(old_priority, 0.0f);
+	F32 decode_priority = imagep->calcDecodePriority();
+	F32 decode_priority_test = llmax(decode_priority, 0.0f);
+	// Ignore < 20% difference
+	if ((decode_priority_test < old_priority_test * .8f) ||
+		(decode_priority_test > old_priority_test * 1.25f))
+	{
+		removeImageFromList(imagep);
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
+}
+
 /*
  static U8 get_image_type(LLViewerImage* imagep, LLHost target_host)
  {
@@ -765,6 +852,16 @@ F32 LLViewerImageList::updateImagesFetchTextures(F32 max_time)
 		update_counter--;
 	}
 	
+	// entries reprioritized out of turn this frame
+	for (std::vector<LLPointer<LLViewerImage> >::iterator iter = mPriorityUpdatedImages.begin();
+		 iter != mPriorityUpdatedImages.end(); ++iter)
+	{
+		if ((*iter)->mInImageList) // not flushed since
+		{
+			entries.push_back(*iter);
+		}
+	}
+
 	// 256 cycled entries
 	update_counter = llmin(max_update_count, mUUIDMap.size());
 	if (update_counter > 0)
@@ -802,6 +899,8 @@ F32 LLViewerImageList::updateImagesFetchTextures(F32 max_time)
 		}
 		min_count--;
 	}
+	mPriorityUpdatedImages.clear();
+
 	if (fetch_count == 0)
 	{
 		gDebugTimers[0].pause();
@@ -1397,7 +1496,7 @@ bool LLUIImageList::initFromFile()
 
 	LLXMLNodePtr root;
 
-	if (!LLXMLNode::parseFile(base_file_path, root, NULL))
+	if (!LLXMLCache::parseFile(base_file_path, root, NULL))
 	{
 		llwarns << "Unable to parse UI image list file " << base_file_path << llendl;
 		return false;
@@ -1432,7 +1531,7 @@ bool LLUIImageList::initFromFile()
 		if (!path_it->empty() && (*path_it) != base_file_path)
 		{
 			LLXMLNodePtr update_root;
-			if (LLXMLNode::parseFile(*path_it, update_root, NULL))
+			if (LLXMLCache::parseFile(*path_it, update_root, NULL))
 			{
 				LLXMLNode::updateNode(root, update_root);
 			}
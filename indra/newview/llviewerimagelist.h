@@ -36,11 +36,13 @@
 #include "lluuid.h"
 //#include "message.h"
 #include "llgl.h"
+#include "llindexedheap.h"
 #include "llstat.h"
 #include "llviewerimage.h"
 #include "llui.h"
 #include <list>
 #include <set>
+#include <vector>
 
 const U32 LL_IMAGE_REZ_LOSSLESS_CUTOFF = 128;
 
@@ -126,6 +128,13 @@ public:
 	void removeImageFromList(LLViewerImage *image);
 
 	void dirtyImage(LLViewerImage *image);
+
+	// Recalculates the decode priority of image on the next update, ahead of
+	// the round robin, with larger requested sizes going first. Called by
+	// LLViewerImage::addTextureStats() when an image is suddenly wanted bigger.
+	void requestPriorityUpdate(LLViewerImage *image, F32 virtual_size);
+	// Called when an image reaches its desired discard level, with the time it took.
+	void addTimeToFullRes(F32 seconds);
 	
 	// Using image stats, determine what images are necessary, and perform image updates.
 	void updateImages(F32 max_time);
@@ -152,6 +161,7 @@ public:
 	
 private:
 	void updateImagesDecodePriorities();
+	void updateImageDecodePriority(LLViewerImage* imagep);
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
@@ -176,6 +186,18 @@ private:
 	typedef std::set<LLPointer<LLViewerImage>, LLViewerImage::Compare> image_priority_list_t;	
 	image_priority_list_t mImageList;
 
+	// images waiting for their priority to be recalculated, see requestPriorityUpdate()
+	typedef LLIndexedHeap<LLViewerImage*> priority_update_heap_t;
+	priority_update_heap_t mPriorityUpdateHeap;
+	// reprioritized from mPriorityUpdateHeap this frame, fetched before the round robin entries
+	std::vector<LLPointer<LLViewerImage> > mPriorityUpdatedImages;
+
+	// the last few time to full res samples, for the median
+	std::vector<F32> mTimeToFullRes;
+	S32 mNextTimeToFullRes;
+	F32 mTimeToFullResMedian;
+	BOOL mTimeToFullResChanged;
+
 	// simply holds on to LLViewerImage references to stop them from being purged too soon
 	std::set<LLPointer<LLViewerImage> > mImagePreloads;
 
@@ -194,6 +216,7 @@ public:
 	static LLStat sGLBoundMemStat;
 	static LLStat sRawMemStat;
 	static LLStat sFormattedMemStat;
+	static LLStat sTimeToFullResStat;	// median seconds from becoming visible to the desired discard level
 
 private:
 	static S32 sNumImages;
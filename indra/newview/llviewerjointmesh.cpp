@@ -58,6 +58,7 @@
 #include "llsky.h"
 #include "pipeline.h"
 #include "llviewershadermgr.h"
+#include "llvolumexform.h"
 #include "llmath.h"
 #include "v4math.h"
 #include "m3math.h"
@@ -884,6 +885,15 @@ void LLViewerJointMesh::updateVectorize()
 	{
 		sUpdateGeometryFunc = &updateGeometryOriginal;
 	}
+
+	// Batched frustum tests used by octree culling
+	LLCamera::setUseSSE(vectorizeEnable && gSysCPU.hasSSE());
+	LL_INFOS("AppInit") << "Vectorized Culling    : " << ( LLCamera::getUseSSE() ? "ENABLED" : "DISABLED" ) << LL_ENDL ;
+
+	// Volume face vertex transforms, used when rebuilding prim geometry.
+	// The SSE kernel covers SSE2 too.
+	LLVolumeXform::setUseSSE(vectorizeEnable && sVectorizeProcessor >= 1 && gSysCPU.hasSSE());
+	LL_INFOS("AppInit") << "Vectorized Volumes    : " << ( LLVolumeXform::getUseSSE() ? "ENABLED" : "DISABLED" ) << LL_ENDL ;
 }
 
 void LLViewerJointMesh::updateJointGeometry()
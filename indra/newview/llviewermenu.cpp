@@ -337,6 +337,9 @@ void handle_dump_focus(void*);
 
 // Advanced->Consoles menu
 void handle_show_notifications_console(void*);
+void handle_toggle_event_trace(void*);
+BOOL check_event_trace(void*);
+void handle_write_event_trace(void*);
 void handle_region_dump_settings(void*);
 void handle_region_dump_temp_asset_data(void*);
 void handle_region_clear_temp_asset_data(void*);
@@ -887,6 +890,13 @@ void init_client_menu(LLMenuGL* menu)
 										&get_visibility,
 										(void*)gDebugView->mFastTimerView,
 										  '9', MASK_CONTROL|MASK_SHIFT ) );
+		sub->append(new LLMenuItemCheckGL("Record Event Trace",
+										&handle_toggle_event_trace,
+										NULL,
+										&check_event_trace,
+										NULL));
+		sub->append(new LLMenuItemCallGL("Write Event Trace",
+			&handle_write_event_trace, NULL));
 #if MEM_TRACK_MEM
 		sub->append(new LLMenuItemCheckGL("Memory", 
 										&toggle_visibility,
@@ -3221,6 +3231,22 @@ void handle_show_notifications_console(void *)
 	LLFloaterNotificationConsole::showInstance();
 }
 
+void handle_toggle_event_trace(void*)
+{
+	LLEventTrace::setEnabled(!LLEventTrace::isEnabled());
+}
+
+BOOL check_event_trace(void*)
+{
+	return LLEventTrace::isEnabled();
+}
+
+// Open it in chrome://tracing
+void handle_write_event_trace(void*)
+{
+	LLEventTrace::writeChromeTrace(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "event_trace.json"));
+}
+
 void handle_dump_group_info(void *)
 {
 	llinfos << "group   " << gAgent.mGroupName << llendl;
@@ -2383,10 +2383,22 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 		bump_mask |= LLVertexBuffer::MAP_BINORMAL;
 	}
 
-	genDrawInfo(group, simple_mask, simple_faces);
-	genDrawInfo(group, bump_mask, bump_faces);
-	genDrawInfo(group, fullbright_mask, fullbright_faces);
-	genDrawInfo(group, alpha_mask, alpha_faces, TRUE);
+	//generate vertex data off the main thread when there are helpers for it
+	LLPointer<LLVolumeGeometryBatch> batch;
+	if (LLVolumeGeometryBatch::hasHelpers() && !LLPipeline::sDelayVBUpdate)
+	{
+		batch = new LLVolumeGeometryBatch();
+	}
+
+	genDrawInfo(group, simple_mask, simple_faces, FALSE, batch);
+	genDrawInfo(group, bump_mask, bump_faces, FALSE, batch);
+	genDrawInfo(group, fullbright_mask, fullbright_faces, FALSE, batch);
+	genDrawInfo(group, alpha_mask, alpha_faces, TRUE, batch);
+
+	if (batch.notNull())
+	{
+		batch->build();
+	}
 
 	if (!LLPipeline::sDelayVBUpdate)
 	{
@@ -2500,7 +2512,7 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 	}
 }
 
-void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort)
+void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort, LLVolumeGeometryBatch* batch)
 {
 	//calculate maximum number of vertices to store in a single buffer
 	static const LLCachedControl<S32> render_max_vbo_size("RenderMaxVBOSize", 512);
@@ -2628,7 +2640,12 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 
 					U32 te_idx = facep->getTEOffset();
 
-					if (facep->getGeometryVolume(*volume, te_idx, 
+					if (batch)
+					{ //marked dirty once the batch has been built
+						batch->addFace(facep, *volume, te_idx, 
+							vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset);
+					}
+					else if (facep->getGeometryVolume(*volume, te_idx, 
 						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset))
 					{
 						buffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
@@ -2764,6 +2781,102 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 	}
 }
 
+//-----------------------------------------------------------------------------
+// LLVolumeGeometryBatch
+//-----------------------------------------------------------------------------
+
+//below this many vertices a batch isn't worth handing out to helpers
+const U32 MIN_THREADED_GEOMETRY_VERTICES = 4096;
+
+//static
+S32 LLVolumeGeometryBatch::sMaxHelpers = 0;
+
+LLVolumeGeometryBatch::LLVolumeGeometryBatch()
+	: mNumVertices(0)
+{
+}
+
+LLVolumeGeometryBatch::~LLVolumeGeometryBatch()
+{
+}
+
+BOOL LLVolumeGeometryBatch::addFace(LLFace* facep, const LLVolume& volume, S32 te_idx,
+									const LLMatrix4& mat_vert, const LLMatrix3& mat_normal, U16 index_offset)
+{
+	mJobs.push_back(LLFaceGeometryJob());
+	if (!facep->setupGeometryJob(volume, te_idx, mat_vert, mat_normal, index_offset, mJobs.back()))
+	{
+		mJobs.pop_back();
+		return FALSE;
+	}
+
+	mNumVertices += mJobs.back().getNumVertices();
+	return TRUE;
+}
+
+void LLVolumeGeometryBatch::runTask(S32 index)
+{
+	LLFaceGeometryJob& job = mJobs[index];
+	job.stage();
+	job.build();
+}
+
+void LLVolumeGeometryBatch::build()
+{
+	S32 count = mJobs.size();
+	if (!count)
+	{
+		return;
+	}
+
+	if (count < 2 || mNumVertices < MIN_THREADED_GEOMETRY_VERTICES)
+	{ //write straight into the vertex buffers like getGeometryVolume() does
+		LLFastTimer t(LLFastTimer::FTM_REBUILD_VOLUME_GEN);
+		for (std::vector<LLFaceGeometryJob>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+		{
+			iter->mapDestination();
+			iter->build();
+		}
+	}
+	else
+	{
+		{
+			LLFastTimer t(LLFastTimer::FTM_REBUILD_VOLUME_GEN);
+			run(count, sMaxHelpers);
+		}
+
+		LLFastTimer t(LLFastTimer::FTM_REBUILD_VOLUME_COMMIT);
+		for (std::vector<LLFaceGeometryJob>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+		{
+			iter->commit();
+		}
+	}
+
+	for (std::vector<LLFaceGeometryJob>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		LLFace* facep = iter->getFace();
+		LLVertexBuffer* buffer = facep->mVertexBuffer;
+		buffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
+			facep->getIndicesStart(), facep->getIndicesCount());
+	}
+
+	//unmap the buffers that were written
+	for (std::vector<LLFaceGeometryJob>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		LLVertexBuffer* buffer = iter->getFace()->mVertexBuffer;
+		if (buffer->isLocked())
+		{
+			buffer->setBuffer(0);
+		}
+	}
+}
+
+//static
+void LLVolumeGeometryBatch::initClass(S32 max_helpers)
+{
+	sMaxHelpers = llmax(max_helpers, 0);
+}
+
 void LLGeometryManager::addGeometryCount(LLSpatialGroup* group, U32 &vertex_count, U32 &index_count)
 {	
 	//initialize to default usage for this partition
@@ -1402,28 +1402,67 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 
 	LLGLDepthTest depth(GL_TRUE, GL_FALSE);
 
-	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
-			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
-	{
-		LLViewerRegion* region = *iter;
-		if (water_clip != 0)
-		{
-			LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
-			camera.setUserClipPlane(plane);
-		}
-		else
+	const LLWorld::region_list_t& regions = LLWorld::getInstance()->getRegionList();
+	if (LLSpatialCullBatch::hasHelpers())
+	{ //frustum check octree subtrees on the helper threads, then finish the cull here
+		LLPointer<LLSpatialCullBatch> batch = new LLSpatialCullBatch;
+
+		//each region clips against its own water plane, so those cameras get copied
+		std::vector<LLCamera> region_cameras;
+		region_cameras.reserve(regions.size());
+
+		for (LLWorld::region_list_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
 		{
-			camera.disableUserClipPlane();
+			LLViewerRegion* region = *iter;
+			LLCamera* region_camera = &camera;
+			if (water_clip != 0)
+			{
+				LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+				region_cameras.push_back(camera);
+				region_camera = &region_cameras.back();
+				region_camera->setUserClipPlane(plane);
+			}
+			else
+			{
+				camera.disableUserClipPlane();
+			}
+
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+			{
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part && hasRenderType(part->mDrawableType))
+				{
+					batch->addPartition(part, region_camera);
+				}
+			}
 		}
 
-		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		batch->cull();
+	}
+	else
+	{
+		for (LLWorld::region_list_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
 		{
-			LLSpatialPartition* part = region->getSpatialPartition(i);
-			if (part)
+			LLViewerRegion* region = *iter;
+			if (water_clip != 0)
 			{
-				if (hasRenderType(part->mDrawableType))
+				LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+				camera.setUserClipPlane(plane);
+			}
+			else
+			{
+				camera.disableUserClipPlane();
+			}
+
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+			{
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part)
 				{
-					part->cull(camera);
+					if (hasRenderType(part->mDrawableType))
+					{
+						part->cull(camera);
+					}
 				}
 			}
 		}
@@ -0,0 +1,223 @@
+/**
+ * @file lllogchat_test.cpp
+ * @date 2010-06
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header: almost always required for newview cpp files
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../lllogchat.h"
+// Dependencies
+#include "lldir.h"
+#include "llcontrol.h"
+#include "lluuid.h"
+// Tut header
+#include "../test/lltut.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes:
+// * Add here stubbed implementation of the few classes and methods used in the class to be tested
+// * Add as little as possible (let the link errors guide you)
+// * Do not make any assumption as to how those classes or methods work (i.e. don't copy/paste code)
+// * A simulator for a class can be implemented here. Please comment and document thoroughly.
+
+// Stub directory calls: every transcript goes straight into the temp directory
+LLDir::LLDir() { }
+LLDir::~LLDir() { }
+S32 LLDir::deleteFilesInDir(const std::string &dirname, const std::string &mask) { return 0; }
+void LLDir::setChatLogsDir(const std::string &path) { }
+void LLDir::setPerAccountChatLogsDir(const std::string &first, const std::string &last) { }
+void LLDir::setLindenUserDir(const std::string &first, const std::string &last) { }
+void LLDir::setSkinFolder(const std::string &skin_folder) { }
+bool LLDir::setCacheDir(const std::string &path) { return true; }
+void LLDir::dumpCurrentDirectories() { }
+std::string LLDir::getExpandedFilename(ELLPath location, const std::string &filename) const
+{
+#if LL_WINDOWS
+	return filename;
+#else
+	return "/tmp/" + filename;
+#endif
+}
+
+class LLDir_Test : public LLDir
+{
+public:
+	virtual void initAppDirs(const std::string &app_name) { }
+	virtual U32 countFilesInDir(const std::string &dirname, const std::string &mask) { return 0; }
+	virtual BOOL getNextFileInDir(const std::string &dirname, const std::string &mask, std::string &fname, BOOL wrap) { return FALSE; }
+	virtual void getRandomFileInDir(const std::string &dirname, const std::string &mask, std::string &fname) { }
+	virtual std::string getCurPath() { return ""; }
+	virtual BOOL fileExists(const std::string &filename) const { return FALSE; }
+	virtual std::string getLLPluginLauncher() { return ""; }
+	virtual std::string getLLPluginFilename(std::string base_name) { return ""; }
+};
+LLDir_Test gDirTest;
+LLDir *gDirUtilp = &gDirTest;
+
+// Stub settings calls, only timestamps use them
+LLControlGroup::LLControlGroup() { }
+LLControlGroup::~LLControlGroup() { }
+std::string LLControlGroup::getString(const std::string& name) { return ""; }
+std::string LLControlGroup::getText(const std::string& name) { return ""; }
+BOOL LLControlGroup::getBOOL(const std::string& name) { return FALSE; }
+S32 LLControlGroup::getS32(const std::string& name) { return 0; }
+F32 LLControlGroup::getF32(const std::string& name) { return 0.f; }
+U32 LLControlGroup::getU32(const std::string& name) { return 0; }
+LLControlGroup gSavedSettings;
+
+// Stub other stuff
+BOOL gPacificDaylightTime;
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	// Test wrapper declarations
+	struct logchat_test
+	{
+		// Constructor and destructor of the test wrapper
+		logchat_test()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+			oStr << "lllogchat-test-" << random;
+			mBaseName = oStr.str();
+		}
+		~logchat_test()
+		{
+			LLLogChat::cleanupClass();
+			for (S32 i = 0; i < (S32)mNames.size(); i++)
+			{
+				LLFile::remove(LLLogChat::makeLogFileName(mNames[i]));
+			}
+		}
+
+		std::string getName(S32 index)
+		{
+			std::string name = mBaseName + llformat("-%d", index);
+			if (std::find(mNames.begin(), mNames.end(), name) == mNames.end())
+			{
+				mNames.push_back(name);
+			}
+			return name;
+		}
+
+		std::string readFile(const std::string& name)
+		{
+			llifstream file(LLLogChat::makeLogFileName(name), std::ios::in | std::ios::binary);
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			return contents.str();
+		}
+
+		static void loadCallback(LLLogChat::ELogLineType type, std::string line, void* userdata)
+		{
+			if (type == LLLogChat::LOG_LINE)
+			{
+				((std::vector<std::string>*)userdata)->push_back(line);
+			}
+		}
+
+		std::string mBaseName;
+		std::vector<std::string> mNames;
+	};
+
+	// Tut templating thingamagic: test group, object and test instance
+	typedef test_group<logchat_test> logchat_t;
+	typedef logchat_t::object logchat_object_t;
+	tut::logchat_t tut_logchat("logchat");
+
+	template<> template<>
+	void logchat_object_t::test<1>()
+	{
+		// lines queued for more transcripts than the writer keeps open are
+		// all on disk, in order, once it has shut down
+		const S32 NUM_LOGS = 12;
+		const S32 NUM_LINES = 20;
+		LLLogChat::initClass();
+		for (S32 line = 0; line < NUM_LINES; line++)
+		{
+			for (S32 log = 0; log < NUM_LOGS; log++)
+			{
+				LLLogChat::saveHistory(getName(log), llformat("line %d of %d", line, log));
+			}
+		}
+		LLLogChat::cleanupClass();
+
+		for (S32 log = 0; log < NUM_LOGS; log++)
+		{
+			std::string expected;
+			for (S32 line = 0; line < NUM_LINES; line++)
+			{
+				expected += llformat("line %d of %d\n", line, log);
+			}
+			ensure_equals("written", readFile(getName(log)), expected);
+		}
+	}
+
+	template<> template<>
+	void logchat_object_t::test<2>()
+	{
+		// lines still queued show up in the history, and the writer appends
+		// after them
+		LLLogChat::initClass();
+		LLLogChat::saveHistory(getName(0), "first");
+		LLLogChat::saveHistory(getName(0), "second");
+		std::vector<std::string> lines;
+		LLLogChat::loadHistory(getName(0), loadCallback, &lines);
+		ensure_equals("loaded", lines.size(), (size_t)2);
+		ensure_equals("first", lines[0], std::string("first"));
+		ensure_equals("second", lines[1], std::string("second"));
+
+		LLLogChat::saveHistory(getName(0), "third");
+		LLLogChat::cleanupClass();
+		ensure_equals("appended", readFile(getName(0)), std::string("first\nsecond\nthird\n"));
+	}
+
+	template<> template<>
+	void logchat_object_t::test<3>()
+	{
+		// without the writer, lines go straight to disk
+		LLLogChat::saveHistory(getName(0), "now");
+		ensure_equals("written", readFile(getName(0)), std::string("now\n"));
+	}
+}
@@ -0,0 +1,340 @@
+/**
+ * @file lltexlayerbake_test.cpp
+ * @brief Tests for the software avatar bake compositor.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header: almost always required for newview cpp files
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../lltexlayerbake.h"
+// For timer class
+#include "lltimer.h"
+// Tut header
+#include "../test/lltut.h"
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes:
+// * Add here stubbed implementation of the few classes and methods used in the class to be tested
+// * Add as little as possible (let the link errors guide you)
+// * Do not make any assumption as to how those classes or methods work (i.e. don't copy/paste code)
+// * A simulator for a class can be implemented here. Please comment and document thoroughly.
+
+// The compositor works on real pixels, so these stubs do keep a plain heap
+// buffer of width * height * components bytes and nothing else.
+LLImageBase::LLImageBase()
+	: mData(NULL), mDataSize(0), mWidth(0), mHeight(0), mComponents(0), mBadBufferAllocation(FALSE), mMemType(0) {}
+LLImageBase::~LLImageBase() { LLImageBase::deleteData(); }
+void LLImageBase::dump() { }
+void LLImageBase::sanityCheck() { }
+void LLImageBase::deleteData() { delete[] mData; mData = NULL; mDataSize = 0; }
+U8* LLImageBase::allocateData(S32 size)
+{
+	if (size < 0)
+	{
+		size = mWidth * mHeight * mComponents;
+	}
+	if (!mData || size != mDataSize)
+	{
+		delete[] mData;
+		mData = new U8[size];
+		mDataSize = size;
+	}
+	return mData;
+}
+U8* LLImageBase::reallocateData(S32 size) { return allocateData(size); }
+const U8* LLImageBase::getData() const { return mData; }
+U8* LLImageBase::getData() { return mData; }
+void LLImageBase::setSize(S32 width, S32 height, S32 ncomponents)
+{
+	mWidth = width;
+	mHeight = height;
+	mComponents = ncomponents;
+}
+U8* LLImageBase::allocateDataSize(S32 width, S32 height, S32 ncomponents, S32 size)
+{
+	setSize(width, height, ncomponents);
+	return allocateData(size);
+}
+
+LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components) { allocateDataSize(width, height, components); }
+LLImageRaw::LLImageRaw(U8 *data, U16 width, U16 height, S8 components)
+{
+	allocateDataSize(width, height, components);
+	memcpy(getData(), data, width * height * components);
+}
+LLImageRaw::~LLImageRaw() { }
+void LLImageRaw::deleteData() { LLImageBase::deleteData(); }
+U8* LLImageRaw::allocateData(S32 size) { return LLImageBase::allocateData(size); }
+U8* LLImageRaw::reallocateData(S32 size) { return LLImageBase::reallocateData(size); }
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	// Test wrapper declarations
+	struct texlayerbake_test
+	{
+		// Constructor and destructor of the test wrapper
+		texlayerbake_test()
+		{
+		}
+		~texlayerbake_test()
+		{
+			LLTexLayerBakeThread::cleanupClass();
+		}
+
+		// Image of the given size filled with a repeatable pattern
+		static LLPointer<LLImageRaw> makeImage(S32 width, S32 height, S32 components, U32 seed)
+		{
+			LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+			U8* data = image->getData();
+			U32 state = seed;
+			for (S32 i = 0; i < width * height * components; i++)
+			{
+				state = state * 1664525 + 1013904223;
+				data[i] = (U8)(state >> 24);
+			}
+			return image;
+		}
+
+		// A bake with local, static and alpha param images, built the same
+		// way every time for a given size and seed
+		static LLTexLayerBake* makeBake(S32 size, S32 num_layers, U32 seed)
+		{
+			LLTexLayerBake* bake = new LLTexLayerBake(size, size);
+			bake->mLayers.resize(num_layers);
+			for (S32 i = 0; i < num_layers; i++)
+			{
+				LLTexLayerBake::Layer& layer = bake->mLayers[i];
+				layer.mNetColor = LLColor4(0.9f, 0.6f - 0.1f * (i % 4), 0.3f, 1.f);
+				layer.mColorSpecified = TRUE;
+				layer.mHasLocalTexture = TRUE;
+				// Twice the size of the bake, so it gets box filtered
+				layer.mLocalImage = makeImage(size * 2, size * 2, 4, seed + i);
+				layer.mHasAlphaParams = TRUE;
+				layer.mWantsAlphaData = (i % 2 == 0);
+
+				LLTexLayerBake::AlphaParam gradient;
+				gradient.mImage = makeImage(size, size, 1, seed + 100 + i);
+				layer.mAlphaParams.push_back(gradient);
+
+				LLTexLayerBake::AlphaParam constant;
+				constant.mMultiplyBlend = TRUE;
+				constant.mWeight = 0.75f;
+				layer.mAlphaParams.push_back(constant);
+			}
+
+			LLTexLayerBake::Layer mask;
+			mask.mHasStaticImage = TRUE;
+			mask.mStaticImageIsMask = TRUE;
+			mask.mStaticImage = makeImage(size, size, 1, seed + 200);
+			bake->mMaskLayers.push_back(mask);
+			return bake;
+		}
+	};
+
+	// Tut templating thingamagic: test group, object and test instance
+	typedef test_group<texlayerbake_test> texlayerbake_t;
+	typedef texlayerbake_t::object texlayerbake_object_t;
+	tut::texlayerbake_t tut_texlayerbake("texlayerbake");
+
+	// ---------------------------------------------------------------------------------------
+	// Test functions
+	// Notes:
+	// * Test as many as you possibly can without requiring a full blown simulation of everything
+	// * The tests are executed in sequence so the test instance state may change between calls
+	// * Remember that you cannot test private methods with tut
+	// ---------------------------------------------------------------------------------------
+
+	// Blending against known GL results
+	template<> template<>
+	void texlayerbake_object_t::test<1>()
+	{
+		LLTexLayerBakeTarget target(2, 2);
+		U8* data = target.getImage()->getData();
+
+		// Opaque black, then half red over it with LLRender::BT_ALPHA
+		target.setAlphaTest(FALSE);
+		target.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		target.drawRect();
+		target.setAlphaTest(TRUE);
+		target.setColor(LLColor4(1.f, 0.f, 0.f, 0.5f));
+		target.drawRect();
+		ensure_equals("red", data[0], 128);
+		ensure_equals("green", data[1], 0);
+		ensure_equals("alpha", data[3], 191);
+
+		// Anything at or below the alpha reference is discarded
+		target.setColor(LLColor4(0.f, 1.f, 0.f, 0.005f));
+		target.drawRect();
+		ensure_equals("rejected red", data[0], 128);
+		ensure_equals("rejected green", data[1], 0);
+
+		// A GL_ALPHA texture modulates only alpha and takes color from the current color
+		LLPointer<LLImageRaw> alpha = new LLImageRaw(2, 2, 1);
+		memset(alpha->getData(), 128, 4);
+		target.setAlphaTest(FALSE);
+		target.setBlendFunc(LLTexLayerBakeTarget::BF_ONE, LLTexLayerBakeTarget::BF_ZERO);
+		target.setColor(LLColor4(0.2f, 0.4f, 0.6f, 1.f));
+		target.drawImage(alpha, TRUE);
+		ensure_equals("alpha texture red", data[0], 51);
+		ensure_equals("alpha texture green", data[1], 102);
+		ensure_equals("alpha texture blue", data[2], 153);
+		ensure_equals("alpha texture alpha", data[3], 128);
+
+		// The color mask keeps the color channels
+		target.setColorMask(FALSE, TRUE);
+		target.setColor(LLColor4(1.f, 1.f, 1.f, 0.f));
+		target.drawRect();
+		ensure_equals("masked red", data[0], 51);
+		ensure_equals("masked alpha", data[3], 0);
+	}
+
+	// Power of two reductions are box filtered
+	template<> template<>
+	void texlayerbake_object_t::test<2>()
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(4, 4, 1);
+		U8* data = image->getData();
+		for (S32 i = 0; i < 16; i++)
+		{
+			data[i] = (U8)(i * 10);
+		}
+
+		LLPointer<LLImageRaw> fitted = LLTexLayerBakeTarget::fitImage(image, 2, 2);
+		ensure_equals("width", fitted->getWidth(), 2);
+		ensure_equals("height", fitted->getHeight(), 2);
+		const U8* out = fitted->getData();
+		ensure_equals("top left", out[0], 25);	// (0 + 10 + 40 + 50) / 4
+		ensure_equals("top right", out[1], 45);
+		ensure_equals("bottom left", out[2], 105);
+		ensure_equals("bottom right", out[3], 125);
+
+		ensure("images that fit are used as is", LLTexLayerBakeTarget::fitImage(image, 4, 4) == image);
+	}
+
+	// Alpha params build the layer alpha, and layers with masked morphs
+	// contribute it to the mask channel
+	template<> template<>
+	void texlayerbake_object_t::test<3>()
+	{
+		LLPointer<LLTexLayerBake> bake = new LLTexLayerBake(2, 2);
+		bake->mLayers.resize(2);
+
+		LLTexLayerBake::Layer& masked = bake->mLayers[0];
+		masked.mColorSpecified = TRUE;
+		masked.mHasAlphaParams = TRUE;
+		masked.mWantsAlphaData = TRUE;
+		LLTexLayerBake::AlphaParam param;
+		param.mWeight = 0.5f;
+		masked.mAlphaParams.push_back(param);
+
+		// Same alpha, but no masked morphs
+		bake->mLayers[1] = masked;
+		bake->mLayers[1].mWantsAlphaData = FALSE;
+		bake->mLayers[1].mComposited = FALSE;
+
+		bake->bake();
+		ensure("bake succeeded", bake->getSuccess());
+
+		LLImageRaw* baked = bake->getBakedImage();
+		ensure_equals("components", baked->getComponents(), 5);
+		const U8* data = baked->getData();
+		ensure_equals("color through the layer alpha", data[0], 128);
+		ensure_equals("alpha cleared", data[3], 255);
+		ensure_equals("mask", data[4], 128);
+	}
+
+	// Baking on the pool gives the same bytes as baking inline
+	template<> template<>
+	void texlayerbake_object_t::test<4>()
+	{
+		LLPointer<LLTexLayerBake> inline_bake = makeBake(64, 3, 7);
+		inline_bake->bake();
+		ensure("inline bake succeeded", inline_bake->getSuccess());
+
+		for (S32 threaded = 0; threaded < 2; threaded++)
+		{
+			LLTexLayerBakeThread::initClass(2, threaded != 0);
+
+			LLPointer<LLTexLayerBake> bakes[4];
+			for (S32 i = 0; i < 4; i++)
+			{
+				bakes[i] = makeBake(64, 3, 7);
+				LLTexLayerBakeThread::queueBake(bakes[i]);
+			}
+
+			LLTimer timer;
+			for (S32 i = 0; i < 4; i++)
+			{
+				while (!bakes[i]->isDone() && timer.getElapsedTimeF32() < 30.f)
+				{
+					LLTexLayerBakeThread::updateClass(1);
+					ms_sleep(1);
+				}
+				ensure("bake finished", bakes[i]->isDone());
+				ensure("bake succeeded", bakes[i]->getSuccess());
+
+				LLImageRaw* expected = inline_bake->getBakedImage();
+				LLImageRaw* result = bakes[i]->getBakedImage();
+				ensure_equals("size", result->getDataSize(), expected->getDataSize());
+				ensure("same bytes", memcmp(result->getData(), expected->getData(), expected->getDataSize()) == 0);
+			}
+
+			LLTexLayerBakeThread::cleanupClass();
+		}
+	}
+
+	// Without a pool bakes run inline
+	template<> template<>
+	void texlayerbake_object_t::test<5>()
+	{
+		ensure("no pool", !LLTexLayerBakeThread::isInitialized());
+		LLPointer<LLTexLayerBake> bake = makeBake(16, 1, 3);
+		LLTexLayerBakeThread::queueBake(bake);
+		ensure("done on return", bake->isDone());
+	}
+
+	// Timing of a full size bake, for comparison against a GL readback
+	template<> template<>
+	void texlayerbake_object_t::test<6>()
+	{
+		LLPointer<LLTexLayerBake> bake = makeBake(512, 6, 11);
+		bake->bake();
+		ensure("bake succeeded", bake->getSuccess());
+		llinfos << "512x512 bake of 6 layers took " << bake->getBakeTime() * 1000.f << " ms" << llendl;
+	}
+}
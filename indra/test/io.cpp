@@ -41,6 +41,8 @@
 
 #include "llbuffer.h"
 #include "llbufferstream.h"
+#include "llhttpnode.h"
+#include "lliohttpserver.h"
 #include "lliosocket.h"
 #include "llioutil.h"
 #include "llmemorystream.h"
@@ -49,6 +51,7 @@
 #include "llsd.h"
 #include "llsdrpcclient.h"
 #include "llsdrpcserver.h"
+#include "llsdhttpserver.h"
 #include "llsdserialize.h"
 #include "lluuid.h"
 #include "llinstantmessage.h"
@@ -1180,6 +1183,92 @@ namespace tut
 		ensure_equals("accepted socked close", count, 1);
 		lldebugs << "** Sleeper should have timed out.." << llendl;
 	}
+
+	template<> template<>
+	void fitness_test_object::test<6>()
+	{
+		// Load harness: many concurrent LLSD over HTTP requests on
+		// loopback, all serviced by the one pump. Most connections are
+		// idle at any given moment, which is the case the pump has to
+		// handle without visiting every chain.
+		const U16 HTTP_LISTEN_PORT = SERVER_LISTEN_PORT + 1;
+		const S32 CLIENT_COUNT = 200;
+		const F32 LOAD_TIMEOUT_SECS = 10.0f;
+
+		LLHTTPNode& root = LLIOHTTPServer::create(
+			mPool,
+			*mPump,
+			HTTP_LISTEN_PORT);
+		LLHTTPStandardServices::useServices();
+		LLHTTPRegistrar::buildAllServices(root);
+		pump_loop(mPump, 0.1f);
+
+		LLSD payload;
+		payload["agent_id"] = LLUUID::null;
+		payload["sequence"] = 0;
+		payload["message"] = "suckers never play me";
+		std::ostringstream body;
+		LLSDSerialize::toXML(payload, body);
+		std::ostringstream request;
+		request << "POST /web/echo HTTP/1.0\r\n"
+				<< "Content-Length: " << body.str().size() << "\r\n"
+				<< "\r\n"
+				<< body.str();
+
+		LLHost server_host("127.0.0.1", HTTP_LISTEN_PORT);
+		std::vector<LLSocket::ptr_t> clients;
+		std::vector<LLPipeStringExtractor*> responses;
+		LLTimer timer;
+		for(S32 ii = 0; ii < CLIENT_COUNT; ++ii)
+		{
+			LLSocket::ptr_t client = LLSocket::create(mPool, LLSocket::STREAM_TCP);
+			ensure("Connected to server", client->blockingConnect(server_host));
+			clients.push_back(client);
+
+			LLPumpIO::chain_t chain;
+			chain.push_back(LLIOPipe::ptr_t(new LLPipeStringInjector(request.str())));
+			chain.push_back(LLIOPipe::ptr_t(new LLIOSocketWriter(client)));
+			chain.push_back(LLIOPipe::ptr_t(new LLIONull));
+			mPump->addChain(chain, LOAD_TIMEOUT_SECS);
+
+			LLPipeStringExtractor* extractor = new LLPipeStringExtractor;
+			responses.push_back(extractor);
+			chain.clear();
+			chain.push_back(LLIOPipe::ptr_t(new LLIOSocketReader(client)));
+			chain.push_back(LLIOPipe::ptr_t(extractor));
+			mPump->addChain(chain, LOAD_TIMEOUT_SECS);
+		}
+
+		S32 completed = 0;
+		S32 pumps = 0;
+		while(completed < CLIENT_COUNT
+			  && timer.getElapsedTimeF32() < LOAD_TIMEOUT_SECS)
+		{
+			LLFrameTimer::updateFrameTime();
+			mPump->pump();
+			mPump->callback();
+			++pumps;
+			completed = 0;
+			for(S32 ii = 0; ii < CLIENT_COUNT; ++ii)
+			{
+				if(responses[ii]->done()) ++completed;
+			}
+		}
+		F32 elapsed = timer.getElapsedTimeF32();
+		llinfos << "Loopback LLSD load: " << completed << " requests in "
+				<< elapsed << " seconds over " << pumps << " pumps ("
+				<< (elapsed > 0.f ? (F32)completed / elapsed : 0.f)
+				<< " requests/sec)" << llendl;
+		ensure_equals("all requests answered", completed, CLIENT_COUNT);
+		for(S32 ii = 0; ii < CLIENT_COUNT; ++ii)
+		{
+			std::string response = responses[ii]->string();
+			ensure("echo status",
+				   response.find("HTTP/1.0 200 OK\r\n") == 0);
+			ensure("echo body",
+				   response.find("suckers never play me") != std::string::npos);
+		}
+	}
 }
 
 namespace tut
@@ -0,0 +1,214 @@
+/**
+ * @file llassetstorage_tut.cpp
+ * @date 2010-06
+ * @brief LLAssetStorage download queue test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llassetstorage.h"
+#include "llrand.h"
+#include "lltimer.h"
+
+#include <map>
+#include <vector>
+
+namespace tut
+{
+	struct assetstorage_data
+	{
+		typedef LLAssetDownloadQueue::request_list_t request_list_t;
+
+		~assetstorage_data()
+		{
+			// whatever a test left queued
+			while (!mQueue.getQueue().empty())
+			{
+				LLAssetRequest* req = mQueue.getQueue().front();
+				request_list_t requests;
+				mQueue.take(req->getUUID(), req->getType(), requests);
+				for (request_list_t::iterator iter = requests.begin(); iter != requests.end(); ++iter)
+				{
+					delete *iter;
+				}
+			}
+		}
+
+		LLAssetRequest* makeRequest(const LLUUID& uuid, LLAssetType::EType type, S32 tag)
+		{
+			LLAssetRequest* req = new LLAssetRequest(uuid, type);
+			req->mUserData = (void*)(intptr_t)tag;
+			return req;
+		}
+
+		static S32 getTag(const LLAssetRequest* req)
+		{
+			return (S32)(intptr_t)req->mUserData;
+		}
+
+		LLAssetDownloadQueue mQueue;
+	};
+	typedef test_group<assetstorage_data> assetstorage_test;
+	typedef assetstorage_test::object assetstorage_object;
+	tut::assetstorage_test assetstorage_testcase("assetstorage");
+
+	template<> template<>
+	void assetstorage_object::test<1>()
+	{
+		// requests for the same asset coalesce, the type is part of the asset
+		LLUUID id;
+		id.generate();
+		ensure("first starts a transfer", mQueue.add(makeRequest(id, LLAssetType::AT_TEXTURE, 1)));
+		ensure("second rides along", !mQueue.add(makeRequest(id, LLAssetType::AT_TEXTURE, 2)));
+		ensure("other type starts a transfer", mQueue.add(makeRequest(id, LLAssetType::AT_SOUND, 3)));
+		ensure_equals("queued transfers", (S32)mQueue.getQueue().size(), 2);
+		ensure_equals("requests", mQueue.getNumRequests(), 3);
+
+		const request_list_t* pending = mQueue.find(id, LLAssetType::AT_TEXTURE);
+		ensure("found", pending != NULL);
+		ensure_equals("waiting", (S32)pending->size(), 2);
+		ensure("not found", mQueue.find(id, LLAssetType::AT_NOTECARD) == NULL);
+
+		request_list_t requests;
+		ensure_equals("taken", mQueue.take(id, LLAssetType::AT_TEXTURE, requests), 2);
+		ensure_equals("first first", getTag(requests.front()), 1);
+		ensure_equals("second second", getTag(requests.back()), 2);
+		ensure_equals("nothing left to take", mQueue.take(id, LLAssetType::AT_TEXTURE, requests), 0);
+		ensure_equals("queued transfers left", (S32)mQueue.getQueue().size(), 1);
+		ensure_equals("requests left", mQueue.getNumRequests(), 1);
+		ensure_equals("other type left", getTag(mQueue.getQueue().front()), 3);
+
+		for (request_list_t::iterator iter = requests.begin(); iter != requests.end(); ++iter)
+		{
+			delete *iter;
+		}
+	}
+
+	template<> template<>
+	void assetstorage_object::test<2>()
+	{
+		// queue order, and reordering with splice()
+		LLUUID ids[3];
+		for (S32 i = 0; i < 3; i++)
+		{
+			ids[i].generate();
+		}
+		mQueue.add(makeRequest(ids[0], LLAssetType::AT_TEXTURE, 0));
+		mQueue.add(makeRequest(ids[1], LLAssetType::AT_TEXTURE, 1));
+		mQueue.add(makeRequest(ids[2], LLAssetType::AT_SOUND, 2), TRUE);
+
+		request_list_t& queue = mQueue.getQueue();
+		request_list_t::iterator iter = queue.begin();
+		ensure_equals("front", getTag(*iter++), 2);
+		ensure_equals("middle", getTag(*iter++), 0);
+		ensure_equals("back", getTag(*iter++), 1);
+
+		// like LLHTTPAssetStorage moving a failed download to the back
+		queue.splice(queue.end(), queue, queue.begin());
+		ensure_equals("moved to the back", getTag(queue.back()), 2);
+
+		request_list_t requests;
+		ensure_equals("take moved", mQueue.take(ids[2], LLAssetType::AT_SOUND, requests), 1);
+		ensure_equals("take front", mQueue.take(ids[0], LLAssetType::AT_TEXTURE, requests), 1);
+		ensure_equals("one left", (S32)queue.size(), 1);
+		ensure_equals("right one left", getTag(queue.front()), 1);
+
+		for (request_list_t::iterator iter = requests.begin(); iter != requests.end(); ++iter)
+		{
+			delete *iter;
+		}
+	}
+
+	template<> template<>
+	void assetstorage_object::test<3>()
+	{
+		// Thousands of overlapping requests for a few hundred assets, with
+		// transfers completing in random order along the way. Every request
+		// has to come back exactly once, in the order it was made, and only
+		// the first request for an asset in flight may start a transfer.
+		const S32 NUM_ASSETS = 300;
+		const S32 NUM_REQUESTS = 20000;
+		const LLAssetType::EType types[2] = { LLAssetType::AT_TEXTURE, LLAssetType::AT_SOUND };
+
+		std::vector<LLUUID> ids(NUM_ASSETS);
+		for (S32 i = 0; i < NUM_ASSETS; i++)
+		{
+			ids[i].generate();
+		}
+
+		// what should be waiting on each (asset, type), by tag
+		typedef std::map<S32, std::vector<S32> > expected_map_t;
+		expected_map_t expected;
+		S32 transfers = 0;
+		S32 delivered = 0;
+
+		LLTimer timer;
+		S32 tag = 0;
+		while (tag < NUM_REQUESTS || !expected.empty())
+		{
+			if (tag < NUM_REQUESTS && (expected.empty() || ll_frand() < 0.75f))
+			{
+				S32 key = ll_rand(NUM_ASSETS * 2);
+				std::vector<S32>& waiting = expected[key];
+				BOOL first = mQueue.add(makeRequest(ids[key / 2], types[key % 2], tag));
+				ensure_equals("transfer started for new asset only", first ? true : false, waiting.empty());
+				transfers += first ? 1 : 0;
+				waiting.push_back(tag++);
+			}
+			else
+			{
+				// complete a random transfer
+				expected_map_t::iterator done = expected.begin();
+				std::advance(done, ll_rand((S32)expected.size()));
+				request_list_t requests;
+				S32 count = mQueue.take(ids[done->first / 2], types[done->first % 2], requests);
+				ensure_equals("all requests for the asset", count, (S32)done->second.size());
+				S32 i = 0;
+				for (request_list_t::iterator iter = requests.begin(); iter != requests.end(); ++iter, ++i)
+				{
+					ensure_equals("request order", getTag(*iter), done->second[i]);
+					delete *iter;
+				}
+				delivered += count;
+				expected.erase(done);
+			}
+			ensure_equals("queued transfers", (S32)mQueue.getQueue().size(), (S32)expected.size());
+		}
+		F32 elapsed = timer.getElapsedTimeF32();
+
+		ensure_equals("all delivered", delivered, NUM_REQUESTS);
+		ensure_equals("no requests left", mQueue.getNumRequests(), 0);
+		ensure("coalesced", transfers < NUM_REQUESTS);
+		llinfos << NUM_REQUESTS << " asset requests in " << transfers << " transfers, "
+				<< elapsed << "s" << llendl;
+	}
+}
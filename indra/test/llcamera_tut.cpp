@@ -0,0 +1,179 @@
+/**
+ * @file llcamera_tut.cpp
+ * @date 2010-06
+ * @brief LLCamera batched frustum test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llcamera.h"
+#include "llplane.h"
+#include "llrand.h"
+
+#include <vector>
+
+namespace tut
+{
+	struct camera_data
+	{
+		enum { NUM_BOXES = 1003 };	// not a multiple of 4 on purpose
+
+		camera_data()
+		:	mCamera(F_PI_BY_TWO, 1.f, 512, 1.f, 64.f)
+		{
+			// Looking down +x from the origin, as LLViewerCamera would
+			// set it up: near corners first, then far ones, starting at
+			// the bottom left of the screen.
+			LLVector3 frust[8];
+			frust[0].setVec(1.f,  1.f, -1.f);
+			frust[1].setVec(1.f, -1.f, -1.f);
+			frust[2].setVec(1.f, -1.f,  1.f);
+			frust[3].setVec(1.f,  1.f,  1.f);
+			for (U32 i = 0; i < 4; i++)
+			{
+				LLVector3 dir = frust[i];
+				dir.normVec();
+				frust[i + 4] = dir * mCamera.getFar();
+			}
+			mCamera.calcAgentFrustumPlanes(frust);
+
+			for (U32 j = 0; j < 3; j++)
+			{
+				mCenter[j].resize(NUM_BOXES);
+				mRadius[j].resize(NUM_BOXES);
+			}
+			for (S32 i = 0; i < NUM_BOXES; i++)
+			{
+				// mostly small boxes all around the frustum, every tenth
+				// one bigger than the frustum itself
+				F32 size = (i % 10 == 0) ? 100.f : 8.f;
+				for (U32 j = 0; j < 3; j++)
+				{
+					mCenter[j][i] = ll_frand(160.f) - 80.f;
+					mRadius[j][i] = ll_frand(size);
+				}
+			}
+		}
+
+		~camera_data()
+		{
+			LLCamera::setUseSSE(false);
+		}
+
+		void batch(S32 count, S32* results, BOOL no_far_clip)
+		{
+			const F32* const center[3] = { &mCenter[0][0], &mCenter[1][0], &mCenter[2][0] };
+			const F32* const radius[3] = { &mRadius[0][0], &mRadius[1][0], &mRadius[2][0] };
+			mCamera.AABBInFrustumBatch(center, radius, count, results, no_far_clip);
+		}
+
+		S32 scalar(S32 i, BOOL no_far_clip)
+		{
+			LLVector3 center(mCenter[0][i], mCenter[1][i], mCenter[2][i]);
+			LLVector3 radius(mRadius[0][i], mRadius[1][i], mRadius[2][i]);
+			return no_far_clip ? mCamera.AABBInFrustumNoFarClip(center, radius) : mCamera.AABBInFrustum(center, radius);
+		}
+
+		void ensureMatchesScalar(const std::string& msg, S32 count)
+		{
+			std::vector<S32> results(count + 1);
+			for (S32 no_far_clip = 0; no_far_clip < 2; no_far_clip++)
+			{
+				batch(count, &results[0], no_far_clip);
+				for (S32 i = 0; i < count; i++)
+				{
+					ensure_equals(msg, results[i], scalar(i, no_far_clip));
+				}
+			}
+		}
+
+		void ensureAllModesMatchScalar(S32 count)
+		{
+			LLCamera::setUseSSE(false);
+			ensureMatchesScalar("scalar batch", count);
+			if (LLCamera::supportsSSE())
+			{
+				LLCamera::setUseSSE(true);
+				ensure("SSE enabled", LLCamera::getUseSSE());
+				ensureMatchesScalar("SSE batch", count);
+			}
+		}
+
+		LLCamera mCamera;
+		std::vector<F32> mCenter[3];
+		std::vector<F32> mRadius[3];
+	};
+	typedef test_group<camera_data> camera_test;
+	typedef camera_test::object camera_object;
+	tut::camera_test camera_testcase("camera");
+
+	template<> template<>
+	void camera_object::test<1>()
+	{
+		// inside, outside and across the near plane
+		mCenter[0][0] = 10.f;	mCenter[1][0] = 0.f;	mCenter[2][0] = 0.f;
+		mRadius[0][0] = 1.f;	mRadius[1][0] = 1.f;	mRadius[2][0] = 1.f;
+		mCenter[0][1] = -10.f;	mCenter[1][1] = 0.f;	mCenter[2][1] = 0.f;
+		mRadius[0][1] = 1.f;	mRadius[1][1] = 1.f;	mRadius[2][1] = 1.f;
+		mCenter[0][2] = 1.f;	mCenter[1][2] = 0.f;	mCenter[2][2] = 0.f;
+		mRadius[0][2] = 0.5f;	mRadius[1][2] = 0.5f;	mRadius[2][2] = 0.5f;
+		mCenter[0][3] = 37.f;	mCenter[1][3] = 0.f;	mCenter[2][3] = 0.f;
+		mRadius[0][3] = 2.f;	mRadius[1][3] = 2.f;	mRadius[2][3] = 2.f;
+
+		ensure_equals("inside", scalar(0, FALSE), 2);
+		ensure_equals("outside", scalar(1, FALSE), 0);
+		ensure_equals("near plane", scalar(2, FALSE), 1);
+		ensure_equals("far plane", scalar(3, FALSE), 1);
+		ensure_equals("far plane ignored", scalar(3, TRUE), 2);
+
+		ensureAllModesMatchScalar(4);
+	}
+
+	template<> template<>
+	void camera_object::test<2>()
+	{
+		// random boxes, including ones larger than the frustum and a tail
+		// that doesn't fill a vector
+		ensureAllModesMatchScalar(NUM_BOXES);
+		ensureAllModesMatchScalar(3);
+		ensureAllModesMatchScalar(0);
+	}
+
+	template<> template<>
+	void camera_object::test<3>()
+	{
+		// a user clip plane makes a seventh plane, like water reflections do
+		mCamera.setUserClipPlane(LLPlane(LLVector3(0.f, 0.f, 2.f), LLVector3(0.f, 0.f, 1.f)));
+		ensureAllModesMatchScalar(NUM_BOXES);
+		mCamera.disableUserClipPlane();
+		ensureAllModesMatchScalar(NUM_BOXES);
+	}
+}
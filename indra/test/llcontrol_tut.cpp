@@ -39,6 +39,8 @@
 #include "llcontrol.h"
 #include "llsdserialize.h"
 
+#include <vector>
+
 namespace tut
 {
 
@@ -145,4 +147,119 @@ namespace tut
 		ensure("listener fired on changed setting", mListenerFired);	   
 	}
 
+	// what settings.xml declares handles for, more or less
+	const LLControlHandle<TYPE_BOOLEAN> TestBOOL = { 0 };
+	const LLControlHandle<TYPE_S32> TestS32 = { 1 };
+	const LLControlHandle<TYPE_F32> TestF32 = { 2 };
+	const LLControlHandle<TYPE_U32> TestU32 = { 3 };
+	const LLControlHandle<TYPE_STRING> TestString = { 4 };
+	const LLControlHandle<TYPE_F32> TestMissing = { 5 };
+	const LLControlHandle<TYPE_F32> TestWrongType = { 6 };
+	const char* const TEST_NAMES[] = { "TestBOOL", "TestS32", "TestF32", "TestU32", "TestString", "TestMissing", "TestWrongType" };
+	const eControlType TEST_TYPES[] = { TYPE_BOOLEAN, TYPE_S32, TYPE_F32, TYPE_U32, TYPE_STRING, TYPE_F32, TYPE_F32 };
+	const S32 TEST_COUNT = 7;
+
+	struct control_handle_data
+	{
+		control_handle_data()
+		:	mChanges(0)
+		{
+			mGroup.declareBOOL("TestBOOL", TRUE, "", FALSE);
+			mGroup.declareS32("TestS32", -3, "", FALSE);
+			mGroup.declareF32("TestF32", 0.5f, "", FALSE);
+			mGroup.declareU32("TestU32", 7, "", FALSE);
+			mGroup.declareString("TestString", "foo", "", FALSE);
+			mGroup.declareS32("TestWrongType", 1, "", FALSE);
+			mGroup.bindHandles(TEST_NAMES, TEST_TYPES, TEST_COUNT);
+		}
+
+		void onChange(const LLSD& value)
+		{
+			mChanges++;
+			mLastValue = value;
+		}
+
+		LLControlGroup mGroup;
+		S32 mChanges;
+		LLSD mLastValue;
+	};
+	typedef test_group<control_handle_data> control_handle_test;
+	typedef control_handle_test::object control_handle_t;
+	control_handle_test tut_control_handle("control_handle");
+
+	template<> template<>
+	void control_handle_t::test<1>()
+	{
+		ensure_equals("BOOL", mGroup.getBOOL(TestBOOL), TRUE);
+		ensure_equals("S32", mGroup.getS32(TestS32), -3);
+		ensure_equals("F32", mGroup.getF32(TestF32), 0.5f);
+		ensure_equals("U32", mGroup.getU32(TestU32), (U32)7);
+		ensure_equals("string", mGroup.getString(TestString), std::string("foo"));
+
+		// the same controls as by name
+		mGroup.setS32("TestS32", 12);
+		ensure_equals("set by name", mGroup.getS32(TestS32), 12);
+		mGroup.setF32(TestF32, 2.25f);
+		ensure_equals("set by handle", mGroup.getF32("TestF32"), 2.25f);
+		mGroup.setU32(TestU32, 0xfffffff0);
+		ensure_equals("U32 by handle", mGroup.getU32("TestU32"), (U32)0xfffffff0);
+		mGroup.setString(TestString, "bar");
+		ensure_equals("string by handle", mGroup.getString("TestString"), std::string("bar"));
+	}
+
+	template<> template<>
+	void control_handle_t::test<2>()
+	{
+		// setting through a handle still tells whoever is listening
+		mGroup.getControl("TestBOOL")->getSignal()->connect(boost::bind(&control_handle_data::onChange, this, _1));
+		mGroup.setBOOL(TestBOOL, FALSE);
+		ensure_equals("changed", mChanges, 1);
+		ensure_equals("new value", mLastValue.asBoolean(), false);
+		ensure_equals("got new value", mGroup.getBOOL(TestBOOL), FALSE);
+	}
+
+	template<> template<>
+	void control_handle_t::test<3>()
+	{
+		// missing controls, the wrong type and handles past the end of the
+		// table don't get bound to anything
+		ensure("bound", mGroup.getControl(TestF32.mIndex) == mGroup.getControl("TestF32"));
+		ensure("missing", mGroup.getControl(TestMissing.mIndex) == NULL);
+		ensure("wrong type", mGroup.getControl(TestWrongType.mIndex) == NULL);
+		ensure("past the end", mGroup.getControl(TEST_COUNT) == NULL);
+		ensure("negative", mGroup.getControl(-1) == NULL);
+
+		mGroup.cleanup();
+		ensure("cleaned up", mGroup.getControl(TestBOOL.mIndex) == NULL);
+	}
+
+	template<> template<>
+	void control_handle_t::test<4>()
+	{
+		// about as many settings as the viewer has, and every handle reads
+		// the same control as its name, wherever it is in the table
+		const S32 NUM_CONTROLS = 1200;
+
+		LLControlGroup group;
+		std::vector<std::string> names;
+		std::vector<const char*> name_ptrs;
+		std::vector<eControlType> types(NUM_CONTROLS, TYPE_F32);
+		for (S32 i = 0; i < NUM_CONTROLS; i++)
+		{
+			names.push_back(llformat("RenderTestSetting%d", i));
+			group.declareF32(names.back(), (F32)i, "", FALSE);
+		}
+		for (S32 i = 0; i < NUM_CONTROLS; i++)
+		{
+			name_ptrs.push_back(names[i].c_str());
+		}
+		group.bindHandles(&name_ptrs[0], &types[0], NUM_CONTROLS);
+
+		for (S32 i = 0; i < NUM_CONTROLS; i++)
+		{
+			LLControlHandle<TYPE_F32> handle = { i };
+			ensure("same control", group.getControl(i) == group.getControl(names[i]));
+			ensure_equals("same value", group.getF32(handle), group.getF32(names[i]));
+		}
+	}
 }
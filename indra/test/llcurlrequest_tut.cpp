@@ -0,0 +1,224 @@
+/** 
+ * @file llcurlrequest_tut.cpp
+ * @brief Tests for the LLCurlRequest scheduler.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+/**
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+
+// These are too slow on Windows to actually include in the build. JC
+#if !LL_WINDOWS
+
+#include "lltut.h"
+#include "llcurl.h"
+#include "llformat.h"
+#include "llpumpio.h"
+#include "lltimer.h"
+
+#include "llsdhttpserver.h"
+#include "lliohttpserver.h"
+
+namespace tut
+{
+	class SchedulerValueNode : public LLHTTPNode
+	{
+	public:
+		LLSD get() const { return LLSD("value"); }
+	};
+
+	class SchedulerHoldNode : public LLHTTPNode
+	{
+	public:
+		void get(ResponsePtr r, const LLSD& context) const
+		{
+			/* never answers, like a long poll with no events */
+		}
+	};
+
+	LLHTTPRegistration<SchedulerValueNode>	gSchedulerValueNode("/test/scheduler/value");
+	LLHTTPRegistration<SchedulerHoldNode>	gSchedulerHoldNode("/test/scheduler/hold");
+
+	const std::string SCHEDULER_SERVER = "http://localhost:8891";
+
+	struct CurlRequestTestData
+	{
+		CurlRequestTestData()
+			: mMaxActive(0)
+		{
+			apr_pool_create(&mPool, NULL);
+			mServerPump = new LLPumpIO(mPool);
+			mRequest = new LLCurlRequest();
+
+			LLHTTPNode& root = LLIOHTTPServer::create(mPool, *mServerPump, 8891);
+			LLHTTPStandardServices::useServices();
+			LLHTTPRegistrar::buildAllServices(root);
+		}
+
+		~CurlRequestTestData()
+		{
+			delete mRequest;
+			delete mServerPump;
+			apr_pool_destroy(mPool);
+		}
+
+		class Result : public LLCurl::Responder
+		{
+		public:
+			Result(CurlRequestTestData& client, S32 tag)
+				: mClient(client), mTag(tag)
+			{
+			}
+
+			virtual void completed(U32 status, const std::string& reason, const LLSD& content)
+			{
+				mClient.mOrder.push_back(mTag);
+				mClient.mStatus.push_back(status);
+			}
+
+		private:
+			CurlRequestTestData& mClient;
+			S32 mTag;
+		};
+
+		LLCurl::ResponderPtr newResult(S32 tag)
+		{
+			return new Result(*this, tag);
+		}
+
+		// Runs until count requests have completed, tracking the most
+		// requests curl was handed at once.
+		void runUntil(size_t count, F32 timeout = 10.f)
+		{
+			LLTimer timer;
+			timer.setTimerExpirySec(timeout);
+			while (mOrder.size() < count && !timer.hasExpired())
+			{
+				mServerPump->pump();
+				mServerPump->callback();
+				mRequest->process();
+				mMaxActive = llmax(mMaxActive, mRequest->getActive());
+			}
+		}
+
+		apr_pool_t* mPool;
+		LLPumpIO* mServerPump;
+		LLCurlRequest* mRequest;
+		std::vector<S32> mOrder;
+		std::vector<U32> mStatus;
+		S32 mMaxActive;
+	};
+
+	typedef test_group<CurlRequestTestData> CurlRequestTestGroup;
+	typedef CurlRequestTestGroup::object CurlRequestTestObject;
+	CurlRequestTestGroup curlRequestTestGroup("curl_request");
+
+	template<> template<>
+	void CurlRequestTestObject::test<1>()
+	{
+		// one connection, so requests go out strictly by priority
+		mRequest->setClassLimit(LLCurlRequest::REQUEST_CLASS_CAPS, 1);
+		const F32 priorities[] = { 1.f, 3.f, 2.f, 3.f };
+		for (S32 i = 0; i < 4; ++i)
+		{
+			mRequest->get(SCHEDULER_SERVER + "/test/scheduler/value", newResult(i), priorities[i]);
+		}
+		ensure_equals("nothing dispatched before process()", mRequest->getPending(), 4);
+
+		runUntil(4);
+		ensure_equals("all completed", mOrder.size(), (size_t)4);
+		ensure_equals("first", mOrder[0], 1);
+		ensure_equals("equal priority is fifo", mOrder[1], 3);
+		ensure_equals("third", mOrder[2], 2);
+		ensure_equals("last", mOrder[3], 0);
+		ensure_equals("class limit", mMaxActive, 1);
+		ensure_equals("status", mStatus[0], 200U);
+	}
+
+	template<> template<>
+	void CurlRequestTestObject::test<2>()
+	{
+		// the host limit caps concurrency across classes, and the
+		// stats see the requests that had to wait for it
+		mRequest->setHostLimit(2);
+		LLCurlRequest::headers_t headers;
+		for (S32 i = 0; i < 10; ++i)
+		{
+			LLCurlRequest::ERequestClass request_class =
+				(i % 2) ? LLCurlRequest::REQUEST_CLASS_TEXTURE : LLCurlRequest::REQUEST_CLASS_CAPS;
+			mRequest->getByteRange(SCHEDULER_SERVER + "/test/scheduler/value", headers, 0, -1,
+								   newResult(i), 0.f, request_class);
+		}
+
+		runUntil(10);
+		ensure_equals("all completed", mOrder.size(), (size_t)10);
+		ensure("host limit", mMaxActive <= 2);
+		ensure_equals("nothing left", mRequest->getQueued(), 0);
+
+		const LLCurlRequest::Stats& caps = mRequest->getStats(LLCurlRequest::REQUEST_CLASS_CAPS);
+		const LLCurlRequest::Stats& textures = mRequest->getStats(LLCurlRequest::REQUEST_CLASS_TEXTURE);
+		ensure_equals("caps count", caps.mRequests, 5U);
+		ensure_equals("texture count", textures.mRequests, 5U);
+		ensure_equals("no failures", caps.mFailures + textures.mFailures, 0U);
+		ensure("some requests queued", caps.mMaxQueueWait + textures.mMaxQueueWait > 0.0);
+		ensure("transfer time recorded", caps.mTransferTime > 0.0);
+	}
+
+	template<> template<>
+	void CurlRequestTestObject::test<3>()
+	{
+		// a long poll parked on the host doesn't hold its only slot
+		mRequest->setHostLimit(1);
+		mRequest->get(SCHEDULER_SERVER + "/test/scheduler/hold", newResult(0),
+					  1.f, LLCurlRequest::REQUEST_CLASS_LONG_POLL);
+		mRequest->get(SCHEDULER_SERVER + "/test/scheduler/value", newResult(1));
+
+		runUntil(1);
+		ensure_equals("caps completed", mOrder.size(), (size_t)1);
+		ensure_equals("caps request", mOrder[0], 1);
+		ensure_equals("long poll still open", mRequest->getActive(), 1);
+	}
+
+	template<> template<>
+	void CurlRequestTestObject::test<4>()
+	{
+		// nothing listening, the failure reaches the responder and stats
+		mRequest->get("http://localhost:8892/test/scheduler/value", newResult(0));
+
+		runUntil(1);
+		ensure_equals("completed", mOrder.size(), (size_t)1);
+		ensure_equals("transport failure", mStatus[0], 499U);
+		ensure_equals("failure counted",
+					  mRequest->getStats(LLCurlRequest::REQUEST_CLASS_CAPS).mFailures, 1U);
+	}
+}
+
+#endif	// !LL_WINDOWS
@@ -0,0 +1,136 @@
+/**
+ * @file lleventtrace_tut.cpp
+ * @date 2010-06
+ * @brief LLEventTrace test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "lleventtrace.h"
+#include "llfasttimer.h"
+#include "lluuid.h"
+
+#include <sstream>
+
+static LLFastTimer::DeclareTimer FTM_TEST_TRACE("Test Trace");
+
+namespace tut
+{
+	struct eventtrace_data
+	{
+		eventtrace_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "eventtrace-test-" << random << ".json";
+#else
+			oStr << "/tmp/eventtrace-test-" << random << ".json";
+#endif
+			mFilename = oStr.str();
+		}
+
+		~eventtrace_data()
+		{
+			LLEventTrace::setEnabled(FALSE);
+			LLFile::remove(mFilename);
+		}
+
+		std::string writeTrace()
+		{
+			ensure("written", LLEventTrace::writeChromeTrace(mFilename));
+			llifstream file(mFilename);
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			return contents.str();
+		}
+
+		static S32 count(const std::string& str, const std::string& sub)
+		{
+			S32 found = 0;
+			for (size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1))
+			{
+				found++;
+			}
+			return found;
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<eventtrace_data> eventtrace_test;
+	typedef eventtrace_test::object eventtrace_object;
+	tut::eventtrace_test eventtrace_testcase("eventtrace");
+
+	template<> template<>
+	void eventtrace_object::test<1>()
+	{
+		// a timer that started before recording did has no end to write
+		LLFastTimer outer(FTM_TEST_TRACE);
+
+		LLEventTrace::setEnabled(TRUE);
+		ensure("enabled", LLEventTrace::isEnabled());
+		for (S32 i = 0; i < 3; i++)
+		{
+			LLFastTimer t(FTM_TEST_TRACE);
+			LLEventTraceScope trace(LLEventTrace::CAT_MESSAGE, LLEventTrace::internName("Test \"Message\""));
+		}
+		std::string trace = writeTrace();
+
+		ensure("header", trace.find("{\"traceEvents\":[") == 0);
+		ensure("main thread", trace.find("\"args\":{\"name\":\"Main\"}") != std::string::npos);
+		ensure_equals("timer", count(trace, "\"cat\":\"timer\",\"name\":\"Test Trace\""), 3);
+		ensure_equals("message", count(trace, "\"cat\":\"message\",\"name\":\"Test \\\"Message\\\"\""), 3);
+		ensure_equals("balanced", count(trace, "\"ph\":\"E\""), count(trace, "\"ph\":\"B\""));
+	}
+
+	template<> template<>
+	void eventtrace_object::test<2>()
+	{
+		// only the last BUFFER_EVENTS are kept
+		LLEventTrace::setEnabled(TRUE);
+		for (S32 i = 0; i < LLEventTrace::BUFFER_EVENTS; i++)
+		{
+			LLEventTraceScope trace(LLEventTrace::CAT_REQUEST, "Test Request");
+		}
+		LLEventTrace::setEnabled(FALSE);
+		{
+			LLEventTraceScope trace(LLEventTrace::CAT_REQUEST, "Test Untraced");
+		}
+		std::string trace = writeTrace();
+
+		// the oldest slot might have been mid write, so it is left out
+		S32 requests = count(trace, "\"name\":\"Test Request\"");
+		ensure("wrapped", requests <= LLEventTrace::BUFFER_EVENTS / 2 && requests >= LLEventTrace::BUFFER_EVENTS / 2 - 1);
+		ensure_equals("balanced", count(trace, "\"ph\":\"E\""), count(trace, "\"ph\":\"B\""));
+		ensure("disabled", trace.find("Test Untraced") == std::string::npos);
+	}
+}
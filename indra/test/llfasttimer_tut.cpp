@@ -0,0 +1,133 @@
+/**
+ * @file llfasttimer_tut.cpp
+ * @date 2010-06
+ * @brief LLFastTimer per thread timer test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llfasttimer.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+static LLFastTimer::DeclareTimer FTM_TEST_OUTER("Test Outer");
+static LLFastTimer::DeclareTimer FTM_TEST_INNER("Test Inner");
+static LLFastTimer::DeclareTimer FTM_TEST_OUTER_AGAIN("Test Outer");
+
+namespace tut
+{
+	class FastTimerTestThread : public LLThread
+	{
+	public:
+		FastTimerTestThread()
+		:	LLThread("Fast Timer Test")
+		{
+		}
+
+		virtual void run()
+		{
+			for (S32 i = 0; i < 10; i++)
+			{
+				LLFastTimer t(FTM_TEST_OUTER);
+				{
+					LLFastTimer t2(FTM_TEST_INNER);
+					{
+						// recursion is counted once, under the first caller
+						LLFastTimer t3(FTM_TEST_INNER);
+					}
+				}
+			}
+		}
+	};
+
+	struct fasttimer_data
+	{
+		// Returns the test thread's stats, if reset() had collected them.
+		bool findTestThread(LLFastTimer::ThreadStats& found)
+		{
+			std::vector<LLFastTimer::ThreadStats> stats;
+			LLFastTimer::getThreadStats(stats);
+			for (size_t i = 0; i < stats.size(); i++)
+			{
+				if (stats[i].mName == "Fast Timer Test" && !stats[i].mTimers.empty())
+				{
+					found = stats[i];
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+	typedef test_group<fasttimer_data> fasttimer_test;
+	typedef fasttimer_test::object fasttimer_object;
+	tut::fasttimer_test fasttimer_testcase("fasttimer");
+
+	template<> template<>
+	void fasttimer_object::test<1>()
+	{
+		ensure("registered", FTM_TEST_OUTER.getIndex() >= 0);
+		ensure("distinct", FTM_TEST_OUTER.getIndex() != FTM_TEST_INNER.getIndex());
+		ensure_equals("same name shares counters", FTM_TEST_OUTER_AGAIN.getIndex(), FTM_TEST_OUTER.getIndex());
+		ensure_equals("name", LLFastTimer::getTimerName(LLFastTimer::FTM_NUM_TYPES + FTM_TEST_INNER.getIndex()),
+					  std::string("Test Inner"));
+		ensure("main thread", LLFastTimer::isMainThread());
+	}
+
+	template<> template<>
+	void fasttimer_object::test<2>()
+	{
+		FastTimerTestThread thread;
+		thread.start();
+		while (!thread.isStopped())
+		{
+			ms_sleep(1);
+		}
+
+		// A thread's counts are collected the frame after they were made,
+		// or straight away once it has exited.
+		LLFastTimer::ThreadStats stats;
+		LLFastTimer::reset();
+		bool found = findTestThread(stats);
+		LLFastTimer::reset();
+		found = findTestThread(stats) || found;
+		ensure("collected", found);
+
+		S32 outer = LLFastTimer::FTM_NUM_TYPES + FTM_TEST_OUTER.getIndex();
+		S32 inner = LLFastTimer::FTM_NUM_TYPES + FTM_TEST_INNER.getIndex();
+		ensure_equals("timers", stats.mTimers.size(), (size_t)2);
+		ensure_equals("root", stats.mTimers[0].mTimer, outer);
+		ensure_equals("root parent", stats.mTimers[0].mParent, -1);
+		ensure_equals("child", stats.mTimers[1].mTimer, inner);
+		ensure_equals("child parent", stats.mTimers[1].mParent, 0);
+		ensure_equals("child depth", stats.mTimers[1].mDepth, 1);
+		ensure("calls", stats.mTimers[1].mCallAverage > stats.mTimers[0].mCallAverage);
+	}
+}
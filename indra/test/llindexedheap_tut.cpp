@@ -0,0 +1,202 @@
+/**
+ * @file llindexedheap_tut.cpp
+ * @date 2010-06
+ * @brief LLIndexedHeap test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llindexedheap.h"
+#include "llrand.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace tut
+{
+	struct indexedheap_data
+	{
+		struct Item
+		{
+			Item() : mIndex(-1), mPriority(0.f) {}
+			S32 mIndex;
+			F32 mPriority;
+		};
+
+		static void setIndex(Item* &item, const S32 index)	{ item->mIndex = index; }
+		static S32 getIndex(Item* const &item)				{ return item->mIndex; }
+
+		indexedheap_data()
+		:	mItems(100),
+			mHeap(&setIndex, &getIndex)
+		{
+		}
+
+		void push(S32 i, F32 priority)
+		{
+			mItems[i].mPriority = priority;
+			mHeap.push(priority, &mItems[i]);
+		}
+
+		// pops everything, checking the order and every index on the way
+		void ensurePopsInOrder(S32 expected_count)
+		{
+			ensure_equals("length", mHeap.getLength(), expected_count);
+			F32 last = F32_MAX;
+			S32 count = 0;
+			Item* item;
+			F32 priority;
+			while (mHeap.pop(&item, &priority))
+			{
+				ensure("order", priority <= last);
+				ensure_equals("priority", priority, item->mPriority);
+				ensure_equals("index cleared", item->mIndex, -1);
+				last = priority;
+				count++;
+			}
+			ensure_equals("count", count, expected_count);
+			ensure("empty", mHeap.isEmpty());
+		}
+
+		// before mHeap, which tells the items about their indices as it's
+		// destroyed
+		std::vector<Item> mItems;
+		LLIndexedHeap<Item*> mHeap;
+	};
+	typedef test_group<indexedheap_data> indexedheap_test;
+	typedef indexedheap_test::object indexedheap_object;
+	tut::indexedheap_test indexedheap_testcase("indexedheap");
+
+	template<> template<>
+	void indexedheap_object::test<1>()
+	{
+		Item* item = NULL;
+		ensure("pop empty", !mHeap.pop(&item));
+		ensure("remove missing", !mHeap.remove(&mItems[0]));
+
+		push(0, 1.f);
+		push(1, 3.f);
+		push(2, 2.f);
+		ensure("contains", mHeap.contains(&mItems[1]));
+		ensure_equals("top", mHeap.getTopPriority(), 3.f);
+		ensurePopsInOrder(3);
+		ensure("no longer contains", !mHeap.contains(&mItems[1]));
+	}
+
+	template<> template<>
+	void indexedheap_object::test<2>()
+	{
+		// reprioritizing in both directions, and raise() only going up
+		for (S32 i = 0; i < 10; i++)
+		{
+			push(i, (F32)i);
+		}
+		push(0, 20.f);
+		push(9, -1.f);
+		ensure_equals("same length", mHeap.getLength(), 10);
+		ensure_equals("raised to top", mHeap.getTopPriority(), 20.f);
+
+		mHeap.raise(5.f, &mItems[0]);
+		ensure_equals("raise doesn't lower", mHeap.getTopPriority(), 20.f);
+		mItems[1].mPriority = 30.f;
+		mHeap.raise(30.f, &mItems[1]);
+		ensure_equals("raise", mHeap.getTopPriority(), 30.f);
+
+		ensurePopsInOrder(10);
+	}
+
+	template<> template<>
+	void indexedheap_object::test<3>()
+	{
+		// random pushes, updates and removals against a sorted copy
+		for (S32 i = 0; i < (S32)mItems.size(); i++)
+		{
+			push(i, ll_frand(100.f));
+		}
+		S32 count = mItems.size();
+		for (S32 pass = 0; pass < 200; pass++)
+		{
+			S32 i = ll_rand(mItems.size());
+			if (pass % 3 == 0)
+			{
+				if (mHeap.remove(&mItems[i]))
+				{
+					count--;
+				}
+			}
+			else
+			{
+				if (!mHeap.contains(&mItems[i]))
+				{
+					count++;
+				}
+				push(i, ll_frand(100.f));
+			}
+		}
+
+		std::vector<F32> expected;
+		for (S32 i = 0; i < (S32)mItems.size(); i++)
+		{
+			if (mItems[i].mIndex >= 0)
+			{
+				expected.push_back(mItems[i].mPriority);
+			}
+		}
+		std::sort(expected.begin(), expected.end(), std::greater<F32>());
+		ensure_equals("length", mHeap.getLength(), count);
+		ensure_equals("tracked", (S32)expected.size(), count);
+
+		for (std::vector<F32>::iterator iter = expected.begin(); iter != expected.end(); ++iter)
+		{
+			Item* item = NULL;
+			F32 priority;
+			ensure("pop", mHeap.pop(&item, &priority));
+			ensure_equals("sorted", priority, *iter);
+		}
+		ensure("empty", mHeap.isEmpty());
+	}
+
+	template<> template<>
+	void indexedheap_object::test<4>()
+	{
+		for (S32 i = 0; i < 10; i++)
+		{
+			push(i, (F32)i);
+		}
+		mHeap.clear();
+		ensure("empty", mHeap.isEmpty());
+		for (S32 i = 0; i < 10; i++)
+		{
+			ensure_equals("index cleared", mItems[i].mIndex, -1);
+		}
+	}
+}
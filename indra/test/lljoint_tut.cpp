@@ -32,9 +32,6 @@
  * $/LicenseInfo$
  */
 
-#ifdef THIS_DOESNT_LINK
-// THIS DOESN'T LINK!
-
 #include <tut/tut.hpp>
 #include "lltut.h"
 #include "linden_common.h"
@@ -42,6 +39,11 @@
 #include "v3math.h"
 #include "lljoint.h"
 
+#include <deque>
+#include <vector>
+
+#ifdef THIS_DOESNT_LINK
+// THIS DOESN'T LINK!
 
 namespace tut
 {
@@ -246,3 +248,165 @@ namespace tut
 	//*
 }
 #endif // THIS_DOESNT_LINK
+
+namespace tut
+{
+	struct lljoint_update_data
+	{
+		~lljoint_update_data()
+		{
+			for (std::deque<std::vector<LLJoint*> >::iterator iter = mSkeletons.begin();
+				 iter != mSkeletons.end(); ++iter)
+			{
+				std::vector<LLJoint*>& joints = *iter;
+				// children first
+				for (S32 i = (S32)joints.size() - 1; i >= 0; i--)
+				{
+					delete joints[i];
+				}
+			}
+		}
+
+		// a skeleton of count joints, each one's parent at (i - 1) / 3
+		std::vector<LLJoint*>& addSkeleton(S32 count)
+		{
+			mSkeletons.push_back(std::vector<LLJoint*>());
+			std::vector<LLJoint*>& joints = mSkeletons.back();
+			for (S32 i = 0; i < count; i++)
+			{
+				LLJoint* joint = new LLJoint(llformat("joint%d", i), i ? joints[(i - 1) / 3] : NULL);
+				joint->setPosition(LLVector3(0.1f * (i % 3), 0.f, 0.2f));
+				joint->setRotation(LLQuaternion(0.1f * i, LLVector3::z_axis));
+				joints.push_back(joint);
+			}
+			return joints;
+		}
+
+		static void animate(std::vector<LLJoint*>& joints, S32 index, F32 angle)
+		{
+			joints[index]->setRotation(LLQuaternion(angle, LLVector3::x_axis));
+		}
+
+		// the matrices updateWorldMatrixChildren() left in a, against what
+		// getWorldMatrix() works out for b
+		void ensureSameMatrices(const char* msg, std::vector<LLJoint*>& a, std::vector<LLJoint*>& b)
+		{
+			for (size_t i = 0; i < a.size(); i++)
+			{
+				ensure(llformat("%s: joint %d", msg, (S32)i),
+					   a[i]->getXform()->getWorldMatrix() == b[i]->getWorldMatrix());
+			}
+		}
+
+		// a deque so that adding a skeleton leaves the others where they are
+		std::deque<std::vector<LLJoint*> > mSkeletons;
+	};
+	typedef test_group<lljoint_update_data> lljoint_update_test;
+	typedef lljoint_update_test::object lljoint_update_object;
+	tut::lljoint_update_test lljoint_update_testcase("lljoint_update");
+
+	template<> template<>
+	void lljoint_update_object::test<1>()
+	{
+		std::vector<LLJoint*>& a = addSkeleton(40);
+		std::vector<LLJoint*>& b = addSkeleton(40);
+		a[0]->updateWorldMatrixChildren();
+		ensureSameMatrices("first update", a, b);
+
+		animate(a, 5, 0.5f);
+		animate(b, 5, 0.5f);
+		animate(a, 30, -1.f);
+		animate(b, 30, -1.f);
+		a[0]->updateWorldMatrixChildren();
+		ensureSameMatrices("animated", a, b);
+
+		a[0]->setPosition(LLVector3(10.f, 20.f, 30.f));
+		b[0]->setPosition(LLVector3(10.f, 20.f, 30.f));
+		a[0]->updateWorldMatrixChildren();
+		ensureSameMatrices("moved", a, b);
+	}
+
+	template<> template<>
+	void lljoint_update_object::test<2>()
+	{
+		// only what was touched, and what's below it, gets updated
+		std::vector<LLJoint*>& joints = addSkeleton(40);
+		joints[0]->updateWorldMatrixChildren();
+
+		S32 updates = LLJoint::sNumUpdates;
+		joints[0]->updateWorldMatrixChildren();
+		ensure_equals("nothing dirty", LLJoint::sNumUpdates, updates);
+
+		animate(joints, 39, 1.f);
+		joints[0]->updateWorldMatrixChildren();
+		ensure_equals("one leaf", LLJoint::sNumUpdates, updates + 1);
+
+		// joint 4 and 13, 14 and 15 below it
+		animate(joints, 4, 1.f);
+		joints[0]->updateWorldMatrixChildren();
+		ensure_equals("subtree", LLJoint::sNumUpdates, updates + 1 + 4);
+	}
+
+	template<> template<>
+	void lljoint_update_object::test<3>()
+	{
+		std::vector<LLJoint*>& a = addSkeleton(40);
+		std::vector<LLJoint*>& b = addSkeleton(40);
+		a[0]->updateWorldMatrixChildren();
+
+		// left alone while mUpdateXform is off, and caught up once it's on
+		a[4]->mUpdateXform = FALSE;
+		animate(a, 13, 1.f);
+		animate(b, 13, 1.f);
+		a[0]->updateWorldMatrixChildren();
+		ensure("not updated", a[13]->getXform()->getWorldMatrix() != b[13]->getWorldMatrix());
+		animate(a, 20, 1.f);
+		animate(b, 20, 1.f);
+		a[0]->updateWorldMatrixChildren();
+		a[4]->mUpdateXform = TRUE;
+		a[0]->updateWorldMatrixChildren();
+		ensureSameMatrices("caught up", a, b);
+
+		// joints added and removed after the first update
+		LLJoint* extra = new LLJoint("extra", a[39]);
+		a.push_back(extra);
+		b.push_back(new LLJoint("extra", b[39]));
+		a[0]->updateWorldMatrixChildren();
+		ensureSameMatrices("added", a, b);
+
+		LLMatrix4 removed = a[4]->getXform()->getWorldMatrix();
+		a[1]->removeChild(a[4]);
+		b[1]->removeChild(b[4]);
+		a[0]->setPosition(LLVector3(1.f, 0.f, 0.f));
+		b[0]->setPosition(LLVector3(1.f, 0.f, 0.f));
+		a[0]->updateWorldMatrixChildren();
+		ensure("removed", a[4]->getXform()->getWorldMatrix() == removed);
+		ensure("still there", a[5]->getXform()->getWorldMatrix() == b[5]->getWorldMatrix());
+		a[1]->addChild(a[4]);
+		b[1]->addChild(b[4]);
+	}
+
+	template<> template<>
+	void lljoint_update_object::test<4>()
+	{
+		// a skeleton about the size of an avatar's, with a few joints
+		// animated each frame, keeps up with working everything out again
+		const S32 JOINTS = 100;
+		const S32 ANIMATED = 12;
+		const S32 FRAMES = 20;
+
+		std::vector<LLJoint*>& a = addSkeleton(JOINTS);
+		std::vector<LLJoint*>& b = addSkeleton(JOINTS);
+		a[0]->updateWorldMatrixChildren();
+		for (S32 frame = 0; frame < FRAMES; frame++)
+		{
+			for (S32 j = 0; j < ANIMATED; j++)
+			{
+				animate(a, JOINTS - 1 - j * 3, 0.1f * frame);
+				animate(b, JOINTS - 1 - j * 3, 0.1f * frame);
+			}
+			a[0]->updateWorldMatrixChildren();
+			ensureSameMatrices(llformat("frame %d", frame).c_str(), a, b);
+		}
+	}
+}
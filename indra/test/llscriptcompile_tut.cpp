@@ -0,0 +1,399 @@
+/**
+ * @file llscriptcompile_tut.cpp
+ * @date 2010-06
+ * @brief LSL compiler test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llformat.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "lscript_bytecode.h"
+#include "lscript_execute.h"
+#include "lscript_rt_interface.h"
+
+#include <sstream>
+#include <vector>
+
+namespace tut
+{
+	// Folds, dead branches and loops with constant conditions, with the
+	// results left in the first NUM_GOLDEN_GLOBALS globals.
+	const S32 NUM_GOLDEN_GLOBALS = 14;
+	const char* GOLDEN_SCRIPT =
+		"integer gInt;\n"
+		"integer gWrap;\n"
+		"integer gDiv;\n"
+		"integer gShift;\n"
+		"integer gCmp;\n"
+		"integer gCast;\n"
+		"integer gLoop;\n"
+		"integer gBranch;\n"
+		"integer gStr;\n"
+		"integer gCompound;\n"
+		"float gFloat;\n"
+		"float gMixed;\n"
+		"vector gVec;\n"
+		"rotation gRot;\n"
+		"integer gSize = 16;\n"
+		"float gScale = 2.5;\n"
+		"string gPrefix = \"ab\";\n"
+		"integer gUnused = 7;\n"
+		"\n"
+		"integer unused(integer a)\n"
+		"{\n"
+		"\treturn a * 2;\n"
+		"}\n"
+		"\n"
+		"integer count(integer n)\n"
+		"{\n"
+		"\tinteger i = 0;\n"
+		"\twhile (TRUE)\n"
+		"\t{\n"
+		"\t\tif (i >= n)\n"
+		"\t\t{\n"
+		"\t\t\treturn i;\n"
+		"\t\t}\n"
+		"\t\t++i;\n"
+		"\t}\n"
+		"\treturn -1;\n"
+		"}\n"
+		"\n"
+		"default\n"
+		"{\n"
+		"\tstate_entry()\n"
+		"\t{\n"
+		"\t\tinteger x = 3;\n"
+		"\t\tgInt = (1 + 2) * (gSize - 6) / 4 % 7 + -(5) + ~2 + !0;\n"
+		"\t\tgWrap = 2147483647 + 1 + 0x7fffffff * 3 - (-2147483647 - 1);\n"
+		"\t\tgDiv = -7 / 2 + -7 % 3 + 7 / -2;\n"
+		"\t\tgShift = (1 << 31) + (-256 >> 4) + (gSize << 2) + (x << 1);\n"
+		"\t\tgCmp = (1 < 2) + (2 <= 2) * 2;\n"
+		"\t\tgCmp += (3 > 4) * 4 + (1.5 >= 1) * 8;\n"
+		"\t\tgCmp += (2 == 2.0) * 16 + (3 != 3) * 32 + (1 && 0) * 64 + (0 || 5) * 128;\n"
+		"\t\tgCast = (integer)2.7 + (integer)-2.7 + (integer)\"42\" + (integer)((string)17) + (integer)((float)3 * 2);\n"
+		"\t\tgFloat = gScale * 4 + 1.0 / 3.0 - (float)\"0.5\" + (float)(gSize / 3);\n"
+		"\t\tgMixed = gSize / 5.0 + 7 * 0.1 + x;\n"
+		"\t\tgVec = <1, gSize, 3 + 4> * 2 + <gScale, -1, (float)x>;\n"
+		"\t\tgRot = <0, 0, 1 - 1, 2>;\n"
+		"\t\tgStr = (gPrefix + \"cd\" == \"abcd\") + ((string)(1 + 1) + \"x\" == \"2x\") * 2 + ((string)1.5 == \"1.500000\") * 4;\n"
+		"\t\tif (FALSE)\n"
+		"\t\t{\n"
+		"\t\t\tgBranch = 100;\n"
+		"\t\t}\n"
+		"\t\telse if (gSize > 10)\n"
+		"\t\t{\n"
+		"\t\t\tgBranch = 1;\n"
+		"\t\t}\n"
+		"\t\telse\n"
+		"\t\t{\n"
+		"\t\t\tgBranch = 2;\n"
+		"\t\t}\n"
+		"\t\tif (TRUE) gBranch += 10;\n"
+		"\t\tif (0) gBranch += 1000;\n"
+		"\t\twhile (FALSE)\n"
+		"\t\t{\n"
+		"\t\t\tgBranch = -1;\n"
+		"\t\t}\n"
+		"\t\tfor (x = 0; FALSE; ++x)\n"
+		"\t\t{\n"
+		"\t\t\tgBranch = -2;\n"
+		"\t\t}\n"
+		"\t\tdo\n"
+		"\t\t{\n"
+		"\t\t\tgBranch += 100;\n"
+		"\t\t}\n"
+		"\t\twhile (FALSE);\n"
+		"\t\tinteger i;\n"
+		"\t\tfor (i = 0; TRUE; i++)\n"
+		"\t\t{\n"
+		"\t\t\tif (i == 5)\n"
+		"\t\t\t{\n"
+		"\t\t\t\tjump done;\n"
+		"\t\t\t}\n"
+		"\t\t\tgLoop += i;\n"
+		"\t\t}\n"
+		"\t\t@done;\n"
+		"\t\tdo\n"
+		"\t\t{\n"
+		"\t\t\tgLoop += 1000;\n"
+		"\t\t\tif (gLoop > 3000)\n"
+		"\t\t\t{\n"
+		"\t\t\t\tjump out;\n"
+		"\t\t\t}\n"
+		"\t\t}\n"
+		"\t\twhile (1);\n"
+		"\t\t@out;\n"
+		"\t\tgLoop += count(gSize);\n"
+		"\t\tgCompound = 1;\n"
+		"\t\tgCompound += 2 * 3;\n"
+		"\t\tgCompound *= 1 + 1;\n"
+		"\t\tgCompound -= gSize;\n"
+		"\t\tgCompound /= -1 + 3;\n"
+		"\t\tgCompound %= 5;\n"
+		"\t\tgCompound++;\n"
+		"\t\t++gCompound;\n"
+		"\t\tx;\n"
+		"\t\t5;\n"
+		"\t\tgSize;\n"
+		"\t}\n"
+		"}\n";
+
+	struct scriptcompile_data
+	{
+		scriptcompile_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "scriptcompile-test-" << random;
+#else
+			oStr << "/tmp/scriptcompile-test-" << random;
+#endif
+			mBaseName = oStr.str();
+		}
+
+		~scriptcompile_data()
+		{
+			LLFile::remove(mBaseName + ".lsl");
+			LLFile::remove(mBaseName + ".out");
+			LLFile::remove(mBaseName + ".lso");
+			LLFile::remove(mBaseName + ".cil");
+		}
+
+		// A script with num_functions functions that loop, branch, call
+		// each other and build strings and lists, like the big scripts
+		// people actually write.
+		static std::string makeScript(S32 num_functions)
+		{
+			std::ostringstream script;
+			for (S32 i = 0; i < 20; i++)
+			{
+				script << "integer gCount" << i << " = " << i << ";\n";
+				script << "string gName" << i << " = \"name" << i << "\";\n";
+				script << "list gList" << i << " = [" << i << ", 2.5, \"x\", <1, 2, 3>];\n";
+			}
+			for (S32 f = 0; f < num_functions; f++)
+			{
+				script << "integer func" << f << "(integer a, integer b)\n{\n"
+					   << "\tinteger i;\n\tstring s = \"\";\n\tlist l = [];\n"
+					   << "\tfor (i = 0; i < a; ++i)\n\t{\n"
+					   << "\t\ts += (string)i + \",\" + llGetSubString(gName" << f % 20 << ", i % 4, i % 4);\n"
+					   << "\t\tl += [i * " << f + 1 << " + b, (float)i / 3.0, <i, b, " << f << ">];\n";
+				if (f > 0)
+				{
+					script << "\t\tif (i % 3 == 0 && b > " << f % 7 << ") { b = b * 2 - i; }\n"
+						   << "\t\telse if (i > 10) { b += func" << f - 1 << "(i - 1, b - 1); }\n";
+				}
+				script << "\t}\n"
+					   << "\twhile (b > 100) { b = b >> 1; }\n"
+					   << "\tdo { b += llStringLength(s) + llGetListLength(l); } while (b < gCount" << f % 20 << ");\n"
+					   << "\tvector v = <1.0, 2.0, 3.0> * " << f << ".0 + <b, a, 0>;\n"
+					   << "\trotation q = llEuler2Rot(v);\n"
+					   << "\treturn b + (integer)(v.x + q.s) + llList2Integer(l, 0);\n}\n\n";
+			}
+			script << "default\n{\n\tstate_entry()\n\t{\n\t\tinteger n = 0;\n";
+			for (S32 f = 0; f < num_functions; f += 3)
+			{
+				script << "\t\tn += func" << f << "(" << f % 20 << ", n);\n";
+			}
+			script << "\t\tllOwnerSay((string)n);\n\t}\n\n"
+				   << "\ttouch_start(integer total)\n\t{\n\t\tstate other;\n\t}\n}\n\n"
+				   << "state other\n{\n\tstate_entry()\n\t{\n\t\tllOwnerSay(gName0);\n\t\tstate default;\n\t}\n}\n";
+			return script.str();
+		}
+
+		BOOL compile(const std::string& script, BOOL mono, BOOL optimize = TRUE)
+		{
+			llofstream file(mBaseName + ".lsl");
+			file << script;
+			file.close();
+			std::string dst = mBaseName + (mono ? ".cil" : ".lso");
+			return lscript_compile((mBaseName + ".lsl").c_str(), dst.c_str(), (mBaseName + ".out").c_str(),
+								   mono, "ScriptCompileTest", FALSE, optimize);
+		}
+
+		std::string readFile(const std::string& filename)
+		{
+			llifstream file(filename, std::ios::binary);
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			return contents.str();
+		}
+
+		// Runs the LSO from the last compile until the script goes idle and
+		// returns the 32 bit words of its first num_globals globals, which is
+		// where the scripts here keep their results.
+		std::vector<S32> run(S32 num_globals, U32& instructions)
+		{
+			std::vector<U8> bytecode(TOP_OF_MEMORY);
+			LLFILE* fp = LLFile::fopen(mBaseName + ".lso", "rb");
+			ensure("opened bytecode", fp != NULL);
+			size_t bytes = fread(&bytecode[0], 1, bytecode.size(), fp);
+			fclose(fp);
+			ensure_equals("bytecode size", (S32)bytes, TOP_OF_MEMORY);
+
+			LLScriptExecuteLSL2 execute(&bytecode[0], (U32)bytecode.size());
+			const char* error = NULL;
+			U32 events_processed = 0;
+			// the instruction pointer only gets set once state_entry starts
+			S32 quanta = 0;
+			do
+			{
+				LLTimer timer;
+				execute.runQuanta(FALSE, LLUUID::null, &error, 1.f, events_processed, timer);
+			}
+			while (!execute.isFinished() && ++quanta < 100);
+			ensure("finished", execute.isFinished());
+			ensure_equals("faults", execute.getFaults(), 0);
+			instructions = execute.mInstructionCount;
+
+			// each global is an offset to its value, a type byte and a name
+			std::vector<S32> words;
+			S32 offset = get_register(execute.mBuffer, LREG_GVR);
+			for (S32 i = 0; i < num_globals; i++)
+			{
+				S32 value_offset = offset + bytestream2integer(execute.mBuffer, offset) - 4;
+				U8 type = *(execute.mBuffer + offset);
+				S32 num_words = (type == LST_VECTOR) ? 3 : (type == LST_QUATERNION) ? 4 : 1;
+				offset = value_offset;
+				for (S32 j = 0; j < num_words; j++)
+				{
+					words.push_back(bytestream2integer(execute.mBuffer, offset));
+				}
+			}
+			return words;
+		}
+
+		std::string mBaseName;
+	};
+	typedef test_group<scriptcompile_data> scriptcompile_test;
+	typedef scriptcompile_test::object scriptcompile_object;
+	tut::scriptcompile_test scriptcompile_testcase("scriptcompile");
+
+	template<> template<>
+	void scriptcompile_object::test<1>()
+	{
+		// chunks grow in steps but keep every byte in order
+		LLScriptByteCodeChunk chunk(FALSE);
+		for (S32 i = 0; i < 1000; i++)
+		{
+			chunk.addByte((U8)i);
+			chunk.addInteger(i);
+			chunk.addBytes(3);
+		}
+		ensure_equals("size", chunk.mCurrentOffset, 8000);
+		for (S32 i = 0; i < 1000; i++)
+		{
+			ensure_equals("byte", chunk.mCodeChunk[i * 8], (U8)i);
+			S32 offset = i * 8 + 1;
+			ensure_equals("integer", bytestream2integer(chunk.mCodeChunk, offset), i);
+			ensure_equals("padding", chunk.mCodeChunk[i * 8 + 5] | chunk.mCodeChunk[i * 8 + 6] | chunk.mCodeChunk[i * 8 + 7], 0);
+		}
+	}
+
+	template<> template<>
+	void scriptcompile_object::test<2>()
+	{
+		ensure("compiles to LSO", compile(makeScript(6), FALSE));
+		ensure("compiles to Mono", compile(makeScript(6), TRUE));
+		ensure("syntax error", !compile("default { state_entry() { integer i = ; } }", FALSE));
+	}
+
+	template<> template<>
+	void scriptcompile_object::test<3>()
+	{
+		// scripts far bigger than LSO's 16K, which is what Mono scripts look
+		// like, span many code chunk reallocations and parse tree arena blocks
+		// and must come out whole and the same every time
+		const S32 NUM_SCRIPTS = 4;
+		for (S32 i = 0; i < NUM_SCRIPTS; i++)
+		{
+			S32 num_functions = 100 + 40 * i;
+			std::string script = makeScript(num_functions);
+			ensure("compiled", compile(script, TRUE));
+			std::string first = readFile(mBaseName + ".cil");
+			ensure("compiled again", compile(script, TRUE));
+			ensure("same output", first == readFile(mBaseName + ".cil"));
+
+			for (S32 f = 0; f < num_functions; f++)
+			{
+				ensure("has function", first.find(llformat("'gfunc%d'(", f)) != std::string::npos);
+			}
+		}
+	}
+
+	template<> template<>
+	void scriptcompile_object::test<4>()
+	{
+		// optimized bytecode must leave the same results behind, sooner
+		ensure("compiles unoptimized", compile(GOLDEN_SCRIPT, FALSE, FALSE));
+		U32 unoptimized_instructions = 0;
+		std::vector<S32> unoptimized = run(NUM_GOLDEN_GLOBALS, unoptimized_instructions);
+		S32 unoptimized_size = get_register((const U8*)readFile(mBaseName + ".lso").data(), LREG_HR);
+
+		ensure("compiles optimized", compile(GOLDEN_SCRIPT, FALSE, TRUE));
+		U32 optimized_instructions = 0;
+		std::vector<S32> optimized = run(NUM_GOLDEN_GLOBALS, optimized_instructions);
+		S32 optimized_size = get_register((const U8*)readFile(mBaseName + ".lso").data(), LREG_HR);
+
+		ensure("same results", unoptimized == optimized);
+		ensure_equals("arithmetic", optimized[0], -7);
+		ensure_equals("wraparound", optimized[1], 2147483645);
+		ensure_equals("division", optimized[2], -7);
+		ensure_equals("comparisons", optimized[4], 155);
+		ensure_equals("casts", optimized[5], 65);
+		ensure_equals("loops", optimized[6], 3026);
+		ensure_equals("branches", optimized[7], 111);
+		ensure_equals("strings", optimized[8], 7);
+		ensure_equals("compound assignment", optimized[9], 1);
+		ensure("smaller", optimized_size < unoptimized_size);
+		ensure("fewer instructions", optimized_instructions < unoptimized_instructions);
+	}
+
+	template<> template<>
+	void scriptcompile_object::test<5>()
+	{
+		// unused globals and functions go, the rest stay
+		ensure("compiles optimized", compile(GOLDEN_SCRIPT, TRUE, TRUE));
+		std::string optimized = readFile(mBaseName + ".cil");
+		ensure("compiles unoptimized", compile(GOLDEN_SCRIPT, TRUE, FALSE));
+		std::string unoptimized = readFile(mBaseName + ".cil");
+
+		ensure("unused function kept", unoptimized.find("'gunused'(") != std::string::npos);
+		ensure("unused function removed", optimized.find("'gunused'(") == std::string::npos);
+		ensure("unused global removed", optimized.find("'gUnused'") == std::string::npos);
+		ensure("used function kept", optimized.find("'gcount'(") != std::string::npos);
+		ensure("smaller", optimized.size() < unoptimized.size());
+	}
+}
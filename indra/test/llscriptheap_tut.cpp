@@ -0,0 +1,476 @@
+/**
+ * @file llscriptheap_tut.cpp
+ * @date 2010-06
+ * @brief LSL heap allocator test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "lscript_alloc.h"
+#include "lscript_execute.h"
+#include "lscript_rt_interface.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+namespace tut
+{
+	// String concatenation and list appends with no library calls, which
+	// the executor here can't make. Keeps a few strings alive between
+	// iterations so the heap fragments.
+	const S32 NUM_ITERATIONS = 3000;
+	const char* CONCAT_SCRIPT =
+		"string gS;\n"
+		"string gA;\n"
+		"string gB;\n"
+		"list gL;\n"
+		"integer gN;\n"
+		"\n"
+		"default\n"
+		"{\n"
+		"\tstate_entry()\n"
+		"\t{\n"
+		"\t\tinteger i;\n"
+		"\t\tlist keep;\n"
+		"\t\tfor (i = 0; i < 3000; i++)\n"
+		"\t\t{\n"
+		"\t\t\tgS = gS + (string)i;\n"
+		"\t\t\tgA = \"a\" + (string)(i % 7);\n"
+		"\t\t\tgB = gA + gS;\n"
+		"\t\t\tkeep = keep + gA;\n"
+		"\t\t\tif (i % 50 == 0)\n"
+		"\t\t\t{\n"
+		"\t\t\t\tgS = \"\";\n"
+		"\t\t\t\tkeep = [];\n"
+		"\t\t\t}\n"
+		"\t\t\tgL = gL + [i, gA];\n"
+		"\t\t\tgL = [(float)i] + gL;\n"
+		"\t\t\tif (i % 20 == 0)\n"
+		"\t\t\t{\n"
+		"\t\t\t\tgL = [];\n"
+		"\t\t\t}\n"
+		"\t\t}\n"
+		"\t\tgN = i;\n"
+		"\t}\n"
+		"}\n";
+
+	struct scriptheap_data
+	{
+		scriptheap_data()
+		:	mExecute(NULL)
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "scriptheap-test-" << random;
+#else
+			oStr << "/tmp/scriptheap-test-" << random;
+#endif
+			mBaseName = oStr.str();
+		}
+
+		~scriptheap_data()
+		{
+			delete mExecute;
+			LLFile::remove(mBaseName + ".lsl");
+			LLFile::remove(mBaseName + ".out");
+			LLFile::remove(mBaseName + ".lso");
+		}
+
+		// Compiles script and loads it into a fresh executor, without
+		// running it.
+		void load(const std::string& script)
+		{
+			llofstream file(mBaseName + ".lsl");
+			file << script;
+			file.close();
+			ensure("compiled", lscript_compile((mBaseName + ".lsl").c_str(), (mBaseName + ".lso").c_str(),
+											   (mBaseName + ".out").c_str(), FALSE, "ScriptHeapTest", FALSE));
+
+			mBytecode.resize(TOP_OF_MEMORY);
+			LLFILE* fp = LLFile::fopen(mBaseName + ".lso", "rb");
+			ensure("opened bytecode", fp != NULL);
+			fread(&mBytecode[0], 1, mBytecode.size(), fp);
+			fclose(fp);
+
+			delete mExecute;
+			mExecute = new LLScriptExecuteLSL2(&mBytecode[0], (U32)mBytecode.size());
+		}
+
+		void run()
+		{
+			const char* error = NULL;
+			U32 events_processed = 0;
+			// the instruction pointer only gets set once state_entry starts
+			S32 quanta = 0;
+			do
+			{
+				// only the quantum's time slice, nothing here is timed
+				LLTimer timer;
+				mExecute->runQuanta(FALSE, LLUUID::null, &error, 1.f, events_processed, timer);
+			}
+			while (!mExecute->isFinished() && ++quanta < 1000);
+			ensure("finished", mExecute->isFinished());
+			ensure_equals("faults", mExecute->getFaults(), 0);
+		}
+
+		// The first 32 bits of global number index, which for strings and
+		// lists is the heap address.
+		S32 getGlobal(S32 index)
+		{
+			// each global is an offset to its value, a type byte and a name
+			S32 offset = get_register(mExecute->mBuffer, LREG_GVR);
+			for (S32 i = 0; ; i++)
+			{
+				S32 entry_offset = offset;
+				S32 value_offset = entry_offset + bytestream2integer(mExecute->mBuffer, offset);
+				U8 type = *(mExecute->mBuffer + offset);
+				offset = value_offset;
+				if (i == index)
+				{
+					return bytestream2integer(mExecute->mBuffer, offset);
+				}
+				offset += (type == LST_VECTOR) ? 12 : (type == LST_QUATERNION) ? 16 : 4;
+			}
+		}
+
+		std::string getString(S32 address)
+		{
+			LLScriptLibData* data = lsa_get_data(mExecute->mBuffer, address, FALSE);
+			std::string result = (data->mType == LST_STRING && data->mString) ? data->mString : "";
+			delete data;
+			return result;
+		}
+
+		S32 addString(const char* string)
+		{
+			U8* buffer = mExecute->mBuffer;
+			return lsa_heap_add_data(buffer, new LLScriptLibData(string), get_max_heap_size(buffer), TRUE);
+		}
+
+		S32 getRefCount(S32 address)
+		{
+			S32 offset = address + get_register(mExecute->mBuffer, LREG_HR) - 1;
+			LLScriptAllocEntry entry;
+			bytestream2alloc_entry(entry, mExecute->mBuffer, offset);
+			return entry.mReferenceCount;
+		}
+
+		// Random string adds, concatenations and frees on buffer, the same
+		// ones every time for the same seed, until count have been done or
+		// the heap runs into the stack. Returns how many were done.
+		static S32 churn(U8* buffer, S32 count, U32 seed)
+		{
+			std::vector<S32> strings;
+			S32 i = 0;
+			for (; i < count && !get_register(buffer, LREG_FR); i++)
+			{
+				S32 op = nextRand(seed, 10);
+				if (op < 4 || strings.empty())
+				{
+					std::string text(nextRand(seed, 100), 'a' + nextRand(seed, 26));
+					strings.push_back(lsa_heap_add_data(buffer, new LLScriptLibData(text.c_str()), get_max_heap_size(buffer), TRUE));
+				}
+				else if (op < 6)
+				{
+					S32 pick1 = nextRand(seed, (S32)strings.size());
+					S32 pick2 = nextRand(seed, (S32)strings.size());
+					lsa_increase_ref_count(buffer, strings[pick1]);
+					S32 result = lsa_cat_strings(buffer, strings[pick1], strings[pick2], get_max_heap_size(buffer));
+					strings.erase(strings.begin() + pick2);
+					strings.push_back(result);
+				}
+				else
+				{
+					S32 pick = nextRand(seed, (S32)strings.size());
+					lsa_decrease_ref_count(buffer, strings[pick]);
+					strings.erase(strings.begin() + pick);
+				}
+			}
+			return i;
+		}
+
+		static S32 nextRand(U32& seed, S32 range)
+		{
+			seed = seed * 1664525 + 1013904223;
+			return (S32)((seed >> 8) % (U32)range);
+		}
+
+		std::string mBaseName;
+		std::vector<U8> mBytecode;
+		LLScriptExecuteLSL2* mExecute;
+	};
+	typedef test_group<scriptheap_data> scriptheap_test;
+	typedef scriptheap_test::object scriptheap_object;
+	tut::scriptheap_test scriptheap_testcase("scriptheap");
+
+	template<> template<>
+	void scriptheap_object::test<1>()
+	{
+		// freed blocks are reused and merged with their free neighbours
+		load("default { state_entry() { } }");
+		U8* buffer = mExecute->mBuffer;
+		LLScriptHeapFreeList* free_list = LLScriptHeapFreeList::getInstance(buffer);
+		ensure("indexed", free_list != NULL);
+		S32 num_free = free_list->getNumFreeBlocks();
+
+		S32 a = addString("first block");
+		S32 b = addString("second block");
+		S32 c = addString("third block");
+		S32 hp = get_register(buffer, LREG_HP);
+		ensure_equals("read back", getString(b), std::string("second block"));
+
+		lsa_decrease_ref_count(buffer, b);
+		ensure_equals("hole", free_list->getNumFreeBlocks(), num_free + 1);
+		ensure_equals("hole reused", addString("short"), b);
+		ensure_equals("no growth", get_register(buffer, LREG_HP), hp);
+
+		// neighbours stay separate blocks until something needs them together
+		S32 num_runs = free_list->getNumFreeRuns();
+		lsa_decrease_ref_count(buffer, a);
+		lsa_decrease_ref_count(buffer, b);
+		ensure_equals("both free", free_list->getNumFreeBlocks(), num_free + 2);
+		ensure_equals("one run", free_list->getNumFreeRuns(), num_runs + 1);
+		ensure_equals("merged block reused", addString("longer than first block"), a);
+		ensure_equals("merged", free_list->getNumFreeBlocks(), num_free);
+		ensure_equals("no more growth", get_register(buffer, LREG_HP), hp);
+		ensure_equals("untouched", getString(c), std::string("third block"));
+	}
+
+	template<> template<>
+	void scriptheap_object::test<2>()
+	{
+		// concatenation releases its operands before it allocates, so the
+		// result can take their place
+		load("default { state_entry() { } }");
+		U8* buffer = mExecute->mBuffer;
+		S32 heapsize = get_max_heap_size(buffer);
+
+		S32 a = addString("abc");
+		S32 b = addString("defg");
+		S32 hp = get_register(buffer, LREG_HP);
+		S32 ab = lsa_cat_strings(buffer, a, b, heapsize);
+		ensure_equals("cat", getString(ab), std::string("abcdefg"));
+		ensure_equals("in place", ab, a);
+		ensure_equals("no growth", get_register(buffer, LREG_HP), hp);
+
+		// a string added to itself
+		lsa_increase_ref_count(buffer, ab);
+		S32 twice = lsa_cat_strings(buffer, ab, ab, heapsize);
+		ensure_equals("twice", getString(twice), std::string("abcdefgabcdefg"));
+
+		LLScriptLibData* list = new LLScriptLibData;
+		list->mType = LST_LIST;
+		list->mListp = new LLScriptLibData("x");
+		list->mListp->mListp = new LLScriptLibData(7);
+		S32 list1 = lsa_heap_add_data(buffer, list, heapsize, TRUE);
+		S32 offset = list1 + get_register(buffer, LREG_HR) - 1 + SIZEOF_SCRIPT_ALLOC_ENTRY + 4;
+		S32 element = bytestream2integer(buffer, offset);
+
+		// adding a list to itself takes both references, keep one more
+		lsa_increase_ref_count(buffer, list1);
+		lsa_increase_ref_count(buffer, list1);
+		S32 list2 = lsa_cat_lists(buffer, list1, list1, heapsize);
+		LLScriptLibData* result = lsa_get_data(buffer, list2, FALSE);
+		ensure_equals("length", result->getListLength(), 4);
+		ensure_equals("last", result->mListp->mListp->mListp->mListp->mInteger, 7);
+		delete result;
+		ensure_equals("copied", getRefCount(element), 1);
+		ensure_equals("no faults", get_register(buffer, LREG_FR), 0);
+	}
+
+	template<> template<>
+	void scriptheap_object::test<3>()
+	{
+		// the saved heap loads back into an executor that keeps allocating
+		// from it
+		load(CONCAT_SCRIPT);
+		run();
+		U8* state = NULL;
+		S32 size = mExecute->writeState(&state, 0, 0);
+		ensure("wrote state", size > 0);
+		S32 gs = getGlobal(0);
+		std::string expected = getString(gs);
+
+		load(CONCAT_SCRIPT);
+		ensure_equals("read state", mExecute->readState(state), size);
+		delete[] state;
+		ensure_equals("same string", getString(gs), expected);
+
+		S32 address = addString("some temporary string");
+		lsa_decrease_ref_count(mExecute->mBuffer, address);
+		S32 hp = get_register(mExecute->mBuffer, LREG_HP);
+		for (S32 i = 0; i < 100; i++)
+		{
+			ensure_equals("same block", addString("some temporary string"), address);
+			lsa_decrease_ref_count(mExecute->mBuffer, address);
+		}
+		ensure_equals("reused", get_register(mExecute->mBuffer, LREG_HP), hp);
+		ensure_equals("still there", getString(gs), expected);
+	}
+
+	template<> template<>
+	void scriptheap_object::test<4>()
+	{
+		load(CONCAT_SCRIPT);
+		run();
+
+		std::ostringstream tail;
+		for (S32 i = (NUM_ITERATIONS - 1) / 50 * 50 + 1; i < NUM_ITERATIONS; i++)
+		{
+			tail << i;
+		}
+		std::string last = "a" + llformat("%d", (NUM_ITERATIONS - 1) % 7);
+		ensure_equals("concatenated", getString(getGlobal(0)), tail.str());
+		ensure_equals("short string", getString(getGlobal(1)), last);
+		ensure_equals("both", getString(getGlobal(2)), last + tail.str());
+		ensure_equals("iterations", getGlobal(4), NUM_ITERATIONS);
+
+		S32 address = getGlobal(3);
+		LLScriptLibData* list = lsa_get_data(mExecute->mBuffer, address, FALSE);
+		ensure_equals("list length", list->getListLength(), 3 * ((NUM_ITERATIONS - 1) % 20));
+		delete list;
+	}
+
+	template<> template<>
+	void scriptheap_object::test<5>()
+	{
+		// the index leaves the heap exactly as the walk from HR does
+		load("default { state_entry() { } }");
+		std::vector<U8> walked(mExecute->mBuffer, mExecute->mBuffer + TOP_OF_MEMORY);
+		std::vector<U8> indexed(walked);
+		LLScriptHeapFreeList free_list;
+		free_list.attach(&indexed[0]);
+		U8* buffers[2] = { &walked[0], &indexed[0] };
+
+		std::vector<S32> strings;
+		for (S32 i = 0; i < 5000 && !get_register(&walked[0], LREG_FR); i++)
+		{
+			S32 op = ll_rand(10);
+			BOOL add = op < 4 || strings.empty();
+			std::string text(ll_rand(100), 'a' + ll_rand(26));
+			S32 pick1 = strings.empty() ? 0 : ll_rand((S32)strings.size());
+			S32 pick2 = strings.empty() ? 0 : ll_rand((S32)strings.size());
+			S32 results[2];
+			for (S32 j = 0; j < 2; j++)
+			{
+				U8* buffer = buffers[j];
+				if (add)
+				{
+					results[j] = lsa_heap_add_data(buffer, new LLScriptLibData(text.c_str()), get_max_heap_size(buffer), TRUE);
+				}
+				else if (op < 6)
+				{
+					lsa_increase_ref_count(buffer, strings[pick1]);
+					results[j] = lsa_cat_strings(buffer, strings[pick1], strings[pick2], get_max_heap_size(buffer));
+				}
+				else
+				{
+					lsa_decrease_ref_count(buffer, strings[pick1]);
+					results[j] = 0;
+				}
+			}
+			ensure_equals("same block", results[1], results[0]);
+			ensure_equals("same faults", get_register(&indexed[0], LREG_FR), get_register(&walked[0], LREG_FR));
+			if (get_register(&walked[0], LREG_FR))
+			{
+				// a collision leaves the heap in no fit state to compare
+				break;
+			}
+			ensure("same heap", walked == indexed);
+
+			if (add)
+			{
+				strings.push_back(results[0]);
+			}
+			else if (op < 6)
+			{
+				// the cat used up the reference to pick2
+				strings.erase(strings.begin() + pick2);
+				strings.push_back(results[0]);
+			}
+			else
+			{
+				strings.erase(strings.begin() + pick1);
+			}
+			if (!ll_rand(50))
+			{
+				free_list.invalidate();
+			}
+		}
+	}
+
+	template<> template<>
+	void scriptheap_object::test<6>()
+	{
+		// Benchmark, run only when LL_RUN_BENCHMARKS is set: times the same
+		// string churn on a heap that is walked from HR and on one with the
+		// index.
+		if (!getenv("LL_RUN_BENCHMARKS"))
+		{
+			skip("benchmark; set LL_RUN_BENCHMARKS to run it");
+		}
+
+		const S32 PASSES = 50;
+		const S32 NUM_OPS = 5000;
+		load("default { state_entry() { } }");
+		const std::vector<U8> image(mExecute->mBuffer, mExecute->mBuffer + TOP_OF_MEMORY);
+		LLScriptHeapFreeList free_list;
+		F32 walked_time = 0.f;
+		F32 indexed_time = 0.f;
+		S32 num_ops = 0;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			std::vector<U8> walked(image);
+			std::vector<U8> indexed(image);
+			free_list.attach(&indexed[0]);
+
+			LLTimer timer;
+			S32 walked_ops = churn(&walked[0], NUM_OPS, pass + 1);
+			walked_time += timer.getElapsedTimeF32();
+			timer.reset();
+			S32 indexed_ops = churn(&indexed[0], NUM_OPS, pass + 1);
+			indexed_time += timer.getElapsedTimeF32();
+			free_list.detach();
+
+			ensure_equals("same ops", indexed_ops, walked_ops);
+			num_ops += walked_ops;
+		}
+
+		llinfos << num_ops << " heap ops: walk " << walked_time << "s, index "
+				<< indexed_time << "s" << llendl;
+	}
+}
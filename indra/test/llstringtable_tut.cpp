@@ -0,0 +1,200 @@
+/**
+ * @file llstringtable_tut.cpp
+ * @date 2010-07
+ * @brief LLStringTable test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llstringtable.h"
+#include "llstl.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace tut
+{
+	const S32 NUM_WORDS = 5000;
+	const S32 NUM_THREADS = 4;
+
+	// Interns every word in turn, starting at a different place from the
+	// other threads so they race to add the same strings.
+	class StringTableTestThread : public LLThread
+	{
+	public:
+		StringTableTestThread(LLStringTable& table, const std::vector<std::string>& words, S32 start, S32 passes)
+		:	LLThread("String Table Test"),
+			mTable(table),
+			mWords(words),
+			mStart(start),
+			mPasses(passes),
+			mEntries(words.size(), (LLStringTableEntry*)NULL),
+			mMismatches(0),
+			mDone(FALSE)
+		{
+		}
+
+		virtual void run()
+		{
+			S32 count = (S32)mWords.size();
+			for (S32 pass = 0; pass < mPasses; pass++)
+			{
+				for (S32 i = 0; i < count; i++)
+				{
+					S32 word = (mStart + i) % count;
+					LLStringTableEntry* entry = mTable.addStringEntry(mWords[word]);
+					if (!mEntries[word])
+					{
+						mEntries[word] = entry;
+					}
+					else if (mEntries[word] != entry)
+					{
+						mMismatches++;
+					}
+					if (mTable.checkStringEntry(mWords[word]) != entry)
+					{
+						mMismatches++;
+					}
+				}
+			}
+			mDone = TRUE;
+		}
+
+		LLStringTable& mTable;
+		const std::vector<std::string>& mWords;
+		S32 mStart;
+		S32 mPasses;
+		std::vector<LLStringTableEntry*> mEntries;
+		S32 mMismatches;
+		// isStopped() is also true before the thread gets going
+		LLAtomic32<BOOL> mDone;
+	};
+
+	struct stringtable_data
+	{
+		stringtable_data()
+		{
+			for (S32 i = 0; i < NUM_WORDS; i++)
+			{
+				mWords.push_back(llformat("word%d", i));
+			}
+		}
+
+		// Runs threads against a fresh table.
+		void runThreads(S32 num_threads, S32 passes)
+		{
+			LLStringTable table(16);
+			std::vector<StringTableTestThread*> threads;
+			for (S32 i = 0; i < num_threads; i++)
+			{
+				threads.push_back(new StringTableTestThread(table, mWords, i * NUM_WORDS / num_threads, passes));
+				threads.back()->start();
+			}
+			for (S32 i = 0; i < num_threads; i++)
+			{
+				while (!threads[i]->mDone || !threads[i]->isStopped())
+				{
+					ms_sleep(1);
+				}
+			}
+
+			ensure_equals("unique entries", (S32)table.mUniqueEntries, NUM_WORDS);
+			for (S32 i = 0; i < num_threads; i++)
+			{
+				ensure_equals("stable", threads[i]->mMismatches, 0);
+				for (S32 word = 0; word < NUM_WORDS; word++)
+				{
+					ensure("same entry", threads[i]->mEntries[word] == threads[0]->mEntries[word]);
+				}
+			}
+			std::for_each(threads.begin(), threads.end(), DeletePointer());
+		}
+
+		std::vector<std::string> mWords;
+	};
+	typedef test_group<stringtable_data> stringtable_test;
+	typedef stringtable_test::object stringtable_object;
+	tut::stringtable_test stringtable_testcase("stringtable");
+
+	template<> template<>
+	void stringtable_object::test<1>()
+	{
+		LLStringTable table(16);
+		ensure("missing", table.checkString("foo") == NULL);
+
+		char* foo = table.addString("foo");
+		ensure_equals("added", std::string(foo), std::string("foo"));
+		ensure("same pointer", table.addString(std::string("foo")) == foo);
+		ensure("found", table.checkString("foo") == foo);
+		ensure_equals("one string", (S32)table.mUniqueEntries, 1);
+
+		table.removeString("foo");
+		ensure("still referenced", table.checkString("foo") == foo);
+		table.removeString("foo");
+		ensure("removed", table.checkString("foo") == NULL);
+		ensure_equals("no strings", (S32)table.mUniqueEntries, 0);
+
+		// a removed string comes back as the same entry
+		ensure("revived", table.addString("foo") == foo);
+		ensure_equals("one string again", (S32)table.mUniqueEntries, 1);
+		ensure("found again", table.checkString("foo") == foo);
+	}
+
+	template<> template<>
+	void stringtable_object::test<2>()
+	{
+		// pointers stay put as the table grows from 16 buckets
+		LLStringTable table(16);
+		std::vector<char*> strings;
+		for (S32 i = 0; i < NUM_WORDS; i++)
+		{
+			strings.push_back(table.addString(mWords[i]));
+		}
+		ensure("grown", table.mMaxEntries > 16);
+		ensure_equals("unique entries", (S32)table.mUniqueEntries, NUM_WORDS);
+		for (S32 i = 0; i < NUM_WORDS; i++)
+		{
+			ensure("stable", table.checkString(mWords[i]) == strings[i]);
+			ensure("same entry", table.addString(mWords[i]) == strings[i]);
+		}
+	}
+
+	template<> template<>
+	void stringtable_object::test<3>()
+	{
+		// threads adding the same strings all get the same entries
+		const S32 PASSES = 20;
+		runThreads(1, PASSES);
+		runThreads(NUM_THREADS, PASSES);
+	}
+}
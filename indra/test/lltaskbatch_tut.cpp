@@ -0,0 +1,109 @@
+/**
+ * @file lltaskbatch_tut.cpp
+ * @date 2010-06
+ * @brief LLTaskBatch test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "lltaskbatch.h"
+
+namespace tut
+{
+	// counts how many times each task ran
+	class LLTestTaskBatch : public LLTaskBatch
+	{
+	public:
+		LLTestTaskBatch(S32 count) : mRuns(count, 0) {}
+
+		std::vector<S32> mRuns;		// each index is only touched by the task that claimed it
+
+	protected:
+		/*virtual*/ void runTask(S32 index)
+		{
+			mRuns[index]++;
+		}
+	};
+
+	struct taskbatch_data
+	{
+		~taskbatch_data()
+		{
+			LLTaskBatchThread::cleanupClass();
+		}
+
+		void runBatch(S32 count, S32 max_helpers)
+		{
+			LLPointer<LLTestTaskBatch> batch = new LLTestTaskBatch(count);
+			batch->run(count, max_helpers);
+			for (S32 i = 0; i < count; i++)
+			{
+				ensure_equals("task ran once", batch->mRuns[i], 1);
+			}
+		}
+	};
+	typedef test_group<taskbatch_data> taskbatch_test;
+	typedef taskbatch_test::object taskbatch_object;
+	tut::taskbatch_test taskbatch_testcase("taskbatch");
+
+	template<> template<>
+	void taskbatch_object::test<1>()
+	{
+		// no pool, everything runs on this thread
+		ensure("no pool", !LLTaskBatchThread::isInitialized());
+		runBatch(0, 4);
+		runBatch(1, 4);
+		runBatch(100, 4);
+	}
+
+	template<> template<>
+	void taskbatch_object::test<2>()
+	{
+		// unthreaded helpers would only run when polled, so there are none
+		LLTaskBatchThread::initClass(4, false);
+		ensure("no pool", !LLTaskBatchThread::isInitialized());
+	}
+
+	template<> template<>
+	void taskbatch_object::test<3>()
+	{
+		// batches of all sizes share the same helpers, some of which wake up
+		// after the batch they were given is already done
+		LLTaskBatchThread::initClass(3, true);
+		ensure("pool", LLTaskBatchThread::isInitialized());
+		for (S32 i = 0; i < 50; i++)
+		{
+			runBatch(i, 3);
+			runBatch(i, 0);
+		}
+		runBatch(10000, 3);
+	}
+}
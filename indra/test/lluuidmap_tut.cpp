@@ -0,0 +1,215 @@
+/**
+ * @file lluuidmap_tut.cpp
+ * @date 2010-07
+ * @brief LLUUIDMap and LLUUIDSet test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "lluuidmap.h"
+
+#include <map>
+#include <vector>
+
+namespace tut
+{
+	struct uuidmap_data
+	{
+		enum { NUM_IDS = 20000 };
+
+		uuidmap_data()
+		:	mIDs(NUM_IDS)
+		{
+			for (S32 i = 0; i < NUM_IDS; i++)
+			{
+				mIDs[i].generate();
+			}
+		}
+
+		std::vector<LLUUID> mIDs;
+	};
+	typedef test_group<uuidmap_data> uuidmap_test;
+	typedef uuidmap_test::object uuidmap_object;
+	tut::uuidmap_test uuidmap_testcase("uuidmap");
+
+	template<> template<>
+	void uuidmap_object::test<1>()
+	{
+		LLUUIDMap<std::string> map;
+		ensure("empty", map.empty());
+		ensure("not found", map.find(mIDs[0]) == map.end());
+
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			map[mIDs[i]] = llformat("%d", i);
+		}
+		ensure_equals("size", map.size(), (size_t)NUM_IDS);
+		ensure("inserted twice", !map.insert(std::make_pair(mIDs[0], std::string("again"))).second);
+
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			LLUUIDMap<std::string>::const_iterator iter = map.find(mIDs[i]);
+			ensure("found", iter != map.end());
+			ensure_equals("key", iter->first, mIDs[i]);
+			ensure_equals("value", iter->second, llformat("%d", i));
+		}
+
+		// every id once, in some order
+		std::map<LLUUID, S32> seen;
+		for (LLUUIDMap<std::string>::iterator iter = map.begin(); iter != map.end(); ++iter)
+		{
+			seen[iter->first]++;
+		}
+		ensure_equals("iterated", seen.size(), (size_t)NUM_IDS);
+
+		ensure_equals("erased", map.erase(mIDs[0]), (size_t)1);
+		ensure_equals("erased twice", map.erase(mIDs[0]), (size_t)0);
+		ensure("gone", map.count(mIDs[0]) == 0);
+		ensure_equals("size after erase", map.size(), (size_t)(NUM_IDS - 1));
+
+		map.clear();
+		ensure("cleared", map.empty() && map.begin() == map.end());
+	}
+
+	template<> template<>
+	void uuidmap_object::test<2>()
+	{
+		// erasing while iterating, the std::map way
+		LLUUIDMap<S32> map;
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			map[mIDs[i]] = i;
+		}
+		S32 visited = 0;
+		for (LLUUIDMap<S32>::iterator iter = map.begin(); iter != map.end(); )
+		{
+			visited++;
+			if (iter->second % 2)
+			{
+				map.erase(iter++);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+		ensure_equals("visited", visited, (S32)NUM_IDS);
+		ensure_equals("size", map.size(), (size_t)(NUM_IDS / 2));
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			ensure_equals("kept evens", map.count(mIDs[i]), (size_t)(i % 2 ? 0 : 1));
+		}
+
+		// churn doesn't leave the table full of erased slots
+		size_t capacity = map.capacity();
+		for (S32 pass = 0; pass < 10; pass++)
+		{
+			for (S32 i = 1; i < NUM_IDS; i += 2)
+			{
+				map[mIDs[i]] = i;
+			}
+			for (S32 i = 1; i < NUM_IDS; i += 2)
+			{
+				map.erase(mIDs[i]);
+			}
+		}
+		ensure_equals("capacity", map.capacity(), capacity);
+		ensure_equals("size after churn", map.size(), (size_t)(NUM_IDS / 2));
+	}
+
+	template<> template<>
+	void uuidmap_object::test<3>()
+	{
+		// made up ids that only differ in their last bytes
+		LLUUIDSet set;
+		std::vector<LLUUID> ids(NUM_IDS);
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			ids[i].mData[14] = (U8)(i >> 8);
+			ids[i].mData[15] = (U8)i;
+			ensure("inserted", set.insert(ids[i]).second);
+		}
+		ensure_equals("size", set.size(), (size_t)NUM_IDS);
+		ensure("null id", set.count(LLUUID::null) == 1);
+
+		LLUUIDSet copy(set);
+		set.clear();
+		ensure_equals("copied", copy.size(), (size_t)NUM_IDS);
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			ensure("found", copy.find(ids[i]) != copy.end());
+		}
+
+		set.swap(copy);
+		ensure("swapped", copy.empty() && set.size() == NUM_IDS);
+		copy = set;
+		ensure("assigned", copy.count(ids[NUM_IDS - 1]) == 1);
+	}
+
+	template<> template<>
+	void uuidmap_object::test<4>()
+	{
+		// inserts, finds and erases mixed together, so that erased slots are
+		// reused and the table grows part way through, agree with std::map
+		std::map<LLUUID, S32> reference;
+		LLUUIDMap<S32> map;
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			reference[mIDs[i]] = i;
+			map[mIDs[i]] = i;
+			if (i % 3 == 2)
+			{
+				ensure_equals("erased", map.erase(mIDs[i - 1]), reference.erase(mIDs[i - 1]));
+			}
+			if (i % 5 == 4)
+			{
+				reference[mIDs[i - 4]] += 10;
+				map[mIDs[i - 4]] += 10;
+			}
+		}
+
+		ensure_equals("size", map.size(), reference.size());
+		for (S32 i = 0; i < NUM_IDS; i++)
+		{
+			std::map<LLUUID, S32>::iterator expected = reference.find(mIDs[i]);
+			LLUUIDMap<S32>::iterator iter = map.find(mIDs[i]);
+			ensure_equals("found", iter != map.end(), expected != reference.end());
+			if (iter != map.end())
+			{
+				ensure_equals("value", iter->second, expected->second);
+			}
+		}
+		for (LLUUIDMap<S32>::iterator iter = map.begin(); iter != map.end(); ++iter)
+		{
+			ensure_equals("iterated", reference[iter->first], iter->second);
+		}
+	}
+}
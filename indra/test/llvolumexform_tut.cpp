@@ -0,0 +1,247 @@
+/**
+ * @file llvolumexform_tut.cpp
+ * @date 2010-06
+ * @brief LLVolumeXform vertex transform test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llvolumexform.h"
+#include "llquaternion.h"
+#include "lltimer.h"
+
+#include <cstdlib>
+#include <vector>
+
+namespace tut
+{
+	struct volumexform_data
+	{
+		// A vertex laid out the way LLVertexBuffer interleaves them, with
+		// something after each vector the kernels mustn't write over.
+		struct Vertex
+		{
+			LLVector3 mPosition;	F32 mPad0;
+			LLVector3 mNormal;		F32 mPad1;
+			LLVector3 mBinormal;	F32 mPad2;
+		};
+
+		volumexform_data()
+		{
+			LLVolumeParams cube;
+			cube.setCube();
+			mCube = new LLVolume(cube, 4.f);
+
+			LLVolumeParams sphere;
+			sphere.setType(LL_PCODE_PROFILE_CIRCLE_HALF, LL_PCODE_PATH_CIRCLE);
+			mSphere = new LLVolume(sphere, 4.f);
+
+			LLVector3 scale(0.5f, 2.f, 3.f);
+			LLQuaternion rot(0.7f, LLVector3(1.f, 2.f, 3.f));
+			mMat.initAll(scale, rot, LLVector3(128.f, 64.f, 22.f));
+
+			// inverse transpose of the scale and rotation, as LLVOVolume
+			// sets up its normal matrix
+			mNormMat = LLMatrix3(rot);
+			for (U32 i = 0; i < 3; i++)
+			{
+				for (U32 j = 0; j < 3; j++)
+				{
+					mNormMat.mMatrix[i][j] /= scale.mV[i];
+				}
+			}
+		}
+
+		~volumexform_data()
+		{
+			LLVolumeXform::setUseSSE(false);
+		}
+
+		void run(const LLVolumeFace& face, S32 count, std::vector<Vertex>& out)
+		{
+			const F32 UNTOUCHED = -1234.f;
+			out.resize(count + 1);
+			for (S32 i = 0; i < count + 1; i++)
+			{
+				out[i].mPosition.setVec(UNTOUCHED, UNTOUCHED, UNTOUCHED);
+				out[i].mNormal = out[i].mBinormal = out[i].mPosition;
+				out[i].mPad0 = out[i].mPad1 = out[i].mPad2 = UNTOUCHED;
+			}
+
+			LLStrider<LLVector3> positions, normals, binormals;
+			positions = &out[0].mPosition;
+			normals = &out[0].mNormal;
+			binormals = &out[0].mBinormal;
+			positions.setStride(sizeof(Vertex));
+			normals.setStride(sizeof(Vertex));
+			binormals.setStride(sizeof(Vertex));
+
+			LLVolumeXform::transform(&face.mVertices[0], count, mMat, mNormMat, positions, normals, binormals);
+
+			for (S32 i = 0; i < count + 1; i++)
+			{
+				ensure_equals("padding", out[i].mPad0 + out[i].mPad1 + out[i].mPad2, 3.f * UNTOUCHED);
+			}
+			ensure_equals("past the end", out[count].mPosition.mV[VX], UNTOUCHED);
+		}
+
+		void ensureMatchesScalar(const LLVolume* volume, S32 max_count)
+		{
+			for (S32 f = 0; f < volume->getNumVolumeFaces(); f++)
+			{
+				const LLVolumeFace& face = volume->getVolumeFace(f);
+				S32 count = llmin((S32) face.mVertices.size(), max_count);
+				if (!count)
+				{
+					continue;
+				}
+
+				std::vector<Vertex> scalar, sse;
+				LLVolumeXform::setUseSSE(false);
+				run(face, count, scalar);
+
+				for (S32 i = 0; i < count; i++)
+				{
+					LLVector3 normal = face.mVertices[i].mNormal * mNormMat;
+					normal.normVec();
+					ensure_equals("scalar position", scalar[i].mPosition, face.mVertices[i].mPosition * mMat);
+					ensure_equals("scalar normal", scalar[i].mNormal, normal);
+				}
+
+				if (!LLVolumeXform::supportsSSE())
+				{
+					continue;
+				}
+				LLVolumeXform::setUseSSE(true);
+				ensure("SSE enabled", LLVolumeXform::getUseSSE());
+				run(face, count, sse);
+
+				// the same within rounding, the SSE kernel sums in a
+				// different order
+				for (S32 i = 0; i < count; i++)
+				{
+					ensure_approximately_equals("SSE position", dist_vec(sse[i].mPosition, scalar[i].mPosition), 0.f, 12);
+					ensure_approximately_equals("SSE normal", dist_vec(sse[i].mNormal, scalar[i].mNormal), 0.f, 16);
+					ensure_approximately_equals("SSE binormal", dist_vec(sse[i].mBinormal, scalar[i].mBinormal), 0.f, 16);
+				}
+			}
+		}
+
+		LLPointer<LLVolume> mCube;
+		LLPointer<LLVolume> mSphere;
+		LLMatrix4 mMat;
+		LLMatrix3 mNormMat;
+	};
+	typedef test_group<volumexform_data> volumexform_test;
+	typedef volumexform_test::object volumexform_object;
+	tut::volumexform_test volumexform_testcase("volumexform");
+
+	template<> template<>
+	void volumexform_object::test<1>()
+	{
+		ensureMatchesScalar(mCube, S32_MAX);
+		ensureMatchesScalar(mSphere, S32_MAX);
+	}
+
+	template<> template<>
+	void volumexform_object::test<2>()
+	{
+		// counts that leave a tail the vector loop doesn't cover
+		for (S32 count = 1; count < 8; count++)
+		{
+			ensureMatchesScalar(mSphere, count);
+		}
+	}
+
+	template<> template<>
+	void volumexform_object::test<3>()
+	{
+		// a degenerate normal comes out as zero, like LLVector3::normVec()
+		LLVolumeFace face = mCube->getVolumeFace(0);
+		for (S32 i = 0; i < 5 && i < (S32) face.mVertices.size(); i++)
+		{
+			face.mVertices[i].mNormal.clearVec();
+		}
+		std::vector<Vertex> out;
+		LLVolumeXform::setUseSSE(LLVolumeXform::supportsSSE());
+		run(face, llmin((S32) face.mVertices.size(), 5), out);
+		for (U32 i = 0; i + 1 < out.size(); i++)
+		{
+			ensure_equals("zero normal", out[i].mNormal, LLVector3::zero);
+		}
+	}
+
+	template<> template<>
+	void volumexform_object::test<4>()
+	{
+		// Benchmark, run only when LL_RUN_BENCHMARKS is set: times the
+		// scalar and SSE paths over the same sphere.
+		if (!getenv("LL_RUN_BENCHMARKS"))
+		{
+			skip("benchmark; set LL_RUN_BENCHMARKS to run it");
+		}
+
+		const S32 PASSES = 200;
+		const LLVolumeFace& face = mSphere->getVolumeFace(0);
+		S32 count = face.mVertices.size();
+		std::vector<Vertex> out(count);
+		LLStrider<LLVector3> positions, normals, binormals;
+		positions = &out[0].mPosition;
+		normals = &out[0].mNormal;
+		binormals = &out[0].mBinormal;
+		positions.setStride(sizeof(Vertex));
+		normals.setStride(sizeof(Vertex));
+		binormals.setStride(sizeof(Vertex));
+
+		LLVolumeXform::setUseSSE(false);
+		LLTimer timer;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			LLVolumeXform::transform(&face.mVertices[0], count, mMat, mNormMat, positions, normals, binormals);
+		}
+		F32 scalar_time = timer.getElapsedTimeF32();
+
+		F32 sse_time = 0.f;
+		if (LLVolumeXform::supportsSSE())
+		{
+			LLVolumeXform::setUseSSE(true);
+			timer.reset();
+			for (S32 pass = 0; pass < PASSES; pass++)
+			{
+				LLVolumeXform::transform(&face.mVertices[0], count, mMat, mNormMat, positions, normals, binormals);
+			}
+			sse_time = timer.getElapsedTimeF32();
+		}
+
+		llinfos << "LLVolumeXform::transform x" << PASSES * count << ": scalar "
+				<< scalar_time << "s, SSE " << sse_time << "s" << llendl;
+	}
+}
@@ -35,11 +35,158 @@
 #include "lltut.h"
 
 #include "llxfer_file.h"
+#include "llxfermanager.h"
+#include "llxferwindow.h"
+
+#include <queue>
 
 namespace tut
 {
 	struct llxfer_data
 	{
+		// A packet or an ack on its way across the simulated link.
+		struct SimPacket
+		{
+			F64 mArrival;
+			U32 mSequence;
+			BOOL mIsAck;
+			S32 mPacketNum;
+
+			bool operator<(const SimPacket& other) const
+			{
+				// earliest first, in the order they were sent
+				if (mArrival != other.mArrival)
+				{
+					return mArrival > other.mArrival;
+				}
+				return mSequence > other.mSequence;
+			}
+		};
+
+		llxfer_data() : mSeed(12345), mSequence(0) {}
+
+		F32 random()
+		{
+			// repeatable from run to run
+			mSeed = mSeed * 1103515245 + 12345;
+			return (F32)((mSeed >> 8) & 0xffff) / 65536.f;
+		}
+
+		void transmit(F64 now, BOOL is_ack, S32 packet_num)
+		{
+			if (random() < mLoss)
+			{
+				return;
+			}
+			// jittery, but like most real links it doesn't reorder
+			F64& last_arrival = is_ack ? mLastAckArrival : mLastPacketArrival;
+			SimPacket packet;
+			packet.mArrival = llmax(now + mLatency * (1.f + 0.2f * random()), last_arrival);
+			packet.mSequence = mSequence++;
+			packet.mIsAck = is_ack;
+			packet.mPacketNum = packet_num;
+			mLink.push(packet);
+			last_arrival = packet.mArrival;
+		}
+
+		// Runs one xfer of num_packets across a link with the given one way
+		// latency and loss in each direction, driving the window classes
+		// the way LLXferManager does, with the sender limited to max_window
+		// packets in flight. Returns the simulated seconds it took, or a
+		// negative number if the xfer was dropped.
+		F64 runXfer(S32 num_packets, F32 latency, F32 loss, S32 max_window)
+		{
+			mLatency = latency;
+			mLoss = loss;
+			mLink = std::priority_queue<SimPacket>();
+			mLastPacketArrival = 0.0;
+			mLastAckArrival = 0.0;
+
+			LLXferWindow window;
+			LLXferSendWindow sender;
+			LLXferReceiveWindow receiver;
+			LLXferSendWindow::packet_list_t resend;
+			S32 next_to_send = 0;
+			S32 next_expected = 0;
+
+			const F64 FRAME_TIME = 0.01;
+			F64 now = 0.0;
+			while (next_expected < num_packets)
+			{
+				ensure("xfer finishes", now < 1000.0);
+
+				S32 limit = llmin(window.getSize(), max_window);
+				while (next_to_send < num_packets && sender.canSend(next_to_send, limit))
+				{
+					transmit(now, FALSE, next_to_send);
+					sender.packetSent(next_to_send, now);
+					next_to_send++;
+				}
+
+				while (!mLink.empty() && mLink.top().mArrival <= now)
+				{
+					SimPacket packet = mLink.top();
+					mLink.pop();
+					if (packet.mIsAck)
+					{
+						resend.clear();
+						sender.packetAcked(packet.mPacketNum, now, window, resend);
+						for (size_t i = 0; i < resend.size(); i++)
+						{
+							transmit(now, FALSE, resend[i]);
+							sender.packetSent(resend[i], now);
+						}
+					}
+					else if (packet.mPacketNum == next_expected)
+					{
+						transmit(now, TRUE, packet.mPacketNum);
+						next_expected++;
+						std::vector<char> data;
+						BOOL is_last = FALSE;
+						while (receiver.takeNext(next_expected, data, is_last))
+						{
+							ensure_equals("early packet data", (S32)data[0], next_expected % 128);
+							next_expected++;
+						}
+					}
+					else if (packet.mPacketNum < next_expected)
+					{
+						transmit(now, TRUE, packet.mPacketNum);
+					}
+					else
+					{
+						char data = (char)(packet.mPacketNum % 128);
+						if (receiver.add(next_expected, packet.mPacketNum, FALSE, &data, 1))
+						{
+							transmit(now, TRUE, packet.mPacketNum);
+						}
+					}
+				}
+
+				resend.clear();
+				if (!sender.checkTimeouts(now, window, 10, resend))
+				{
+					return -1.0;
+				}
+				for (size_t i = 0; i < resend.size(); i++)
+				{
+					transmit(now, FALSE, resend[i]);
+					sender.packetSent(resend[i], now);
+				}
+
+				now += FRAME_TIME;
+			}
+			ensure_equals("nothing left buffered", receiver.getNumBuffered(), 0);
+			return now;
+		}
+
+		U32 mSeed;
+		U32 mSequence;
+		F32 mLatency;
+		F32 mLoss;
+		std::priority_queue<SimPacket> mLink;
+		F64 mLastPacketArrival;
+		F64 mLastAckArrival;
 	};
 	typedef test_group<llxfer_data> llxfer_test;
 	typedef llxfer_test::object llxfer_object;
@@ -60,4 +207,113 @@ namespace tut
 		ensure("oversized local_filename nul-terminated",
 		       xff.getFileName().length() < LL_MAX_PATH);
 	}
+
+	template<> template<>
+	void llxfer_object::test<2>()
+	{
+		// the window flag has to survive the trip through old peers' decoding
+		LLXferManager manager(NULL);
+		LLXfer_File xff("windowed", FALSE, 1);
+
+		S32 encoded = xff.encodePacketNum(7, TRUE);
+		ensure("no flag before the window opens", !(encoded & LL_XFER_WINDOW_FLAG));
+		xff.mWindowed = TRUE;
+		encoded = xff.encodePacketNum(7, TRUE);
+		ensure("flagged once it has", encoded & LL_XFER_WINDOW_FLAG);
+		ensure_equals("flag masked off", manager.decodePacketNum(encoded), 7);
+		ensure("still the last packet", manager.isLastPacket(encoded));
+		ensure("not the last packet", !manager.isLastPacket(xff.encodePacketNum(8, FALSE)));
+
+		// an offer only goes out on the first packet
+		LLXfer_File offer("offered", FALSE, 1);
+		offer.mOfferWindow = TRUE;
+		encoded = offer.encodePacketNum(0, FALSE);
+		ensure("first packet offers", encoded & LL_XFER_WINDOW_FLAG);
+		ensure_equals("offer masked off", manager.decodePacketNum(encoded), 0);
+		ensure("later ones don't", !(offer.encodePacketNum(1, FALSE) & LL_XFER_WINDOW_FLAG));
+	}
+
+	template<> template<>
+	void llxfer_object::test<3>()
+	{
+		// acks out of order, a packet passed over by later acks and timeouts
+		LLXferWindow window;
+		LLXferSendWindow sender;
+		LLXferSendWindow::packet_list_t resend;
+
+		for (S32 i = 0; i < 6; i++)
+		{
+			ensure("room in the window", sender.canSend(i, 6));
+			sender.packetSent(i, 0.0);
+		}
+		ensure("window full", !sender.canSend(6, 6));
+
+		ensure("ack 0", sender.packetAcked(0, 0.2, window, resend));
+		ensure("duplicate ack", !sender.packetAcked(0, 0.2, window, resend));
+		ensure("ack 2", sender.packetAcked(2, 0.2, window, resend));
+		ensure("ack 3", sender.packetAcked(3, 0.2, window, resend));
+		ensure("1 not lost yet", resend.empty());
+		ensure("ack 4", sender.packetAcked(4, 0.2, window, resend));
+		ensure_equals("1 passed over", resend.size(), (size_t)1);
+		ensure_equals("resend 1", resend[0], 1);
+		ensure_equals("in flight", sender.getNumInFlight(), 2);
+		ensure("timeout from round trips", window.getTimeout() < 3.f);
+
+		sender.packetSent(1, 0.2);
+		resend.clear();
+		ensure("ack 5", sender.packetAcked(5, 0.3, window, resend));
+		ensure("resent 1 went out after 5", resend.empty());
+
+		ensure("first timeout", sender.checkTimeouts(10.0, window, 2, resend));
+		ensure_equals("resend overdue", resend.size(), (size_t)1);
+		sender.packetSent(1, 10.0);
+		resend.clear();
+		ensure("out of retries", !sender.checkTimeouts(20.0, window, 2, resend));
+	}
+
+	template<> template<>
+	void llxfer_object::test<4>()
+	{
+		// early packets are held until their turn, too early ones refused
+		LLXferReceiveWindow receiver;
+		char data[] = { 'a', 'b', 'c' };
+		std::vector<char> out;
+		BOOL is_last = FALSE;
+
+		ensure("not early", !receiver.add(3, 3, FALSE, &data[0], 1));
+		ensure("too early", !receiver.add(3, 3 + LL_XFER_MAX_WINDOW, FALSE, &data[0], 1));
+		ensure("early", receiver.add(3, 5, TRUE, &data[2], 1));
+		ensure("early", receiver.add(3, 4, FALSE, &data[1], 1));
+		ensure("duplicate", receiver.add(3, 4, FALSE, &data[0], 1));
+		ensure_equals("buffered", receiver.getNumBuffered(), 2);
+
+		ensure("3 hasn't arrived", !receiver.takeNext(3, out, is_last));
+		ensure("4", receiver.takeNext(4, out, is_last));
+		ensure_equals("4 data", out[0], 'b');
+		ensure("4 isn't last", !is_last);
+		ensure("5", receiver.takeNext(5, out, is_last));
+		ensure_equals("5 data", out[0], 'c');
+		ensure("5 is last", is_last);
+		ensure_equals("empty", receiver.getNumBuffered(), 0);
+	}
+
+	template<> template<>
+	void llxfer_object::test<5>()
+	{
+		// a 500 packet xfer over 100ms each way with 3% loss each way,
+		// one packet at a time like an old peer and then windowed
+		const S32 NUM_PACKETS = 500;
+		F64 stop_and_wait = runXfer(NUM_PACKETS, 0.1f, 0.03f, 1);
+		F64 windowed = runXfer(NUM_PACKETS, 0.1f, 0.03f, LL_XFER_MAX_WINDOW);
+		ensure("stop and wait finished", stop_and_wait > 0.0);
+		ensure("windowed finished", windowed > 0.0);
+
+		llinfos << NUM_PACKETS << " packets over a lossy 200ms round trip: stop and wait "
+				<< stop_and_wait << "s (" << NUM_PACKETS / stop_and_wait << " packets/s), windowed "
+				<< windowed << "s (" << NUM_PACKETS / windowed << " packets/s)" << llendl;
+		ensure("window pays off", windowed * 3.0 < stop_and_wait);
+
+		// no loss at all, every packet still arrives exactly once
+		ensure("lossless", runXfer(NUM_PACKETS, 0.05f, 0.f, LL_XFER_MAX_WINDOW) > 0.0);
+	}
 }
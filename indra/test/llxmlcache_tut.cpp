@@ -0,0 +1,211 @@
+/**
+ * @file llxmlcache_tut.cpp
+ * @date 2010-07
+ * @brief LLXMLCache test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ *
+ * Copyright (c) 2010, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llxmlcache.h"
+#include "llsd.h"
+#include "llmd5.h"
+#include "llsdserialize.h"
+#include "lluuid.h"
+
+#include <iterator>
+#include <sstream>
+
+namespace tut
+{
+	struct xmlcache_data
+	{
+		xmlcache_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream dir;
+			dir << "/tmp/llxmlcache-test-" << random;
+			mTestDir = dir.str();
+			LLFile::mkdir(mTestDir);
+			LLXMLCache::setCacheDir(mTestDir + "/cache");
+		}
+		~xmlcache_data()
+		{
+			LLXMLCache::setCacheDir("");
+		}
+
+		void writeFile(const std::string& filename, const std::string& contents)
+		{
+			llofstream file(filename, std::ios::binary);
+			file << contents;
+			file.close();
+		}
+
+		// a floater with num_controls widgets in it, in the usual XUI style
+		std::string makeFloater(S32 num_controls)
+		{
+			std::ostringstream xml;
+			xml << "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+				<< "<floater name=\"test\" title=\"Test\" width=\"400\" height=\"300\" can_resize=\"true\">\n";
+			for (S32 i = 0; i < num_controls; i++)
+			{
+				xml << "\t<check_box name=\"check" << i << "\" label=\"Check &amp; box " << i
+					<< "\" left=\"10\" bottom=\"-" << i * 20 << "\" width=\"100\" height=\"16\" follows=\"left|top\" />\n"
+					<< "\t<text name=\"text" << i << "\" type=\"string\" length=\"1\">\n\t\tSome text " << i << "\n\t</text>\n";
+			}
+			xml << "</floater>\n";
+			return xml.str();
+		}
+
+		static std::string toString(LLXMLNodePtr node)
+		{
+			std::ostringstream out;
+			node->writeToOstream(out);
+			return out.str();
+		}
+
+		std::string mTestDir;
+	};
+	typedef test_group<xmlcache_data> xmlcache_test;
+	typedef xmlcache_test::object xmlcache_object;
+	tut::xmlcache_test xmlcache_testcase("xmlcache");
+
+	template<> template<>
+	void xmlcache_object::test<1>()
+	{
+		std::string filename = mTestDir + "/floater_test.xml";
+		writeFile(filename, makeFloater(10));
+
+		LLXMLNodePtr parsed;
+		ensure("parsed", LLXMLNode::parseFile(filename, parsed, NULL));
+
+		S32 misses = LLXMLCache::sMisses;
+		S32 hits = LLXMLCache::sHits;
+		LLXMLNodePtr first;
+		ensure("first read", LLXMLCache::parseFile(filename, first, NULL));
+		ensure_equals("missed", LLXMLCache::sMisses, misses + 1);
+		LLXMLNodePtr second;
+		ensure("second read", LLXMLCache::parseFile(filename, second, NULL));
+		ensure_equals("hit", LLXMLCache::sHits, hits + 1);
+
+		ensure_equals("same as parsed", toString(first), toString(parsed));
+		ensure_equals("same from cache", toString(second), toString(parsed));
+
+		// what the XUI code looks at
+		std::string title;
+		ensure("attribute", second->getAttributeString("title", title));
+		ensure_equals("title", title, std::string("Test"));
+		LLXMLNodePtr child = second->getFirstChild();
+		ensure("first child", child.notNull() && child->hasName("check_box"));
+		child = child->getNextSibling();
+		ensure("in order", child.notNull() && child->hasName("text"));
+		ensure_equals("type", child->getType(), LLXMLNode::TYPE_STRING);
+		ensure_equals("length", child->getLength(), (U32)1);
+		ensure_equals("text", child->getTextContents(), std::string("Some text 0"));
+	}
+
+	template<> template<>
+	void xmlcache_object::test<2>()
+	{
+		std::string filename = mTestDir + "/floater_test.xml";
+		writeFile(filename, makeFloater(10));
+		LLXMLNodePtr node;
+		ensure("cached", LLXMLCache::parseFile(filename, node, NULL));
+
+		// a changed file isn't read from the cache
+		writeFile(filename, makeFloater(11));
+		S32 misses = LLXMLCache::sMisses;
+		ensure("changed", LLXMLCache::parseFile(filename, node, NULL));
+		ensure_equals("missed", LLXMLCache::sMisses, misses + 1);
+		ensure_equals("new contents", node->getChildCount(), (U32)22);
+
+		// nor is a damaged one
+		LLXMLNodePtr parsed;
+		LLXMLNode::parseFile(filename, parsed, NULL);
+		char digest[33];
+		LLMD5((const unsigned char*)filename.c_str()).hex_digest(digest);
+		std::string cache_filename = LLXMLCache::getCacheDir() + "/" + digest + ".xmlc";
+		llifstream cache_file(cache_filename, std::ios::binary);
+		ensure("cache file", cache_file.is_open());
+		std::string cached((std::istreambuf_iterator<char>(cache_file)), std::istreambuf_iterator<char>());
+		cache_file.close();
+		writeFile(cache_filename, cached.substr(0, cached.size() / 2));
+		misses = LLXMLCache::sMisses;
+		ensure("still parses", LLXMLCache::parseFile(filename, node, NULL));
+		ensure_equals("missed again", LLXMLCache::sMisses, misses + 1);
+		ensure_equals("same contents", toString(node), toString(parsed));
+	}
+
+	template<> template<>
+	void xmlcache_object::test<3>()
+	{
+		std::string filename = mTestDir + "/settings.xml";
+		LLSD settings;
+		settings["RenderFarClip"]["Type"] = "F32";
+		settings["RenderFarClip"]["Value"] = 128.0;
+		settings["Include"].append("settings_other.xml");
+		settings["Name"]["Value"] = "A string with <markup> & stuff";
+		llofstream file(filename);
+		LLSDSerialize::toPrettyXML(settings, file);
+		file.close();
+
+		LLSD first;
+		ensure("first read", LLXMLCache::loadLLSD(filename, first) > 0);
+		S32 hits = LLXMLCache::sHits;
+		LLSD second;
+		ensure("second read", LLXMLCache::loadLLSD(filename, second) > 0);
+		ensure_equals("hit", LLXMLCache::sHits, hits + 1);
+		ensure_equals("same", second, first);
+		ensure_equals("string", second["Name"]["Value"].asString(), std::string("A string with <markup> & stuff"));
+
+		LLSD missing;
+		ensure("missing", LLXMLCache::loadLLSD(mTestDir + "/missing.xml", missing) <= 0);
+	}
+
+	template<> template<>
+	void xmlcache_object::test<4>()
+	{
+		// a big floater comes back from the cache the same as it parses
+		std::string filename = mTestDir + "/floater_big.xml";
+		writeFile(filename, makeFloater(500));
+
+		LLXMLNodePtr parsed;
+		ensure("parsed", LLXMLNode::parseFile(filename, parsed, NULL));
+
+		LLXMLNodePtr node;
+		ensure("first read", LLXMLCache::parseFile(filename, node, NULL));
+		S32 hits = LLXMLCache::sHits;
+		ensure("second read", LLXMLCache::parseFile(filename, node, NULL));
+		ensure_equals("hit", LLXMLCache::sHits, hits + 1);
+		ensure_equals("widgets", node->getChildCount(), (U32)1000);
+		ensure_equals("same as parsed", toString(node), toString(parsed));
+	}
+}